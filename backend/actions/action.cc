@@ -16,11 +16,20 @@
 
 #include "backend/actions/action.h"
 
+#include <memory>
 #include <variant>
 
 #include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/types/span.h"
+#include "backend/actions/context.h"
 #include "backend/actions/ops.h"
+#include "backend/common/rows.h"
+#include "backend/datamodel/key_range.h"
+#include "backend/schema/catalog/column.h"
+#include "backend/storage/iterator.h"
 #include "absl/status/status.h"
+#include "zetasql/base/status_macros.h"
 
 namespace google {
 namespace spanner {
@@ -75,27 +84,53 @@ absl::Status Modifier::Modify(const ActionContext* ctx,
 
 absl::Status Effector::Effect(const ActionContext* ctx,
                               const WriteOp& op) const {
-  return std::visit(overloaded{
-                        [&](const InsertOp& op) { return Effect(ctx, op); },
-                        [&](const UpdateOp& op) { return Effect(ctx, op); },
-                        [&](const DeleteOp& op) { return Effect(ctx, op); },
-                    },
-                    op);
+  ZETASQL_ASSIGN_OR_RETURN(Row base_row,
+                   ReadBaseRow(ctx, op, BaseRowColumns(op)));
+  return Effect(ctx, op, base_row);
+}
+
+absl::Status Effector::Effect(const ActionContext* ctx, const WriteOp& op,
+                              const Row& base_row) const {
+  return std::visit(
+      overloaded{
+          [&](const InsertOp& op) { return Effect(ctx, op); },
+          [&](const UpdateOp& op) { return Effect(ctx, op, base_row); },
+          [&](const DeleteOp& op) { return Effect(ctx, op, base_row); },
+      },
+      op);
 }
 
 absl::Status Effector::Effect(const ActionContext* ctx,
                               const InsertOp& op) const {
   return absl::OkStatus();
 }
-absl::Status Effector::Effect(const ActionContext* ctx,
-                              const UpdateOp& op) const {
+absl::Status Effector::Effect(const ActionContext* ctx, const UpdateOp& op,
+                              const Row& base_row) const {
   return absl::OkStatus();
 }
-absl::Status Effector::Effect(const ActionContext* ctx,
-                              const DeleteOp& op) const {
+absl::Status Effector::Effect(const ActionContext* ctx, const DeleteOp& op,
+                              const Row& base_row) const {
   return absl::OkStatus();
 }
 
+absl::StatusOr<Row> ReadBaseRow(const ActionContext* ctx, const WriteOp& op,
+                                absl::Span<const Column* const> columns) {
+  Row base_row;
+  if (columns.empty() || std::holds_alternative<InsertOp>(op)) {
+    return base_row;
+  }
+  ZETASQL_ASSIGN_OR_RETURN(
+      std::unique_ptr<StorageIterator> itr,
+      ctx->store()->Read(TableOf(op), KeyRange::Point(KeyOf(op)), columns));
+  if (itr->Next()) {
+    for (int i = 0; i < itr->NumColumns(); ++i) {
+      base_row[columns[i]] = itr->ColumnValue(i);
+    }
+  }
+  ZETASQL_RETURN_IF_ERROR(itr->Status());
+  return base_row;
+}
+
 absl::Status Verifier::Verify(const ActionContext* ctx,
                               const WriteOp& op) const {
   return std::visit(overloaded{
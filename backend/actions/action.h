@@ -18,10 +18,15 @@
 #define THIRD_PARTY_CLOUD_SPANNER_EMULATOR_BACKEND_ACTIONS_ACTION_H_
 
 #include <string>
+#include <vector>
 
 #include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/types/span.h"
 #include "backend/actions/context.h"
 #include "backend/actions/ops.h"
+#include "backend/common/rows.h"
+#include "backend/schema/catalog/column.h"
 #include "backend/schema/catalog/table.h"
 #include "absl/status/status.h"
 
@@ -128,23 +133,47 @@ class Modifier {
 //       return absl::OkStatus();
 //     }
 //   };
+//
+// Effectors which need the contents of a row before it is updated or deleted
+// return the columns they need from BaseRowColumns, rather than reading the row
+// themselves. This lets all the effectors of a table share a single read of the
+// row (see ActionRegistry::ExecuteEffectors).
 class Effector {
  public:
   virtual ~Effector() {}
 
   // Creates additional WriteOp(s) based on the given WriteOp within the give
-  // action context.
+  // action context, reading the base row of the WriteOp first.
   absl::Status Effect(const ActionContext* ctx, const WriteOp& op) const;
 
+  // Creates additional WriteOp(s) based on the given WriteOp within the give
+  // action context. 'base_row' holds the values of the row written by 'op'
+  // before 'op' is applied, for at least the columns returned by
+  // BaseRowColumns(op). It is empty if the row does not exist.
+  absl::Status Effect(const ActionContext* ctx, const WriteOp& op,
+                      const Row& base_row) const;
+
+  // Returns the columns of the row written by 'op' which the effector reads
+  // before 'op' is applied. Empty if the effector does not read the row.
+  virtual std::vector<const Column*> BaseRowColumns(const WriteOp& op) const {
+    return {};
+  }
+
  private:
   virtual absl::Status Effect(const ActionContext* ctx,
                               const InsertOp& op) const;
-  virtual absl::Status Effect(const ActionContext* ctx,
-                              const UpdateOp& op) const;
-  virtual absl::Status Effect(const ActionContext* ctx,
-                              const DeleteOp& op) const;
+  virtual absl::Status Effect(const ActionContext* ctx, const UpdateOp& op,
+                              const Row& base_row) const;
+  virtual absl::Status Effect(const ActionContext* ctx, const DeleteOp& op,
+                              const Row& base_row) const;
 };
 
+// Returns the values of 'columns' in the row written by 'op', as seen by the
+// actions before 'op' is applied. Returns an empty row if the row does not
+// exist, or if 'op' is an InsertOp or 'columns' is empty.
+absl::StatusOr<Row> ReadBaseRow(const ActionContext* ctx, const WriteOp& op,
+                                absl::Span<const Column* const> columns);
+
 // A Verifier verifies whether some database constraint is met. This
 // executes at the end of the statement or transaction.
 class Verifier {
@@ -22,6 +22,7 @@
 #include <memory>
 #include <string>
 #include <utility>
+#include <variant>
 #include <vector>
 
 #include "zetasql/public/analyzer_options.h"
@@ -39,12 +40,11 @@
 #include "backend/actions/ops.h"
 #include "backend/common/graph_dependency_helper.h"
 #include "backend/common/ids.h"
+#include "backend/common/rows.h"
 #include "backend/datamodel/key.h"
-#include "backend/datamodel/key_range.h"
 #include "backend/query/analyzer_options.h"
 #include "backend/schema/catalog/column.h"
 #include "backend/schema/catalog/table.h"
-#include "backend/storage/iterator.h"
 #include "common/constants.h"
 #include "common/errors.h"
 #include "zetasql/base/ret_check.h"
@@ -279,32 +279,48 @@ absl::Status EvaluatedColumnEffector::Effect(const ActionContext* ctx,
                 /*apply_on_update=*/false);
 }
 
-absl::Status EvaluatedColumnEffector::Effect(const ActionContext* ctx,
-                                             const UpdateOp& op) const {
-  bool apply_on_update = false;
+bool EvaluatedColumnEffector::IsEvaluatedColumnEffect(
+    const UpdateOp& op, bool* apply_on_update) const {
+  *apply_on_update = false;
   for (const Column* column : op.columns) {
     // If any non-key generated columns appear then this is a generated column
     // effect and we do not need to process it again. The non-key requirement is
     // needed because user-generated updates are expected to include key values,
     // including generated ones.
     if (!IsKeyColumn(column)) {
-      apply_on_update = true;
+      *apply_on_update = true;
       if (column->is_generated()) {
-        return absl::OkStatus();
+        return true;
       }
     }
   }
+  return false;
+}
+
+std::vector<const Column*> EvaluatedColumnEffector::BaseRowColumns(
+    const WriteOp& op) const {
+  bool apply_on_update;
+  if (!std::holds_alternative<UpdateOp>(op) ||
+      IsEvaluatedColumnEffect(std::get<UpdateOp>(op), &apply_on_update)) {
+    return {};
+  }
+  return dependent_columns_;
+}
+
+absl::Status EvaluatedColumnEffector::Effect(const ActionContext* ctx,
+                                             const UpdateOp& op,
+                                             const Row& base_row) const {
+  bool apply_on_update;
+  if (IsEvaluatedColumnEffect(op, &apply_on_update)) {
+    return absl::OkStatus();
+  }
 
   zetasql::ParameterValueMap column_values;
-  ZETASQL_ASSIGN_OR_RETURN(
-      std::unique_ptr<StorageIterator> itr,
-      ctx->store()->Read(table_, KeyRange::Point(op.key), dependent_columns_));
-  ZETASQL_RET_CHECK(itr->Next());
-  ZETASQL_RETURN_IF_ERROR(itr->Status());
   ZETASQL_RET_CHECK_EQ(op.columns.size(), op.values.size());
-  ZETASQL_RET_CHECK_EQ(itr->NumColumns(), dependent_columns_.size());
-  for (int i = 0; i < dependent_columns_.size(); ++i) {
-    column_values[dependent_columns_[i]->Name()] = itr->ColumnValue(i);
+  for (const Column* column : dependent_columns_) {
+    auto it = base_row.find(column);
+    ZETASQL_RET_CHECK(it != base_row.end());
+    column_values[column->Name()] = it->second;
   }
   for (int i = 0; i < op.columns.size(); ++i) {
     column_values[op.columns[i]->Name()] = op.values[i];
@@ -29,6 +29,7 @@
 #include "backend/access/write.h"
 #include "backend/actions/action.h"
 #include "backend/actions/ops.h"
+#include "backend/common/rows.h"
 #include "backend/schema/catalog/table.h"
 #include "absl/status/status.h"
 
@@ -64,18 +65,25 @@ class EvaluatedColumnEffector : public Effector {
       std::vector<std::vector<zetasql::Value>>* evaluated_values,
       std::vector<const Column*>* columns_with_evaluated_values) const;
 
+  std::vector<const Column*> BaseRowColumns(const WriteOp& op) const override;
+
  private:
   absl::Status Initialize(const zetasql::AnalyzerOptions& analyzer_options,
                           zetasql::Catalog* function_catalog);
   absl::Status Effect(const ActionContext* ctx,
                       const InsertOp& op) const override;
-  absl::Status Effect(const ActionContext* ctx,
-                      const UpdateOp& op) const override;
-  absl::Status Effect(const ActionContext* ctx,
-                      const DeleteOp& op) const override {
+  absl::Status Effect(const ActionContext* ctx, const UpdateOp& op,
+                      const Row& base_row) const override;
+  absl::Status Effect(const ActionContext* ctx, const DeleteOp& op,
+                      const Row& base_row) const override {
     return absl::OkStatus();
   }
 
+  // Returns true if 'op' is itself the effect of an earlier update of this
+  // table's evaluated columns, so that it must not be processed again. Sets
+  // 'apply_on_update' if 'op' updates any non-key column.
+  bool IsEvaluatedColumnEffect(const UpdateOp& op, bool* apply_on_update) const;
+
   absl::Status Effect(const ActionContext* ctx, const Key& key,
                       zetasql::ParameterValueMap* column_values,
                       bool is_update_op, bool apply_on_update) const;
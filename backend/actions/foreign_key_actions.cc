@@ -20,6 +20,7 @@
 #include <iterator>
 #include <memory>
 #include <optional>
+#include <variant>
 #include <vector>
 
 #include "zetasql/public/value.h"
@@ -30,6 +31,7 @@
 #include "backend/actions/context.h"
 #include "backend/actions/ops.h"
 #include "backend/common/case.h"
+#include "backend/common/rows.h"
 #include "backend/datamodel/key.h"
 #include "backend/datamodel/key_range.h"
 #include "backend/schema/catalog/column.h"
@@ -250,25 +252,34 @@ absl::Status ForeignKeyActionEffector::EffectForUnorderedReferencedKey(
 }
 
 absl::Status ForeignKeyActionEffector::EffectForNonPKReferencedKey(
-    const ActionContext* ctx, const DeleteOp& op) const {
-  // Read the values of all non-key columns in the referenced table that is
-  // referenced by a foreign key.
-  ZETASQL_ASSIGN_OR_RETURN(std::unique_ptr<StorageIterator> itr,
-                   ctx->store()->Read(foreign_key_->referenced_table(),
-                                      KeyRange::Prefix(op.key),
-                                      foreign_key_->referenced_columns()));
-  while (itr->Next()) {
-    Key referenced_key;
-    for (int i = 0; i < itr->NumColumns(); ++i) {
-      referenced_key.AddColumn(itr->ColumnValue(i));
-    }
-    ZETASQL_RETURN_IF_ERROR(ProcessDeleteByKey(ctx, referenced_key));
+    const ActionContext* ctx, const Row& base_row) const {
+  // The values of the columns in the referenced table that are referenced by
+  // the foreign key, if the deleted row exists.
+  if (base_row.empty()) {
+    return absl::OkStatus();
   }
-  return absl::OkStatus();
+  Key referenced_key;
+  for (const Column* column : foreign_key_->referenced_columns()) {
+    referenced_key.AddColumn(base_row.at(column));
+  }
+  return ProcessDeleteByKey(ctx, referenced_key);
+}
+
+std::vector<const Column*> ForeignKeyActionEffector::BaseRowColumns(
+    const WriteOp& op) const {
+  // Only deletes by a referenced key which is not a primary key prefix need the
+  // values of the deleted row.
+  if (!std::holds_alternative<DeleteOp>(op) ||
+      referenced_key_prefix_shape_ != FKPrefixShape::kNone) {
+    return {};
+  }
+  absl::Span<const Column* const> columns = foreign_key_->referenced_columns();
+  return std::vector<const Column*>(columns.begin(), columns.end());
 }
 
 absl::Status ForeignKeyActionEffector::Effect(const ActionContext* ctx,
-                                              const DeleteOp& op) const {
+                                              const DeleteOp& op,
+                                              const Row& base_row) const {
   switch (referenced_key_prefix_shape_) {
     case FKPrefixShape::kInOrder:
       ZETASQL_RETURN_IF_ERROR(ProcessDeleteByKey(ctx, op.key));
@@ -283,7 +294,7 @@ absl::Status ForeignKeyActionEffector::Effect(const ActionContext* ctx,
       ZETASQL_RETURN_IF_ERROR(EffectForUnorderedReferencedKey(ctx, op));
       break;
     case FKPrefixShape::kNone:
-      ZETASQL_RETURN_IF_ERROR(EffectForNonPKReferencedKey(ctx, op));
+      ZETASQL_RETURN_IF_ERROR(EffectForNonPKReferencedKey(ctx, base_row));
       break;
   }
   return absl::OkStatus();
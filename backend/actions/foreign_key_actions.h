@@ -17,11 +17,15 @@
 #ifndef THIRD_PARTY_CLOUD_SPANNER_EMULATOR_BACKEND_ACTIONS_FOREIGN_KEY_ACTIONS_H_
 #define THIRD_PARTY_CLOUD_SPANNER_EMULATOR_BACKEND_ACTIONS_FOREIGN_KEY_ACTIONS_H_
 
+#include <vector>
+
 #include "absl/status/status.h"
 #include "backend/actions/action.h"
 #include "backend/actions/context.h"
 #include "backend/actions/ops.h"
+#include "backend/common/rows.h"
 #include "backend/datamodel/key.h"
+#include "backend/schema/catalog/column.h"
 #include "backend/schema/catalog/foreign_key.h"
 #include "backend/schema/catalog/table.h"
 
@@ -44,13 +48,15 @@ class ForeignKeyActionEffector : public Effector {
  public:
   explicit ForeignKeyActionEffector(const ForeignKey* foreign_key);
 
+  std::vector<const Column*> BaseRowColumns(const WriteOp& op) const override;
+
  private:
-  absl::Status Effect(const ActionContext* ctx,
-                      const DeleteOp& op) const override;
+  absl::Status Effect(const ActionContext* ctx, const DeleteOp& op,
+                      const Row& base_row) const override;
   absl::Status EffectForUnorderedReferencedKey(const ActionContext* ctx,
                                                const DeleteOp& op) const;
   absl::Status EffectForNonPKReferencedKey(const ActionContext* ctx,
-                                           const DeleteOp& op) const;
+                                           const Row& base_row) const;
   // Retrive all rows in the referencing table that reference the foreign key,
   // and then delete those rows.
   absl::Status ProcessDeleteByKey(const ActionContext* ctx,
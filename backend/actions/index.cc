@@ -16,11 +16,14 @@
 
 #include "backend/actions/index.h"
 
+#include <algorithm>
 #include <iterator>
+#include <variant>
 #include <vector>
 
 #include "absl/status/statusor.h"
 #include "backend/common/indexing.h"
+#include "backend/common/rows.h"
 #include "backend/schema/catalog/column.h"
 #include "backend/schema/catalog/index.h"
 #include "backend/schema/catalog/table.h"
@@ -33,28 +36,6 @@ namespace spanner {
 namespace emulator {
 namespace backend {
 
-namespace {
-
-// Returns the row from the indexed table for the given key.
-absl::StatusOr<Row> ReadBaseTableRow(
-    const ActionContext* ctx, const Table* table, const Key& key,
-    const std::vector<const Column*>& base_columns) {
-  ZETASQL_ASSIGN_OR_RETURN(
-      std::unique_ptr<StorageIterator> itr,
-      ctx->store()->Read(table, KeyRange::Point(key), base_columns));
-
-  Row base_row;
-  if (itr->Next()) {
-    for (int i = 0; i < itr->NumColumns(); ++i) {
-      base_row[base_columns[i]] = itr->ColumnValue(i);
-    }
-  }
-  ZETASQL_RETURN_IF_ERROR(itr->Status());
-  return base_row;
-}
-
-}  // namespace
-
 IndexEffector::IndexEffector(const Index* index) : index_(index) {
   // Save the base table columns corresponding to the index data table.
   for (const Column* column : index->index_data_table()->columns()) {
@@ -78,11 +59,34 @@ absl::Status IndexEffector::Effect(const ActionContext* ctx,
   return absl::OkStatus();
 }
 
-absl::Status IndexEffector::Effect(const ActionContext* ctx,
-                                   const UpdateOp& op) const {
-  // Read the current base row values from the indexed table.
-  ZETASQL_ASSIGN_OR_RETURN(Row base_row,
-                   ReadBaseTableRow(ctx, op.table, op.key, base_columns_));
+std::vector<const Column*> IndexEffector::BaseRowColumns(
+    const WriteOp& op) const {
+  if (std::holds_alternative<InsertOp>(op) ||
+      (std::holds_alternative<UpdateOp>(op) &&
+       !UpdatesIndexedColumns(std::get<UpdateOp>(op)))) {
+    return {};
+  }
+  return base_columns_;
+}
+
+bool IndexEffector::UpdatesIndexedColumns(const UpdateOp& op) const {
+  return std::any_of(op.columns.begin(), op.columns.end(),
+                     [this](const Column* column) {
+                       return std::find(base_columns_.begin(),
+                                        base_columns_.end(),
+                                        column) != base_columns_.end();
+                     });
+}
+
+absl::Status IndexEffector::Effect(const ActionContext* ctx, const UpdateOp& op,
+                                   const Row& base_row) const {
+  // Updates which do not touch the indexed columns leave the index entry
+  // unchanged, and do not need to lock it or the indexed columns.
+  if (!UpdatesIndexedColumns(op)) {
+    return absl::OkStatus();
+  }
+
+  // The current base row values from the indexed table.
   if (base_row.empty()) {
     return error::Internal(
         absl::StrCat("Missing row from base table when an Update index effect "
@@ -96,13 +100,20 @@ absl::Status IndexEffector::Effect(const ActionContext* ctx,
     ctx->effects()->Delete(index_->index_data_table(), old_index_key);
   }
 
-  // Patch new values into value map.
+  // Patch new values into the index's columns of the base row, which may be
+  // shared with other effectors.
+  Row new_row;
+  for (const Column* column : base_columns_) {
+    new_row[column] = base_row.at(column);
+  }
   for (int i = 0; i < op.columns.size(); ++i) {
-    base_row[op.columns[i]] = op.values[i];
+    if (new_row.contains(op.columns[i])) {
+      new_row[op.columns[i]] = op.values[i];
+    }
   }
-  ZETASQL_ASSIGN_OR_RETURN(Key new_index_key, ComputeIndexKey(base_row, index_));
-  ValueList index_values = ComputeIndexValues(base_row, index_);
-  if (ShouldFilterIndexKeyOrValue(index_, new_index_key, base_row)) {
+  ZETASQL_ASSIGN_OR_RETURN(Key new_index_key, ComputeIndexKey(new_row, index_));
+  ValueList index_values = ComputeIndexValues(new_row, index_);
+  if (ShouldFilterIndexKeyOrValue(index_, new_index_key, new_row)) {
     return absl::OkStatus();
   }
 
@@ -112,12 +123,8 @@ absl::Status IndexEffector::Effect(const ActionContext* ctx,
   return absl::OkStatus();
 }
 
-absl::Status IndexEffector::Effect(const ActionContext* ctx,
-                                   const DeleteOp& op) const {
-  // Read base row values.
-  ZETASQL_ASSIGN_OR_RETURN(Row base_row,
-                   ReadBaseTableRow(ctx, op.table, op.key, base_columns_));
-
+absl::Status IndexEffector::Effect(const ActionContext* ctx, const DeleteOp& op,
+                                   const Row& base_row) const {
   // Did not find an entry to delete from the index.
   if (base_row.empty()) {
     return absl::OkStatus();
@@ -17,8 +17,12 @@
 #ifndef THIRD_PARTY_CLOUD_SPANNER_EMULATOR_BACKEND_ACTIONS_INDEX_H_
 #define THIRD_PARTY_CLOUD_SPANNER_EMULATOR_BACKEND_ACTIONS_INDEX_H_
 
+#include <vector>
+
 #include "backend/actions/action.h"
 #include "backend/actions/ops.h"
+#include "backend/common/rows.h"
+#include "backend/schema/catalog/column.h"
 #include "backend/schema/catalog/table.h"
 #include "absl/status/status.h"
 
@@ -44,13 +48,18 @@ class IndexEffector : public Effector {
  public:
   explicit IndexEffector(const Index* index);
 
+  std::vector<const Column*> BaseRowColumns(const WriteOp& op) const override;
+
  private:
   absl::Status Effect(const ActionContext* ctx,
                       const InsertOp& op) const override;
-  absl::Status Effect(const ActionContext* ctx,
-                      const UpdateOp& op) const override;
-  absl::Status Effect(const ActionContext* ctx,
-                      const DeleteOp& op) const override;
+  absl::Status Effect(const ActionContext* ctx, const UpdateOp& op,
+                      const Row& base_row) const override;
+  absl::Status Effect(const ActionContext* ctx, const DeleteOp& op,
+                      const Row& base_row) const override;
+
+  // Returns true if 'op' updates a column relevant to the index.
+  bool UpdatesIndexedColumns(const UpdateOp& op) const;
 
   const Index* index_;
 
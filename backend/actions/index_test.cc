@@ -27,6 +27,7 @@
 #include "absl/types/variant.h"
 #include "backend/actions/context.h"
 #include "backend/actions/ops.h"
+#include "backend/common/rows.h"
 #include "tests/common/actions.h"
 #include "tests/common/schema_constructor.h"
 #include "tests/common/scoped_feature_flags_setter.h"
@@ -99,6 +100,26 @@ TEST_F(IndexTest, DeleteCascadesToIndexEntry) {
           index_->index_data_table(), Key({String("value"), Int64(1)})}));
 }
 
+TEST_F(IndexTest, DeleteUsesGivenBaseRow) {
+  // Inserts are computed from the row operation alone.
+  WriteOp insert = Insert(table_, Key({Int64(1)}), base_columns_,
+                          {Int64(1), String("value"), Null(StringType())});
+  EXPECT_TRUE(effector_->BaseRowColumns(insert).empty());
+  EXPECT_EQ(effector_->BaseRowColumns(Delete(table_, Key({Int64(1)}))).size(),
+            index_columns_.size());
+
+  // The base row is not read again from the store, which is empty.
+  Row base_row =
+      MakeRow(base_columns_, {Int64(1), String("value"), String("value2")});
+  ZETASQL_EXPECT_OK(
+      effector_->Effect(ctx(), Delete(table_, Key({Int64(1)})), base_row));
+  ASSERT_EQ(effects_buffer()->ops_queue()->size(), 1);
+  EXPECT_THAT(
+      effects_buffer()->ops_queue()->front(),
+      testing::VariantWith<DeleteOp>(DeleteOp{
+          index_->index_data_table(), Key({String("value"), Int64(1)})}));
+}
+
 TEST_F(IndexTest, InsertCascadesToIndexEntry) {
   // Insert base table entry.
   ZETASQL_EXPECT_OK(effector_->Effect(
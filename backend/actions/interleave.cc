@@ -67,7 +67,8 @@ InterleaveParentEffector::InterleaveParentEffector(const Table* parent,
       on_delete_action_(child->on_delete_action()) {}
 
 absl::Status InterleaveParentEffector::Effect(const ActionContext* ctx,
-                                              const DeleteOp& op) const {
+                                              const DeleteOp& op,
+                                              const Row& base_row) const {
   switch (on_delete_action_) {
     case Table::OnDeleteAction::kNoAction: {
       return absl::OkStatus();
@@ -63,8 +63,8 @@ class InterleaveParentEffector : public Effector {
   InterleaveParentEffector(const Table* parent, const Table* child);
 
  private:
-  absl::Status Effect(const ActionContext* ctx,
-                      const DeleteOp& op) const override;
+  absl::Status Effect(const ActionContext* ctx, const DeleteOp& op,
+                      const Row& base_row) const override;
 
   const Table* parent_;
   const Table* child_;
@@ -40,6 +40,7 @@
 #include "backend/actions/interleave.h"
 #include "backend/actions/ops.h"
 #include "backend/actions/unique_index.h"
+#include "backend/common/rows.h"
 #include "backend/query/analyzer_options.h"
 #include "backend/query/function_catalog.h"
 #include "backend/schema/catalog/check_constraint.h"
@@ -66,8 +67,24 @@ absl::Status ActionRegistry::ExecuteValidators(const ActionContext* ctx,
 
 absl::Status ActionRegistry::ExecuteEffectors(const ActionContext* ctx,
                                               const WriteOp& op) {
-  for (auto& effector : table_effectors_[TableOf(op)]) {
-    ZETASQL_RETURN_IF_ERROR(effector->Effect(ctx, op));
+  const auto& effectors = table_effectors_[TableOf(op)];
+
+  // Effects are buffered rather than applied, so every effector sees the same
+  // contents of the written row. Read the union of the columns they need once,
+  // rather than once per index or foreign key.
+  std::vector<const Column*> base_columns;
+  absl::flat_hash_set<const Column*> seen_columns;
+  for (auto& effector : effectors) {
+    for (const Column* column : effector->BaseRowColumns(op)) {
+      if (seen_columns.insert(column).second) {
+        base_columns.push_back(column);
+      }
+    }
+  }
+  ZETASQL_ASSIGN_OR_RETURN(Row base_row, ReadBaseRow(ctx, op, base_columns));
+
+  for (auto& effector : effectors) {
+    ZETASQL_RETURN_IF_ERROR(effector->Effect(ctx, op, base_row));
   }
   return absl::OkStatus();
 }
@@ -58,7 +58,8 @@ class ActionRegistry {
   // Executes the list of validators that apply to the given operation.
   absl::Status ExecuteValidators(const ActionContext* ctx, const WriteOp& op);
 
-  // Executes the list of effectors that apply to the given operation.
+  // Executes the list of effectors that apply to the given operation. The row
+  // written by an update or delete is read once, for all the effectors.
   absl::Status ExecuteEffectors(const ActionContext* ctx, const WriteOp& op);
 
   // Executes the evaluated key effector that applies to the given mutation op.
@@ -138,6 +138,15 @@ const Table* TableOf(const WriteOp& op) {
   return std::visit(TableVisitor(), op);
 }
 
+struct KeyVisitor {
+  template <typename OpT>
+  const Key& operator()(const OpT& op) const {
+    return op.key;
+  }
+};
+
+const Key& KeyOf(const WriteOp& op) { return std::visit(KeyVisitor(), op); }
+
 }  // namespace backend
 }  // namespace emulator
 }  // namespace spanner
@@ -82,6 +82,9 @@ using WriteOp = std::variant<InsertOp, UpdateOp, DeleteOp>;
 // Returns the table of the row operation.
 const Table* TableOf(const WriteOp& op);
 
+// Returns the primary key of the row of the row operation.
+const Key& KeyOf(const WriteOp& op);
+
 // Streams out a string representation of the WriteOp.
 std::ostream& operator<<(std::ostream& out, const WriteOp& op);
 std::ostream& operator<<(std::ostream& out, const InsertOp& op);
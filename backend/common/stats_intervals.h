@@ -0,0 +1,104 @@
+//
+// Copyright 2026 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#ifndef THIRD_PARTY_CLOUD_SPANNER_EMULATOR_BACKEND_COMMON_STATS_INTERVALS_H_
+#define THIRD_PARTY_CLOUD_SPANNER_EMULATOR_BACKEND_COMMON_STATS_INTERVALS_H_
+
+#include <vector>
+
+#include "absl/container/btree_map.h"
+#include "absl/time/time.h"
+
+namespace google {
+namespace spanner {
+namespace emulator {
+namespace backend {
+
+// StatsIntervals holds the intervals of a single length into which the
+// SPANNER_SYS statistics tables aggregate their data, keyed by the end of each
+// interval. Only the most recent 'max_intervals' intervals are retained.
+//
+// This class is not thread-safe.
+template <typename Interval>
+class StatsIntervals {
+ public:
+  StatsIntervals(absl::Duration length, int max_intervals)
+      : length_(length), max_intervals_(max_intervals) {}
+
+  // Returns the length of the intervals.
+  absl::Duration length() const { return length_; }
+
+  // Returns the interval containing 'time', adding it if needed. Returns
+  // nullptr if 'time' falls before the retained intervals. The returned
+  // interval is only valid until the next call.
+  Interval* GetOrAdd(absl::Time time) {
+    absl::Time interval_end =
+        absl::UnixEpoch() + absl::Ceil(time - absl::UnixEpoch(), length_);
+    auto [itr, inserted] = intervals_.try_emplace(interval_end);
+    if (inserted && intervals_.size() > max_intervals_) {
+      if (itr == intervals_.begin()) {
+        intervals_.erase(itr);
+        return nullptr;
+      }
+      // Erasing from a btree_map invalidates its iterators.
+      intervals_.erase(intervals_.begin());
+      itr = intervals_.find(interval_end);
+    }
+    return &itr->second;
+  }
+
+  // Returns the retained intervals, keyed by their end.
+  const absl::btree_map<absl::Time, Interval>& intervals() const {
+    return intervals_;
+  }
+
+ private:
+  absl::Duration length_;
+  int max_intervals_;
+  absl::btree_map<absl::Time, Interval> intervals_;
+};
+
+// Returns the minute, 10 minute and hour intervals reported by the SPANNER_SYS
+// statistics tables, retained for as long as Cloud Spanner retains them.
+template <typename Interval>
+std::vector<StatsIntervals<Interval>> MakeStatsIntervals() {
+  std::vector<StatsIntervals<Interval>> series;
+  series.emplace_back(absl::Minutes(1), /*max_intervals=*/6 * 60);
+  series.emplace_back(absl::Minutes(10), /*max_intervals=*/4 * 24 * 6);
+  series.emplace_back(absl::Hours(1), /*max_intervals=*/30 * 24);
+  return series;
+}
+
+// Returns the intervals of the given length in 'series', or nullptr if there
+// are none.
+template <typename Interval>
+const StatsIntervals<Interval>* FindStatsIntervals(
+    const std::vector<StatsIntervals<Interval>>& series,
+    absl::Duration length) {
+  for (const StatsIntervals<Interval>& intervals : series) {
+    if (intervals.length() == length) {
+      return &intervals;
+    }
+  }
+  return nullptr;
+}
+
+}  // namespace backend
+}  // namespace emulator
+}  // namespace spanner
+}  // namespace google
+
+#endif  // THIRD_PARTY_CLOUD_SPANNER_EMULATOR_BACKEND_COMMON_STATS_INTERVALS_H_
@@ -0,0 +1,71 @@
+//
+// Copyright 2026 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "backend/common/stats_intervals.h"
+
+#include <vector>
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "absl/time/time.h"
+
+namespace google {
+namespace spanner {
+namespace emulator {
+namespace backend {
+
+namespace {
+
+TEST(StatsIntervalsTest, AddsIntervalsEndingAtMultiplesOfLength) {
+  StatsIntervals<int> intervals(absl::Minutes(1), /*max_intervals=*/10);
+  absl::Time t0 = absl::FromUnixSeconds(3600);
+  ++*intervals.GetOrAdd(t0 + absl::Seconds(10));
+  ++*intervals.GetOrAdd(t0 + absl::Seconds(50));
+  ++*intervals.GetOrAdd(t0 + absl::Seconds(70));
+
+  ASSERT_EQ(intervals.intervals().size(), 2);
+  EXPECT_EQ(intervals.intervals().at(t0 + absl::Minutes(1)), 2);
+  EXPECT_EQ(intervals.intervals().at(t0 + absl::Minutes(2)), 1);
+}
+
+TEST(StatsIntervalsTest, RetainsMostRecentIntervals) {
+  StatsIntervals<int> intervals(absl::Minutes(1), /*max_intervals=*/2);
+  absl::Time t0 = absl::FromUnixSeconds(3600);
+  ++*intervals.GetOrAdd(t0 + absl::Minutes(1));
+  ++*intervals.GetOrAdd(t0 + absl::Minutes(2));
+  ++*intervals.GetOrAdd(t0 + absl::Minutes(3));
+  EXPECT_EQ(intervals.intervals().size(), 2);
+  EXPECT_FALSE(intervals.intervals().contains(t0 + absl::Minutes(1)));
+
+  // Times before the retained intervals are dropped.
+  EXPECT_EQ(intervals.GetOrAdd(t0), nullptr);
+  EXPECT_EQ(intervals.intervals().size(), 2);
+}
+
+TEST(StatsIntervalsTest, FindsIntervalsOfSpannerSysTables) {
+  std::vector<StatsIntervals<int>> series = MakeStatsIntervals<int>();
+  EXPECT_NE(FindStatsIntervals(series, absl::Minutes(1)), nullptr);
+  EXPECT_NE(FindStatsIntervals(series, absl::Minutes(10)), nullptr);
+  EXPECT_NE(FindStatsIntervals(series, absl::Hours(1)), nullptr);
+  EXPECT_EQ(FindStatsIntervals(series, absl::Minutes(5)), nullptr);
+}
+
+}  // namespace
+
+}  // namespace backend
+}  // namespace emulator
+}  // namespace spanner
+}  // namespace google
@@ -17,37 +17,57 @@
 #include "backend/database/database.h"
 
 #include <memory>
+#include <optional>
+#include <string>
 #include <thread>  // NOLINT
 #include <utility>
+#include <vector>
 
 #include "google/spanner/admin/database/v1/common.pb.h"
 #include "zetasql/public/types/type_factory.h"
+#include "zetasql/public/value.h"
+#include "absl/container/flat_hash_map.h"
+#include "absl/container/flat_hash_set.h"
 #include "absl/functional/bind_front.h"
 #include "absl/memory/memory.h"
 #include "absl/status/status.h"
 #include "absl/status/statusor.h"
 #include "absl/strings/string_view.h"
+#include "absl/synchronization/mutex.h"
 #include "absl/time/clock.h"
 #include "absl/time/time.h"
+#include "absl/types/span.h"
 #include "absl/types/variant.h"
 #include "backend/actions/manager.h"
 #include "backend/common/ids.h"
 #include "backend/database/change_stream/change_stream_partition_churner.h"
 #include "backend/database/pg_oid_assigner/pg_oid_assigner.h"
+#include "backend/datamodel/key.h"
+#include "backend/locking/handle.h"
 #include "backend/locking/manager.h"
 #include "backend/query/query_engine.h"
+#include "backend/query/spanner_sys_stats.h"
+#include "backend/schema/backfills/index_backfill.h"
 #include "backend/schema/catalog/proto_bundle.h"
+#include "backend/schema/catalog/index.h"
 #include "backend/schema/catalog/schema.h"
+#include "backend/schema/catalog/table.h"
 #include "backend/schema/catalog/versioned_catalog.h"
+#include "backend/schema/ddl/operations.pb.h"
 #include "backend/schema/graph/schema_graph.h"
 #include "backend/schema/updater/schema_updater.h"
 #include "backend/schema/updater/scoped_schema_change_lock.h"
 #include "backend/storage/in_memory_storage.h"
+#include "backend/storage/storage.h"
+#include "backend/storage/version_garbage_collector.h"
 #include "backend/transaction/options.h"
 #include "backend/transaction/read_only_transaction.h"
 #include "backend/transaction/read_write_transaction.h"
+#include "backend/transaction/write_capture.h"
 #include "common/clock.h"
+#include "common/config.h"
 #include "common/errors.h"
+#include "zetasql/base/ret_check.h"
 #include "absl/status/status.h"
 #include "zetasql/base/status_macros.h"
 
@@ -56,6 +76,78 @@ namespace spanner {
 namespace emulator {
 namespace backend {
 
+namespace {
+
+// Delay between the attempts of an online schema change to lock the database.
+constexpr absl::Duration kSchemaChangeLockRetryDelay = absl::Milliseconds(1);
+
+// Returns the statements of 'schema_change_operation' if they only create
+// indexes on existing tables of 'schema', which can be backfilled before the
+// database is locked. Returns an empty list otherwise.
+std::vector<ddl::CreateIndex> OnlineCreatedIndexes(
+    const Schema* schema,
+    const SchemaChangeOperation& schema_change_operation) {
+  std::vector<ddl::CreateIndex> create_indexes;
+  for (const std::string& statement : schema_change_operation.statements) {
+    absl::StatusOr<std::unique_ptr<ddl::DDLStatement>> ddl_statement =
+        ParseDDLByDialect(statement, schema_change_operation.database_dialect);
+    if (!ddl_statement.ok() || !(*ddl_statement)->has_create_index() ||
+        schema->FindTable((*ddl_statement)->create_index().index_base_name()) ==
+            nullptr) {
+      return {};
+    }
+    create_indexes.push_back((*ddl_statement)->create_index());
+  }
+  return create_indexes;
+}
+
+// Catches up the indexes created by 'create_indexes' in 'updated_schema', which
+// were backfilled at 'backfill_timestamp', with the rows of the indexed tables
+// in 'written_keys' which were written since.
+absl::Status CatchUpIndexes(
+    const Schema* existing_schema, const Schema* updated_schema,
+    absl::Span<const ddl::CreateIndex> create_indexes,
+    const absl::flat_hash_map<TableID, std::vector<Key>>& written_keys,
+    absl::Time backfill_timestamp, absl::Time timestamp, Storage* storage) {
+  for (const ddl::CreateIndex& create_index : create_indexes) {
+    // An index created IF NOT EXISTS may have existed already.
+    if (existing_schema->FindIndex(create_index.index_name()) != nullptr) {
+      continue;
+    }
+    const Index* index = updated_schema->FindIndex(create_index.index_name());
+    ZETASQL_RET_CHECK_NE(index, nullptr);
+    auto keys = written_keys.find(index->indexed_table()->id());
+    if (keys != written_keys.end()) {
+      ZETASQL_RETURN_IF_ERROR(CatchUpIndex(index, keys->second,
+                                   backfill_timestamp, timestamp, storage));
+    }
+  }
+  return absl::OkStatus();
+}
+
+// Marks the index data tables of the indexes created by 'create_indexes' in
+// 'updated_schema' as dropped at 'timestamp'. An online schema change which is
+// abandoned, or applied again once the database is locked, creates its indexes
+// with new table IDs, so the rows it backfilled would otherwise never be
+// reclaimed.
+void DropOnlineCreatedIndexes(const Schema* existing_schema,
+                              const Schema* updated_schema,
+                              absl::Span<const ddl::CreateIndex> create_indexes,
+                              absl::Time timestamp, Storage* storage) {
+  for (const ddl::CreateIndex& create_index : create_indexes) {
+    if (existing_schema->FindIndex(create_index.index_name()) != nullptr) {
+      continue;
+    }
+    // Indexes after a statement whose backfill failed were not created.
+    const Index* index = updated_schema->FindIndex(create_index.index_name());
+    if (index != nullptr) {
+      storage->MarkDroppedTable(timestamp, index->index_data_table()->id());
+    }
+  }
+}
+
+}  // namespace
+
 // TransactionIDGenerator is initialized to 1 because 0 is used as a sentinel
 // value for an invalid transaction.
 Database::Database()
@@ -67,7 +159,8 @@ absl::StatusOr<std::unique_ptr<Database>> Database::Create(
   auto database = absl::WrapUnique(new Database());
   database->clock_ = clock;
   database->database_id_ = database_id;
-  database->storage_ = std::make_unique<InMemoryStorage>();
+  database->storage_ =
+      std::make_unique<InMemoryStorage>(config::max_database_memory_bytes());
   database->lock_manager_ = std::make_unique<LockManager>(clock);
   database->type_factory_ = std::make_unique<zetasql::TypeFactory>();
   database->action_manager_ = std::make_unique<ActionManager>();
@@ -107,13 +200,28 @@ absl::StatusOr<std::unique_ptr<Database>> Database::Create(
 
   database->change_stream_partition_churner_ =
       std::make_unique<ChangeStreamPartitionChurner>(
-          absl::bind_front(&Database::CreateReadWriteTransaction,
-                           database.get()),
+          // Transactions of the churner are internal to the emulator, so
+          // they are not recorded in the transaction statistics.
+          [database = database.get()](const ReadWriteOptions& options,
+                                      const RetryState& retry_state)
+              -> absl::StatusOr<std::unique_ptr<ReadWriteTransaction>> {
+            return database->NewReadWriteTransaction(
+                options, retry_state, /*transaction_stats=*/nullptr);
+          },
           database->clock_);
 
   database->change_stream_partition_churner_->Update(
       database->versioned_catalog_->GetLatestSchema());
 
+  database->query_engine_->spanner_sys_stats()->SetSource(
+      SpannerSysStats::kTableSizesStats1Hour,
+      absl::bind_front(&Database::GetTableSizesStats, database.get()));
+  database->query_engine_->spanner_sys_stats()->SetSource(
+      SpannerSysStats::kSchemaVersionStats,
+      absl::bind_front(&Database::GetSchemaVersionStatsRows, database.get()));
+  database->transaction_stats_.AddSources(
+      database->query_engine_->spanner_sys_stats());
+
   // Some functions need to access the schema (e.g. sequence functions), so
   // set the latest schema to the function catalog here.
   database->query_engine_->SetLatestSchemaForFunctionCatalog(
@@ -122,6 +230,10 @@ absl::StatusOr<std::unique_ptr<Database>> Database::Create(
   database->storage_->SetVersionRetentionPeriod(
       database->versioned_catalog_->version_retention_period());
 
+  database->version_garbage_collector_ =
+      std::make_unique<VersionGarbageCollector>(database->storage_.get(),
+                                                database->clock_);
+
   return database;
 }
 absl::StatusOr<std::unique_ptr<ReadOnlyTransaction>>
@@ -134,10 +246,17 @@ Database::CreateReadOnlyTransaction(const ReadOnlyOptions& options) {
 absl::StatusOr<std::unique_ptr<ReadWriteTransaction>>
 Database::CreateReadWriteTransaction(const ReadWriteOptions& options,
                                      const RetryState& retry_state) {
+  return NewReadWriteTransaction(options, retry_state, &transaction_stats_);
+}
+
+std::unique_ptr<ReadWriteTransaction> Database::NewReadWriteTransaction(
+    const ReadWriteOptions& options, const RetryState& retry_state,
+    TransactionStats* transaction_stats) {
   return std::make_unique<ReadWriteTransaction>(
       options, retry_state, transaction_id_generator_.NextId(), clock_,
       storage_.get(), lock_manager_.get(), versioned_catalog_.get(),
-      action_manager_.get());
+      action_manager_.get(), transaction_stats, &change_stream_notifier_,
+      &write_capture_);
 }
 
 SchemaChangeContext Database::GetSchemaChangeContext() {
@@ -159,34 +278,128 @@ absl::Status Database::UpdateSchema(
     return error::UpdateDatabaseMissingStatements();
   }
 
+  // Schema changes are applied one at a time, since an online schema change
+  // backfills before it locks the database.
+  absl::MutexLock schema_change_lock(&schema_change_mu_);
+  const Schema* existing_schema = versioned_catalog_->GetLatestSchema();
+
+  // Indexes created on existing tables are backfilled at a snapshot before the
+  // database is locked, so that the transactions which run meanwhile are not
+  // aborted. The rows written since the snapshot are caught up on once the
+  // database is locked.
+  std::vector<ddl::CreateIndex> online_indexes =
+      OnlineCreatedIndexes(existing_schema, schema_change_operation);
+  std::optional<SchemaChangeResult> online_result;
+  absl::Time backfill_timestamp;
+  if (!online_indexes.empty()) {
+    absl::flat_hash_set<TableID> indexed_table_ids;
+    for (const ddl::CreateIndex& create_index : online_indexes) {
+      indexed_table_ids.insert(
+          existing_schema->FindTable(create_index.index_base_name())->id());
+    }
+    write_capture_.Start(std::move(indexed_table_ids));
+
+    // Wait for the commits before the snapshot to be written to storage.
+    backfill_timestamp = clock_->Now();
+    lock_manager_
+        ->CreateHandle(transaction_id_generator_.NextId(), /*abort_fn=*/nullptr,
+                       TransactionPriority(1))
+        ->WaitForSafeRead(backfill_timestamp);
+
+    auto context = GetSchemaChangeContext();
+    context.schema_change_timestamp = backfill_timestamp;
+    SchemaUpdater updater;
+    absl::StatusOr<SchemaChangeResult> result = updater.UpdateSchemaFromDDL(
+        existing_schema, schema_change_operation, context);
+    if (!result.ok()) {
+      write_capture_.Stop();
+      return result.status();
+    }
+    online_result = *std::move(result);
+  }
+  // Drops the indexes backfilled by the online schema change, if it is not the
+  // one which is applied.
+  auto drop_online_indexes = [&](absl::Time timestamp) {
+    if (online_result.has_value() && online_result->updated_schema != nullptr) {
+      DropOnlineCreatedIndexes(existing_schema,
+                               online_result->updated_schema.get(),
+                               online_indexes, timestamp, storage_.get());
+    }
+  };
+
   // Make an exclusive lock request for the database. If there are any
-  // concurrent transactions it will be denied and the operation aborted.
-  ScopedSchemaChangeLock lock{transaction_id_generator_.NextId(),
-                              lock_manager_.get()};
-  ZETASQL_RETURN_IF_ERROR(lock.Wait());
+  // concurrent transactions it will be denied and the operation aborted. An
+  // online schema change retries for up to the lock wait timeout instead, as
+  // its backfill is already done.
+  absl::Time lock_deadline = absl::Now();
+  if (online_result.has_value() && online_result->backfill_status.ok()) {
+    lock_deadline += absl::Milliseconds(config::lock_wait_timeout_ms());
+  }
+  std::optional<ScopedSchemaChangeLock> lock;
+  while (true) {
+    lock.emplace(transaction_id_generator_.NextId(), lock_manager_.get());
+    absl::Status status = lock->Wait();
+    if (status.ok()) {
+      break;
+    }
+    lock.reset();
+    if (absl::Now() >= lock_deadline) {
+      write_capture_.Stop();
+      drop_online_indexes(clock_->Now());
+      return status;
+    }
+    absl::SleepFor(kSchemaChangeLockRetryDelay);
+  }
+  // No transaction commits while the database is locked.
+  absl::flat_hash_map<TableID, std::vector<Key>> written_keys =
+      write_capture_.Stop();
 
   // Reserve a commit timestamp for the schema changes. Even if the
   // schema change fails, it will result in a no-op commit that will
   // be invisible to other read-only/read-write transactions.
-  ZETASQL_ASSIGN_OR_RETURN(auto update_timestamp, lock.ReserveCommitTimestamp());
+  absl::StatusOr<absl::Time> reserved_timestamp =
+      lock->ReserveCommitTimestamp();
+  if (!reserved_timestamp.ok()) {
+    drop_online_indexes(clock_->Now());
+    return reserved_timestamp.status();
+  }
+  absl::Time update_timestamp = *reserved_timestamp;
 
-  auto context = GetSchemaChangeContext();
-  context.schema_change_timestamp = update_timestamp;
-  const Schema* existing_schema = versioned_catalog_->GetLatestSchema();
-  SchemaUpdater updater;
-  ZETASQL_ASSIGN_OR_RETURN(auto result,
-                   updater.UpdateSchemaFromDDL(
-                       existing_schema, schema_change_operation, context));
+  std::optional<SchemaChangeResult> result;
+  if (online_result.has_value() && online_result->backfill_status.ok()) {
+    // If the rows written since the backfill violate a unique index, the
+    // schema change is applied again below to report the statement which
+    // failed.
+    absl::Status catch_up_status = CatchUpIndexes(
+        existing_schema, online_result->updated_schema.get(), online_indexes,
+        written_keys, backfill_timestamp, update_timestamp, storage_.get());
+    if (catch_up_status.ok()) {
+      result = *std::move(online_result);
+      online_result.reset();
+    }
+  }
+  if (!result.has_value()) {
+    // A backfill which failed is applied again now that the database is
+    // locked, since the rows written meanwhile may have fixed it. The retry
+    // creates the indexes anew, so the rows of the online attempt are dropped.
+    drop_online_indexes(update_timestamp);
+    auto context = GetSchemaChangeContext();
+    context.schema_change_timestamp = update_timestamp;
+    SchemaUpdater updater;
+    ZETASQL_ASSIGN_OR_RETURN(result, updater.UpdateSchemaFromDDL(
+                                 existing_schema, schema_change_operation,
+                                 context));
+  }
   *commit_timestamp = update_timestamp;
-  *num_succesful_statements = result.num_successful_statements;
-  *backfill_status = result.backfill_status;
+  *num_succesful_statements = result->num_successful_statements;
+  *backfill_status = result->backfill_status;
 
   // We update the schema even if the backfill status was not OK, the returned
   // schema will be the schema for the last valid statement before the statement
   // for which the backfill/verification failed.
-  if (result.updated_schema != nullptr) {
+  if (result->updated_schema != nullptr) {
     ZETASQL_RETURN_IF_ERROR(versioned_catalog_->AddSchema(
-        update_timestamp, std::move(result.updated_schema)));
+        update_timestamp, std::move(result->updated_schema)));
     action_manager_->AddActionsForSchema(versioned_catalog_->GetLatestSchema(),
                                          query_engine_->function_catalog(),
                                          query_engine_->type_factory());
@@ -214,6 +427,47 @@ const Schema* Database::GetLatestSchema() const {
   return versioned_catalog_->GetLatestSchema();
 }
 
+SchemaVersionStats Database::GetSchemaVersionStats() const {
+  return versioned_catalog_->GetSchemaVersionStats();
+}
+
+std::vector<SpannerSysStats::Row> Database::GetSchemaVersionStatsRows()
+    const {
+  SchemaVersionStats stats = GetSchemaVersionStats();
+  return {SpannerSysStats::Row{
+      {"NUM_VERSIONS", zetasql::values::Int64(stats.num_versions)},
+      {"NUM_PINNED_VERSIONS",
+       zetasql::values::Int64(stats.num_pinned_versions)},
+      {"NUM_SCHEMA_OBJECTS", zetasql::values::Int64(stats.num_schema_objects)},
+      {"USED_BYTES",
+       zetasql::values::Double(static_cast<double>(stats.used_bytes))},
+  }};
+}
+
+std::vector<SpannerSysStats::Row> Database::GetTableSizesStats() const {
+  // Sizes are reported as of the end of the current hour's interval.
+  absl::Time interval_end =
+      absl::UnixEpoch() +
+      absl::Floor(clock_->Now() - absl::UnixEpoch(), absl::Hours(1));
+  auto make_row = [&](const std::string& name, const Table* table) {
+    return SpannerSysStats::Row{
+        {"INTERVAL_END", zetasql::values::Timestamp(interval_end)},
+        {"TABLE_NAME", zetasql::values::String(name)},
+        {"USED_BYTES", zetasql::values::Double(static_cast<double>(
+                           storage_->TableSizeBytes(table->id())))},
+    };
+  };
+
+  std::vector<SpannerSysStats::Row> rows;
+  for (const Table* table : GetLatestSchema()->tables()) {
+    rows.push_back(make_row(table->Name(), table));
+    for (const Index* index : table->indexes()) {
+      rows.push_back(make_row(index->Name(), index->index_data_table()));
+    }
+  }
+  return rows;
+}
+
 }  // namespace backend
 }  // namespace emulator
 }  // namespace spanner
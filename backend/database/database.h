@@ -26,6 +26,7 @@
 #include "absl/status/status.h"
 #include "absl/status/statusor.h"
 #include "absl/strings/string_view.h"
+#include "absl/synchronization/mutex.h"
 #include "absl/time/time.h"
 #include "absl/types/variant.h"
 #include "backend/actions/manager.h"
@@ -34,13 +35,18 @@
 #include "backend/database/pg_oid_assigner/pg_oid_assigner.h"
 #include "backend/locking/manager.h"
 #include "backend/query/query_engine.h"
+#include "backend/query/spanner_sys_stats.h"
 #include "backend/schema/catalog/schema.h"
 #include "backend/schema/catalog/versioned_catalog.h"
 #include "backend/schema/updater/schema_updater.h"
 #include "backend/storage/storage.h"
+#include "backend/storage/version_garbage_collector.h"
+#include "backend/transaction/change_stream_notifier.h"
 #include "backend/transaction/options.h"
 #include "backend/transaction/read_only_transaction.h"
 #include "backend/transaction/read_write_transaction.h"
+#include "backend/transaction/transaction_stats.h"
+#include "backend/transaction/write_capture.h"
 #include "common/clock.h"
 #include "absl/status/status.h"
 
@@ -75,10 +81,20 @@ class Database {
 
   // Updates the schema for this database.
   //
-  // All schema changes are applied synchronously and transactionally.
-  // If there are any transactions or other schema changes already in progress,
-  // incoming schema change requests will be rejected with a FAILED_PRECONDITION
-  // error.
+  // Schema changes are applied transactionally, one at a time, and this call
+  // returns once the schema change is applied. The frontend makes the call on
+  // a background thread of the database, after UpdateDatabaseDdl has returned
+  // the operation which tracks it. If there are any transactions already in
+  // progress, incoming schema change requests will be rejected with a
+  // FAILED_PRECONDITION error.
+  //
+  // Schema changes which only create indexes on existing tables are applied
+  // online: the indexes are backfilled at a snapshot while transactions keep
+  // running, and then caught up on the rows written since the snapshot once the
+  // transactions in progress are done, before the schema change is published.
+  // If the backfill or the catch-up fails, the schema change is applied again
+  // while the database is locked, and the index rows of the online attempt are
+  // dropped.
   //
   // DDL statements in `schema_change_operation.statements` are applied
   // one-by-one until they either all succeed or the first failure is
@@ -110,6 +126,9 @@ class Database {
   // Retrives the current version of the schema.
   const Schema* GetLatestSchema() const;
 
+  // Returns statistics of the schema versions held in memory by the database.
+  SchemaVersionStats GetSchemaVersionStats() const;
+
   // Used to execute queries against the database.
   QueryEngine* query_engine() { return query_engine_.get(); }
 
@@ -122,6 +141,11 @@ class Database {
 
   PgOidAssigner* get_pg_oid_assigner() { return pg_oid_assigner_.get(); }
 
+  // Notifies change stream queries of the commits to the change streams.
+  ChangeStreamNotifier* change_stream_notifier() {
+    return &change_stream_notifier_;
+  }
+
  private:
   Database();
   // Delete copy and assignment operators since database shouldn't be copyable.
@@ -130,6 +154,20 @@ class Database {
 
   SchemaChangeContext GetSchemaChangeContext();
 
+  // Creates a read write transaction which records its attempts in
+  // 'transaction_stats' if it is not null.
+  std::unique_ptr<ReadWriteTransaction> NewReadWriteTransaction(
+      const ReadWriteOptions& options, const RetryState& retry_state,
+      TransactionStats* transaction_stats);
+
+  // Returns the rows of SPANNER_SYS.TABLE_SIZES_STATS_1HOUR: the estimated
+  // memory used by each table and index of the latest schema.
+  std::vector<SpannerSysStats::Row> GetTableSizesStats() const;
+
+  // Returns the row of SPANNER_SYS.SCHEMA_VERSION_STATS: the schema versions
+  // held in memory and their estimated size.
+  std::vector<SpannerSysStats::Row> GetSchemaVersionStatsRows() const;
+
   // Clock to provide commit timestamps.
   Clock* clock_;
 
@@ -154,6 +192,19 @@ class Database {
   // Lock management.
   std::unique_ptr<LockManager> lock_manager_;
 
+  // Statistics of the transactions of the database, served by the SPANNER_SYS
+  // tables of query_engine_.
+  TransactionStats transaction_stats_;
+
+  // Publishes the writes of committed transactions to change streams.
+  ChangeStreamNotifier change_stream_notifier_;
+
+  // Records the rows written while an online schema change backfills.
+  WriteCapture write_capture_;
+
+  // Serializes schema changes.
+  absl::Mutex schema_change_mu_;
+
   // Type factory used for all ZetaSQL operations on this database.
   std::unique_ptr<zetasql::TypeFactory> type_factory_;
 
@@ -174,6 +225,10 @@ class Database {
 
   // Assigns OIDs to database objects when dialect is POSTGRESQL.
   std::unique_ptr<PgOidAssigner> pg_oid_assigner_;
+
+  // Reclaims expired versions from storage_ in the background. Declared last
+  // so that it is stopped before the storage is destroyed.
+  std::unique_ptr<VersionGarbageCollector> version_garbage_collector_;
 };
 
 }  // namespace backend
@@ -18,6 +18,7 @@
 
 #include <memory>
 #include <string>
+#include <thread>  // NOLINT
 #include <utility>
 #include <vector>
 
@@ -26,10 +27,17 @@
 #include "zetasql/base/testing/status_matchers.h"
 #include "tests/common/proto_matchers.h"
 #include "absl/status/status.h"
+#include "absl/synchronization/notification.h"
+#include "absl/time/clock.h"
+#include "absl/time/time.h"
 #include "backend/access/read.h"
 #include "backend/datamodel/key_set.h"
+#include "backend/query/query_context.h"
+#include "backend/query/query_engine.h"
+#include "backend/schema/catalog/versioned_catalog.h"
 #include "backend/schema/updater/schema_updater.h"
 #include "backend/transaction/options.h"
+#include "backend/transaction/read_only_transaction.h"
 #include "common/clock.h"
 #include "common/config.h"
 #include "common/errors.h"
@@ -40,6 +48,7 @@ namespace emulator {
 namespace backend {
 namespace {
 
+using zetasql::values::Double;
 using zetasql::values::Int64;
 using zetasql_base::testing::StatusIs;
 
@@ -266,6 +275,134 @@ TEST_F(DatabaseTest, ConcurrentSchemaChangeIsAborted) {
   config::set_abort_current_transaction_probability(current_probability);
 }
 
+TEST_F(DatabaseTest, CreateIndexWaitsForConcurrentTransaction) {
+  auto current_probability = config::abort_current_transaction_probability();
+  config::set_abort_current_transaction_probability(0);
+  auto current_timeout = config::lock_wait_timeout_ms();
+  config::set_lock_wait_timeout_ms(60000);
+
+  std::vector<std::string> create_statements = {R"(
+    CREATE TABLE T(
+      k1 INT64,
+      k2 INT64,
+    ) PRIMARY KEY(k1)
+  )"};
+  ZETASQL_ASSERT_OK_AND_ASSIGN(
+      auto db,
+      Database::Create(&clock_, kDatabaseId,
+                       SchemaChangeOperation{.statements = create_statements}));
+
+  // Initiate a Read inside a read-write transaction to acquire locks.
+  std::unique_ptr<RowCursor> row_cursor;
+  ZETASQL_ASSERT_OK_AND_ASSIGN(
+      std::unique_ptr<ReadWriteTransaction> txn,
+      db->CreateReadWriteTransaction(ReadWriteOptions(), RetryState()));
+  ZETASQL_ASSERT_OK(txn->Read(read_column("T", "k1"), &row_cursor));
+
+  // The index is backfilled while the transaction runs, and the schema change
+  // waits for the transaction to release its locks.
+  absl::Status update_status;
+  absl::Status backfill_status;
+  int completed_statements = 0;
+  absl::Time commit_ts;
+  absl::Notification updated;
+  std::thread update_thread([&]() {
+    update_status = db->UpdateSchema(
+        SchemaChangeOperation{.statements = {"CREATE INDEX I ON T(k2)"}},
+        &completed_statements, &commit_ts, &backfill_status);
+    updated.Notify();
+  });
+  EXPECT_FALSE(updated.WaitForNotificationWithTimeout(absl::Milliseconds(200)));
+
+  // The transaction is not aborted, and its write is caught up on by the index.
+  Mutation m;
+  m.AddWriteOp(MutationOpType::kInsert, "T", {"k1", "k2"},
+               {{Int64(1), Int64(2)}});
+  ZETASQL_ASSERT_OK(txn->Write(m));
+  ZETASQL_EXPECT_OK(txn->Commit());
+  update_thread.join();
+  ZETASQL_EXPECT_OK(update_status);
+  ZETASQL_EXPECT_OK(backfill_status);
+  EXPECT_EQ(completed_statements, 1);
+
+  ZETASQL_ASSERT_OK_AND_ASSIGN(std::unique_ptr<ReadOnlyTransaction> read_txn,
+                       db->CreateReadOnlyTransaction(ReadOnlyOptions()));
+  ReadArg index_read = read_column("T", "k2");
+  index_read.index = "I";
+  ZETASQL_ASSERT_OK(read_txn->Read(index_read, &row_cursor));
+  ASSERT_TRUE(row_cursor->Next());
+  EXPECT_EQ(row_cursor->ColumnValue(0), Int64(2));
+  EXPECT_FALSE(row_cursor->Next());
+
+  config::set_lock_wait_timeout_ms(current_timeout);
+  config::set_abort_current_transaction_probability(current_probability);
+}
+
+TEST_F(DatabaseTest, CreateIndexReportsViolationWrittenDuringBackfill) {
+  auto current_probability = config::abort_current_transaction_probability();
+  config::set_abort_current_transaction_probability(0);
+  auto current_timeout = config::lock_wait_timeout_ms();
+  config::set_lock_wait_timeout_ms(60000);
+
+  std::vector<std::string> create_statements = {R"(
+    CREATE TABLE T(
+      k1 INT64,
+      k2 INT64,
+    ) PRIMARY KEY(k1)
+  )"};
+  ZETASQL_ASSERT_OK_AND_ASSIGN(
+      auto db,
+      Database::Create(&clock_, kDatabaseId,
+                       SchemaChangeOperation{.statements = create_statements}));
+  ZETASQL_ASSERT_OK_AND_ASSIGN(
+      std::unique_ptr<ReadWriteTransaction> setup_txn,
+      db->CreateReadWriteTransaction(ReadWriteOptions(), RetryState()));
+  Mutation setup;
+  setup.AddWriteOp(MutationOpType::kInsert, "T", {"k1", "k2"},
+                   {{Int64(1), Int64(1)}, {Int64(2), Int64(2)}});
+  ZETASQL_ASSERT_OK(setup_txn->Write(setup));
+  ZETASQL_ASSERT_OK(setup_txn->Commit());
+
+  std::unique_ptr<RowCursor> row_cursor;
+  ZETASQL_ASSERT_OK_AND_ASSIGN(
+      std::unique_ptr<ReadWriteTransaction> txn,
+      db->CreateReadWriteTransaction(ReadWriteOptions(), RetryState()));
+  ZETASQL_ASSERT_OK(txn->Read(read_column("T", "k1"), &row_cursor));
+
+  // The unique index is valid at the snapshot it is backfilled at, but not
+  // once the transaction commits.
+  std::vector<std::string> update_statements = {
+      "CREATE INDEX J ON T(k1)", "CREATE UNIQUE INDEX I ON T(k2)"};
+  absl::Status update_status;
+  absl::Status backfill_status;
+  int completed_statements = 0;
+  absl::Time commit_ts;
+  std::thread update_thread([&]() {
+    update_status = db->UpdateSchema(
+        SchemaChangeOperation{.statements = update_statements},
+        &completed_statements, &commit_ts, &backfill_status);
+  });
+  absl::SleepFor(absl::Milliseconds(200));
+  Mutation m;
+  m.AddWriteOp(MutationOpType::kInsert, "T", {"k1", "k2"},
+               {{Int64(3), Int64(2)}});
+  ZETASQL_ASSERT_OK(txn->Write(m));
+  ZETASQL_EXPECT_OK(txn->Commit());
+  update_thread.join();
+
+  // The violation is reported as if the schema change had run under the lock:
+  // only the statements before the unique index are applied.
+  ZETASQL_EXPECT_OK(update_status);
+  EXPECT_EQ(backfill_status,
+            error::UniqueIndexViolationOnIndexCreation("I", "{Int64(2)}"));
+  EXPECT_EQ(completed_statements, 1);
+  EXPECT_NE(db->GetLatestSchema()->FindIndex("J"), nullptr);
+  EXPECT_EQ(db->GetLatestSchema()->FindIndex("I"), nullptr);
+
+  config::set_lock_wait_timeout_ms(current_timeout);
+  config::set_abort_current_transaction_probability(current_probability);
+}
+
 TEST_F(DatabaseTest, SchemaChangeLocksSuccesfullyReleased) {
   std::vector<std::string> create_statements = {R"(
     CREATE TABLE T(
@@ -302,6 +439,51 @@ TEST_F(DatabaseTest, SchemaChangeLocksSuccesfullyReleased) {
   ZETASQL_EXPECT_OK(txn->Commit());
 }
 
+TEST_F(DatabaseTest, SchemaVersionStatsAreQueryable) {
+  std::vector<std::string> create_statements = {R"(
+    CREATE TABLE T(
+      k1 INT64,
+      k2 INT64,
+    ) PRIMARY KEY(k1)
+  )"};
+  ZETASQL_ASSERT_OK_AND_ASSIGN(
+      auto db,
+      Database::Create(&clock_, kDatabaseId,
+                       SchemaChangeOperation{.statements = create_statements}));
+  SchemaVersionStats created_stats = db->GetSchemaVersionStats();
+  EXPECT_GT(created_stats.used_bytes, 0);
+
+  std::vector<std::string> update_statements = {R"(
+    CREATE INDEX I on T(k2)
+  )"};
+  absl::Status backfill_status;
+  int completed_statements;
+  absl::Time commit_ts;
+  ZETASQL_ASSERT_OK(
+      db->UpdateSchema(SchemaChangeOperation{.statements = update_statements},
+                       &completed_statements, &commit_ts, &backfill_status));
+  ZETASQL_ASSERT_OK(backfill_status);
+  SchemaVersionStats updated_stats = db->GetSchemaVersionStats();
+  EXPECT_EQ(updated_stats.num_versions, created_stats.num_versions + 1);
+  EXPECT_GT(updated_stats.used_bytes, created_stats.used_bytes);
+
+  ZETASQL_ASSERT_OK_AND_ASSIGN(std::unique_ptr<ReadOnlyTransaction> txn,
+                       db->CreateReadOnlyTransaction(ReadOnlyOptions()));
+  ZETASQL_ASSERT_OK_AND_ASSIGN(
+      QueryResult result,
+      db->query_engine()->ExecuteSql(
+          Query{"SELECT NUM_VERSIONS, NUM_PINNED_VERSIONS, USED_BYTES "
+                "FROM SPANNER_SYS.SCHEMA_VERSION_STATS"},
+          QueryContext{.schema = txn->schema(), .reader = txn.get()}));
+  ASSERT_TRUE(result.rows->Next());
+  EXPECT_EQ(result.rows->ColumnValue(0), Int64(updated_stats.num_versions));
+  EXPECT_EQ(result.rows->ColumnValue(1), Int64(0));
+  EXPECT_EQ(result.rows->ColumnValue(2),
+            Double(static_cast<double>(updated_stats.used_bytes)));
+  EXPECT_FALSE(result.rows->Next());
+  ZETASQL_EXPECT_OK(result.rows->Status());
+}
+
 }  // namespace
 }  // namespace backend
 }  // namespace emulator
@@ -17,6 +17,8 @@
 #include "backend/locking/handle.h"
 
 #include <functional>
+#include <utility>
+#include <vector>
 
 #include "absl/status/status.h"
 #include "absl/status/statusor.h"
@@ -38,8 +40,13 @@ LockHandle::LockHandle(LockManager* manager, TransactionID tid,
       priority_(priority) {}
 
 LockHandle::~LockHandle() {
-  absl::MutexLock lock(&mu_);
-  try_abort_transaction_fn_ = nullptr;
+  {
+    absl::MutexLock lock(&mu_);
+    try_abort_transaction_fn_ = nullptr;
+  }
+  // Release any locks still held so that waiters are not blocked on a handle
+  // which no longer exists.
+  manager_->UnlockAll(this);
 }
 
 void LockHandle::EnqueueLock(const LockRequest& request) {
@@ -48,11 +55,7 @@ void LockHandle::EnqueueLock(const LockRequest& request) {
 
 void LockHandle::UnlockAll() { manager_->UnlockAll(this); }
 
-bool LockHandle::IsBlocked() {
-  // The current implementation never blocks.
-  absl::MutexLock lock(&mu_);
-  return false;
-}
+bool LockHandle::IsBlocked() { return manager_->IsBlocked(this); }
 
 bool LockHandle::IsAborted() {
   absl::MutexLock lock(&mu_);
@@ -60,7 +63,9 @@ bool LockHandle::IsAborted() {
 }
 
 absl::Status LockHandle::Wait() {
-  // The current implementation never blocks.
+  // The handle mutex must not be held while waiting in the lock manager, since
+  // the lock manager aborts waiting handles.
+  manager_->Wait(this);
   absl::MutexLock lock(&mu_);
   return status_;
 }
@@ -85,11 +90,26 @@ absl::Status LockHandle::TryAbortTransaction(const absl::Status& status) {
   return error::CouldNotObtainLockHandleMutex(tid_);
 }
 
+bool LockHandle::CanBeAborted() {
+  absl::MutexLock lock(&mu_);
+  return try_abort_transaction_fn_ != nullptr;
+}
+
 void LockHandle::Reset() {
   absl::MutexLock lock(&mu_);
   status_ = absl::OkStatus();
 }
 
+void LockHandle::AddLockWait(const LockWait& wait) {
+  absl::MutexLock lock(&mu_);
+  lock_waits_.push_back(wait);
+}
+
+std::vector<LockWait> LockHandle::TakeLockWaits() {
+  absl::MutexLock lock(&mu_);
+  return std::exchange(lock_waits_, {});
+}
+
 absl::StatusOr<absl::Time> LockHandle::ReserveCommitTimestamp() {
   return manager_->ReserveCommitTimestamp(this);
 }
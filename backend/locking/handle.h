@@ -17,6 +17,8 @@
 #ifndef THIRD_PARTY_CLOUD_SPANNER_EMULATOR_BACKEND_LOCKING_HANDLE_H_
 #define THIRD_PARTY_CLOUD_SPANNER_EMULATOR_BACKEND_LOCKING_HANDLE_H_
 
+#include <vector>
+
 #include "absl/base/thread_annotations.h"
 #include "absl/status/status.h"
 #include "absl/status/statusor.h"
@@ -40,10 +42,11 @@ class LockManager;
 // happens via the LockHandle. This includes incremental acquisition of read
 // write locks, waiting on those locks, and unlocking those locks.
 //
-// EnqueueLock() is non-blocking and only enqueues the lock request. The
-// transaction can subsequently query whether the requests have completed by
-// checking IsBlocked() or perform a blocking Wait() to find out the final
-// state of the lock requests.
+// EnqueueLock() is non-blocking and only enqueues the lock request. Requests
+// which do not conflict with locks held by other transactions are granted
+// immediately. The transaction can subsequently query whether the requests have
+// completed by checking IsBlocked() or perform a blocking Wait() to find out
+// the final state of the lock requests.
 //
 // Usage (happy path, error handling skipped):
 //    // Get a handle.
@@ -104,6 +107,9 @@ class LockHandle {
   // commits.
   void WaitForSafeRead(absl::Time read_time);
 
+  // Returns the waits of this handle for conflicting locks since the last call.
+  std::vector<LockWait> TakeLockWaits() ABSL_LOCKS_EXCLUDED(mu_);
+
  private:
   // Only the LockManager is allowed to create and destroy LockHandles.
   friend class LockManager;
@@ -120,9 +126,16 @@ class LockHandle {
   absl::Status TryAbortTransaction(const absl::Status& status)
       ABSL_LOCKS_EXCLUDED(mu_);
 
+  // Returns true if the transaction which owns this handle can be aborted by
+  // other transactions.
+  bool CanBeAborted() ABSL_LOCKS_EXCLUDED(mu_);
+
   // Resets the state of this handle.
   void Reset() ABSL_LOCKS_EXCLUDED(mu_);
 
+  // Records a wait of this handle for a conflicting lock.
+  void AddLockWait(const LockWait& wait) ABSL_LOCKS_EXCLUDED(mu_);
+
   // The LockManager which this LockHandle interacts with.
   LockManager* const manager_;
 
@@ -144,6 +157,9 @@ class LockHandle {
 
   // The status of the lock handle requests.
   absl::Status status_ ABSL_GUARDED_BY(mu_);
+
+  // Waits for conflicting locks not taken by TakeLockWaits() yet.
+  std::vector<LockWait> lock_waits_ ABSL_GUARDED_BY(mu_);
 };
 
 }  // namespace backend
@@ -16,8 +16,13 @@
 
 #include "backend/locking/manager.h"
 
+#include <algorithm>
 #include <functional>
+#include <iterator>
 #include <memory>
+#include <optional>
+#include <utility>
+#include <vector>
 
 #include "absl/memory/memory.h"
 #include "absl/random/random.h"
@@ -26,8 +31,11 @@
 #include "absl/status/statusor.h"
 #include "absl/strings/substitute.h"
 #include "absl/synchronization/mutex.h"
+#include "absl/time/clock.h"
 #include "absl/time/time.h"
 #include "backend/common/ids.h"
+#include "backend/datamodel/key.h"
+#include "backend/datamodel/key_range.h"
 #include "common/config.h"
 #include "common/errors.h"
 #include "zetasql/base/ret_check.h"
@@ -37,63 +45,384 @@ namespace spanner {
 namespace emulator {
 namespace backend {
 
+namespace {
+
+// Interval at which a blocked transaction retries wounding younger holders
+// which could not be aborted because they were busy.
+constexpr absl::Duration kWoundRetryInterval = absl::Milliseconds(5);
+
+// Returns true if the two lock modes are compatible.
+bool Compatible(LockMode a, LockMode b) {
+  return a == LockMode::kShared && b == LockMode::kShared;
+}
+
+// Returns true if locks in the given modes on the given sorted column lists of
+// the same rows conflict. See LockRequest for what each lock covers.
+bool Conflicts(LockMode a_mode, const std::vector<ColumnID>& a_column_ids,
+               LockMode b_mode, const std::vector<ColumnID>& b_column_ids) {
+  if (Compatible(a_mode, b_mode)) {
+    return false;
+  }
+  // Exclusive locks without columns lock whole rows.
+  if ((a_mode == LockMode::kExclusive && a_column_ids.empty()) ||
+      (b_mode == LockMode::kExclusive && b_column_ids.empty())) {
+    return true;
+  }
+  // Otherwise one of the locks is held by an update, which does not lock the
+  // existence of the rows, so the locks only conflict on common columns.
+  auto a = a_column_ids.begin();
+  auto b = b_column_ids.begin();
+  while (a != a_column_ids.end() && b != b_column_ids.end()) {
+    if (*a == *b) {
+      return true;
+    }
+    if (*a < *b) {
+      ++a;
+    } else {
+      ++b;
+    }
+  }
+  return false;
+}
+
+// Returns the union of the given sorted column lists.
+std::vector<ColumnID> MergeColumnIDs(const std::vector<ColumnID>& a,
+                                     const std::vector<ColumnID>& b) {
+  std::vector<ColumnID> merged;
+  merged.reserve(a.size() + b.size());
+  std::set_union(a.begin(), a.end(), b.begin(), b.end(),
+                 std::back_inserter(merged));
+  return merged;
+}
+
+// Returns the given key range in ClosedOpen form.
+KeyRange ClosedOpen(const KeyRange& range) {
+  return range.IsClosedOpen() ? range : range.ToClosedOpen();
+}
+
+// Returns true if 'range' is the ClosedOpen range covering a single key or key
+// prefix, i.e. [k, k+).
+bool IsKeyLockRange(const KeyRange& range) {
+  return range.limit_key() == range.start_key().ToPrefixLimit();
+}
+
+// Returns true if the two ClosedOpen ranges overlap.
+bool Overlaps(const KeyRange& a, const KeyRange& b) {
+  return a.start_key() < b.limit_key() && b.start_key() < a.limit_key();
+}
+
+// Returns the first n columns of the given key, with their sort order.
+Key KeyPrefix(const Key& key, int n) {
+  Key prefix;
+  for (int i = 0; i < n; ++i) {
+    prefix.AddColumn(key.ColumnValue(i), key.IsColumnDescending(i),
+                     key.IsColumnNullsLast(i));
+  }
+  return prefix;
+}
+
+// Returns true if the transaction with 'a_priority' and 'a_tid' is older than
+// the transaction with 'b_priority' and 'b_tid'. Transactions with lower
+// priority values started earlier, and ties are broken by transaction id.
+bool IsOlder(TransactionPriority a_priority, TransactionID a_tid,
+             TransactionPriority b_priority, TransactionID b_tid) {
+  return std::make_pair(a_priority, a_tid) < std::make_pair(b_priority, b_tid);
+}
+
+}  // namespace
+
 std::unique_ptr<LockHandle> LockManager::CreateHandle(
     TransactionID tid, const std::function<absl::Status()>& abort_fn,
     TransactionPriority priority) {
   return absl::WrapUnique(new LockHandle(this, tid, abort_fn, priority));
 }
 
-void LockManager::EnqueueLock(LockHandle* handle, const LockRequest& request) {
-  absl::MutexLock lock(&mu_);
+std::vector<LockHandle*> LockManager::FindConflicts(
+    LockHandle* handle, const LockRequest& request) {
+  std::vector<LockHandle*> conflicts;
+  auto add_conflict = [&](LockHandle* holder) {
+    if (holder != handle && std::find(conflicts.begin(), conflicts.end(),
+                                      holder) == conflicts.end()) {
+      conflicts.push_back(holder);
+    }
+  };
 
-  // Don't hand out locks to aborted handles.
-  if (handle->IsAborted()) {
+  if (database_lock_holder_ != nullptr) {
+    add_conflict(database_lock_holder_);
+  }
+
+  if (request.IsDatabaseLock()) {
+    for (const auto& [holder, state] : handle_states_) {
+      if (state.holds_database_lock || !state.key_locks.empty() ||
+          !state.tables_with_range_locks.empty()) {
+        add_conflict(holder);
+      }
+    }
+    return conflicts;
+  }
+
+  auto table_itr = table_locks_.find(request.table_id());
+  if (table_itr == table_locks_.end()) {
+    return conflicts;
+  }
+  const TableLocks& table = table_itr->second;
+  const KeyRange range = ClosedOpen(request.key_range());
+  if (range.start_key() >= range.limit_key()) {
+    return conflicts;
+  }
+  auto check = [&](const HeldLock& held) {
+    if (Conflicts(held.mode, held.column_ids, request.mode(),
+                  request.column_ids())) {
+      add_conflict(held.holder);
+    }
+  };
+
+  // Key locks starting within the range overlap it.
+  for (auto itr = table.key_locks.lower_bound(range.start_key());
+       itr != table.key_locks.end() && itr->first < range.limit_key(); ++itr) {
+    check(itr->second);
+  }
+  // Key locks starting before the range overlap it only if they lock a prefix
+  // of the range's start key.
+  for (int i = 0; i < range.start_key().NumColumns(); ++i) {
+    auto [begin, end] =
+        table.key_locks.equal_range(KeyPrefix(range.start_key(), i));
+    for (auto itr = begin; itr != end; ++itr) {
+      check(itr->second);
+    }
+  }
+  for (const auto& [held_range, held] : table.range_locks) {
+    if (Overlaps(held_range, range)) {
+      check(held);
+    }
+  }
+  return conflicts;
+}
+
+void LockManager::Grant(LockHandle* handle, const LockRequest& request) {
+  HandleState& state = handle_states_[handle];
+  if (request.IsDatabaseLock()) {
+    database_lock_holder_ = handle;
+    state.holds_database_lock = true;
     return;
   }
 
-  // If there is no transaction holding the lock, we grant it.
-  if (active_handle_ == nullptr) {
-    active_handle_ = handle;
+  const KeyRange range = ClosedOpen(request.key_range());
+  if (range.start_key() >= range.limit_key()) {
     return;
   }
+  TableLocks* table = &table_locks_[request.table_id()];
+
+  // Requests for more columns of rows already locked by this transaction in
+  // the same mode extend the held lock in place instead of adding another
+  // entry.
+  auto upgrade = [&](HeldLock& held) {
+    if (held.holder != handle || held.mode != request.mode()) {
+      return false;
+    }
+    if (request.LocksWholeRows() ||
+        (held.mode == LockMode::kExclusive && held.column_ids.empty())) {
+      held.column_ids.clear();
+    } else {
+      held.column_ids = MergeColumnIDs(held.column_ids, request.column_ids());
+    }
+    return true;
+  };
 
-  // If the requesting transaction is already holding the lock, we grant it.
-  if (active_handle_->tid() == handle->tid()) {
+  if (IsKeyLockRange(range)) {
+    auto [begin, end] = table->key_locks.equal_range(range.start_key());
+    for (auto itr = begin; itr != end; ++itr) {
+      if (upgrade(itr->second)) {
+        return;
+      }
+    }
+    auto itr = table->key_locks.emplace(
+        range.start_key(),
+        HeldLock{handle, request.mode(), request.column_ids()});
+    state.key_locks.emplace_back(table, itr);
     return;
   }
 
-  // If we reached here, another transaction is already holding the lock.
-  // Randomly abort the current transaction to ensure that starting a new
-  // transaction is not blocked by the current transaction if this is waiting
-  // for a new transaction to finish.
-  absl::BitGen gen;
-  if (absl::uniform_int_distribution<int>(1, 100)(gen) <=
-      config::abort_current_transaction_probability()) {
-    auto could_be_aborted = active_handle_->TryAbortTransaction(
-        error::AbortCurrentTransaction(active_handle_->tid(), handle->tid()));
-    if (could_be_aborted.ok()) {
-      active_handle_ = handle;
+  for (auto& [held_range, held] : table->range_locks) {
+    if (held_range == range && upgrade(held)) {
       return;
     }
   }
+  table->range_locks.emplace_back(
+      range, HeldLock{handle, request.mode(), request.column_ids()});
+  state.tables_with_range_locks.insert(table);
+}
+
+bool LockManager::Wound(LockHandle* requester, LockHandle* holder) {
+  HandleState& state = handle_states_[holder];
+  if (state.commit_timestamp.has_value() || !holder->CanBeAborted()) {
+    return false;
+  }
 
-  // Couldn't abort the transaction currently holding the lock, so abort the
-  // new transaction.
-  handle->Abort(
-      error::AbortConcurrentTransaction(handle->tid(), active_handle_->tid()));
+  absl::Status status =
+      error::AbortCurrentTransaction(holder->tid(), requester->tid());
+  if (state.waiting) {
+    // The holder is blocked in Wait() and will observe the abort when it wakes
+    // up.
+    AbortHandle(holder, status);
+    return true;
+  }
+  if (holder->TryAbortTransaction(status).ok()) {
+    ReleaseLocks(holder);
+    state.pending.clear();
+    return true;
+  }
+
+  // The holder is busy executing an operation. Abort it on its next lock
+  // request or commit, and let the requester retry in the meantime.
+  state.wounded_by = requester->tid();
+  return false;
 }
 
-void LockManager::UnlockAll(LockHandle* handle) {
+LockHandle* LockManager::TryGrantPending(LockHandle* handle) {
+  HandleState& state = handle_states_[handle];
+  while (!state.pending.empty()) {
+    const PendingRequest& pending = state.pending.front();
+    LockHandle* blocker = nullptr;
+    for (LockHandle* holder : FindConflicts(handle, pending.request)) {
+      bool may_wound = pending.may_wound_older ||
+                       (!pending.request.IsDatabaseLock() &&
+                        IsOlder(handle->priority(), handle->tid(),
+                                holder->priority(), holder->tid()));
+      if (may_wound && Wound(handle, holder)) {
+        continue;
+      }
+      if (blocker == nullptr) {
+        blocker = holder;
+      }
+    }
+    if (blocker != nullptr) {
+      return blocker;
+    }
+    Grant(handle, pending.request);
+    state.pending.erase(state.pending.begin());
+  }
+  return nullptr;
+}
+
+void LockManager::ReleaseLocks(LockHandle* handle) {
+  auto state_itr = handle_states_.find(handle);
+  if (state_itr == handle_states_.end()) {
+    return;
+  }
+  HandleState& state = state_itr->second;
+  for (auto& [table, itr] : state.key_locks) {
+    table->key_locks.erase(itr);
+  }
+  state.key_locks.clear();
+  for (TableLocks* table : state.tables_with_range_locks) {
+    table->range_locks.erase(
+        std::remove_if(table->range_locks.begin(), table->range_locks.end(),
+                       [handle](const auto& entry) {
+                         return entry.second.holder == handle;
+                       }),
+        table->range_locks.end());
+  }
+  state.tables_with_range_locks.clear();
+  if (state.holds_database_lock) {
+    database_lock_holder_ = nullptr;
+    state.holds_database_lock = false;
+  }
+  locks_released_cvar_.SignalAll();
+}
+
+void LockManager::AbortHandle(LockHandle* handle, const absl::Status& status) {
+  handle->Abort(status);
+  ReleaseLocks(handle);
+  handle_states_[handle].pending.clear();
+}
+
+void LockManager::EnqueueLock(LockHandle* handle, const LockRequest& request) {
   absl::MutexLock lock(&mu_);
 
-  // If the transaction does not hold the lock, there is nothing to do.
-  if (active_handle_ == nullptr || active_handle_->tid() != handle->tid()) {
-    handle->Reset();
+  // Don't hand out locks to aborted handles.
+  if (handle->IsAborted()) {
     return;
   }
 
-  // Clear the active transaction if it holds the lock.
-  active_handle_ = nullptr;
+  HandleState& state = handle_states_[handle];
+  if (state.wounded_by.has_value()) {
+    AbortHandle(handle, error::AbortCurrentTransaction(handle->tid(),
+                                                       *state.wounded_by));
+    return;
+  }
+
+  absl::BitGen gen;
+  bool may_wound_older = absl::uniform_int_distribution<int>(1, 100)(gen) <=
+                         config::abort_current_transaction_probability();
+  state.pending.push_back(PendingRequest{request, may_wound_older});
+  LockHandle* blocker = TryGrantPending(handle);
+
+  // Database-wide locks are never queued. If a conflicting transaction could
+  // not be aborted, the request is denied.
+  if (blocker != nullptr && request.IsDatabaseLock()) {
+    AbortHandle(handle, error::AbortConcurrentTransaction(handle->tid(),
+                                                          blocker->tid()));
+  }
+}
+
+bool LockManager::IsBlocked(LockHandle* handle) {
+  absl::MutexLock lock(&mu_);
+  auto state_itr = handle_states_.find(handle);
+  return state_itr != handle_states_.end() &&
+         !state_itr->second.pending.empty();
+}
+
+void LockManager::Wait(LockHandle* handle) {
+  absl::MutexLock lock(&mu_);
+  absl::Time start = absl::Now();
+  absl::Time deadline =
+      start + absl::Milliseconds(config::lock_wait_timeout_ms());
+
+  // The request which blocked the handle first. The whole wait is attributed
+  // to it.
+  std::optional<LockRequest> blocked_request;
+  while (true) {
+    auto state_itr = handle_states_.find(handle);
+    if (state_itr == handle_states_.end() || handle->IsAborted()) {
+      break;
+    }
+    HandleState& state = state_itr->second;
+    LockHandle* blocker = TryGrantPending(handle);
+    if (blocker == nullptr) {
+      break;
+    }
+    if (!blocked_request.has_value()) {
+      blocked_request = state.pending.front().request;
+    }
+    if (absl::Now() >= deadline) {
+      AbortHandle(handle, error::AbortConcurrentTransaction(handle->tid(),
+                                                            blocker->tid()));
+      break;
+    }
+    state.waiting = true;
+    locks_released_cvar_.WaitWithDeadline(
+        &mu_, std::min(deadline, absl::Now() + kWoundRetryInterval));
+    state.waiting = false;
+  }
+  if (blocked_request.has_value()) {
+    handle->AddLockWait(LockWait{*blocked_request, absl::Now() - start});
+  }
+}
+
+void LockManager::UnlockAll(LockHandle* handle) {
+  absl::MutexLock lock(&mu_);
+  auto state_itr = handle_states_.find(handle);
+  if (state_itr != handle_states_.end()) {
+    ReleaseLocks(handle);
+    // Release the hold on a reserved commit timestamp that was never marked
+    // committed.
+    if (state_itr->second.commit_timestamp.has_value()) {
+      pending_commit_timestamps_.erase(*state_itr->second.commit_timestamp);
+      pending_commit_cvar_.SignalAll();
+    }
+    handle_states_.erase(state_itr);
+  }
   handle->Reset();
 }
 
@@ -101,30 +430,44 @@ absl::StatusOr<absl::Time> LockManager::ReserveCommitTimestamp(
     LockHandle* handle) {
   absl::MutexLock lock(&mu_);
 
-  // If there is no transaction holding the lock, we grant it to the transaction
-  // requesting commit timestamp. This can happen if transaction has empty
-  // mutations and write locks weren't thus acquired yet.
-  if (active_handle_ == nullptr) {
-    active_handle_ = handle;
-  } else if (active_handle_->tid() != handle->tid()) {
-    // There is another active transaction, abort this transaction.
+  // Transactions wounded while they were busy are aborted before they commit.
+  HandleState& state = handle_states_[handle];
+  if (state.wounded_by.has_value()) {
+    absl::Status status =
+        error::AbortCurrentTransaction(handle->tid(), *state.wounded_by);
+    AbortHandle(handle, status);
+    return status;
+  }
+
+  // A transaction which did not acquire any locks (e.g. one with empty
+  // mutations) cannot commit while another transaction holds a database-wide
+  // lock.
+  if (database_lock_holder_ != nullptr && database_lock_holder_ != handle) {
     return error::AbortConcurrentTransaction(handle->tid(),
-                                             active_handle_->tid());
+                                             database_lock_holder_->tid());
   }
 
-  pending_commit_timestamp_ = clock_->Now();
-  return pending_commit_timestamp_;
+  ZETASQL_RET_CHECK(!state.commit_timestamp.has_value())
+      << absl::Substitute("Transaction $0 already reserved a commit timestamp.",
+                          handle->tid());
+  state.commit_timestamp = clock_->Now();
+  pending_commit_timestamps_.insert(*state.commit_timestamp);
+  return *state.commit_timestamp;
 }
 
 absl::Status LockManager::MarkCommitted(LockHandle* handle) {
   absl::MutexLock lock(&mu_);
 
-  // This transaction should have been set as the active transaction.
-  ZETASQL_RET_CHECK_EQ(active_handle_->tid(), handle->tid())
-      << absl::Substitute("Transaction $0 is not active.", handle->tid());
+  // This transaction should have reserved a commit timestamp.
+  auto state_itr = handle_states_.find(handle);
+  ZETASQL_RET_CHECK(state_itr != handle_states_.end() &&
+            state_itr->second.commit_timestamp.has_value())
+      << absl::Substitute("Transaction $0 is not committing.", handle->tid());
 
-  last_commit_timestamp_ = pending_commit_timestamp_;
-  pending_commit_timestamp_ = absl::InfiniteFuture();
+  absl::Time commit_timestamp = *state_itr->second.commit_timestamp;
+  state_itr->second.commit_timestamp.reset();
+  last_commit_timestamp_ = std::max(last_commit_timestamp_, commit_timestamp);
+  pending_commit_timestamps_.erase(commit_timestamp);
   pending_commit_cvar_.SignalAll();
   return absl::OkStatus();
 }
@@ -138,7 +481,8 @@ void LockManager::WaitForSafeRead(absl::Time read_time) {
   bool f = false;
   mu_.AwaitWithDeadline(absl::Condition(&f), read_time);
 
-  while (pending_commit_timestamp_ < read_time) {
+  while (!pending_commit_timestamps_.empty() &&
+         *pending_commit_timestamps_.begin() < read_time) {
     pending_commit_cvar_.Wait(&mu_);
   }
 }
@@ -17,15 +17,26 @@
 #ifndef THIRD_PARTY_CLOUD_SPANNER_EMULATOR_BACKEND_LOCKING_MANAGER_H_
 #define THIRD_PARTY_CLOUD_SPANNER_EMULATOR_BACKEND_LOCKING_MANAGER_H_
 
+#include <functional>
+#include <map>
 #include <memory>
+#include <optional>
+#include <set>
+#include <utility>
+#include <vector>
 
 #include "absl/base/thread_annotations.h"
+#include "absl/container/flat_hash_set.h"
+#include "absl/container/node_hash_map.h"
 #include "absl/status/status.h"
 #include "absl/status/statusor.h"
 #include "absl/synchronization/mutex.h"
 #include "absl/time/time.h"
 #include "backend/common/ids.h"
+#include "backend/datamodel/key.h"
+#include "backend/datamodel/key_range.h"
 #include "backend/locking/handle.h"
+#include "backend/locking/request.h"
 #include "common/clock.h"
 
 namespace google {
@@ -40,9 +51,22 @@ namespace backend {
 // happens via the LockHandle. See LockHandle methods for more details about
 // this interaction.
 //
-// We currently only implement a whole-database lock. The interface is generic
-// to avoid irreversibly baking the single-lock assumption into the rest of the
-// system.
+// Locks are shared or exclusive locks on columns of key ranges of a table, so
+// that transactions touching disjoint rows, or disjoint columns of the same
+// rows, can run and commit concurrently.
+// Conflicts are resolved with wound-wait using the transaction priority: a
+// transaction requesting a lock held by a younger transaction (one with a
+// larger priority value) wounds it, aborting the holder and taking over its
+// locks, while a younger requester waits for the older holder to release its
+// locks. Waits are bounded by config::lock_wait_timeout_ms(), after which the
+// requester is aborted. Transactions which have started to commit are never
+// wounded.
+//
+// A request with an empty table id is a database-wide lock which conflicts with
+// every lock held by other transactions. It is used by schema changes and is
+// never queued: if it conflicts with other transactions, it either wounds them
+// (with probability config::abort_current_transaction_probability()) or is
+// denied immediately.
 class LockManager {
  public:
   explicit LockManager(Clock* clock) : clock_(clock) {}
@@ -62,17 +86,109 @@ class LockManager {
   friend class LockHandle;
   void EnqueueLock(LockHandle* handle, const LockRequest& request)
       ABSL_LOCKS_EXCLUDED(mu_);
+  bool IsBlocked(LockHandle* handle) ABSL_LOCKS_EXCLUDED(mu_);
+  void Wait(LockHandle* handle) ABSL_LOCKS_EXCLUDED(mu_);
   void UnlockAll(LockHandle* handle) ABSL_LOCKS_EXCLUDED(mu_);
   absl::StatusOr<absl::Time> ReserveCommitTimestamp(LockHandle* handle)
       ABSL_LOCKS_EXCLUDED(mu_);
   absl::Status MarkCommitted(LockHandle* handle) ABSL_LOCKS_EXCLUDED(mu_);
   void WaitForSafeRead(absl::Time read_time) ABSL_LOCKS_EXCLUDED(mu_);
 
+  // A lock granted to a transaction on the given sorted columns. See
+  // LockRequest for what the lock covers.
+  struct HeldLock {
+    LockHandle* holder;
+    LockMode mode;
+    std::vector<ColumnID> column_ids;
+  };
+
+  // Locks granted on a single table. Locks on a single key or key prefix (the
+  // ranges produced by KeyRange::Point and KeyRange::Prefix) are indexed by
+  // their start key so that conflicts can be found with a few seeks. Other
+  // ranges, typically from scans, are checked linearly.
+  struct TableLocks {
+    std::multimap<Key, HeldLock> key_locks;
+    std::vector<std::pair<KeyRange, HeldLock>> range_locks;
+  };
+
+  // A lock request which has not been granted yet.
+  struct PendingRequest {
+    LockRequest request;
+
+    // Whether the request may wound conflicting holders regardless of their
+    // age. Decided once per request from
+    // config::abort_current_transaction_probability().
+    bool may_wound_older;
+  };
+
+  // Lock state of a single transaction.
+  struct HandleState {
+    // Requests not granted yet, in the order they were enqueued.
+    std::vector<PendingRequest> pending;
+
+    // Locks granted to the transaction.
+    std::vector<std::pair<TableLocks*, std::multimap<Key, HeldLock>::iterator>>
+        key_locks;
+    absl::flat_hash_set<TableLocks*> tables_with_range_locks;
+    bool holds_database_lock = false;
+
+    // True while the transaction is blocked in Wait().
+    bool waiting = false;
+
+    // Set if an older transaction tried to wound this transaction while it
+    // could not be aborted. The transaction is aborted on its next lock
+    // request or commit.
+    std::optional<TransactionID> wounded_by;
+
+    // Commit timestamp reserved by the transaction, if any.
+    std::optional<absl::Time> commit_timestamp;
+  };
+
+  // Returns the handles other than 'handle' which hold locks that conflict
+  // with 'request'.
+  std::vector<LockHandle*> FindConflicts(LockHandle* handle,
+                                         const LockRequest& request)
+      ABSL_EXCLUSIVE_LOCKS_REQUIRED(mu_);
+
+  // Records 'request' as granted to 'handle'.
+  void Grant(LockHandle* handle, const LockRequest& request)
+      ABSL_EXCLUSIVE_LOCKS_REQUIRED(mu_);
+
+  // Grants pending requests of 'handle' in order, wounding conflicting holders
+  // where allowed. Returns the holder blocking the first request which could
+  // not be granted, or nullptr if all pending requests were granted.
+  LockHandle* TryGrantPending(LockHandle* handle)
+      ABSL_EXCLUSIVE_LOCKS_REQUIRED(mu_);
+
+  // Tries to abort 'holder' on behalf of 'requester'. Returns true and
+  // releases the locks of 'holder' if it was aborted.
+  bool Wound(LockHandle* requester, LockHandle* holder)
+      ABSL_EXCLUSIVE_LOCKS_REQUIRED(mu_);
+
+  // Releases all locks granted to 'handle' and wakes up waiters.
+  void ReleaseLocks(LockHandle* handle) ABSL_EXCLUSIVE_LOCKS_REQUIRED(mu_);
+
+  // Aborts 'handle' with 'status', dropping its pending requests and releasing
+  // its locks.
+  void AbortHandle(LockHandle* handle, const absl::Status& status)
+      ABSL_EXCLUSIVE_LOCKS_REQUIRED(mu_);
+
   // Mutex to guard state below.
   absl::Mutex mu_;
 
-  // The currently active transaction (only one transaction can be active).
-  LockHandle* active_handle_ ABSL_GUARDED_BY(mu_) = nullptr;
+  // Locks granted on each table.
+  absl::node_hash_map<TableID, TableLocks> table_locks_ ABSL_GUARDED_BY(mu_);
+
+  // Lock state of each transaction which requested locks or a commit
+  // timestamp.
+  absl::node_hash_map<LockHandle*, HandleState> handle_states_
+      ABSL_GUARDED_BY(mu_);
+
+  // The transaction holding the database-wide lock, if any.
+  LockHandle* database_lock_holder_ ABSL_GUARDED_BY(mu_) = nullptr;
+
+  // Signals that locks were released.
+  absl::CondVar locks_released_cvar_ ABSL_GUARDED_BY(mu_);
 
   // System wide monotonic clock used to provide commit and read timestamps.
   Clock* clock_;
@@ -80,11 +196,10 @@ class LockManager {
   // Timestamp at which last schema update or commit completed.
   absl::Time last_commit_timestamp_ ABSL_GUARDED_BY(mu_) = absl::InfinitePast();
 
-  // Commit timestamp being used by an in-progress commit.
-  absl::Time pending_commit_timestamp_ ABSL_GUARDED_BY(mu_) =
-      absl::InfiniteFuture();
+  // Commit timestamps being used by in-progress commits.
+  std::set<absl::Time> pending_commit_timestamps_ ABSL_GUARDED_BY(mu_);
 
-  // Signals completion of pending commit.
+  // Signals completion of pending commits.
   absl::CondVar pending_commit_cvar_ ABSL_GUARDED_BY(mu_);
 };
 
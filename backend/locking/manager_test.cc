@@ -25,9 +25,14 @@
 #include "gmock/gmock.h"
 #include "gtest/gtest.h"
 #include "zetasql/base/testing/status_matchers.h"
+#include "zetasql/public/value.h"
 #include "tests/common/proto_matchers.h"
+#include "absl/flags/reflection.h"
 #include "absl/time/clock.h"
 #include "backend/common/ids.h"
+#include "backend/datamodel/key.h"
+#include "backend/datamodel/key_range.h"
+#include "common/config.h"
 
 namespace google {
 namespace spanner {
@@ -36,10 +41,15 @@ namespace backend {
 
 namespace {
 
+using zetasql::values::Int64;
+
 class LockManagerTest : public testing::Test {
  public:
   LockManagerTest()
-      : request_(LockMode::kExclusive, "table", KeyRange::All(), {}) {}
+      : request_(LockMode::kExclusive, "table", KeyRange::All(), {}) {
+    // Keep conflicting lock waits short.
+    config::set_lock_wait_timeout_ms(10);
+  }
 
   Clock* clock() { return &clock_; }
   LockManager* manager() { return &manager_; }
@@ -49,6 +59,7 @@ class LockManagerTest : public testing::Test {
   Clock clock_;
   LockManager manager_ = LockManager(&clock_);
   LockRequest request_;
+  absl::FlagSaver flag_saver_;
 };
 
 TEST_F(LockManagerTest, SingleTransactionAcquiresLock) {
@@ -60,7 +71,7 @@ TEST_F(LockManagerTest, SingleTransactionAcquiresLock) {
   ZETASQL_EXPECT_OK(lh->Wait());
 }
 
-TEST_F(LockManagerTest, ConcurrentTransactionIsAborted) {
+TEST_F(LockManagerTest, ConflictingTransactionIsAbortedAfterTimeout) {
   std::unique_ptr<LockHandle> lh1 =
       manager()->CreateHandle(TransactionID(1),
                               /*try_abort_fn=*/nullptr, TransactionPriority(1));
@@ -75,12 +86,12 @@ TEST_F(LockManagerTest, ConcurrentTransactionIsAborted) {
   EXPECT_FALSE(lh1->IsBlocked());
   EXPECT_FALSE(lh1->IsAborted());
 
-  // Second transaction does not get the lock.
+  // Second transaction waits for the lock and gives up.
   lh2->EnqueueLock(request());
-  EXPECT_FALSE(lh2->IsBlocked());
-  EXPECT_TRUE(lh2->IsAborted());
+  EXPECT_TRUE(lh2->IsBlocked());
   EXPECT_THAT(lh2->Wait(),
               zetasql_base::testing::StatusIs(absl::StatusCode::kAborted));
+  EXPECT_FALSE(lh2->IsBlocked());
   EXPECT_TRUE(lh2->IsAborted());
 }
 
@@ -99,7 +110,7 @@ TEST_F(LockManagerTest, SequentialTransactionAcquiresLock) {
   lh1->EnqueueLock(request());
   ZETASQL_EXPECT_OK(lh1->Wait());
 
-  // Second transaction does not get the lock yet.
+  // Second transaction does not get the lock.
   lh2->EnqueueLock(request());
   EXPECT_THAT(lh2->Wait(),
               zetasql_base::testing::StatusIs(absl::StatusCode::kAborted));
@@ -116,6 +127,183 @@ TEST_F(LockManagerTest, SequentialTransactionAcquiresLock) {
   ZETASQL_EXPECT_OK(lh3->Wait());
 }
 
+TEST_F(LockManagerTest, DisjointKeysAreLockedConcurrently) {
+  std::unique_ptr<LockHandle> lh1 =
+      manager()->CreateHandle(TransactionID(1),
+                              /*try_abort_fn=*/nullptr, TransactionPriority(1));
+  std::unique_ptr<LockHandle> lh2 =
+      manager()->CreateHandle(TransactionID(2),
+                              /*try_abort_fn=*/nullptr, TransactionPriority(1));
+
+  lh1->EnqueueLock(LockRequest(LockMode::kExclusive, "table",
+                               KeyRange::Point(Key({Int64(1)})), {}));
+  ZETASQL_EXPECT_OK(lh1->Wait());
+
+  // Different keys and different tables do not conflict.
+  lh2->EnqueueLock(LockRequest(LockMode::kExclusive, "table",
+                               KeyRange::Point(Key({Int64(2)})), {}));
+  lh2->EnqueueLock(LockRequest(LockMode::kExclusive, "other_table",
+                               KeyRange::All(), {}));
+  EXPECT_FALSE(lh2->IsBlocked());
+  ZETASQL_EXPECT_OK(lh2->Wait());
+
+  // A range covering a locked key conflicts.
+  lh2->EnqueueLock(LockRequest(
+      LockMode::kShared, "table",
+      KeyRange::ClosedClosed(Key({Int64(0)}), Key({Int64(5)})), {}));
+  EXPECT_TRUE(lh2->IsBlocked());
+}
+
+TEST_F(LockManagerTest, SharedLocksAreCompatible) {
+  std::unique_ptr<LockHandle> lh1 =
+      manager()->CreateHandle(TransactionID(1),
+                              /*try_abort_fn=*/nullptr, TransactionPriority(1));
+  std::unique_ptr<LockHandle> lh2 =
+      manager()->CreateHandle(TransactionID(2),
+                              /*try_abort_fn=*/nullptr, TransactionPriority(1));
+  LockRequest shared(LockMode::kShared, "table", KeyRange::All(), {});
+
+  lh1->EnqueueLock(shared);
+  ZETASQL_EXPECT_OK(lh1->Wait());
+  lh2->EnqueueLock(shared);
+  EXPECT_FALSE(lh2->IsBlocked());
+  ZETASQL_EXPECT_OK(lh2->Wait());
+
+  // Upgrading to an exclusive lock conflicts with the other reader.
+  lh2->EnqueueLock(request());
+  EXPECT_TRUE(lh2->IsBlocked());
+}
+
+TEST_F(LockManagerTest, DisjointColumnsOfTheSameRowAreLockedConcurrently) {
+  std::unique_ptr<LockHandle> lh1 =
+      manager()->CreateHandle(TransactionID(1),
+                              /*try_abort_fn=*/nullptr, TransactionPriority(1));
+  std::unique_ptr<LockHandle> lh2 =
+      manager()->CreateHandle(TransactionID(2),
+                              /*try_abort_fn=*/nullptr, TransactionPriority(1));
+  std::unique_ptr<LockHandle> lh3 =
+      manager()->CreateHandle(TransactionID(3),
+                              /*try_abort_fn=*/nullptr, TransactionPriority(1));
+  const KeyRange row = KeyRange::Point(Key({Int64(1)}));
+
+  // Updates of different columns of the same row do not conflict, nor do they
+  // conflict with reads of the row's existence.
+  lh1->EnqueueLock(LockRequest(LockMode::kShared, "table", row, {}));
+  lh1->EnqueueLock(LockRequest(LockMode::kExclusive, "table", row, {"a"}));
+  ZETASQL_EXPECT_OK(lh1->Wait());
+  lh2->EnqueueLock(LockRequest(LockMode::kShared, "table", row, {}));
+  lh2->EnqueueLock(LockRequest(LockMode::kExclusive, "table", row, {"b"}));
+  EXPECT_FALSE(lh2->IsBlocked());
+  ZETASQL_EXPECT_OK(lh2->Wait());
+
+  // Reads and updates of an updated column conflict.
+  lh3->EnqueueLock(LockRequest(LockMode::kShared, "table", row, {"b", "c"}));
+  EXPECT_TRUE(lh3->IsBlocked());
+  lh2->UnlockAll();
+  ZETASQL_EXPECT_OK(lh3->Wait());
+  lh3->EnqueueLock(
+      LockRequest(LockMode::kExclusive, "table", KeyRange::All(), {"a"}));
+  EXPECT_TRUE(lh3->IsBlocked());
+}
+
+TEST_F(LockManagerTest, WholeRowLocksConflictWithColumnLocks) {
+  std::unique_ptr<LockHandle> lh1 =
+      manager()->CreateHandle(TransactionID(1),
+                              /*try_abort_fn=*/nullptr, TransactionPriority(1));
+  std::unique_ptr<LockHandle> lh2 =
+      manager()->CreateHandle(TransactionID(2),
+                              /*try_abort_fn=*/nullptr, TransactionPriority(1));
+  const KeyRange row = KeyRange::Point(Key({Int64(1)}));
+
+  lh1->EnqueueLock(LockRequest(LockMode::kExclusive, "table", row, {"a"}));
+  ZETASQL_EXPECT_OK(lh1->Wait());
+
+  // Inserts and deletes lock the whole row.
+  lh2->EnqueueLock(LockRequest(LockMode::kExclusive, "table", row, {}));
+  EXPECT_TRUE(lh2->IsBlocked());
+  lh1->UnlockAll();
+  ZETASQL_EXPECT_OK(lh2->Wait());
+
+  // Reading the existence of a row locked as a whole conflicts.
+  lh1->EnqueueLock(LockRequest(LockMode::kShared, "table", row, {}));
+  EXPECT_TRUE(lh1->IsBlocked());
+}
+
+TEST_F(LockManagerTest, OlderTransactionWoundsYoungerTransaction) {
+  config::set_abort_current_transaction_probability(0);
+
+  bool younger_aborted = false;
+  std::unique_ptr<LockHandle> older =
+      manager()->CreateHandle(TransactionID(1),
+                              /*try_abort_fn=*/nullptr, TransactionPriority(1));
+  std::unique_ptr<LockHandle> younger = manager()->CreateHandle(
+      TransactionID(2),
+      [&younger_aborted]() {
+        younger_aborted = true;
+        return absl::OkStatus();
+      },
+      TransactionPriority(2));
+
+  younger->EnqueueLock(request());
+  ZETASQL_EXPECT_OK(younger->Wait());
+
+  // The older transaction takes the lock from the younger one.
+  older->EnqueueLock(request());
+  EXPECT_FALSE(older->IsBlocked());
+  ZETASQL_EXPECT_OK(older->Wait());
+  EXPECT_TRUE(younger_aborted);
+  EXPECT_THAT(younger->Wait(),
+              zetasql_base::testing::StatusIs(absl::StatusCode::kAborted));
+}
+
+TEST_F(LockManagerTest, YoungerTransactionWaitsForOlderTransaction) {
+  config::set_lock_wait_timeout_ms(60 * 1000);
+
+  std::unique_ptr<LockHandle> older =
+      manager()->CreateHandle(TransactionID(1),
+                              /*try_abort_fn=*/nullptr, TransactionPriority(1));
+  std::unique_ptr<LockHandle> younger =
+      manager()->CreateHandle(TransactionID(2),
+                              /*try_abort_fn=*/nullptr, TransactionPriority(2));
+
+  older->EnqueueLock(request());
+  ZETASQL_EXPECT_OK(older->Wait());
+
+  younger->EnqueueLock(request());
+  EXPECT_TRUE(younger->IsBlocked());
+  std::thread unlocker([&older]() {
+    absl::SleepFor(absl::Milliseconds(10));
+    older->UnlockAll();
+  });
+  ZETASQL_EXPECT_OK(younger->Wait());
+  EXPECT_FALSE(younger->IsBlocked());
+  unlocker.join();
+}
+
+TEST_F(LockManagerTest, RecordsWaitsForConflictingLocks) {
+  std::unique_ptr<LockHandle> lh1 =
+      manager()->CreateHandle(TransactionID(1),
+                              /*try_abort_fn=*/nullptr, TransactionPriority(1));
+  std::unique_ptr<LockHandle> lh2 =
+      manager()->CreateHandle(TransactionID(2),
+                              /*try_abort_fn=*/nullptr, TransactionPriority(1));
+
+  // Locks granted without waiting are not recorded.
+  lh1->EnqueueLock(request());
+  ZETASQL_EXPECT_OK(lh1->Wait());
+  EXPECT_TRUE(lh1->TakeLockWaits().empty());
+
+  // Waits which time out are recorded as well.
+  lh2->EnqueueLock(request());
+  EXPECT_THAT(lh2->Wait(),
+              zetasql_base::testing::StatusIs(absl::StatusCode::kAborted));
+  std::vector<LockWait> waits = lh2->TakeLockWaits();
+  ASSERT_EQ(waits.size(), 1);
+  EXPECT_EQ(waits[0].request.table_id(), "table");
+  EXPECT_GE(waits[0].duration, absl::Milliseconds(10));
+  EXPECT_TRUE(lh2->TakeLockWaits().empty());
+}
+
 TEST_F(LockManagerTest, TransactionsThatDidNotAcquireLockCanReleaseIt) {
   std::unique_ptr<LockHandle> lh1 =
       manager()->CreateHandle(TransactionID(1),
@@ -16,6 +16,7 @@
 
 #include "backend/locking/request.h"
 
+#include <algorithm>
 #include <vector>
 
 namespace google {
@@ -29,7 +30,11 @@ LockRequest::LockRequest(LockMode mode, TableID table_id,
     : mode_(mode),
       table_id_(table_id),
       key_range_(key_range),
-      column_ids_(column_ids) {}
+      column_ids_(column_ids) {
+  std::sort(column_ids_.begin(), column_ids_.end());
+  column_ids_.erase(std::unique(column_ids_.begin(), column_ids_.end()),
+                    column_ids_.end());
+}
 
 }  // namespace backend
 }  // namespace emulator
@@ -19,6 +19,7 @@
 
 #include <vector>
 
+#include "absl/time/time.h"
 #include "backend/common/ids.h"
 #include "backend/datamodel/key_range.h"
 
@@ -34,11 +35,35 @@ enum class LockMode {
 };
 
 // LockRequest encapsulates a single lock request from a transaction.
+//
+// A request locks the given columns of the rows in its key range, so that
+// transactions writing disjoint columns of the same rows do not conflict.
+// Shared requests also lock the existence of the rows, which every read
+// observes. Exclusive requests without columns lock whole rows, including their
+// existence, and are used by inserts and deletes. Exclusive requests with
+// columns only lock those columns, as updates do not change which rows exist.
 class LockRequest {
  public:
   LockRequest(LockMode mode, TableID table_id, const KeyRange& key_range,
               const std::vector<ColumnID>& column_ids);
 
+  // Accessors.
+  LockMode mode() const { return mode_; }
+  const TableID& table_id() const { return table_id_; }
+  const KeyRange& key_range() const { return key_range_; }
+  const std::vector<ColumnID>& column_ids() const { return column_ids_; }
+
+  // Returns true if this request locks every column of the rows in its key
+  // range, as well as their existence.
+  bool LocksWholeRows() const {
+    return mode_ == LockMode::kExclusive && column_ids_.empty();
+  }
+
+  // Returns true if this request is for a database-wide lock, which conflicts
+  // with every lock held by other transactions. Database-wide locks are
+  // requested with an empty table id.
+  bool IsDatabaseLock() const { return table_id_.empty(); }
+
  private:
   // The mode in which we want to acquire the lock.
   LockMode mode_;
@@ -49,10 +74,17 @@ class LockRequest {
   // The range of keys we want to lock.
   KeyRange key_range_;
 
-  // The columns in this range that we want to lock.
+  // The columns in this range that we want to lock, sorted and deduplicated.
   std::vector<ColumnID> column_ids_;
 };
 
+// A wait of a transaction for a lock request which conflicted with locks held
+// by other transactions.
+struct LockWait {
+  LockRequest request;
+  absl::Duration duration;
+};
+
 }  // namespace backend
 }  // namespace emulator
 }  // namespace spanner
@@ -169,10 +169,16 @@ Catalog::Catalog(const Schema* schema, const FunctionCatalog* function_catalog,
                  zetasql::TypeFactory* type_factory,
                  const zetasql::AnalyzerOptions& options, RowReader* reader,
                  QueryEvaluator* query_evaluator,
-                 std::optional<std::string> change_stream_internal_lookup)
+                 std::optional<std::string> change_stream_internal_lookup,
+                 const SpannerSysStats* spanner_sys_stats,
+                 std::shared_ptr<const SystemCatalogs> system_catalogs)
     : schema_(schema),
       function_catalog_(function_catalog),
-      type_factory_(type_factory) {
+      type_factory_(type_factory),
+      spanner_sys_stats_(spanner_sys_stats),
+      system_catalogs_(system_catalogs != nullptr
+                           ? std::move(system_catalogs)
+                           : std::make_shared<const SystemCatalogs>()) {
   for (const auto* named_schema : schema->named_schemas()) {
     named_schemas_[named_schema->Name()] =
         std::make_unique<QueryableNamedSchema>(named_schema);
@@ -546,16 +552,42 @@ absl::Status Catalog::GetTableValuedFunctions(
   return absl::OkStatus();
 }
 
-zetasql::Catalog* Catalog::GetInformationSchemaCatalog() const {
+zetasql::Catalog* SystemCatalogs::GetInformationSchemaCatalog(
+    const Schema* schema, const SpannerSysCatalog* spanner_sys_catalog) const {
   absl::MutexLock lock(&mu_);
-  auto spanner_sys_catalog = GetSpannerSysCatalogWithoutLocks();
   if (!information_schema_catalog_) {
     information_schema_catalog_ = std::make_unique<InformationSchemaCatalog>(
-        InformationSchemaCatalog::kName, schema_, spanner_sys_catalog);
+        InformationSchemaCatalog::kName, schema, spanner_sys_catalog);
   }
   return information_schema_catalog_.get();
 }
 
+zetasql::Catalog* SystemCatalogs::GetPGInformationSchemaCatalog(
+    const Schema* schema, const SpannerSysCatalog* spanner_sys_catalog) const {
+  absl::MutexLock lock(&mu_);
+  if (!pg_information_schema_catalog_) {
+    pg_information_schema_catalog_ = std::make_unique<InformationSchemaCatalog>(
+        InformationSchemaCatalog::kPGName, schema, spanner_sys_catalog);
+  }
+  return pg_information_schema_catalog_.get();
+}
+
+zetasql::Catalog* SystemCatalogs::GetPGCatalog(
+    const zetasql::EnumerableCatalog* root_catalog,
+    const Schema* schema) const {
+  absl::MutexLock lock(&mu_);
+  if (!pg_catalog_) {
+    pg_catalog_ =
+        std::make_unique<postgres_translator::PGCatalog>(root_catalog, schema);
+  }
+  return pg_catalog_.get();
+}
+
+zetasql::Catalog* Catalog::GetInformationSchemaCatalog() const {
+  return system_catalogs_->GetInformationSchemaCatalog(schema_,
+                                                       GetSpannerSysCatalog());
+}
+
 SpannerSysCatalog* Catalog::GetSpannerSysCatalog() const {
   absl::MutexLock lock(&mu_);
   return GetSpannerSysCatalogWithoutLocks();
@@ -563,19 +595,15 @@ SpannerSysCatalog* Catalog::GetSpannerSysCatalog() const {
 
 SpannerSysCatalog* Catalog::GetSpannerSysCatalogWithoutLocks() const {
   if (!spanner_sys_catalog_) {
-    spanner_sys_catalog_ = std::make_unique<SpannerSysCatalog>();
+    spanner_sys_catalog_ =
+        std::make_unique<SpannerSysCatalog>(spanner_sys_stats_);
   }
   return spanner_sys_catalog_.get();
 }
 
 zetasql::Catalog* Catalog::GetPGInformationSchemaCatalog() const {
-  absl::MutexLock lock(&mu_);
-  auto spanner_sys_catalog = GetSpannerSysCatalogWithoutLocks();
-  if (!pg_information_schema_catalog_) {
-    pg_information_schema_catalog_ = std::make_unique<InformationSchemaCatalog>(
-        InformationSchemaCatalog::kPGName, schema_, spanner_sys_catalog);
-  }
-  return pg_information_schema_catalog_.get();
+  return system_catalogs_->GetPGInformationSchemaCatalog(
+      schema_, GetSpannerSysCatalog());
 }
 
 zetasql::Catalog* Catalog::GetNetFunctionsCatalog() const {
@@ -596,13 +624,8 @@ zetasql::Catalog* Catalog::GetPGFunctionsCatalog() const {
 }
 
 zetasql::Catalog* Catalog::GetPGCatalog() const {
-  absl::MutexLock lock(&mu_);
   if (schema_->dialect() == database_api::DatabaseDialect::POSTGRESQL) {
-    if (!pg_catalog_) {
-      pg_catalog_ =
-          std::make_unique<postgres_translator::PGCatalog>(this, schema_);
-    }
-    return pg_catalog_.get();
+    return system_catalogs_->GetPGCatalog(this, schema_);
   }
   return nullptr;
 }
@@ -44,6 +44,7 @@
 #include "backend/query/queryable_table.h"
 #include "backend/query/queryable_view.h"
 #include "backend/query/spanner_sys_catalog.h"
+#include "backend/query/spanner_sys_stats.h"
 #include "backend/schema/catalog/schema.h"
 #include "common/constants.h"
 
@@ -56,12 +57,57 @@ class NetCatalog;
 class PGFunctionCatalog;
 class PreparePropertyGraphCatalog;
 
+// The catalogs of the system tables of a schema version: INFORMATION_SCHEMA,
+// and for PostgreSQL databases, the PostgreSQL INFORMATION_SCHEMA and
+// pg_catalog. Their tables are filled from the whole schema when they are first
+// looked up, so the query engine builds them once per schema version and
+// shares them, read-only, between all the catalogs of that version. The schema
+// and catalogs passed to the getters are only used while the tables are filled.
+//
+// This class is thread-safe.
+class SystemCatalogs {
+ public:
+  // Returns the INFORMATION_SCHEMA catalog of 'schema', filling it if needed.
+  zetasql::Catalog* GetInformationSchemaCatalog(
+      const Schema* schema, const SpannerSysCatalog* spanner_sys_catalog) const
+      ABSL_LOCKS_EXCLUDED(mu_);
+
+  // Returns the PostgreSQL INFORMATION_SCHEMA catalog of 'schema', filling it
+  // if needed.
+  zetasql::Catalog* GetPGInformationSchemaCatalog(
+      const Schema* schema, const SpannerSysCatalog* spanner_sys_catalog) const
+      ABSL_LOCKS_EXCLUDED(mu_);
+
+  // Returns the pg_catalog catalog of 'schema', under 'root_catalog', filling
+  // it if needed.
+  zetasql::Catalog* GetPGCatalog(
+      const zetasql::EnumerableCatalog* root_catalog,
+      const Schema* schema) const ABSL_LOCKS_EXCLUDED(mu_);
+
+ private:
+  mutable absl::Mutex mu_;
+
+  // Information schema catalog (created only if accessed).
+  mutable std::unique_ptr<zetasql::Catalog> information_schema_catalog_
+      ABSL_GUARDED_BY(mu_);
+
+  // PG information schema catalog (created only if accessed).
+  mutable std::unique_ptr<zetasql::Catalog> pg_information_schema_catalog_
+      ABSL_GUARDED_BY(mu_);
+
+  // Sub-catalog for resolving pg_catalog lookup (created only if accessed).
+  mutable std::unique_ptr<zetasql::Catalog> pg_catalog_ ABSL_GUARDED_BY(mu_);
+};
+
 // Implementation of zetasql::Catalog for the root catalog in the catalog
 // hierarchy. For more details, see code of zetasql::Catalog.
 class Catalog : public zetasql::EnumerableCatalog {
  public:
   // 'reader' can be nullptr unless CreateEvaluatorTableIterator is called
-  // on tables in the catalog.
+  // on tables in the catalog. The SPANNER_SYS statistics tables are empty if
+  // 'spanner_sys_stats' is nullptr. The system tables are served from
+  // 'system_catalogs', which must belong to 'schema', or from catalogs of
+  // this catalog's own if it is nullptr.
   Catalog(
       const Schema* schema, const FunctionCatalog* function_catalog,
       zetasql::TypeFactory* type_factory,
@@ -69,7 +115,9 @@ class Catalog : public zetasql::EnumerableCatalog {
       const zetasql::AnalyzerOptions& options =
           MakeGoogleSqlAnalyzerOptions(kDefaultTimeZone),
       RowReader* reader = nullptr, QueryEvaluator* query_evaluator = nullptr,
-      std::optional<std::string> change_stream_internal_lookup = std::nullopt);
+      std::optional<std::string> change_stream_internal_lookup = std::nullopt,
+      const SpannerSysStats* spanner_sys_stats = nullptr,
+      std::shared_ptr<const SystemCatalogs> system_catalogs = nullptr);
 
   std::string FullName() const override {
     // The name of the root catalog is "".
@@ -202,16 +250,15 @@ class Catalog : public zetasql::EnumerableCatalog {
   // do not involve views.
   QueryEvaluator* query_evaluator_ = nullptr;
 
-  // Mutex to protect state below.
-  mutable absl::Mutex mu_;
+  // Source of the rows of the SPANNER_SYS statistics tables. May be unset.
+  const SpannerSysStats* spanner_sys_stats_ = nullptr;
 
-  // Information schema catalog (created only if accessed).
-  mutable std::unique_ptr<zetasql::Catalog> information_schema_catalog_
-      ABSL_GUARDED_BY(mu_);
+  // Catalogs of the system tables, possibly shared with the other catalogs of
+  // the schema.
+  std::shared_ptr<const SystemCatalogs> system_catalogs_;
 
-  // PG information schema catalog (created only if accessed).
-  mutable std::unique_ptr<zetasql::Catalog> pg_information_schema_catalog_
-      ABSL_GUARDED_BY(mu_);
+  // Mutex to protect state below.
+  mutable absl::Mutex mu_;
 
   // Spanner sys catalog (created only if accessed).
   mutable std::unique_ptr<SpannerSysCatalog> spanner_sys_catalog_
@@ -224,9 +271,6 @@ class Catalog : public zetasql::EnumerableCatalog {
   mutable std::unique_ptr<zetasql::Catalog> pg_function_catalog_
       ABSL_GUARDED_BY(mu_);
 
-  // Sub-catalog for resolving pg_catalog lookup.
-  mutable std::unique_ptr<zetasql::Catalog> pg_catalog_ ABSL_GUARDED_BY(mu_);
-
   // System Procedures available.
   CaseInsensitiveStringMap<std::unique_ptr<zetasql::Procedure>> procedures_;
 
@@ -0,0 +1,201 @@
+//
+// Copyright 2026 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "backend/query/deterministic_row_order.h"
+
+#include <optional>
+#include <vector>
+
+#include "zetasql/public/function.h"
+#include "zetasql/resolved_ast/resolved_ast.h"
+#include "zetasql/resolved_ast/resolved_ast_visitor.h"
+#include "absl/container/flat_hash_set.h"
+#include "absl/status/status.h"
+#include "common/constants.h"
+
+namespace google {
+namespace spanner {
+namespace emulator {
+namespace backend {
+
+namespace {
+
+// Finds the parts of a statement whose result may differ between executions
+// of the statement at the same timestamp.
+class NondeterminismFinder : public zetasql::ResolvedASTVisitor {
+ public:
+  // 'top_limit' is the LIMIT applied to the ordered rows of the query, if
+  // any, which picks the same rows in every execution.
+  explicit NondeterminismFinder(const zetasql::ResolvedScan* top_limit)
+      : top_limit_(top_limit) {}
+
+  bool found() const { return found_; }
+
+  absl::Status VisitResolvedFunctionCall(
+      const zetasql::ResolvedFunctionCall* node) override {
+    const zetasql::Function* function = node->function();
+    // GET_NEXT_SEQUENCE_VALUE is not declared volatile, but returns a new
+    // value on every call.
+    if (function->function_options().volatility !=
+            zetasql::FunctionEnums::IMMUTABLE ||
+        function->Name() == kGetNextSequenceValueFunctionName) {
+      found_ = true;
+      return absl::OkStatus();
+    }
+    return DefaultVisit(node);
+  }
+
+  // Aggregate and analytic functions may see their input rows in any order,
+  // which changes the result of e.g. ARRAY_AGG, ANY_VALUE or a floating point
+  // SUM.
+  absl::Status VisitResolvedAggregateFunctionCall(
+      const zetasql::ResolvedAggregateFunctionCall* node) override {
+    found_ = true;
+    return absl::OkStatus();
+  }
+
+  absl::Status VisitResolvedAnalyticFunctionCall(
+      const zetasql::ResolvedAnalyticFunctionCall* node) override {
+    found_ = true;
+    return absl::OkStatus();
+  }
+
+  absl::Status VisitResolvedSampleScan(
+      const zetasql::ResolvedSampleScan* node) override {
+    found_ = true;
+    return absl::OkStatus();
+  }
+
+  // A LIMIT within the query may pick different rows in each execution, even
+  // over ordered rows when their ordering has ties.
+  absl::Status VisitResolvedLimitOffsetScan(
+      const zetasql::ResolvedLimitOffsetScan* node) override {
+    if (node != top_limit_) {
+      found_ = true;
+      return absl::OkStatus();
+    }
+    return DefaultVisit(node);
+  }
+
+  absl::Status VisitResolvedSubqueryExpr(
+      const zetasql::ResolvedSubqueryExpr* node) override {
+    if (node->subquery_type() == zetasql::ResolvedSubqueryExpr::ARRAY &&
+        !node->subquery()->is_ordered()) {
+      found_ = true;
+      return absl::OkStatus();
+    }
+    return DefaultVisit(node);
+  }
+
+ private:
+  const zetasql::ResolvedScan* top_limit_;
+  bool found_ = false;
+};
+
+// Returns true if 'scan' reads from a single table and 'ordered_column_ids'
+// contains all the primary key columns of the table, so that no two rows of
+// the scan are ordered alike.
+bool OrdersPrimaryKey(const zetasql::ResolvedScan* scan,
+                      const absl::flat_hash_set<int>& ordered_column_ids) {
+  while (true) {
+    if (scan->Is<zetasql::ResolvedProjectScan>()) {
+      scan = scan->GetAs<zetasql::ResolvedProjectScan>()->input_scan();
+    } else if (scan->Is<zetasql::ResolvedFilterScan>()) {
+      scan = scan->GetAs<zetasql::ResolvedFilterScan>()->input_scan();
+    } else {
+      break;
+    }
+  }
+  if (!scan->Is<zetasql::ResolvedTableScan>()) {
+    return false;
+  }
+  const auto* table_scan = scan->GetAs<zetasql::ResolvedTableScan>();
+  std::optional<std::vector<int>> primary_key =
+      table_scan->table()->PrimaryKey();
+  if (!primary_key.has_value()) {
+    return false;
+  }
+  for (int key_column_index : *primary_key) {
+    bool ordered = false;
+    for (int i = 0; i < table_scan->column_index_list_size(); ++i) {
+      if (table_scan->column_index_list(i) == key_column_index &&
+          ordered_column_ids.contains(
+              table_scan->column_list(i).column_id())) {
+        ordered = true;
+        break;
+      }
+    }
+    if (!ordered) {
+      return false;
+    }
+  }
+  return true;
+}
+
+}  // namespace
+
+bool HasDeterministicRowOrder(const zetasql::ResolvedStatement* statement) {
+  if (!statement->Is<zetasql::ResolvedQueryStmt>()) {
+    return false;
+  }
+  const auto* query_stmt = statement->GetAs<zetasql::ResolvedQueryStmt>();
+
+  // Find the ORDER BY of the query. Only projections and a single LIMIT of the
+  // ordered rows may follow it.
+  const zetasql::ResolvedScan* top_limit = nullptr;
+  const zetasql::ResolvedScan* scan = query_stmt->query();
+  while (!scan->Is<zetasql::ResolvedOrderByScan>()) {
+    if (scan->Is<zetasql::ResolvedProjectScan>()) {
+      scan = scan->GetAs<zetasql::ResolvedProjectScan>()->input_scan();
+    } else if (scan->Is<zetasql::ResolvedLimitOffsetScan>() &&
+               top_limit == nullptr) {
+      top_limit = scan;
+      scan = scan->GetAs<zetasql::ResolvedLimitOffsetScan>()->input_scan();
+    } else {
+      return false;
+    }
+  }
+  const auto* order_by = scan->GetAs<zetasql::ResolvedOrderByScan>();
+  absl::flat_hash_set<int> ordered_column_ids;
+  for (const auto& item : order_by->order_by_item_list()) {
+    // Strings which differ may still be equal under a collation.
+    if (item->collation_name() != nullptr) {
+      return false;
+    }
+    ordered_column_ids.insert(item->column_ref()->column().column_id());
+  }
+
+  NondeterminismFinder finder(top_limit);
+  if (!query_stmt->Accept(&finder).ok() || finder.found()) {
+    return false;
+  }
+
+  // Rows which are ordered alike may come in any order, unless they are equal.
+  bool orders_all_columns = true;
+  for (const auto& column : query_stmt->output_column_list()) {
+    if (!ordered_column_ids.contains(column->column().column_id())) {
+      orders_all_columns = false;
+      break;
+    }
+  }
+  return orders_all_columns ||
+         OrdersPrimaryKey(order_by->input_scan(), ordered_column_ids);
+}
+
+}  // namespace backend
+}  // namespace emulator
+}  // namespace spanner
+}  // namespace google
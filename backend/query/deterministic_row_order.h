@@ -0,0 +1,45 @@
+//
+// Copyright 2026 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#ifndef THIRD_PARTY_CLOUD_SPANNER_EMULATOR_BACKEND_QUERY_DETERMINISTIC_ROW_ORDER_H_
+#define THIRD_PARTY_CLOUD_SPANNER_EMULATOR_BACKEND_QUERY_DETERMINISTIC_ROW_ORDER_H_
+
+#include "zetasql/resolved_ast/resolved_ast.h"
+
+namespace google {
+namespace spanner {
+namespace emulator {
+namespace backend {
+
+// Returns true if every execution of 'statement' at the same timestamp
+// produces the same rows in the same order.
+//
+// The evaluator scrambles the order of rows which a query does not order, so
+// this holds only for queries whose outermost ORDER BY either includes every
+// output column or includes the primary key of the single table they scan.
+// The query must also not call functions such as RAND() or CURRENT_TIMESTAMP()
+// which are evaluated anew for each execution, nor compute values which depend
+// on the order of unordered rows, e.g. through aggregate functions or LIMIT in
+// a subquery. The check is conservative: it may return false for queries which
+// are in fact deterministic.
+bool HasDeterministicRowOrder(const zetasql::ResolvedStatement* statement);
+
+}  // namespace backend
+}  // namespace emulator
+}  // namespace spanner
+}  // namespace google
+
+#endif  // THIRD_PARTY_CLOUD_SPANNER_EMULATOR_BACKEND_QUERY_DETERMINISTIC_ROW_ORDER_H_
@@ -0,0 +1,102 @@
+//
+// Copyright 2026 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "backend/query/force_index_rewriter.h"
+
+#include "zetasql/public/value.h"
+#include "zetasql/resolved_ast/resolved_ast.h"
+#include "absl/status/status.h"
+#include "absl/strings/match.h"
+#include "backend/query/queryable_table.h"
+#include "backend/schema/catalog/index.h"
+#include "backend/schema/catalog/table.h"
+#include "zetasql/base/status_macros.h"
+
+namespace google {
+namespace spanner {
+namespace emulator {
+namespace backend {
+
+namespace {
+
+// Returns the index named by the FORCE_INDEX hint of 'scan', or null if the
+// scan has no such hint or the hint names the base table.
+const Index* FindForcedIndex(const zetasql::ResolvedTableScan* scan) {
+  if (!scan->table()->Is<QueryableTable>()) {
+    return nullptr;
+  }
+  for (const auto& hint : scan->hint_list()) {
+    if (!(absl::EqualsIgnoreCase(hint->qualifier(), "spanner") ||
+          hint->qualifier().empty()) ||
+        !absl::EqualsIgnoreCase(hint->name(), "force_index") ||
+        hint->value()->node_kind() != zetasql::RESOLVED_LITERAL) {
+      continue;
+    }
+    const zetasql::Value& value =
+        hint->value()->GetAs<zetasql::ResolvedLiteral>()->value();
+    if (!value.type()->IsString() || value.is_null() ||
+        absl::EqualsIgnoreCase(value.string_value(), "_base_table")) {
+      return nullptr;
+    }
+    const Table* table =
+        scan->table()->GetAs<QueryableTable>()->wrapped_table();
+    return table->FindIndex(
+        table->FindIndexQualifiedName(value.string_value()));
+  }
+  return nullptr;
+}
+
+}  // namespace
+
+absl::Status ForceIndexRewriter::VisitResolvedTableScan(
+    const zetasql::ResolvedTableScan* node) {
+  ZETASQL_RETURN_IF_ERROR(CopyVisitResolvedTableScan(node));
+  if (dml_target_scans_.contains(node)) {
+    return absl::OkStatus();
+  }
+  const Index* index = FindForcedIndex(node);
+  if (index == nullptr || !IndexesEveryRow(index)) {
+    return absl::OkStatus();
+  }
+  zetasql::ResolvedTableScan* scan =
+      GetUnownedTopOfStack<zetasql::ResolvedTableScan>();
+  scan->set_table(
+      node->table()->GetAs<QueryableTable>()->WithForcedIndex(index));
+  return absl::OkStatus();
+}
+
+absl::Status ForceIndexRewriter::VisitResolvedInsertStmt(
+    const zetasql::ResolvedInsertStmt* node) {
+  dml_target_scans_.insert(node->table_scan());
+  return CopyVisitResolvedInsertStmt(node);
+}
+
+absl::Status ForceIndexRewriter::VisitResolvedUpdateStmt(
+    const zetasql::ResolvedUpdateStmt* node) {
+  dml_target_scans_.insert(node->table_scan());
+  return CopyVisitResolvedUpdateStmt(node);
+}
+
+absl::Status ForceIndexRewriter::VisitResolvedDeleteStmt(
+    const zetasql::ResolvedDeleteStmt* node) {
+  dml_target_scans_.insert(node->table_scan());
+  return CopyVisitResolvedDeleteStmt(node);
+}
+
+}  // namespace backend
+}  // namespace emulator
+}  // namespace spanner
+}  // namespace google
@@ -0,0 +1,62 @@
+//
+// Copyright 2026 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#ifndef THIRD_PARTY_CLOUD_SPANNER_EMULATOR_BACKEND_QUERY_FORCE_INDEX_REWRITER_H_
+#define THIRD_PARTY_CLOUD_SPANNER_EMULATOR_BACKEND_QUERY_FORCE_INDEX_REWRITER_H_
+
+#include "zetasql/resolved_ast/resolved_ast.h"
+#include "zetasql/resolved_ast/resolved_ast_deep_copy_visitor.h"
+#include "absl/container/flat_hash_set.h"
+#include "absl/status/status.h"
+
+namespace google {
+namespace spanner {
+namespace emulator {
+namespace backend {
+
+// Implements ResolvedASTDeepCopyVisitor to make table scans with a FORCE_INDEX
+// hint read their rows through the hinted index, by replacing the scanned
+// table with QueryableTable::WithForcedIndex().
+//
+// Expects the hints to have been validated by IndexHintValidator. Scans of the
+// base table, of managed indexes unknown to the schema, and of indexes which do
+// not hold an entry for every row of the table are left unchanged, as are the
+// target tables of DML statements.
+class ForceIndexRewriter : public zetasql::ResolvedASTDeepCopyVisitor {
+ public:
+  absl::Status VisitResolvedTableScan(
+      const zetasql::ResolvedTableScan* node) override;
+
+  absl::Status VisitResolvedInsertStmt(
+      const zetasql::ResolvedInsertStmt* node) override;
+
+  absl::Status VisitResolvedUpdateStmt(
+      const zetasql::ResolvedUpdateStmt* node) override;
+
+  absl::Status VisitResolvedDeleteStmt(
+      const zetasql::ResolvedDeleteStmt* node) override;
+
+ private:
+  // The table scans of DML target tables.
+  absl::flat_hash_set<const zetasql::ResolvedTableScan*> dml_target_scans_;
+};
+
+}  // namespace backend
+}  // namespace emulator
+}  // namespace spanner
+}  // namespace google
+
+#endif  // THIRD_PARTY_CLOUD_SPANNER_EMULATOR_BACKEND_QUERY_FORCE_INDEX_REWRITER_H_
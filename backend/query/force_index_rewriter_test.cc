@@ -0,0 +1,107 @@
+//
+// Copyright 2026 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "backend/query/force_index_rewriter.h"
+
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "zetasql/public/type.h"
+#include "zetasql/public/value.h"
+#include "zetasql/resolved_ast/resolved_ast.h"
+#include "zetasql/resolved_ast/resolved_column.h"
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "zetasql/base/testing/status_matchers.h"
+#include "backend/query/queryable_table.h"
+#include "backend/schema/catalog/schema.h"
+#include "backend/schema/catalog/table.h"
+#include "tests/common/schema_constructor.h"
+
+namespace google {
+namespace spanner {
+namespace emulator {
+namespace backend {
+
+namespace {
+
+class ForceIndexRewriterTest : public testing::Test {
+ public:
+  // Returns the table scanned by `SELECT string_col FROM test_table` with the
+  // given FORCE_INDEX hint, after rewriting.
+  const zetasql::Table* RewrittenScanTable(const std::string& index_name) {
+    zetasql::ResolvedColumn column(
+        /*column_id=*/1, zetasql::IdString::MakeGlobal("test_table"),
+        zetasql::IdString::MakeGlobal("string_col"),
+        zetasql::types::StringType());
+    std::unique_ptr<zetasql::ResolvedTableScan> scan =
+        zetasql::MakeResolvedTableScan({column}, &table_,
+                                         /*for_system_time_expr=*/nullptr);
+    scan->set_column_index_list({1});
+    scan->add_hint_list(zetasql::MakeResolvedOption(
+        /*qualifier=*/"spanner", "force_index",
+        zetasql::MakeResolvedLiteral(
+            zetasql::Value::StringValue(index_name))));
+    std::vector<std::unique_ptr<zetasql::ResolvedOutputColumn>>
+        output_columns;
+    output_columns.push_back(
+        zetasql::MakeResolvedOutputColumn("string_col", column));
+    std::unique_ptr<zetasql::ResolvedQueryStmt> statement =
+        zetasql::MakeResolvedQueryStmt(std::move(output_columns),
+                                         /*is_value_table=*/false,
+                                         std::move(scan));
+
+    ForceIndexRewriter rewriter;
+    ZETASQL_EXPECT_OK(statement->Accept(&rewriter));
+    rewritten_statement_ =
+        rewriter.ConsumeRootNode<zetasql::ResolvedQueryStmt>().value();
+    return rewritten_statement_->query()
+        ->GetAs<zetasql::ResolvedTableScan>()
+        ->table();
+  }
+
+  const Table* schema_table() { return schema_->FindTable("test_table"); }
+  const QueryableTable* table() { return &table_; }
+
+ private:
+  zetasql::TypeFactory type_factory_;
+  std::unique_ptr<const Schema> schema_ =
+      test::CreateSchemaWithOneTable(&type_factory_);
+  QueryableTable table_{schema_->FindTable("test_table"), /*reader=*/nullptr};
+  std::unique_ptr<zetasql::ResolvedQueryStmt> rewritten_statement_;
+};
+
+TEST_F(ForceIndexRewriterTest, ReadsHintedIndex) {
+  const zetasql::Table* scan_table = RewrittenScanTable("test_index");
+  ASSERT_TRUE(scan_table->Is<QueryableTable>());
+  EXPECT_NE(scan_table, table());
+  EXPECT_EQ(scan_table->GetAs<QueryableTable>()->forced_index(),
+            schema_table()->FindIndex("test_index"));
+  EXPECT_EQ(scan_table->Name(), table()->Name());
+}
+
+TEST_F(ForceIndexRewriterTest, KeepsBaseTable) {
+  EXPECT_EQ(RewrittenScanTable("_BASE_TABLE"), table());
+}
+
+}  // namespace
+
+}  // namespace backend
+}  // namespace emulator
+}  // namespace spanner
+}  // namespace google
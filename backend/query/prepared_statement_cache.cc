@@ -0,0 +1,117 @@
+//
+// Copyright 2026 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "backend/query/prepared_statement_cache.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <iterator>
+#include <map>
+#include <memory>
+#include <string>
+#include <utility>
+
+#include "zetasql/public/value.h"
+#include "absl/strings/str_cat.h"
+#include "absl/synchronization/mutex.h"
+#include "backend/schema/catalog/schema.h"
+
+namespace google {
+namespace spanner {
+namespace emulator {
+namespace backend {
+
+std::string PreparedStatementCache::MakeKey(
+    const Schema* schema, const std::string& sql,
+    const std::map<std::string, zetasql::Value>& declared_params) {
+  std::string key = absl::StrCat(static_cast<int>(schema->dialect()), ":",
+                                 schema->generation());
+  for (const auto& [name, value] : declared_params) {
+    absl::StrAppend(&key, ":", name, "=", value.type()->DebugString());
+  }
+  absl::StrAppend(&key, ":", sql);
+  return key;
+}
+
+std::unique_ptr<PreparedStatement> PreparedStatementCache::Take(
+    const std::string& key) {
+  absl::MutexLock lock(&mu_);
+  auto it = index_.find(key);
+  if (it == index_.end()) {
+    ++misses_;
+    return nullptr;
+  }
+  ++hits_;
+  std::unique_ptr<PreparedStatement> statement =
+      std::move(it->second->statement);
+  Erase(it->second);
+  return statement;
+}
+
+void PreparedStatementCache::Put(const std::string& key,
+                                 int64_t schema_generation, int64_t size_bytes,
+                                 std::unique_ptr<PreparedStatement> statement) {
+  absl::MutexLock lock(&mu_);
+  if (size_bytes > max_bytes_ ||
+      schema_generation < min_schema_generation_ || index_.contains(key)) {
+    return;
+  }
+  entries_.push_front(Entry{key, size_bytes, std::move(statement)});
+  index_[key] = entries_.begin();
+  size_bytes_ += size_bytes;
+  while (size_bytes_ > max_bytes_) {
+    Erase(std::prev(entries_.end()));
+  }
+}
+
+void PreparedStatementCache::Invalidate(int64_t schema_generation) {
+  absl::MutexLock lock(&mu_);
+  min_schema_generation_ = std::max(min_schema_generation_, schema_generation);
+  entries_.clear();
+  index_.clear();
+  size_bytes_ = 0;
+}
+
+void PreparedStatementCache::Erase(EntryList::iterator it) {
+  size_bytes_ -= it->size_bytes;
+  index_.erase(it->key);
+  entries_.erase(it);
+}
+
+int64_t PreparedStatementCache::hits() const {
+  absl::MutexLock lock(&mu_);
+  return hits_;
+}
+
+int64_t PreparedStatementCache::misses() const {
+  absl::MutexLock lock(&mu_);
+  return misses_;
+}
+
+int64_t PreparedStatementCache::size() const {
+  absl::MutexLock lock(&mu_);
+  return entries_.size();
+}
+
+int64_t PreparedStatementCache::size_bytes() const {
+  absl::MutexLock lock(&mu_);
+  return size_bytes_;
+}
+
+}  // namespace backend
+}  // namespace emulator
+}  // namespace spanner
+}  // namespace google
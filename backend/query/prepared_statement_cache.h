@@ -0,0 +1,131 @@
+//
+// Copyright 2026 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#ifndef THIRD_PARTY_CLOUD_SPANNER_EMULATOR_BACKEND_QUERY_PREPARED_STATEMENT_CACHE_H_
+#define THIRD_PARTY_CLOUD_SPANNER_EMULATOR_BACKEND_QUERY_PREPARED_STATEMENT_CACHE_H_
+
+#include <cstdint>
+#include <list>
+#include <map>
+#include <memory>
+#include <string>
+
+#include "zetasql/public/value.h"
+#include "absl/base/thread_annotations.h"
+#include "absl/container/flat_hash_map.h"
+#include "absl/synchronization/mutex.h"
+#include "backend/schema/catalog/schema.h"
+
+namespace google {
+namespace spanner {
+namespace emulator {
+namespace backend {
+
+// A statement which has been analyzed and prepared for execution against a
+// specific schema. Implemented by the query engine.
+class PreparedStatement {
+ public:
+  virtual ~PreparedStatement() = default;
+};
+
+// PreparedStatementCache is an LRU cache of prepared statements.
+//
+// A statement is taken out of the cache while it is being executed, and put
+// back once the execution is done, so that a prepared statement is never used
+// by two executions at the same time. Concurrent executions of the same
+// statement each prepare their own copy, and only one of them is kept.
+//
+// The cache is bounded by the estimated memory used by its statements. Entries
+// are keyed by the schema generation they were prepared against, and all of
+// them are dropped when the schema changes.
+//
+// This class is thread-safe.
+class PreparedStatementCache {
+ public:
+  // A 'max_bytes' of zero disables the cache.
+  explicit PreparedStatementCache(int64_t max_bytes) : max_bytes_(max_bytes) {}
+
+  // Returns the cache key for a statement with the given SQL text and declared
+  // parameters prepared against 'schema'.
+  static std::string MakeKey(
+      const Schema* schema, const std::string& sql,
+      const std::map<std::string, zetasql::Value>& declared_params);
+
+  // Removes the statement with the given key from the cache and returns it, or
+  // returns nullptr and counts a miss if there is no such statement.
+  std::unique_ptr<PreparedStatement> Take(const std::string& key)
+      ABSL_LOCKS_EXCLUDED(mu_);
+
+  // Adds a statement prepared against the given schema generation to the
+  // cache, evicting the least recently used statements if needed. The
+  // statement is dropped if it was prepared against a schema which has since
+  // been invalidated, or if it is larger than the cache.
+  void Put(const std::string& key, int64_t schema_generation,
+           int64_t size_bytes, std::unique_ptr<PreparedStatement> statement)
+      ABSL_LOCKS_EXCLUDED(mu_);
+
+  // Drops all statements, and rejects statements prepared against schema
+  // generations older than 'schema_generation' from then on.
+  void Invalidate(int64_t schema_generation) ABSL_LOCKS_EXCLUDED(mu_);
+
+  // The number of lookups which found a statement in the cache.
+  int64_t hits() const ABSL_LOCKS_EXCLUDED(mu_);
+
+  // The number of lookups which did not find a statement in the cache.
+  int64_t misses() const ABSL_LOCKS_EXCLUDED(mu_);
+
+  // The number of statements in the cache.
+  int64_t size() const ABSL_LOCKS_EXCLUDED(mu_);
+
+  // The estimated memory used by the statements in the cache.
+  int64_t size_bytes() const ABSL_LOCKS_EXCLUDED(mu_);
+
+ private:
+  struct Entry {
+    std::string key;
+    int64_t size_bytes;
+    std::unique_ptr<PreparedStatement> statement;
+  };
+  using EntryList = std::list<Entry>;
+
+  // Removes the given entry from the cache.
+  void Erase(EntryList::iterator it) ABSL_EXCLUSIVE_LOCKS_REQUIRED(mu_);
+
+  const int64_t max_bytes_;
+
+  mutable absl::Mutex mu_;
+
+  // Entries ordered from the most to the least recently used.
+  EntryList entries_ ABSL_GUARDED_BY(mu_);
+
+  // Index of the entries by key.
+  absl::flat_hash_map<std::string, EntryList::iterator> index_
+      ABSL_GUARDED_BY(mu_);
+
+  // Statements prepared against older schema generations are not cached.
+  int64_t min_schema_generation_ ABSL_GUARDED_BY(mu_) = 0;
+
+  int64_t size_bytes_ ABSL_GUARDED_BY(mu_) = 0;
+  int64_t hits_ ABSL_GUARDED_BY(mu_) = 0;
+  int64_t misses_ ABSL_GUARDED_BY(mu_) = 0;
+};
+
+}  // namespace backend
+}  // namespace emulator
+}  // namespace spanner
+}  // namespace google
+
+#endif  // THIRD_PARTY_CLOUD_SPANNER_EMULATOR_BACKEND_QUERY_PREPARED_STATEMENT_CACHE_H_
@@ -0,0 +1,164 @@
+//
+// Copyright 2026 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "backend/query/prepared_statement_cache.h"
+
+#include <map>
+#include <memory>
+#include <string>
+#include <utility>
+
+#include "zetasql/public/type.h"
+#include "zetasql/public/value.h"
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "backend/schema/catalog/schema.h"
+
+namespace google {
+namespace spanner {
+namespace emulator {
+namespace backend {
+
+namespace {
+
+class FakeStatement : public PreparedStatement {
+ public:
+  explicit FakeStatement(int id) : id(id) {}
+  const int id;
+};
+
+int IdOf(const std::unique_ptr<PreparedStatement>& statement) {
+  return static_cast<const FakeStatement*>(statement.get())->id;
+}
+
+TEST(PreparedStatementCacheTest, TakeRemovesStatementFromCache) {
+  PreparedStatementCache cache(/*max_bytes=*/100);
+  EXPECT_EQ(cache.Take("a"), nullptr);
+
+  cache.Put("a", /*schema_generation=*/1, /*size_bytes=*/10,
+            std::make_unique<FakeStatement>(1));
+  EXPECT_EQ(cache.size(), 1);
+  EXPECT_EQ(cache.size_bytes(), 10);
+
+  std::unique_ptr<PreparedStatement> statement = cache.Take("a");
+  ASSERT_NE(statement, nullptr);
+  EXPECT_EQ(IdOf(statement), 1);
+  EXPECT_EQ(cache.size(), 0);
+  EXPECT_EQ(cache.size_bytes(), 0);
+  EXPECT_EQ(cache.Take("a"), nullptr);
+
+  EXPECT_EQ(cache.hits(), 1);
+  EXPECT_EQ(cache.misses(), 2);
+}
+
+TEST(PreparedStatementCacheTest, KeepsOneStatementPerKey) {
+  PreparedStatementCache cache(/*max_bytes=*/100);
+  cache.Put("a", /*schema_generation=*/1, /*size_bytes=*/10,
+            std::make_unique<FakeStatement>(1));
+  cache.Put("a", /*schema_generation=*/1, /*size_bytes=*/10,
+            std::make_unique<FakeStatement>(2));
+  EXPECT_EQ(cache.size(), 1);
+  EXPECT_EQ(IdOf(cache.Take("a")), 1);
+}
+
+TEST(PreparedStatementCacheTest, EvictsLeastRecentlyUsedStatements) {
+  PreparedStatementCache cache(/*max_bytes=*/30);
+  cache.Put("a", /*schema_generation=*/1, /*size_bytes=*/10,
+            std::make_unique<FakeStatement>(1));
+  cache.Put("b", /*schema_generation=*/1, /*size_bytes=*/10,
+            std::make_unique<FakeStatement>(2));
+  cache.Put("c", /*schema_generation=*/1, /*size_bytes=*/10,
+            std::make_unique<FakeStatement>(3));
+
+  // Using "a" makes "b" the least recently used statement.
+  cache.Put("a", /*schema_generation=*/1, /*size_bytes=*/10, cache.Take("a"));
+  cache.Put("d", /*schema_generation=*/1, /*size_bytes=*/10,
+            std::make_unique<FakeStatement>(4));
+
+  EXPECT_EQ(cache.size(), 3);
+  EXPECT_EQ(cache.size_bytes(), 30);
+  EXPECT_EQ(cache.Take("b"), nullptr);
+  EXPECT_NE(cache.Take("a"), nullptr);
+  EXPECT_NE(cache.Take("c"), nullptr);
+  EXPECT_NE(cache.Take("d"), nullptr);
+}
+
+TEST(PreparedStatementCacheTest, DropsStatementsLargerThanCache) {
+  PreparedStatementCache cache(/*max_bytes=*/30);
+  cache.Put("a", /*schema_generation=*/1, /*size_bytes=*/40,
+            std::make_unique<FakeStatement>(1));
+  EXPECT_EQ(cache.size(), 0);
+  EXPECT_EQ(cache.size_bytes(), 0);
+}
+
+TEST(PreparedStatementCacheTest, ZeroMaxBytesDisablesCache) {
+  PreparedStatementCache cache(/*max_bytes=*/0);
+  cache.Put("a", /*schema_generation=*/1, /*size_bytes=*/1,
+            std::make_unique<FakeStatement>(1));
+  EXPECT_EQ(cache.Take("a"), nullptr);
+}
+
+TEST(PreparedStatementCacheTest, InvalidateDropsStatementsOfOlderSchemas) {
+  PreparedStatementCache cache(/*max_bytes=*/100);
+  cache.Put("a", /*schema_generation=*/1, /*size_bytes=*/10,
+            std::make_unique<FakeStatement>(1));
+  std::unique_ptr<PreparedStatement> in_use = cache.Take("a");
+  cache.Put("b", /*schema_generation=*/1, /*size_bytes=*/10,
+            std::make_unique<FakeStatement>(2));
+
+  cache.Invalidate(/*schema_generation=*/2);
+  EXPECT_EQ(cache.size(), 0);
+  EXPECT_EQ(cache.size_bytes(), 0);
+
+  // A statement of the old schema which was in use is not put back.
+  cache.Put("a", /*schema_generation=*/1, /*size_bytes=*/10,
+            std::move(in_use));
+  EXPECT_EQ(cache.size(), 0);
+
+  cache.Put("c", /*schema_generation=*/2, /*size_bytes=*/10,
+            std::make_unique<FakeStatement>(3));
+  EXPECT_EQ(cache.size(), 1);
+}
+
+TEST(PreparedStatementCacheTest, KeysDependOnSchemaSqlAndParameterTypes) {
+  Schema schema;
+  Schema new_schema;
+  std::map<std::string, zetasql::Value> int_param = {
+      {"p", zetasql::values::Int64(1)}};
+  std::map<std::string, zetasql::Value> other_int_param = {
+      {"p", zetasql::values::Int64(2)}};
+  std::map<std::string, zetasql::Value> string_param = {
+      {"p", zetasql::values::String("1")}};
+
+  std::string key =
+      PreparedStatementCache::MakeKey(&schema, "SELECT @p", int_param);
+  EXPECT_EQ(key, PreparedStatementCache::MakeKey(&schema, "SELECT @p",
+                                                 other_int_param));
+  EXPECT_NE(key, PreparedStatementCache::MakeKey(&schema, "SELECT @p",
+                                                 string_param));
+  EXPECT_NE(key, PreparedStatementCache::MakeKey(&schema, "SELECT @p", {}));
+  EXPECT_NE(key, PreparedStatementCache::MakeKey(&schema, "SELECT @p + 1",
+                                                 int_param));
+  EXPECT_NE(key, PreparedStatementCache::MakeKey(&new_schema, "SELECT @p",
+                                                 int_param));
+}
+
+}  // namespace
+
+}  // namespace backend
+}  // namespace emulator
+}  // namespace spanner
+}  // namespace google
@@ -31,6 +31,7 @@
 #include <vector>
 
 #include "google/spanner/admin/database/v1/common.pb.h"
+#include "google/spanner/v1/query_plan.pb.h"
 #include "google/spanner/v1/spanner.pb.h"
 #include "zetasql/public/analyzer.h"
 #include "zetasql/public/analyzer_options.h"
@@ -48,14 +49,17 @@
 #include "zetasql/resolved_ast/resolved_column.h"
 #include "zetasql/resolved_ast/resolved_node.h"
 #include "zetasql/resolved_ast/resolved_node_kind.pb.h"
+#include "absl/base/attributes.h"
 #include "absl/container/flat_hash_map.h"
 #include "absl/container/flat_hash_set.h"
 #include "absl/log/log.h"
+#include "absl/memory/memory.h"
 #include "absl/status/status.h"
 #include "absl/status/statusor.h"
 #include "absl/strings/cord.h"
 #include "absl/strings/match.h"
 #include "absl/strings/substitute.h"
+#include "absl/synchronization/mutex.h"
 #include "absl/time/clock.h"
 #include "absl/time/time.h"
 #include "backend/access/read.h"
@@ -69,17 +73,22 @@
 #include "backend/query/ann_validator.h"
 #include "backend/query/catalog.h"
 #include "backend/query/change_stream/change_stream_query_validator.h"
+#include "backend/query/deterministic_row_order.h"
 #include "backend/query/dml_query_validator.h"
 #include "backend/query/feature_filter/query_size_limits_checker.h"
 #include "backend/query/function_catalog.h"
+#include "backend/query/force_index_rewriter.h"
 #include "backend/query/hint_rewriter.h"
 #include "backend/query/index_hint_validator.h"
 #include "backend/query/insert_on_conflict_dml_execution.h"
 #include "backend/query/partitionability_validator.h"
 #include "backend/query/partitioned_dml_validator.h"
+#include "backend/query/prepared_statement_cache.h"
 #include "backend/query/query_context.h"
 #include "backend/query/query_engine_options.h"
 #include "backend/query/query_engine_util.h"
+#include "backend/query/query_plan.h"
+#include "backend/query/query_stats.h"
 #include "backend/query/query_validator.h"
 #include "backend/query/queryable_column.h"
 #include "backend/query/queryable_view.h"
@@ -142,6 +151,361 @@ class VectorsRowCursor : public RowCursor {
   std::vector<std::vector<zetasql::Value>> column_values_;
 };
 
+// A QueryEvaluator instance against a specific QueryEngine and QueryContext.
+class QueryEvaluatorForEngine : public QueryEvaluator {
+ public:
+  QueryEvaluatorForEngine(const QueryEngine& query_engine,
+                          const QueryContext& query_context)
+      : query_engine_(query_engine), query_context_(query_context) {}
+  ~QueryEvaluatorForEngine() override = default;
+
+  absl::StatusOr<std::unique_ptr<RowCursor>> Evaluate(
+      const std::string& query) override {
+    Query q{/*sql=*/query, /*declared_params=*/{}, /*undeclared_params=*/{}};
+    q.record_stats = false;
+
+    ZETASQL_ASSIGN_OR_RETURN(auto result,
+                     query_engine_.ExecuteSql(q, query_context_,
+                                              v1::ExecuteSqlRequest::NORMAL));
+    return std::move(result.rows);
+  }
+
+ private:
+  const QueryEngine& query_engine_;
+  const QueryContext& query_context_;
+};
+
+// A RowCursor which counts the rows read from the cursor it wraps.
+class RowCountingCursor : public RowCursor {
+ public:
+  RowCountingCursor(std::unique_ptr<RowCursor> cursor, int64_t* num_rows)
+      : cursor_(std::move(cursor)), num_rows_(num_rows) {}
+
+  bool Next() override {
+    if (!cursor_->Next()) {
+      return false;
+    }
+    ++*num_rows_;
+    return true;
+  }
+
+  absl::Status Status() const override { return cursor_->Status(); }
+  int NumColumns() const override { return cursor_->NumColumns(); }
+  const std::string ColumnName(int i) const override {
+    return cursor_->ColumnName(i);
+  }
+  const zetasql::Type* ColumnType(int i) const override {
+    return cursor_->ColumnType(i);
+  }
+  const zetasql::Value ColumnValue(int i) const override {
+    return cursor_->ColumnValue(i);
+  }
+
+ private:
+  std::unique_ptr<RowCursor> cursor_;
+  int64_t* num_rows_;
+};
+
+// A RowCursor which measures the rows read from the cursor of a table scan,
+// and the time spent reading them, in a profiled execution.
+class ScanProfilingCursor : public RowCursor {
+ public:
+  ScanProfilingCursor(std::unique_ptr<RowCursor> cursor, ScanProfile* profile)
+      : cursor_(std::move(cursor)), profile_(profile) {}
+
+  bool Next() override {
+    absl::Time start_time = absl::Now();
+    bool has_row = cursor_->Next();
+    profile_->latency += absl::Now() - start_time;
+    if (has_row) {
+      ++profile_->rows_scanned;
+    }
+    return has_row;
+  }
+
+  absl::Status Status() const override { return cursor_->Status(); }
+  int NumColumns() const override { return cursor_->NumColumns(); }
+  const std::string ColumnName(int i) const override {
+    return cursor_->ColumnName(i);
+  }
+  const zetasql::Type* ColumnType(int i) const override {
+    return cursor_->ColumnType(i);
+  }
+  const zetasql::Value ColumnValue(int i) const override {
+    return cursor_->ColumnValue(i);
+  }
+
+ private:
+  std::unique_ptr<RowCursor> cursor_;
+  ScanProfile* profile_;
+};
+
+// Forwards reads to the reader of a QueryContext, which may be changed after
+// the reader has been handed out to the tables of a catalog.
+class ContextRowReader : public RowReader {
+ public:
+  explicit ContextRowReader(const QueryContext* context) : context_(context) {}
+
+  absl::Status Read(const ReadArg& read_arg,
+                    std::unique_ptr<RowCursor>* cursor) override {
+    ZETASQL_RET_CHECK_NE(context_->reader, nullptr);
+    ZETASQL_RETURN_IF_ERROR(context_->reader->Read(read_arg, cursor));
+    if (rows_scanned_ != nullptr) {
+      *cursor = std::make_unique<RowCountingCursor>(std::move(*cursor),
+                                                    rows_scanned_);
+    }
+    if (profile_ != nullptr) {
+      ScanProfile* scan = &profile_->scans[read_arg.index.empty()
+                                               ? read_arg.table
+                                               : read_arg.index];
+      ++scan->executions;
+      *cursor = std::make_unique<ScanProfilingCursor>(std::move(*cursor), scan);
+    }
+    return absl::OkStatus();
+  }
+
+  // Counts the rows read through this reader in 'rows_scanned' from now on,
+  // or stops counting them if it is null.
+  void set_rows_scanned(int64_t* rows_scanned) { rows_scanned_ = rows_scanned; }
+
+  // Profiles the reads made through this reader in 'profile' from now on, or
+  // stops profiling them if it is null.
+  void set_profile(QueryProfile* profile) { profile_ = profile; }
+
+ private:
+  const QueryContext* context_;
+  int64_t* rows_scanned_ = nullptr;
+  QueryProfile* profile_ = nullptr;
+};
+
+// Objects referenced by the evaluation of a query. Query rows are produced
+// lazily as the returned row cursor is iterated, so the cursor owns these.
+//
+// Once an execution is done, the state is kept in the query engine's prepared
+// statement cache so that later executions of the same statement against the
+// same schema can skip analyzing and preparing it. The catalog is shared by all
+// the statements of a schema, and reads through the 'reader' and evaluates
+// views through the 'view_evaluator' of the execution bound to the current
+// thread. Both refer to 'context', so a cached state is bound to a new
+// execution by replacing its context.
+struct QueryEvaluationState : public PreparedStatement {
+  QueryEvaluationState(const QueryEngine& query_engine,
+                       const QueryContext& query_context)
+      : context(query_context),
+        reader(&context),
+        view_evaluator(query_engine, context) {}
+
+  // A copy of the context the query is executed in.
+  QueryContext context;
+
+  // Reads through the reader of 'context'.
+  ContextRowReader reader;
+
+  // Evaluates views referenced by the query.
+  QueryEvaluatorForEngine view_evaluator;
+
+  std::shared_ptr<Catalog> catalog;
+  std::unique_ptr<const zetasql::AnalyzerOutput> analyzer_output;
+
+  // The analyzed statement with its hints rewritten, which is validated
+  // against the context of every execution.
+  std::unique_ptr<zetasql::ResolvedStatement> hinted_statement;
+
+  // The statement which is executed.
+  std::unique_ptr<zetasql::ResolvedStatement> resolved_statement;
+  std::unique_ptr<zetasql::PreparedQuery> prepared_query;
+  std::unique_ptr<zetasql::PreparedModify> prepared_modify;
+
+  // The cache the state is returned to once the execution is done, or null if
+  // the statement is not cacheable.
+  PreparedStatementCache* cache = nullptr;
+  std::string cache_key;
+  int64_t schema_generation = 0;
+  int64_t size_bytes = 0;
+};
+
+// The evaluation state of the execution in progress on this thread. Tables of
+// shared catalogs are read by the ZetaSQL evaluator without any reference to
+// the execution they are read for, so they find its reader here.
+ABSL_CONST_INIT thread_local QueryEvaluationState* bound_state = nullptr;
+
+// Binds an execution to the current thread for the lifetime of this object.
+// Executions nest, e.g. when a query reads from a view, so the execution which
+// was bound before is restored afterwards.
+class ScopedExecutionBinding {
+ public:
+  explicit ScopedExecutionBinding(QueryEvaluationState* state)
+      : previous_(bound_state) {
+    bound_state = state;
+  }
+  ~ScopedExecutionBinding() { bound_state = previous_; }
+
+  ScopedExecutionBinding(const ScopedExecutionBinding&) = delete;
+  ScopedExecutionBinding& operator=(const ScopedExecutionBinding&) = delete;
+
+ private:
+  QueryEvaluationState* previous_;
+};
+
+// Reads through the reader of the execution bound to the current thread.
+class BoundRowReader : public RowReader {
+ public:
+  absl::Status Read(const ReadArg& read_arg,
+                    std::unique_ptr<RowCursor>* cursor) override {
+    ZETASQL_RET_CHECK_NE(bound_state, nullptr);
+    return bound_state->reader.Read(read_arg, cursor);
+  }
+};
+
+// Evaluates views for the execution bound to the current thread.
+class BoundQueryEvaluator : public QueryEvaluator {
+ public:
+  absl::StatusOr<std::unique_ptr<RowCursor>> Evaluate(
+      const std::string& query) override {
+    ZETASQL_RET_CHECK_NE(bound_state, nullptr);
+    return bound_state->view_evaluator.Evaluate(query);
+  }
+};
+
+// Returns 'state' to the prepared statement cache it came from, if any.
+void ReleaseQueryEvaluationState(std::unique_ptr<QueryEvaluationState> state) {
+  if (state == nullptr) {
+    return;
+  }
+  state->reader.set_rows_scanned(nullptr);
+  state->reader.set_profile(nullptr);
+  if (state->cache == nullptr) {
+    return;
+  }
+  PreparedStatementCache* cache = state->cache;
+  std::string cache_key = state->cache_key;
+  int64_t schema_generation = state->schema_generation;
+  int64_t size_bytes = state->size_bytes;
+  cache->Put(cache_key, schema_generation, size_bytes, std::move(state));
+}
+
+// A RowCursor which pulls rows from a ZetaSQL evaluator as it is iterated.
+class EvaluatorRowCursor : public RowCursor {
+ public:
+  // Fetches the first row of 'iterator' so that errors which occur before any
+  // row is produced, such as errors from sorting or aggregation, are reported
+  // when the query is executed rather than while the rows are streamed.
+  static absl::StatusOr<std::unique_ptr<RowCursor>> Create(
+      std::unique_ptr<QueryEvaluationState> state,
+      std::unique_ptr<zetasql::EvaluatorTableIterator> iterator) {
+    bool has_first_row = iterator->NextRow();
+    ZETASQL_RETURN_IF_ERROR(iterator->Status());
+    return absl::WrapUnique(new EvaluatorRowCursor(
+        std::move(state), std::move(iterator), has_first_row));
+  }
+
+  // Returns the evaluation state to the prepared statement cache once the
+  // iterator is gone.
+  ~EvaluatorRowCursor() override {
+    iterator_.reset();
+    ReleaseQueryEvaluationState(std::move(state_));
+  }
+
+  bool Next() override {
+    if (pending_first_row_) {
+      pending_first_row_ = false;
+      return has_first_row_;
+    }
+    ScopedExecutionBinding binding(state_.get());
+    return has_first_row_ && iterator_->NextRow();
+  }
+
+  absl::Status Status() const override { return iterator_->Status(); }
+
+  int NumColumns() const override { return iterator_->NumColumns(); }
+
+  const std::string ColumnName(int i) const override {
+    return iterator_->GetColumnName(i);
+  }
+
+  const zetasql::Type* ColumnType(int i) const override {
+    return iterator_->GetColumnType(i);
+  }
+
+  const zetasql::Value ColumnValue(int i) const override {
+    return iterator_->GetValue(i);
+  }
+
+ private:
+  EvaluatorRowCursor(std::unique_ptr<QueryEvaluationState> state,
+                     std::unique_ptr<zetasql::EvaluatorTableIterator> iterator,
+                     bool has_first_row)
+      : state_(std::move(state)),
+        iterator_(std::move(iterator)),
+        has_first_row_(has_first_row) {}
+
+  std::unique_ptr<QueryEvaluationState> state_;
+  std::unique_ptr<zetasql::EvaluatorTableIterator> iterator_;
+
+  // Whether the iterator produced a first row, and whether that row has not
+  // been returned by Next() yet.
+  const bool has_first_row_;
+  bool pending_first_row_ = true;
+};
+
+// A RowCursor which measures an execution of a query as its rows are consumed,
+// and records it in the query statistics once it is destroyed.
+class QueryStatsRowCursor : public RowCursor {
+ public:
+  QueryStatsRowCursor(std::unique_ptr<RowCursor> cursor,
+                      QueryStats* query_stats, std::string sql,
+                      absl::Time start_time,
+                      std::unique_ptr<QueryExecutionStats> stats)
+      : cursor_(std::move(cursor)),
+        query_stats_(query_stats),
+        sql_(std::move(sql)),
+        start_time_(start_time),
+        stats_(std::move(stats)) {}
+
+  // The wrapped cursor stops counting scanned rows in 'stats_' once it is
+  // destroyed, so it is destroyed first.
+  ~QueryStatsRowCursor() override {
+    cursor_.reset();
+    absl::Time end_time = absl::Now();
+    stats_->latency = end_time - start_time_;
+    query_stats_->Record(sql_, end_time, *stats_);
+  }
+
+  bool Next() override {
+    absl::Time start = absl::Now();
+    bool has_row = cursor_->Next();
+    if (has_row) {
+      ++stats_->rows_returned;
+      for (int i = 0; i < cursor_->NumColumns(); ++i) {
+        stats_->bytes_returned += cursor_->ColumnValue(i).physical_byte_size();
+      }
+    } else if (!cursor_->Status().ok()) {
+      stats_->failed = true;
+    }
+    stats_->cpu_time += absl::Now() - start;
+    return has_row;
+  }
+
+  absl::Status Status() const override { return cursor_->Status(); }
+  int NumColumns() const override { return cursor_->NumColumns(); }
+  const std::string ColumnName(int i) const override {
+    return cursor_->ColumnName(i);
+  }
+  const zetasql::Type* ColumnType(int i) const override {
+    return cursor_->ColumnType(i);
+  }
+  const zetasql::Value ColumnValue(int i) const override {
+    return cursor_->ColumnValue(i);
+  }
+
+ private:
+  std::unique_ptr<RowCursor> cursor_;
+  QueryStats* query_stats_;
+  const std::string sql_;
+  const absl::Time start_time_;
+  std::unique_ptr<QueryExecutionStats> stats_;
+};
+
 zetasql::EvaluatorOptions CommonEvaluatorOptions(
     zetasql::TypeFactory* type_factory, const std::string time_zone,
     bool return_all_insert_rows_insert_ignore_dml = false) {
@@ -638,11 +1002,30 @@ absl::StatusOr<CaseInsensitiveStringSet> ColumnsInUpdate(
   return columns;
 }
 
+// Returns the prepared form of a DML statement. The statement is prepared into
+// 'prepared_modify' unless an earlier execution has already done so.
+absl::StatusOr<zetasql::PreparedModify*> GetOrPrepareModify(
+    const zetasql::ResolvedStatement* statement,
+    const zetasql::EvaluatorOptions& evaluator_options,
+    const zetasql::ParameterValueMap& parameters, const std::string time_zone,
+    std::unique_ptr<zetasql::PreparedModify>* prepared_modify) {
+  if (*prepared_modify == nullptr) {
+    auto prepared = std::make_unique<zetasql::PreparedModify>(
+        statement, evaluator_options);
+    ZETASQL_ASSIGN_OR_RETURN(auto analyzer_options,
+                     MakeAnalyzerOptionsWithParameters(parameters, time_zone));
+    ZETASQL_RETURN_IF_ERROR(prepared->Prepare(analyzer_options));
+    *prepared_modify = std::move(prepared);
+  }
+  return prepared_modify->get();
+}
+
 absl::StatusOr<ExecuteUpdateResult> EvaluateResolvedInsert(
     const zetasql::ResolvedInsertStmt* insert_statement,
     const zetasql::ParameterValueMap& parameters,
     zetasql::TypeFactory* type_factory, DatabaseDialect database_dialect,
     const std::string time_zone,
+    std::unique_ptr<zetasql::PreparedModify>* prepared_modify,
     bool return_all_insert_rows_insert_ignore_dml = false) {
   if (insert_statement->insert_mode() ==
       zetasql::ResolvedInsertStmt::OR_REPLACE) {
@@ -678,13 +1061,13 @@ absl::StatusOr<ExecuteUpdateResult> EvaluateResolvedInsert(
     }
   }
 
-  auto prepared_insert = std::make_unique<zetasql::PreparedModify>(
-      insert_statement,
-      CommonEvaluatorOptions(type_factory, time_zone,
-                             return_all_insert_rows_insert_ignore_dml));
-  ZETASQL_ASSIGN_OR_RETURN(auto analyzer_options,
-                   MakeAnalyzerOptionsWithParameters(parameters, time_zone));
-  ZETASQL_RETURN_IF_ERROR(prepared_insert->Prepare(analyzer_options));
+  ZETASQL_ASSIGN_OR_RETURN(
+      zetasql::PreparedModify * prepared_insert,
+      GetOrPrepareModify(
+          insert_statement,
+          CommonEvaluatorOptions(type_factory, time_zone,
+                                 return_all_insert_rows_insert_ignore_dml),
+          parameters, time_zone, prepared_modify));
 
   std::unique_ptr<zetasql::EvaluatorTableIterator> returning_iter;
   // `returning_iter` can be NULL if there is no THEN RETURN clause.
@@ -739,15 +1122,16 @@ absl::StatusOr<ExecuteUpdateResult> EvaluateResolvedUpdate(
     const zetasql::ResolvedUpdateStmt* update_statement,
     const zetasql::ParameterValueMap& parameters,
     zetasql::TypeFactory* type_factory, const Schema* schema,
-    const std::string time_zone) {
+    const std::string time_zone,
+    std::unique_ptr<zetasql::PreparedModify>* prepared_modify) {
   ZETASQL_ASSIGN_OR_RETURN(auto updated_columns,
                    ColumnsInUpdate(update_statement->update_item_list()));
 
-  auto prepared_update = std::make_unique<zetasql::PreparedModify>(
-      update_statement, CommonEvaluatorOptions(type_factory, time_zone));
-  ZETASQL_ASSIGN_OR_RETURN(auto analyzer_options,
-                   MakeAnalyzerOptionsWithParameters(parameters, time_zone));
-  ZETASQL_RETURN_IF_ERROR(prepared_update->Prepare(analyzer_options));
+  ZETASQL_ASSIGN_OR_RETURN(
+      zetasql::PreparedModify * prepared_update,
+      GetOrPrepareModify(update_statement,
+                         CommonEvaluatorOptions(type_factory, time_zone),
+                         parameters, time_zone, prepared_modify));
 
   std::unique_ptr<zetasql::EvaluatorTableIterator> returning_iter;
   auto status_or = prepared_update->Execute(parameters, {}, &returning_iter);
@@ -773,12 +1157,13 @@ absl::StatusOr<ExecuteUpdateResult> EvaluateResolvedUpdate(
 absl::StatusOr<ExecuteUpdateResult> EvaluateResolvedDelete(
     const zetasql::ResolvedDeleteStmt* delete_statement,
     const zetasql::ParameterValueMap& parameters,
-    zetasql::TypeFactory* type_factory, const std::string time_zone) {
-  auto prepared_delete = std::make_unique<zetasql::PreparedModify>(
-      delete_statement, CommonEvaluatorOptions(type_factory, time_zone));
-  ZETASQL_ASSIGN_OR_RETURN(auto analyzer_options,
-                   MakeAnalyzerOptionsWithParameters(parameters, time_zone));
-  ZETASQL_RETURN_IF_ERROR(prepared_delete->Prepare(analyzer_options));
+    zetasql::TypeFactory* type_factory, const std::string time_zone,
+    std::unique_ptr<zetasql::PreparedModify>* prepared_modify) {
+  ZETASQL_ASSIGN_OR_RETURN(
+      zetasql::PreparedModify * prepared_delete,
+      GetOrPrepareModify(delete_statement,
+                         CommonEvaluatorOptions(type_factory, time_zone),
+                         parameters, time_zone, prepared_modify));
 
   std::unique_ptr<zetasql::EvaluatorTableIterator> returning_iter;
   ZETASQL_ASSIGN_OR_RETURN(auto iterator,
@@ -794,27 +1179,34 @@ absl::StatusOr<ExecuteUpdateResult> EvaluateResolvedDelete(
 }
 
 // Uses googlesql/public/evaluator to evaluate a DML statement represented by a
-// resolved AST and returns a pair of mutation and count of modified rows.
+// resolved AST and returns a pair of mutation and count of modified rows. If
+// 'prepared_modify' is set, the prepared statement is kept there and reused by
+// later evaluations of the same resolved statement.
 absl::StatusOr<ExecuteUpdateResult> EvaluateUpdate(
     const zetasql::ResolvedStatement* resolved_statement,
     zetasql::Catalog* catalog, const zetasql::ParameterValueMap& parameters,
     zetasql::TypeFactory* type_factory, DatabaseDialect database_dialect,
     const Schema* schema, const std::string time_zone,
-    bool return_all_insert_rows_insert_ignore_dml = false) {
+    bool return_all_insert_rows_insert_ignore_dml = false,
+    std::unique_ptr<zetasql::PreparedModify>* prepared_modify = nullptr) {
+  std::unique_ptr<zetasql::PreparedModify> uncached_prepared_modify;
+  if (prepared_modify == nullptr) {
+    prepared_modify = &uncached_prepared_modify;
+  }
   switch (resolved_statement->node_kind()) {
     case zetasql::RESOLVED_INSERT_STMT:
       return EvaluateResolvedInsert(
           resolved_statement->GetAs<zetasql::ResolvedInsertStmt>(),
           parameters, type_factory, database_dialect, time_zone,
-          return_all_insert_rows_insert_ignore_dml);
+          prepared_modify, return_all_insert_rows_insert_ignore_dml);
     case zetasql::RESOLVED_UPDATE_STMT:
       return EvaluateResolvedUpdate(
           resolved_statement->GetAs<zetasql::ResolvedUpdateStmt>(),
-          parameters, type_factory, schema, time_zone);
+          parameters, type_factory, schema, time_zone, prepared_modify);
     case zetasql::RESOLVED_DELETE_STMT:
       return EvaluateResolvedDelete(
           resolved_statement->GetAs<zetasql::ResolvedDeleteStmt>(),
-          parameters, type_factory, time_zone);
+          parameters, type_factory, time_zone, prepared_modify);
     default:
       ZETASQL_RET_CHECK_FAIL() << "Unsupported support node kind "
                        << ResolvedNodeKind_Name(
@@ -833,30 +1225,41 @@ absl::StatusOr<std::unique_ptr<RowCursor>> ResolveCallStatement() {
 }
 
 // Uses googlesql/public/evaluator to evaluate a query statement represented by
-// a resolved AST and returns a row cursor.
+// a resolved AST and returns a row cursor. Unless 'materialize_rows' is set,
+// rows are produced as the cursor is iterated and 'num_output_rows' is not
+// set.
 absl::StatusOr<std::unique_ptr<RowCursor>> EvaluateQuery(
-    const zetasql::ResolvedStatement* resolved_statement,
+    std::unique_ptr<QueryEvaluationState> state,
     const zetasql::ParameterValueMap& params,
     zetasql::TypeFactory* type_factory, int64_t* num_output_rows,
     const v1::ExecuteSqlRequest_QueryMode query_mode,
-    const std::string time_zone) {
+    const std::string time_zone, bool materialize_rows) {
+  const zetasql::ResolvedStatement* resolved_statement =
+      state->resolved_statement.get();
   if (resolved_statement->node_kind() == zetasql::RESOLVED_CALL_STMT) {
     // Evaluation of a CALL statement is currently a no-op. This is added to
     // ensure the emulator doesn't error out when the customer tries the CALL
     // statement.
+    ReleaseQueryEvaluationState(std::move(state));
     return ResolveCallStatement();
   }
   ZETASQL_RET_CHECK_EQ(resolved_statement->node_kind(), zetasql::RESOLVED_QUERY_STMT)
       << "input is not a query statement";
 
-  auto prepared_query = std::make_unique<zetasql::PreparedQuery>(
-      resolved_statement->GetAs<zetasql::ResolvedQueryStmt>(),
-      CommonEvaluatorOptions(type_factory, time_zone));
-  // Call PrepareQuery to set the AnalyzerOptions that we used to Analyze the
-  // statement.
-  ZETASQL_ASSIGN_OR_RETURN(auto analyzer_options,
-                   MakeAnalyzerOptionsWithParameters(params, time_zone));
-  ZETASQL_RETURN_IF_ERROR(prepared_query->Prepare(analyzer_options));
+  // The query is already prepared if the state came from the prepared
+  // statement cache.
+  if (state->prepared_query == nullptr) {
+    auto prepared_query = std::make_unique<zetasql::PreparedQuery>(
+        resolved_statement->GetAs<zetasql::ResolvedQueryStmt>(),
+        CommonEvaluatorOptions(type_factory, time_zone));
+    // Call PrepareQuery to set the AnalyzerOptions that we used to Analyze the
+    // statement.
+    ZETASQL_ASSIGN_OR_RETURN(auto analyzer_options,
+                     MakeAnalyzerOptionsWithParameters(params, time_zone));
+    ZETASQL_RETURN_IF_ERROR(prepared_query->Prepare(analyzer_options));
+    state->prepared_query = std::move(prepared_query);
+  }
+  zetasql::PreparedQuery* prepared_query = state->prepared_query.get();
 
   // Get the query metadata from the prepared query.
   std::vector<std::string> names;
@@ -873,22 +1276,28 @@ absl::StatusOr<std::unique_ptr<RowCursor>> EvaluateQuery(
     // This allows clients to use PLAN to get the metadata of the query without
     // having to execute the query and/or supply values for all query
     // parameters. This is used by some drivers (e.g. JDBC) and by PGAdapter.
+    ReleaseQueryEvaluationState(std::move(state));
     return std::make_unique<VectorsRowCursor>(names, types, values);
-  } else {
-    // Finally execute the query.
-    ZETASQL_ASSIGN_OR_RETURN(auto iterator, prepared_query->Execute(params));
+  }
 
-    while (iterator->NextRow()) {
-      values.emplace_back();
-      values.back().reserve(iterator->NumColumns());
-      for (int i = 0; i < iterator->NumColumns(); ++i) {
-        values.back().push_back(iterator->GetValue(i));
-      }
+  // Finally execute the query.
+  ZETASQL_ASSIGN_OR_RETURN(auto iterator, prepared_query->Execute(params));
+  if (!materialize_rows) {
+    return EvaluatorRowCursor::Create(std::move(state), std::move(iterator));
+  }
+
+  while (iterator->NextRow()) {
+    values.emplace_back();
+    values.back().reserve(iterator->NumColumns());
+    for (int i = 0; i < iterator->NumColumns(); ++i) {
+      values.back().push_back(iterator->GetValue(i));
     }
-    ZETASQL_RETURN_IF_ERROR(iterator->Status());
-    *num_output_rows = values.size();
-    return std::make_unique<VectorsRowCursor>(names, types, values);
   }
+  ZETASQL_RETURN_IF_ERROR(iterator->Status());
+  *num_output_rows = values.size();
+  iterator.reset();
+  ReleaseQueryEvaluationState(std::move(state));
+  return std::make_unique<VectorsRowCursor>(names, types, values);
 }
 
 absl::StatusOr<std::map<std::string, zetasql::Value>> ExtractParameters(
@@ -955,21 +1364,26 @@ bool IsDMLStmtWitoutSelect(
   return true;
 }
 
-absl::StatusOr<std::unique_ptr<zetasql::ResolvedStatement>>
-ExtractValidatedResolvedStatementAndOptions(
-    const zetasql::AnalyzerOutput* analyzer_output,
-    const QueryContext& context, bool in_partition_query = false,
-    QueryEngineOptions* query_engine_options = nullptr) {
+// Returns a copy of the statement of 'analyzer_output' with its query hints
+// rewritten to use only the 'spanner' prefix.
+absl::StatusOr<std::unique_ptr<zetasql::ResolvedStatement>> RewriteHints(
+    const zetasql::AnalyzerOutput* analyzer_output) {
   ZETASQL_RET_CHECK_NE(analyzer_output->resolved_statement(), nullptr);
-
-  // Rewrite query hints to use only the 'spanner' prefix.
   HintRewriter rewriter;
   ZETASQL_RETURN_IF_ERROR(analyzer_output->resolved_statement()->Accept(&rewriter));
-  ZETASQL_ASSIGN_OR_RETURN(auto statement,
-                   rewriter.ConsumeRootNode<zetasql::ResolvedStatement>());
+  return rewriter.ConsumeRootNode<zetasql::ResolvedStatement>();
+}
 
-  // Validate the query and extract and return any options specified
-  // through hint if the caller requested them.
+// Validates 'statement', as returned by RewriteHints for 'analyzer_output',
+// against the context it is executed in, e.g. the type of its transaction and
+// the columns in which it has written pending commit timestamps. Extracts any
+// options specified through hints into 'query_engine_options' if it is not
+// null.
+absl::Status ValidateStatementInContext(
+    const zetasql::ResolvedStatement* statement,
+    const zetasql::AnalyzerOutput* analyzer_output,
+    const QueryContext& context, bool in_partition_query = false,
+    QueryEngineOptions* query_engine_options = nullptr) {
   QueryEngineOptions options;
   std::unique_ptr<QueryValidator> query_validator =
       IsDMLStmtWitoutSelect(analyzer_output->resolved_statement())
@@ -994,16 +1408,23 @@ ExtractValidatedResolvedStatementAndOptions(
           config::disable_query_null_filtered_index_check(),
       allow_search_indexes_in_transaction, in_partition_query,
       in_select_for_update_query};
-  ZETASQL_RETURN_IF_ERROR(statement->Accept(&index_hint_validator));
+  return statement->Accept(&index_hint_validator);
+}
 
+// Returns the statement to execute for 'hinted_statement', as returned by
+// RewriteHints, once it has been validated. The result only depends on the
+// statement and on 'schema', so it is kept by prepared statements.
+absl::StatusOr<std::unique_ptr<zetasql::ResolvedStatement>>
+RewriteStatementForExecution(const zetasql::ResolvedStatement* hinted_statement,
+                             const Schema* schema) {
   ANNFunctionsRewriter ann_functions_rewriter;
-  ZETASQL_RETURN_IF_ERROR(statement->Accept(&ann_functions_rewriter));
+  ZETASQL_RETURN_IF_ERROR(hinted_statement->Accept(&ann_functions_rewriter));
   ZETASQL_ASSIGN_OR_RETURN(
-      statement,
+      auto statement,
       ann_functions_rewriter.ConsumeRootNode<zetasql::ResolvedStatement>());
 
   if (!ann_functions_rewriter.ann_functions().empty()) {
-    ANNValidator ann_validator(context.schema);
+    ANNValidator ann_validator(schema);
     ZETASQL_RETURN_IF_ERROR(statement->Accept(&ann_validator));
     // Check if all the ANN functions passed the validation.
     for (const auto& ann_function : ann_functions_rewriter.ann_functions()) {
@@ -1014,6 +1435,13 @@ ExtractValidatedResolvedStatementAndOptions(
     }
   }
 
+  // Make the scans with a valid FORCE_INDEX hint read through their index.
+  ForceIndexRewriter force_index_rewriter;
+  ZETASQL_RETURN_IF_ERROR(statement->Accept(&force_index_rewriter));
+  ZETASQL_ASSIGN_OR_RETURN(
+      statement,
+      force_index_rewriter.ConsumeRootNode<zetasql::ResolvedStatement>());
+
   // Check the query size limits
   // https://cloud.google.com/spanner/quotas#query_limits
   QuerySizeLimitsChecker checker;
@@ -1022,6 +1450,19 @@ ExtractValidatedResolvedStatementAndOptions(
   return statement;
 }
 
+absl::StatusOr<std::unique_ptr<zetasql::ResolvedStatement>>
+ExtractValidatedResolvedStatementAndOptions(
+    const zetasql::AnalyzerOutput* analyzer_output,
+    const QueryContext& context, bool in_partition_query = false,
+    QueryEngineOptions* query_engine_options = nullptr) {
+  ZETASQL_ASSIGN_OR_RETURN(auto statement, RewriteHints(analyzer_output));
+  ZETASQL_RETURN_IF_ERROR(ValidateStatementInContext(statement.get(),
+                                             analyzer_output, context,
+                                             in_partition_query,
+                                             query_engine_options));
+  return RewriteStatementForExecution(statement.get(), context.schema);
+}
+
 // Implements ResolvedASTVisitor to get the target table that various DML
 // statements modify.
 class ExtractDmlTargetTableVisitor : public zetasql::ResolvedASTVisitor {
@@ -1048,28 +1489,82 @@ class ExtractDmlTargetTableVisitor : public zetasql::ResolvedASTVisitor {
   std::optional<std::string> target_table_;
 };
 
-// A QueryEvaluator instance against a specific QueryEngine and QueryContext.
-class QueryEvaluatorForEngine : public QueryEvaluator {
- public:
-  QueryEvaluatorForEngine(const QueryEngine& query_engine,
-                          const QueryContext& query_context)
-      : query_engine_(query_engine), query_context_(query_context) {}
-  ~QueryEvaluatorForEngine() override = default;
+// Number of schema versions whose system table catalogs are kept by the query
+// engine.
+constexpr size_t kMaxSchemasWithSystemCatalogs = 4;
+
+// Rough estimates of the memory held by a prepared statement, used to bound
+// the size of the prepared statement cache. A resolved node is accounted for
+// in the analyzer output, in its validated copy and in the evaluator's plan.
+// The catalog is shared by all the statements of a schema, so it is not
+// accounted for.
+constexpr int64_t kEstimatedBytesPerResolvedNode = 1024;
+
+int64_t CountResolvedNodes(const zetasql::ResolvedNode* node) {
+  std::vector<const zetasql::ResolvedNode*> children;
+  node->GetChildNodes(&children);
+  int64_t count = 1;
+  for (const zetasql::ResolvedNode* child : children) {
+    count += CountResolvedNodes(child);
+  }
+  return count;
+}
 
-  absl::StatusOr<std::unique_ptr<RowCursor>> Evaluate(
-      const std::string& query) override {
-    Query q{/*sql=*/query, /*declared_params=*/{}, /*undeclared_params=*/{}};
+int64_t EstimatePreparedStatementSize(const Query& query,
+                                      const QueryEvaluationState& state) {
+  return query.sql.size() +
+         CountResolvedNodes(state.analyzer_output->resolved_statement()) *
+             kEstimatedBytesPerResolvedNode;
+}
 
-    ZETASQL_ASSIGN_OR_RETURN(auto result,
-                     query_engine_.ExecuteSql(q, query_context_,
-                                              v1::ExecuteSqlRequest::NORMAL));
-    return std::move(result.rows);
+// Analyzes 'query' against 'catalog' and stores both in 'state'. DML
+// statements are analyzed without pruning unused columns, since their
+// mutations are built from all the columns of the modified rows.
+absl::Status AnalyzeQuery(const Query& query, std::shared_ptr<Catalog> catalog,
+                          const FunctionCatalog* function_catalog,
+                          zetasql::TypeFactory* type_factory,
+                          zetasql::AnalyzerOptions analyzer_options,
+                          QueryEvaluationState* state) {
+  const QueryContext& context = state->context;
+  std::unique_ptr<const zetasql::AnalyzerOutput> analyzer_output;
+  if (context.schema->dialect() == database_api::DatabaseDialect::POSTGRESQL &&
+      !query.change_stream_internal_lookup.has_value()) {
+    ZETASQL_ASSIGN_OR_RETURN(
+        analyzer_output,
+        AnalyzePostgreSQL(query.sql, catalog.get(), analyzer_options,
+                          type_factory, function_catalog));
+
+  } else {
+    ZETASQL_ASSIGN_OR_RETURN(analyzer_output, Analyze(query.sql, catalog.get(),
+                                              analyzer_options, type_factory));
+
+    if (analyzer_output->has_graph_references()) {
+      analyzer_options.set_prune_unused_columns(false);
+      ZETASQL_ASSIGN_OR_RETURN(
+          analyzer_output,
+          Analyze(query.sql, catalog.get(), analyzer_options, type_factory));
+    }
   }
 
- private:
-  const QueryEngine& query_engine_;
-  const QueryContext& query_context_;
-};
+  if (IsDMLStmt(analyzer_output->resolved_statement()->node_kind())) {
+    analyzer_options.set_prune_unused_columns(false);
+    if (context.schema->dialect() ==
+        database_api::DatabaseDialect::POSTGRESQL) {
+      ZETASQL_ASSIGN_OR_RETURN(
+          analyzer_output,
+          AnalyzePostgreSQL(query.sql, catalog.get(), analyzer_options,
+                            type_factory, function_catalog));
+    } else {
+      ZETASQL_ASSIGN_OR_RETURN(
+          analyzer_output,
+          Analyze(query.sql, catalog.get(), analyzer_options, type_factory));
+    }
+  }
+
+  state->catalog = std::move(catalog);
+  state->analyzer_output = std::move(analyzer_output);
+  return absl::OkStatus();
+}
 
 }  // namespace
 
@@ -1080,10 +1575,11 @@ absl::StatusOr<std::string> QueryEngine::GetDmlTargetTable(
                        query.declared_params,
                        GetTimeZone(function_catalog_.GetLatestSchema())));
   analyzer_options.set_prune_unused_columns(true);
-  Catalog catalog(schema, &function_catalog_, type_factory_, analyzer_options);
+  ZETASQL_ASSIGN_OR_RETURN(std::shared_ptr<Catalog> catalog,
+                   GetSchemaCatalog(schema));
   ZETASQL_ASSIGN_OR_RETURN(
       auto analyzer_output,
-      Analyze(query.sql, &catalog, analyzer_options, type_factory_));
+      Analyze(query.sql, catalog.get(), analyzer_options, type_factory_));
   ZETASQL_ASSIGN_OR_RETURN(auto params,
                    ExtractParameters(query, analyzer_output.get()));
   ZETASQL_ASSIGN_OR_RETURN(auto statement,
@@ -1112,6 +1608,67 @@ std::string QueryEngine::GetTimeZone(const Schema* schema) {
   return time_zone;
 }
 
+absl::StatusOr<std::shared_ptr<Catalog>> QueryEngine::GetSchemaCatalog(
+    const Schema* schema) const {
+  {
+    absl::MutexLock lock(&catalog_mu_);
+    if (catalog_ != nullptr &&
+        catalog_schema_generation_ == schema->generation()) {
+      return catalog_;
+    }
+  }
+
+  // The catalog is built without holding the lock, so that statements against
+  // the current schema are not blocked by a statement against another one.
+  // The analyzer options only matter for the analysis of generated columns and
+  // of the change stream TVFs, which do not depend on the statement.
+  static BoundRowReader* const bound_reader = new BoundRowReader();
+  static BoundQueryEvaluator* const bound_evaluator = new BoundQueryEvaluator();
+  ZETASQL_ASSIGN_OR_RETURN(
+      auto analyzer_options,
+      MakeAnalyzerOptionsWithParameters({}, GetTimeZone(schema)));
+  analyzer_options.set_prune_unused_columns(true);
+  auto catalog = std::make_shared<Catalog>(
+      schema, &function_catalog_, type_factory_, analyzer_options, bound_reader,
+      bound_evaluator, /*change_stream_internal_lookup=*/std::nullopt,
+      &spanner_sys_stats_, GetSystemCatalogs(schema));
+
+  absl::MutexLock lock(&catalog_mu_);
+  if (catalog_ == nullptr ||
+      catalog_schema_generation_ < schema->generation()) {
+    catalog_ = catalog;
+    catalog_schema_generation_ = schema->generation();
+  } else if (catalog_schema_generation_ == schema->generation()) {
+    // Another statement built the catalog first.
+    return catalog_;
+  }
+  return catalog;
+}
+
+std::shared_ptr<const SystemCatalogs> QueryEngine::GetSystemCatalogs(
+    const Schema* schema) const {
+  absl::MutexLock lock(&catalog_mu_);
+  std::shared_ptr<const SystemCatalogs> system_catalogs =
+      system_catalogs_[schema->generation()];
+  if (system_catalogs == nullptr) {
+    system_catalogs = std::make_shared<const SystemCatalogs>();
+    system_catalogs_[schema->generation()] = system_catalogs;
+    while (system_catalogs_.size() > kMaxSchemasWithSystemCatalogs) {
+      system_catalogs_.erase(system_catalogs_.begin());
+    }
+  }
+  return system_catalogs;
+}
+
+void QueryEngine::DropCatalogsOlderThan(int64_t schema_generation) {
+  std::shared_ptr<Catalog> dropped;
+  absl::MutexLock lock(&catalog_mu_);
+  if (catalog_schema_generation_ < schema_generation) {
+    // The catalog is destroyed once the lock is released.
+    dropped = std::move(catalog_);
+  }
+}
+
 absl::StatusOr<QueryResult> QueryEngine::ExecuteInsertOnConflictDml(
     const Query& query, const zetasql::ResolvedStatement* resolved_statement,
     const std::map<std::string, zetasql::Value>& params,
@@ -1269,6 +1826,34 @@ absl::StatusOr<QueryResult> QueryEngine::ExecuteInsertOnConflictDml(
 absl::StatusOr<QueryResult> QueryEngine::ExecuteSql(
     const Query& query, const QueryContext& context,
     v1::ExecuteSqlRequest_QueryMode query_mode) const {
+  if (!query.record_stats || query.change_stream_internal_lookup.has_value()) {
+    return ExecuteSqlInternal(query, context, query_mode, /*stats=*/nullptr);
+  }
+
+  // The rows scanned while the returned rows are consumed are counted in
+  // 'stats', so it is owned by the returned row cursor.
+  absl::Time start_time = absl::Now();
+  auto stats = std::make_unique<QueryExecutionStats>();
+  stats->in_read_write_transaction = context.writer != nullptr;
+  absl::StatusOr<QueryResult> result =
+      ExecuteSqlInternal(query, context, query_mode, stats.get());
+  stats->cpu_time = absl::Now() - start_time;
+  if (!result.ok() || result->rows == nullptr) {
+    stats->failed = !result.ok();
+    stats->latency = stats->cpu_time;
+    query_stats_.Record(query.sql, start_time + stats->latency, *stats);
+    return result;
+  }
+  result->rows = std::make_unique<QueryStatsRowCursor>(
+      std::move(result->rows), &query_stats_, query.sql, start_time,
+      std::move(stats));
+  return result;
+}
+
+absl::StatusOr<QueryResult> QueryEngine::ExecuteSqlInternal(
+    const Query& query, const QueryContext& context,
+    v1::ExecuteSqlRequest_QueryMode query_mode,
+    QueryExecutionStats* stats) const {
   absl::Time start_time = absl::Now();
 
   ZETASQL_ASSIGN_OR_RETURN(auto analyzer_options,
@@ -1277,40 +1862,69 @@ absl::StatusOr<QueryResult> QueryEngine::ExecuteSql(
                        GetTimeZone(function_catalog_.GetLatestSchema())));
   analyzer_options.set_prune_unused_columns(true);
 
-  QueryEvaluatorForEngine view_evaluator(*this, context);
-  auto catalog = std::make_unique<Catalog>(
-      context.schema, &function_catalog_, type_factory_, analyzer_options,
-      context.reader, &view_evaluator, query.change_stream_internal_lookup);
-
-  std::unique_ptr<const zetasql::AnalyzerOutput> analyzer_output;
-  if (context.schema->dialect() == database_api::DatabaseDialect::POSTGRESQL &&
-      !query.change_stream_internal_lookup.has_value()) {
-    ZETASQL_ASSIGN_OR_RETURN(
-        analyzer_output,
-        AnalyzePostgreSQL(query.sql, catalog.get(), analyzer_options,
-                          type_factory_, &function_catalog_));
-
+  // Change stream lookups are analyzed against a catalog which exposes the
+  // internal tables of a change stream, so they are not cached.
+  std::unique_ptr<QueryEvaluationState> state;
+  std::string cache_key;
+  if (!query.change_stream_internal_lookup.has_value()) {
+    cache_key = PreparedStatementCache::MakeKey(context.schema, query.sql,
+                                                query.declared_params);
+    state.reset(static_cast<QueryEvaluationState*>(
+        prepared_statement_cache_.Take(cache_key).release()));
+  }
+  if (state != nullptr) {
+    state->context = context;
   } else {
-    ZETASQL_ASSIGN_OR_RETURN(analyzer_output, Analyze(query.sql, catalog.get(),
-                                              analyzer_options, type_factory_));
-
-    if (analyzer_output->has_graph_references()) {
-      analyzer_options.set_prune_unused_columns(false);
-      catalog = std::make_unique<Catalog>(
+    state = std::make_unique<QueryEvaluationState>(*this, context);
+    std::shared_ptr<Catalog> catalog;
+    if (query.change_stream_internal_lookup.has_value()) {
+      catalog = std::make_shared<Catalog>(
           context.schema, &function_catalog_, type_factory_, analyzer_options,
-          context.reader, &view_evaluator, query.change_stream_internal_lookup);
-      ZETASQL_ASSIGN_OR_RETURN(
-          analyzer_output,
-          Analyze(query.sql, catalog.get(), analyzer_options, type_factory_));
+          &state->reader, &state->view_evaluator,
+          query.change_stream_internal_lookup, &spanner_sys_stats_,
+          GetSystemCatalogs(context.schema));
+    } else {
+      ZETASQL_ASSIGN_OR_RETURN(catalog, GetSchemaCatalog(context.schema));
+    }
+    ZETASQL_RETURN_IF_ERROR(AnalyzeQuery(query, std::move(catalog),
+                                 &function_catalog_, type_factory_,
+                                 analyzer_options, state.get()));
+    statements_analyzed_.fetch_add(1, std::memory_order_relaxed);
+    if (!cache_key.empty()) {
+      state->cache = &prepared_statement_cache_;
+      state->cache_key = cache_key;
+      state->schema_generation = context.schema->generation();
+      state->size_bytes = EstimatePreparedStatementSize(query, *state);
     }
   }
+  if (stats != nullptr) {
+    state->reader.set_rows_scanned(&stats->rows_scanned);
+  }
+  // The state outlives this call, whether it is owned by the returned rows or
+  // put back in the prepared statement cache.
+  ScopedExecutionBinding binding(state.get());
+  const zetasql::AnalyzerOutput* analyzer_output =
+      state->analyzer_output.get();
 
-  ZETASQL_ASSIGN_OR_RETURN(auto params,
-                   ExtractParameters(query, analyzer_output.get()));
+  ZETASQL_ASSIGN_OR_RETURN(auto params, ExtractParameters(query, analyzer_output));
 
-  ZETASQL_ASSIGN_OR_RETURN(auto resolved_statement,
-                   ExtractValidatedResolvedStatementAndOptions(
-                       analyzer_output.get(), context));
+  // The validation depends on the transaction, e.g. on the columns in which it
+  // has written pending commit timestamps, so it is repeated for every
+  // execution. The rewrites do not, so a cached state keeps their result.
+  if (state->hinted_statement == nullptr) {
+    ZETASQL_ASSIGN_OR_RETURN(state->hinted_statement,
+                     RewriteHints(analyzer_output));
+  }
+  ZETASQL_RETURN_IF_ERROR(ValidateStatementInContext(
+      state->hinted_statement.get(), analyzer_output, context));
+  if (state->resolved_statement == nullptr) {
+    ZETASQL_ASSIGN_OR_RETURN(state->resolved_statement,
+                     RewriteStatementForExecution(
+                         state->hinted_statement.get(), context.schema));
+    statements_rewritten_.fetch_add(1, std::memory_order_relaxed);
+  }
+  const zetasql::ResolvedStatement* statement =
+      state->resolved_statement.get();
 
   // Change stream queries are not directly executed via this generic ExecuteSql
   // function in query engine. If a change stream query reaches here, it is from
@@ -1320,50 +1934,60 @@ absl::StatusOr<QueryResult> QueryEngine::ExecuteSql(
       absl::flat_hash_map<std::string, zetasql::Value>(params.begin(),
                                                          params.end())};
   ZETASQL_ASSIGN_OR_RETURN(auto is_change_stream,
-                   validator.IsChangeStreamQuery(resolved_statement.get()));
+                   validator.IsChangeStreamQuery(statement));
   if (is_change_stream) {
     return error::ChangeStreamQueriesMustBeStreaming();
   }
 
+  // The plan is built before the statement is executed, since the state which
+  // owns the statement goes back to the prepared statement cache once the
+  // execution is done. Reads are profiled as the statement is executed.
+  bool is_dml = IsDMLStmt(statement->node_kind());
+  v1::QueryPlan query_plan;
+  QueryProfile profile;
+  if (query_mode == v1::ExecuteSqlRequest::PLAN ||
+      query_mode == v1::ExecuteSqlRequest::PROFILE) {
+    query_plan = BuildQueryPlan(statement);
+  }
+  if (query_mode == v1::ExecuteSqlRequest::PROFILE) {
+    state->reader.set_profile(&profile);
+  }
+
   QueryResult result;
   if (!IsDMLStmt(analyzer_output->resolved_statement()->node_kind())) {
+    result.parameter_types = analyzer_output->undeclared_parameters();
+    result.has_deterministic_row_order = HasDeterministicRowOrder(statement);
+
+    // Rows of profiled queries are counted up front for the query stats, and
+    // callers of change stream lookups check whether any rows were returned.
+    bool materialize_rows = query_mode == v1::ExecuteSqlRequest::PROFILE ||
+                            query.change_stream_internal_lookup.has_value();
     ZETASQL_ASSIGN_OR_RETURN(
         auto cursor,
-        EvaluateQuery(resolved_statement.get(), params, type_factory_,
+        EvaluateQuery(std::move(state), params, type_factory_,
                       &result.num_output_rows, query_mode,
-                      GetTimeZone(function_catalog_.GetLatestSchema())));
+                      GetTimeZone(function_catalog_.GetLatestSchema()),
+                      materialize_rows));
     result.rows = std::move(cursor);
   } else {
     ZETASQL_RET_CHECK_NE(context.writer, nullptr);
     analyzer_options.set_prune_unused_columns(false);
-    if (context.schema->dialect() ==
-        database_api::DatabaseDialect::POSTGRESQL) {
-      ZETASQL_ASSIGN_OR_RETURN(
-          analyzer_output,
-          AnalyzePostgreSQL(query.sql, catalog.get(), analyzer_options,
-                            type_factory_, &function_catalog_));
-    } else {
-      ZETASQL_ASSIGN_OR_RETURN(
-          analyzer_output,
-          Analyze(query.sql, catalog.get(), analyzer_options, type_factory_));
-    }
-    ZETASQL_ASSIGN_OR_RETURN(resolved_statement,
-                     ExtractValidatedResolvedStatementAndOptions(
-                         analyzer_output.get(), context));
 
     // Only execute the SQL statement if the user did not request PLAN mode.
     if (query_mode != v1::ExecuteSqlRequest::PLAN) {
       bool is_insert_on_conflict_stmt =
-          resolved_statement->Is<zetasql::ResolvedInsertStmt>() &&
-          resolved_statement->GetAs<zetasql::ResolvedInsertStmt>()
+          statement->Is<zetasql::ResolvedInsertStmt>() &&
+          statement->GetAs<zetasql::ResolvedInsertStmt>()
                   ->on_conflict_clause() != nullptr;
       if (!is_insert_on_conflict_stmt) {
         ZETASQL_ASSIGN_OR_RETURN(
             auto execute_update_result,
-            EvaluateUpdate(resolved_statement.get(), catalog.get(), params,
+            EvaluateUpdate(statement, state->catalog.get(), params,
                            type_factory_, context.schema->dialect(),
                            context.schema,
-                           GetTimeZone(function_catalog_.GetLatestSchema())));
+                           GetTimeZone(function_catalog_.GetLatestSchema()),
+                           /*return_all_insert_rows_insert_ignore_dml=*/false,
+                           &state->prepared_modify));
         ZETASQL_RETURN_IF_ERROR(context.writer->Write(execute_update_result.mutation));
         result.modified_row_count = execute_update_result.modify_row_count;
         result.rows = std::move(execute_update_result.returning_row_cursor);
@@ -1379,12 +2003,12 @@ absl::StatusOr<QueryResult> QueryEngine::ExecuteSql(
           return error::UnsupportedUpsertQueries(error_message);
         }
         ZETASQL_ASSIGN_OR_RETURN(result, ExecuteInsertOnConflictDml(
-                                     query, resolved_statement.get(), params,
-                                     *catalog, analyzer_options, context));
+                                     query, statement, params, *state->catalog,
+                                     analyzer_options, context));
       }
     } else {
       // Add the columns and types of the returning clause to the result.
-      auto returning_clause = GetReturningClause(resolved_statement.get());
+      auto returning_clause = GetReturningClause(statement);
       if (returning_clause != nullptr) {
         std::vector<std::string> names;
         std::vector<const zetasql::Type*> types;
@@ -1396,13 +2020,21 @@ absl::StatusOr<QueryResult> QueryEngine::ExecuteSql(
         result.rows = std::make_unique<VectorsRowCursor>(names, types, values);
       }
     }
+    result.parameter_types = analyzer_output->undeclared_parameters();
+    ReleaseQueryEvaluationState(std::move(state));
   }
-  // Add both undeclared and declared parameters to the result.
-  result.parameter_types = analyzer_output->undeclared_parameters();
+  // Add declared parameters to the result, in addition to the undeclared ones.
   for (auto const& param : query.declared_params) {
     result.parameter_types.insert({param.first, param.second.type()});
   }
   result.elapsed_time = absl::Now() - start_time;
+  if (query_mode == v1::ExecuteSqlRequest::PROFILE) {
+    profile.rows_returned =
+        is_dml ? result.modified_row_count : result.num_output_rows;
+    profile.latency = result.elapsed_time;
+    AddExecutionStats(profile, &query_plan);
+  }
+  result.query_plan = std::move(query_plan);
   return result;
 }
 
@@ -1438,16 +2070,17 @@ absl::Status QueryEngine::IsPartitionable(const Query& query,
                        query.declared_params,
                        GetTimeZone(function_catalog_.GetLatestSchema())));
   analyzer_options.set_prune_unused_columns(true);
-  Catalog catalog{context.schema, &function_catalog_, type_factory_,
-                  analyzer_options};
+  ZETASQL_ASSIGN_OR_RETURN(std::shared_ptr<Catalog> catalog,
+                   GetSchemaCatalog(context.schema));
 
   std::unique_ptr<const zetasql::AnalyzerOutput> analyzer_output;
   if (context.schema->dialect() == database_api::DatabaseDialect::POSTGRESQL) {
-    ZETASQL_ASSIGN_OR_RETURN(analyzer_output,
-                     AnalyzePostgreSQL(query.sql, &catalog, analyzer_options,
-                                       type_factory_, &function_catalog_));
+    ZETASQL_ASSIGN_OR_RETURN(
+        analyzer_output,
+        AnalyzePostgreSQL(query.sql, catalog.get(), analyzer_options,
+                          type_factory_, &function_catalog_));
   } else {
-    ZETASQL_ASSIGN_OR_RETURN(analyzer_output, Analyze(query.sql, &catalog,
+    ZETASQL_ASSIGN_OR_RETURN(analyzer_output, Analyze(query.sql, catalog.get(),
                                               analyzer_options, type_factory_));
   }
 
@@ -1476,11 +2109,11 @@ absl::Status QueryEngine::IsValidPartitionedDML(
                        query.declared_params,
                        GetTimeZone(function_catalog_.GetLatestSchema())));
   analyzer_options.set_prune_unused_columns(true);
-  Catalog catalog{context.schema, &function_catalog_, type_factory_,
-                  analyzer_options};
+  ZETASQL_ASSIGN_OR_RETURN(std::shared_ptr<Catalog> catalog,
+                   GetSchemaCatalog(context.schema));
   ZETASQL_ASSIGN_OR_RETURN(
       auto analyzer_output,
-      Analyze(query.sql, &catalog, analyzer_options, type_factory_));
+      Analyze(query.sql, catalog.get(), analyzer_options, type_factory_));
 
   ZETASQL_ASSIGN_OR_RETURN(auto resolved_statement,
                    ExtractValidatedResolvedStatementAndOptions(
@@ -1500,24 +2133,25 @@ bool IsDMLQuery(const std::string& query) {
 absl::StatusOr<ChangeStreamQueryValidator::ChangeStreamMetadata>
 QueryEngine::TryGetChangeStreamMetadata(const Query& query,
                                         const Schema* schema,
-                                        bool in_read_write_txn) {
+                                        bool in_read_write_txn) const {
   const absl::Time start_time = absl::Now();
   ZETASQL_ASSIGN_OR_RETURN(auto analyzer_options,
                    MakeAnalyzerOptionsWithParameters(query.declared_params,
                                                      GetTimeZone(schema)));
   analyzer_options.set_prune_unused_columns(true);
-  zetasql::TypeFactory type_factory;
-  FunctionCatalog function_catalog(
-      &type_factory, kCloudSpannerEmulatorFunctionCatalogName, schema);
-  Catalog catalog{schema, &function_catalog, &type_factory, analyzer_options};
+  // The statement is analyzed against the shared catalog of the schema, so
+  // that the system tables are not rebuilt for every query.
+  ZETASQL_ASSIGN_OR_RETURN(std::shared_ptr<Catalog> catalog,
+                   GetSchemaCatalog(schema));
   std::unique_ptr<const zetasql::AnalyzerOutput> analyzer_output;
   if (schema->dialect() == database_api::DatabaseDialect::POSTGRESQL) {
-    ZETASQL_ASSIGN_OR_RETURN(analyzer_output,
-                     AnalyzePostgreSQL(query.sql, &catalog, analyzer_options,
-                                       &type_factory, &function_catalog));
+    ZETASQL_ASSIGN_OR_RETURN(
+        analyzer_output,
+        AnalyzePostgreSQL(query.sql, catalog.get(), analyzer_options,
+                          type_factory_, &function_catalog_));
   } else {
-    ZETASQL_ASSIGN_OR_RETURN(analyzer_output, Analyze(query.sql, &catalog,
-                                              analyzer_options, &type_factory));
+    ZETASQL_ASSIGN_OR_RETURN(analyzer_output, Analyze(query.sql, catalog.get(),
+                                              analyzer_options, type_factory_));
   }
 
   ZETASQL_ASSIGN_OR_RETURN(auto params,
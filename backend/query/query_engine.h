@@ -17,24 +17,34 @@
 #ifndef THIRD_PARTY_CLOUD_SPANNER_EMULATOR_BACKEND_QUERY_QUERY_ENGINE_H_
 #define THIRD_PARTY_CLOUD_SPANNER_EMULATOR_BACKEND_QUERY_QUERY_ENGINE_H_
 
+#include <atomic>
+#include <cstdint>
+#include <map>
 #include <memory>
 #include <optional>
 #include <string>
 
 #include "google/protobuf/struct.pb.h"
+#include "google/spanner/v1/query_plan.pb.h"
 #include "google/spanner/v1/spanner.pb.h"
 #include "zetasql/public/analyzer_options.h"
 #include "zetasql/public/type.h"
 #include "zetasql/public/value.h"
 #include "zetasql/resolved_ast/resolved_ast.h"
+#include "absl/base/thread_annotations.h"
 #include "absl/memory/memory.h"
 #include "absl/status/status.h"
 #include "absl/status/statusor.h"
+#include "absl/synchronization/mutex.h"
 #include "backend/query/catalog.h"
 #include "backend/query/change_stream/change_stream_query_validator.h"
 #include "backend/query/function_catalog.h"
+#include "backend/query/prepared_statement_cache.h"
 #include "backend/query/query_context.h"
+#include "backend/query/query_stats.h"
+#include "backend/query/spanner_sys_stats.h"
 #include "backend/schema/catalog/schema.h"
+#include "common/config.h"
 #include "absl/status/status.h"
 
 namespace google {
@@ -58,6 +68,11 @@ struct Query {
   // If not empty,the current query is an internal query against a non public
   // partition or data table of this change stream
   std::optional<std::string> change_stream_internal_lookup;
+
+  // Whether the execution is recorded in the SPANNER_SYS query statistics.
+  // Queries issued by the emulator itself, such as the bodies of views, are
+  // not recorded.
+  bool record_stats = true;
 };
 
 // Returns true if the given query is a DML statement.
@@ -79,11 +94,24 @@ struct QueryResult {
   // The number of modified rows.
   int64_t modified_row_count = 0;
 
-  // The number of rows in the returned row cursor.
+  // The number of rows in the returned row cursor. Only set when the rows are
+  // materialized up front, which is the case for PROFILE queries and change
+  // stream lookups. Rows of other queries are produced by the evaluator as the
+  // row cursor is iterated.
   int64_t num_output_rows = 0;
 
+  // True if the query produces the same rows in the same order whenever it is
+  // executed at the same timestamp, so that a re-execution can skip the rows
+  // which an earlier execution returned. See HasDeterministicRowOrder.
+  bool has_deterministic_row_order = false;
+
   // Query execution elapsed time.
   absl::Duration elapsed_time;
+
+  // The plan of the statement. Only set in PLAN and PROFILE mode, in which
+  // case the plan nodes of a PROFILE execution also carry its runtime
+  // statistics.
+  v1::QueryPlan query_plan;
 };
 
 // QueryEngine handles SQL-related requests.
@@ -93,7 +121,11 @@ class QueryEngine {
                        const Schema* schema)
       : type_factory_(type_factory),
         function_catalog_(type_factory,
-                          kCloudSpannerEmulatorFunctionCatalogName, schema) {}
+                          kCloudSpannerEmulatorFunctionCatalogName, schema),
+        prepared_statement_cache_(
+            config::prepared_statement_cache_max_bytes()) {
+    query_stats_.AddSources(&spanner_sys_stats_);
+  }
 
   // Returns the name of the table that a given DML query modifies.
   absl::StatusOr<std::string> GetDmlTargetTable(const Query& query,
@@ -105,6 +137,8 @@ class QueryEngine {
                                          const QueryContext& context) const;
 
   // Executes a SQL query (SELECT query or DML) using the given query mode.
+  // The execution is recorded in the query statistics once the returned rows
+  // have been consumed.
   absl::StatusOr<QueryResult> ExecuteSql(
       const Query& query, const QueryContext& context,
       v1::ExecuteSqlRequest_QueryMode query_mode) const;
@@ -131,23 +165,95 @@ class QueryEngine {
   // valid change stream query. Returns corresponding error status if current
   // query is an invalid regular query, a non-change stream tvf query or an
   // invalid change stream tvf query.
-  static absl::StatusOr<ChangeStreamQueryValidator::ChangeStreamMetadata>
+  absl::StatusOr<ChangeStreamQueryValidator::ChangeStreamMetadata>
   TryGetChangeStreamMetadata(const Query& query, const Schema* schema,
-                             bool in_read_write_txn = false);
+                             bool in_read_write_txn = false) const;
 
   zetasql::TypeFactory* type_factory() const { return type_factory_; }
 
   const FunctionCatalog* function_catalog() const { return &function_catalog_; }
 
+  // Also drops the prepared statements of older schemas, which are kept in
+  // the prepared statement cache.
   void SetLatestSchemaForFunctionCatalog(const Schema* schema) {
     function_catalog_.SetLatestSchema(schema);
+    if (schema != nullptr) {
+      prepared_statement_cache_.Invalidate(schema->generation());
+      DropCatalogsOlderThan(schema->generation());
+    }
+  }
+
+  // Returns the catalog of 'schema', which is built once per schema version
+  // and shared by all the statements analyzed against it. The catalog is not
+  // tied to a transaction: its tables read through the reader of the execution
+  // in progress on the calling thread.
+  absl::StatusOr<std::shared_ptr<Catalog>> GetSchemaCatalog(
+      const Schema* schema) const ABSL_LOCKS_EXCLUDED(catalog_mu_);
+
+  // Statements analyzed and prepared by earlier executions.
+  const PreparedStatementCache& prepared_statement_cache() const {
+    return prepared_statement_cache_;
   }
 
+  // Number of statements analyzed, and rewritten for execution, by ExecuteSql.
+  // Statements found in the prepared statement cache are neither.
+  int64_t statements_analyzed() const { return statements_analyzed_; }
+  int64_t statements_rewritten() const { return statements_rewritten_; }
+
+  // Sources of the rows of the SPANNER_SYS statistics tables queried through
+  // this engine.
+  SpannerSysStats* spanner_sys_stats() { return &spanner_sys_stats_; }
+
+  // Statistics of the queries executed through this engine.
+  const QueryStats& query_stats() const { return query_stats_; }
+
  private:
   static std::string GetTimeZone(const Schema* schema);
 
+  // Returns the catalogs of the system tables of 'schema', which are shared by
+  // all the catalogs of the schema, including those built per statement.
+  std::shared_ptr<const SystemCatalogs> GetSystemCatalogs(
+      const Schema* schema) const ABSL_LOCKS_EXCLUDED(catalog_mu_);
+
+  // Releases the shared catalog if it was built for a schema older than the
+  // given generation.
+  void DropCatalogsOlderThan(int64_t schema_generation)
+      ABSL_LOCKS_EXCLUDED(catalog_mu_);
+
+  // Executes a SQL query, counting the rows it scans in 'stats' if it is not
+  // null.
+  absl::StatusOr<QueryResult> ExecuteSqlInternal(
+      const Query& query, const QueryContext& context,
+      v1::ExecuteSqlRequest_QueryMode query_mode,
+      QueryExecutionStats* stats) const;
+
   zetasql::TypeFactory* type_factory_;
   FunctionCatalog function_catalog_;
+
+  // Executions take statements out of the cache and put them back when they
+  // are done, so it is mutable.
+  mutable PreparedStatementCache prepared_statement_cache_;
+
+  SpannerSysStats spanner_sys_stats_;
+
+  // The catalog of the newest schema seen by GetSchemaCatalog. Catalogs of
+  // older schemas are built for each statement which needs them, as queries at
+  // older timestamps are rare.
+  mutable absl::Mutex catalog_mu_;
+  mutable std::shared_ptr<Catalog> catalog_ ABSL_GUARDED_BY(catalog_mu_);
+  mutable int64_t catalog_schema_generation_ ABSL_GUARDED_BY(catalog_mu_) = 0;
+
+  // The catalogs of the system tables of the newest schemas seen, keyed by
+  // schema generation. Unlike the shared catalog, these are kept for a few
+  // older schemas too, which serve the reads at older timestamps.
+  mutable std::map<int64_t, std::shared_ptr<const SystemCatalogs>>
+      system_catalogs_ ABSL_GUARDED_BY(catalog_mu_);
+
+  mutable std::atomic<int64_t> statements_analyzed_ = 0;
+  mutable std::atomic<int64_t> statements_rewritten_ = 0;
+
+  // Executions record their statistics once they are done, so it is mutable.
+  mutable QueryStats query_stats_;
 };
 
 }  // namespace backend
@@ -45,6 +45,7 @@
 #include "backend/datamodel/key_set.h"
 #include "backend/datamodel/value.h"
 #include "backend/query/query_context.h"
+#include "backend/query/spanner_sys_stats.h"
 #include "backend/schema/catalog/schema.h"
 #include "common/feature_flags.h"
 #include "common/limits.h"
@@ -68,6 +69,7 @@ using testing::ElementsAre;
 using testing::Field;
 using testing::HasSubstr;
 using testing::IsTrue;
+using testing::Ne;
 using testing::Property;
 using testing::Return;
 using testing::UnorderedElementsAre;
@@ -79,6 +81,7 @@ using ::emulator::tests::common::TestEnum;
 
 using zetasql::values::Array;
 using zetasql::values::Date;
+using zetasql::values::Double;
 using zetasql::values::Enum;
 using zetasql::values::Int64;
 using zetasql::values::NullInt64;
@@ -198,6 +201,43 @@ std::vector<const zetasql::Type*> GetColumnTypes(
   return types;
 }
 
+// Returns the first plan node with the given display name, or null if there is
+// none.
+const v1::PlanNode* FindPlanNode(const v1::QueryPlan& plan,
+                                 absl::string_view display_name) {
+  for (const v1::PlanNode& node : plan.plan_nodes()) {
+    if (node.display_name() == display_name) {
+      return &node;
+    }
+  }
+  return nullptr;
+}
+
+// Returns the descriptions of the scalar children of 'node' linked with the
+// given type.
+std::vector<std::string> GetScalarChildren(const v1::QueryPlan& plan,
+                                           const v1::PlanNode& node,
+                                           absl::string_view type) {
+  std::vector<std::string> descriptions;
+  for (const v1::PlanNode::ChildLink& link : node.child_links()) {
+    const v1::PlanNode& child = plan.plan_nodes(link.child_index());
+    if (link.type() == type && child.kind() == v1::PlanNode::SCALAR) {
+      descriptions.push_back(child.short_representation().description());
+    }
+  }
+  return descriptions;
+}
+
+// Returns the total of an execution statistic of 'node'.
+std::string GetExecutionStat(const v1::PlanNode& node,
+                             absl::string_view name) {
+  auto it = node.execution_stats().fields().find(std::string(name));
+  if (it == node.execution_stats().fields().end()) {
+    return "";
+  }
+  return it->second.struct_value().fields().at("total").string_value();
+}
+
 absl::StatusOr<std::vector<std::vector<zetasql::Value>>> GetAllColumnValues(
     std::unique_ptr<backend::RowCursor> cursor) {
   std::vector<std::vector<zetasql::Value>> all_values;
@@ -599,6 +639,211 @@ TEST_P(QueryEngineTest, ExecuteSqlSelectsOneFromTable) {
                                ElementsAre(Int64(1)))));
 }
 
+TEST_P(QueryEngineTest, ProfileSqlCountsOutputRows) {
+  ZETASQL_ASSERT_OK_AND_ASSIGN(
+      QueryResult result,
+      query_engine().ExecuteSql(Query{"SELECT 1 AS one FROM test_table"},
+                                QueryContext{schema(), reader()},
+                                v1::ExecuteSqlRequest::PROFILE));
+  EXPECT_EQ(result.num_output_rows, 3);
+  EXPECT_THAT(GetAllColumnValues(std::move(result.rows)),
+              IsOkAndHolds(testing::SizeIs(3)));
+}
+
+TEST_P(QueryEngineTest, ExecuteSqlReportsErrorsFromStreamedRows) {
+  if (GetParam() == POSTGRESQL) {
+    GTEST_SKIP();
+  }
+  // Rows are evaluated as the cursor is iterated, so an error in a later row
+  // may only surface from the cursor.
+  absl::StatusOr<QueryResult> result = query_engine().ExecuteSql(
+      Query{"SELECT 12 DIV (int64_col - 4) FROM test_table"},
+      QueryContext{schema(), reader()});
+  absl::Status status =
+      result.ok() ? GetAllColumnValues(std::move(result->rows)).status()
+                  : result.status();
+  EXPECT_THAT(status, StatusIs(StatusCode::kOutOfRange));
+}
+
+TEST_P(QueryEngineTest, ExecuteSqlReusesPreparedStatements) {
+  Query query;
+  if (GetParam() == POSTGRESQL) {
+    query = {"SELECT int64_col FROM test_table WHERE int64_col > $1"};
+  } else {
+    query = {"SELECT int64_col FROM test_table WHERE int64_col > @p1"};
+  }
+
+  query.declared_params = {{"p1", Int64(1)}};
+  ZETASQL_ASSERT_OK_AND_ASSIGN(
+      QueryResult result,
+      query_engine().ExecuteSql(query, QueryContext{schema(), reader()}));
+  EXPECT_THAT(GetAllColumnValues(std::move(result.rows)),
+              IsOkAndHolds(ElementsAre(ElementsAre(Int64(2)),
+                                       ElementsAre(Int64(4)))));
+
+  // The second execution binds new parameter values to the statement prepared
+  // by the first one.
+  query.declared_params = {{"p1", Int64(2)}};
+  ZETASQL_ASSERT_OK_AND_ASSIGN(
+      result,
+      query_engine().ExecuteSql(query, QueryContext{schema(), reader()}));
+  EXPECT_THAT(GetAllColumnValues(std::move(result.rows)),
+              IsOkAndHolds(ElementsAre(ElementsAre(Int64(4)))));
+
+  EXPECT_EQ(query_engine().prepared_statement_cache().misses(), 1);
+  EXPECT_EQ(query_engine().prepared_statement_cache().hits(), 1);
+
+  // The second execution neither analyzed nor rewrote the statement again.
+  EXPECT_EQ(query_engine().statements_analyzed(), 1);
+  EXPECT_EQ(query_engine().statements_rewritten(), 1);
+}
+
+TEST_P(QueryEngineTest, ReportsWhetherRowOrderIsDeterministic) {
+  if (GetParam() == POSTGRESQL) {
+    // The queries below use GoogleSQL syntax.
+    GTEST_SKIP();
+  }
+  auto has_deterministic_row_order =
+      [&](const std::string& sql) -> absl::StatusOr<bool> {
+    ZETASQL_ASSIGN_OR_RETURN(QueryResult result,
+                     query_engine().ExecuteSql(
+                         Query{sql}, QueryContext{schema(), reader()}));
+    ZETASQL_RETURN_IF_ERROR(
+        GetAllColumnValues(std::move(result.rows)).status());
+    return result.has_deterministic_row_order;
+  };
+
+  // Ordered by the primary key, or by every output column.
+  EXPECT_THAT(has_deterministic_row_order(
+                  "SELECT * FROM test_table ORDER BY int64_col"),
+              IsOkAndHolds(true));
+  EXPECT_THAT(has_deterministic_row_order(
+                  "SELECT string_col FROM test_table WHERE int64_col > 1 "
+                  "ORDER BY string_col, int64_col DESC LIMIT 2"),
+              IsOkAndHolds(true));
+  EXPECT_THAT(has_deterministic_row_order(
+                  "SELECT x FROM UNNEST([3, 1, 2]) AS x ORDER BY x"),
+              IsOkAndHolds(true));
+
+  // Rows which are not ordered, or are ordered with ties.
+  EXPECT_THAT(has_deterministic_row_order("SELECT * FROM test_table"),
+              IsOkAndHolds(false));
+  EXPECT_THAT(has_deterministic_row_order(
+                  "SELECT * FROM test_table ORDER BY string_col"),
+              IsOkAndHolds(false));
+  EXPECT_THAT(has_deterministic_row_order(
+                  "SELECT x FROM (SELECT int64_col AS x FROM test_table "
+                  "LIMIT 2) ORDER BY x"),
+              IsOkAndHolds(false));
+
+  // Values which differ between executions.
+  EXPECT_THAT(has_deterministic_row_order(
+                  "SELECT int64_col, RAND() AS r FROM test_table "
+                  "ORDER BY int64_col"),
+              IsOkAndHolds(false));
+  EXPECT_THAT(has_deterministic_row_order(
+                  "SELECT ARRAY_AGG(int64_col) AS a FROM test_table "
+                  "GROUP BY string_col ORDER BY string_col"),
+              IsOkAndHolds(false));
+}
+
+TEST_P(QueryEngineTest, SchemaChangeInvalidatesPreparedStatements) {
+  Query query{"SELECT int64_col FROM test_table"};
+  ZETASQL_ASSERT_OK_AND_ASSIGN(
+      QueryResult result,
+      query_engine().ExecuteSql(query, QueryContext{schema(), reader()}));
+  result.rows.reset();
+  EXPECT_EQ(query_engine().prepared_statement_cache().size(), 1);
+
+  query_engine().SetLatestSchemaForFunctionCatalog(multi_table_schema());
+  EXPECT_EQ(query_engine().prepared_statement_cache().size(), 0);
+  EXPECT_EQ(query_engine().prepared_statement_cache().size_bytes(), 0);
+}
+
+TEST_P(QueryEngineTest, StatementsShareTheCatalogOfASchema) {
+  ZETASQL_ASSERT_OK_AND_ASSIGN(std::shared_ptr<Catalog> catalog,
+                       query_engine().GetSchemaCatalog(schema()));
+
+  // Executions in different transactions read through their own reader, even
+  // while the rows of another execution against the same catalog are pending.
+  test::TestRowReader other_reader{
+      {{"test_table",
+        {{"int64_col", "string_col"},
+         {zetasql::types::Int64Type(), zetasql::types::StringType()},
+         {{Int64(8), String("eight")}}}}}};
+  ZETASQL_ASSERT_OK_AND_ASSIGN(
+      QueryResult result,
+      query_engine().ExecuteSql(Query{"SELECT int64_col FROM test_table"},
+                                QueryContext{schema(), reader()}));
+  ZETASQL_ASSERT_OK_AND_ASSIGN(
+      QueryResult other_result,
+      query_engine().ExecuteSql(Query{"SELECT string_col FROM test_table"},
+                                QueryContext{schema(), &other_reader}));
+  EXPECT_THAT(GetAllColumnValues(std::move(other_result.rows)),
+              IsOkAndHolds(ElementsAre(ElementsAre(String("eight")))));
+  EXPECT_THAT(GetAllColumnValues(std::move(result.rows)),
+              IsOkAndHolds(ElementsAre(ElementsAre(Int64(1)),
+                                       ElementsAre(Int64(2)),
+                                       ElementsAre(Int64(4)))));
+
+  EXPECT_THAT(query_engine().GetSchemaCatalog(schema()), IsOkAndHolds(catalog));
+  EXPECT_THAT(query_engine().GetSchemaCatalog(multi_table_schema()),
+              IsOkAndHolds(Ne(catalog)));
+}
+
+TEST_P(QueryEngineTest, CatalogsOfASchemaShareTheSystemTables) {
+  if (GetParam() == POSTGRESQL) {
+    GTEST_SKIP();
+  }
+  // Only the catalog of the newest schema is shared, so each lookup builds a
+  // new catalog of the older schema.
+  ZETASQL_ASSERT_OK(
+      query_engine().GetSchemaCatalog(multi_table_schema()).status());
+  ZETASQL_ASSERT_OK_AND_ASSIGN(std::shared_ptr<Catalog> catalog,
+                       query_engine().GetSchemaCatalog(schema()));
+  ZETASQL_ASSERT_OK_AND_ASSIGN(std::shared_ptr<Catalog> other_catalog,
+                       query_engine().GetSchemaCatalog(schema()));
+  ASSERT_NE(catalog, other_catalog);
+
+  const zetasql::Table* table = nullptr;
+  const zetasql::Table* other_table = nullptr;
+  ZETASQL_ASSERT_OK(
+      catalog->FindTable({"INFORMATION_SCHEMA", "TABLES"}, &table));
+  ZETASQL_ASSERT_OK(
+      other_catalog->FindTable({"INFORMATION_SCHEMA", "TABLES"}, &other_table));
+  EXPECT_EQ(table, other_table);
+}
+
+TEST_P(QueryEngineTest, SpannerSysStatsTablesReadCurrentRows) {
+  if (GetParam() == POSTGRESQL) {
+    GTEST_SKIP();
+  }
+  double used_bytes = 10;
+  query_engine().spanner_sys_stats()->SetSource(
+      SpannerSysStats::kTableSizesStats1Hour, [&]() {
+        return std::vector<SpannerSysStats::Row>{
+            {{"TABLE_NAME", String("test_table")},
+             {"USED_BYTES", Double(used_bytes)}}};
+      });
+
+  // Rows are read when the table is scanned, so the cached statement sees the
+  // current statistics. Columns without a value are NULL.
+  Query query{
+      "SELECT TABLE_NAME, USED_BYTES, INTERVAL_END "
+      "FROM SPANNER_SYS.TABLE_SIZES_STATS_1HOUR"};
+  for (double expected_bytes : {10, 20}) {
+    used_bytes = expected_bytes;
+    ZETASQL_ASSERT_OK_AND_ASSIGN(
+        QueryResult result,
+        query_engine().ExecuteSql(query, QueryContext{schema(), reader()}));
+    EXPECT_THAT(GetAllColumnValues(std::move(result.rows)),
+                IsOkAndHolds(ElementsAre(
+                    ElementsAre(String("test_table"), Double(expected_bytes),
+                                NullTimestamp()))));
+  }
+  EXPECT_EQ(query_engine().prepared_statement_cache().hits(), 1);
+}
+
 TEST_P(QueryEngineTest, PlanSqlSelectsOneFromTable) {
   ZETASQL_ASSERT_OK_AND_ASSIGN(
       QueryResult result,
@@ -612,6 +857,97 @@ TEST_P(QueryEngineTest, PlanSqlSelectsOneFromTable) {
               IsOkAndHolds(ElementsAre()));
 }
 
+TEST_P(QueryEngineTest, PlanSqlDescribesScansFiltersAndSorts) {
+  if (GetParam() == POSTGRESQL) {
+    GTEST_SKIP();
+  }
+  ZETASQL_ASSERT_OK_AND_ASSIGN(
+      QueryResult result,
+      query_engine().ExecuteSql(
+          Query{"SELECT string_col FROM test_table "
+                "WHERE int64_col > 1 AND string_col IS NOT NULL "
+                "ORDER BY string_col DESC LIMIT 2"},
+          QueryContext{schema(), reader()}, v1::ExecuteSqlRequest::PLAN));
+  const v1::QueryPlan& plan = result.query_plan;
+  ASSERT_GT(plan.plan_nodes_size(), 0);
+  EXPECT_EQ(plan.plan_nodes(0).display_name(), "Serialize Result");
+
+  const v1::PlanNode* sort = FindPlanNode(plan, "Sort Limit");
+  ASSERT_NE(sort, nullptr);
+  EXPECT_THAT(GetScalarChildren(plan, *sort, "Key"),
+              ElementsAre("string_col DESC"));
+  EXPECT_THAT(GetScalarChildren(plan, *sort, "Limit"), ElementsAre("2"));
+
+  // The condition on the key column bounds the keys read by the scan.
+  const v1::PlanNode* filter = FindPlanNode(plan, "Filter Scan");
+  ASSERT_NE(filter, nullptr);
+  EXPECT_THAT(GetScalarChildren(plan, *filter, "Seek Condition"),
+              ElementsAre("int64_col > 1"));
+  EXPECT_THAT(GetScalarChildren(plan, *filter, "Residual Condition"),
+              ElementsAre("NOT string_col IS NULL"));
+
+  const v1::PlanNode* scan = FindPlanNode(plan, "Scan");
+  ASSERT_NE(scan, nullptr);
+  EXPECT_EQ(scan->metadata().fields().at("scan_target").string_value(),
+            "test_table");
+  EXPECT_FALSE(scan->metadata().fields().count("Full scan") > 0);
+  EXPECT_FALSE(scan->has_execution_stats());
+}
+
+TEST_P(QueryEngineTest, PlanSqlDescribesDml) {
+  if (GetParam() == POSTGRESQL) {
+    GTEST_SKIP();
+  }
+  MockRowWriter writer;
+  EXPECT_CALL(writer, Write(testing::_)).Times(0);
+  ZETASQL_ASSERT_OK_AND_ASSIGN(
+      QueryResult result,
+      query_engine().ExecuteSql(
+          Query{"UPDATE test_table SET string_col = 'foo' "
+                "WHERE string_col = 'bar'"},
+          QueryContext{schema(), reader(), &writer},
+          v1::ExecuteSqlRequest::PLAN));
+  const v1::QueryPlan& plan = result.query_plan;
+  ASSERT_GT(plan.plan_nodes_size(), 0);
+  EXPECT_EQ(plan.plan_nodes(0).display_name(), "Update");
+
+  const v1::PlanNode* filter = FindPlanNode(plan, "Filter Scan");
+  ASSERT_NE(filter, nullptr);
+  EXPECT_THAT(GetScalarChildren(plan, *filter, "Seek Condition"),
+              ElementsAre());
+  EXPECT_THAT(GetScalarChildren(plan, *filter, "Residual Condition"),
+              ElementsAre("string_col = 'bar'"));
+
+  const v1::PlanNode* scan = FindPlanNode(plan, "Scan");
+  ASSERT_NE(scan, nullptr);
+  EXPECT_EQ(scan->metadata().fields().at("Full scan").string_value(), "true");
+}
+
+TEST_P(QueryEngineTest, ProfileSqlReportsRowsPerPlanNode) {
+  ZETASQL_ASSERT_OK_AND_ASSIGN(
+      QueryResult result,
+      query_engine().ExecuteSql(Query{"SELECT COUNT(*) FROM test_table"},
+                                QueryContext{schema(), reader()},
+                                v1::ExecuteSqlRequest::PROFILE));
+  const v1::QueryPlan& plan = result.query_plan;
+  ASSERT_GT(plan.plan_nodes_size(), 0);
+  EXPECT_EQ(GetExecutionStat(plan.plan_nodes(0), "rows"), "1");
+  EXPECT_NE(GetExecutionStat(plan.plan_nodes(0), "latency"), "");
+  ASSERT_NE(FindPlanNode(plan, "Aggregate"), nullptr);
+
+  const v1::PlanNode* scan = FindPlanNode(plan, "Scan");
+  ASSERT_NE(scan, nullptr);
+  EXPECT_EQ(GetExecutionStat(*scan, "scanned_rows"), "3");
+}
+
+TEST_P(QueryEngineTest, ExecuteSqlDoesNotReturnQueryPlan) {
+  ZETASQL_ASSERT_OK_AND_ASSIGN(
+      QueryResult result,
+      query_engine().ExecuteSql(Query{"SELECT 1 AS one FROM test_table"},
+                                QueryContext{schema(), reader()}));
+  EXPECT_EQ(result.query_plan.plan_nodes_size(), 0);
+}
+
 TEST_P(QueryEngineTest, ExecuteSqlSelectsGenerateUUIDFromTable) {
   // When using the postgres  dialect, generate_uuid() is exposed only via the
   // 'spanner' namespace.
@@ -0,0 +1,695 @@
+//
+// Copyright 2026 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "backend/query/query_plan.h"
+
+#include <optional>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "google/protobuf/struct.pb.h"
+#include "google/spanner/v1/query_plan.pb.h"
+#include "zetasql/public/catalog.h"
+#include "zetasql/public/function.h"
+#include "zetasql/public/options.pb.h"
+#include "zetasql/public/type.h"
+#include "zetasql/resolved_ast/resolved_ast.h"
+#include "zetasql/resolved_ast/resolved_ast_enums.pb.h"
+#include "zetasql/resolved_ast/resolved_node.h"
+#include "zetasql/resolved_ast/resolved_node_kind.pb.h"
+#include "absl/container/flat_hash_map.h"
+#include "absl/strings/ascii.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/str_join.h"
+#include "absl/strings/string_view.h"
+#include "absl/strings/strip.h"
+#include "absl/time/time.h"
+
+namespace google {
+namespace spanner {
+namespace emulator {
+namespace backend {
+
+namespace {
+
+using v1::PlanNode;
+
+// Returns the infix operator of the function named 'name', or an empty string
+// if it is not an infix operator.
+absl::string_view InfixOperator(absl::string_view name) {
+  static const auto* const kInfixOperators =
+      new absl::flat_hash_map<absl::string_view, absl::string_view>{
+          {"$equal", "="},
+          {"$not_equal", "!="},
+          {"$less", "<"},
+          {"$less_or_equal", "<="},
+          {"$greater", ">"},
+          {"$greater_or_equal", ">="},
+          {"$and", "AND"},
+          {"$or", "OR"},
+          {"$add", "+"},
+          {"$subtract", "-"},
+          {"$multiply", "*"},
+          {"$divide", "/"},
+          {"$concat_op", "||"},
+          {"$like", "LIKE"},
+      };
+  auto it = kInfixOperators->find(name);
+  return it == kInfixOperators->end() ? "" : it->second;
+}
+
+bool IsInfixCall(const zetasql::ResolvedExpr* expr) {
+  return expr->Is<zetasql::ResolvedFunctionCall>() &&
+         !InfixOperator(
+              expr->GetAs<zetasql::ResolvedFunctionCall>()->function()->Name())
+              .empty();
+}
+
+// Returns true if 'expr' has the same value for every row of a scan.
+bool IsConstant(const zetasql::ResolvedExpr* expr) {
+  switch (expr->node_kind()) {
+    case zetasql::RESOLVED_LITERAL:
+    case zetasql::RESOLVED_PARAMETER:
+      return true;
+    case zetasql::RESOLVED_CAST:
+      return IsConstant(expr->GetAs<zetasql::ResolvedCast>()->expr());
+    default:
+      return false;
+  }
+}
+
+// Formats expressions the way Cloud Spanner describes them in query plans.
+// Subqueries are described by a placeholder and collected, so that their plans
+// can be added as children of the node which evaluates the expression.
+class ExpressionFormatter {
+ public:
+  std::string Format(const zetasql::ResolvedExpr* expr) {
+    switch (expr->node_kind()) {
+      case zetasql::RESOLVED_COLUMN_REF:
+        return expr->GetAs<zetasql::ResolvedColumnRef>()->column().name();
+      case zetasql::RESOLVED_LITERAL:
+        return expr->GetAs<zetasql::ResolvedLiteral>()->value().GetSQLLiteral();
+      case zetasql::RESOLVED_PARAMETER: {
+        auto parameter = expr->GetAs<zetasql::ResolvedParameter>();
+        return parameter->name().empty()
+                   ? absl::StrCat("$", parameter->position())
+                   : absl::StrCat("@", parameter->name());
+      }
+      case zetasql::RESOLVED_CAST: {
+        auto cast = expr->GetAs<zetasql::ResolvedCast>();
+        return absl::StrCat(
+            "CAST(", Format(cast->expr()), " AS ",
+            cast->type()->ShortTypeName(zetasql::PRODUCT_EXTERNAL), ")");
+      }
+      case zetasql::RESOLVED_FUNCTION_CALL:
+      case zetasql::RESOLVED_AGGREGATE_FUNCTION_CALL:
+      case zetasql::RESOLVED_ANALYTIC_FUNCTION_CALL:
+        return FormatFunctionCall(
+            expr->GetAs<zetasql::ResolvedFunctionCallBase>());
+      case zetasql::RESOLVED_SUBQUERY_EXPR:
+        subqueries_.push_back(expr->GetAs<zetasql::ResolvedSubqueryExpr>());
+        return absl::StrCat("$subquery", subqueries_.size());
+      default:
+        return expr->node_kind_string();
+    }
+  }
+
+  // The subqueries in the formatted expressions, in the order of their
+  // placeholders.
+  const std::vector<const zetasql::ResolvedSubqueryExpr*>& subqueries() const {
+    return subqueries_;
+  }
+
+ private:
+  std::string FormatFunctionCall(
+      const zetasql::ResolvedFunctionCallBase* call) {
+    const std::string& name = call->function()->Name();
+    std::vector<std::string> args;
+    for (const auto& arg : call->argument_list()) {
+      args.push_back(IsInfixCall(arg.get())
+                         ? absl::StrCat("(", Format(arg.get()), ")")
+                         : Format(arg.get()));
+    }
+
+    absl::string_view infix_operator = InfixOperator(name);
+    if (!infix_operator.empty() && args.size() >= 2) {
+      return absl::StrJoin(args, absl::StrCat(" ", infix_operator, " "));
+    }
+    if (name == "$count_star") {
+      return "COUNT(*)";
+    }
+    if (name == "$not" && args.size() == 1) {
+      return absl::StrCat("NOT ", args[0]);
+    }
+    if (name == "$unary_minus" && args.size() == 1) {
+      return absl::StrCat("-", args[0]);
+    }
+    if (name == "$is_null" && args.size() == 1) {
+      return absl::StrCat(args[0], " IS NULL");
+    }
+    if (name == "$between" && args.size() == 3) {
+      return absl::StrCat(args[0], " BETWEEN ", args[1], " AND ", args[2]);
+    }
+    if (name == "$in" && !args.empty()) {
+      return absl::StrCat(
+          args[0], " IN (",
+          absl::StrJoin(args.begin() + 1, args.end(), ", "), ")");
+    }
+    std::string function_name = name;
+    if (call->function()->IsZetaSQLBuiltin()) {
+      function_name = absl::AsciiStrToUpper(absl::StripPrefix(name, "$"));
+    }
+    return absl::StrCat(function_name, "(", absl::StrJoin(args, ", "), ")");
+  }
+
+  std::vector<const zetasql::ResolvedSubqueryExpr*> subqueries_;
+};
+
+// Returns the display name of the scalar node of 'expr'.
+absl::string_view ScalarDisplayName(const zetasql::ResolvedExpr* expr) {
+  switch (expr->node_kind()) {
+    case zetasql::RESOLVED_COLUMN_REF:
+      return "Reference";
+    case zetasql::RESOLVED_LITERAL:
+      return "Constant";
+    case zetasql::RESOLVED_PARAMETER:
+      return "Parameter";
+    default:
+      return "Function";
+  }
+}
+
+// Appends the conjuncts of 'expr' to 'conjuncts'.
+void SplitConjunction(const zetasql::ResolvedExpr* expr,
+                      std::vector<const zetasql::ResolvedExpr*>* conjuncts) {
+  if (expr->Is<zetasql::ResolvedFunctionCall>()) {
+    auto call = expr->GetAs<zetasql::ResolvedFunctionCall>();
+    if (call->function()->Name() == "$and") {
+      for (const auto& arg : call->argument_list()) {
+        SplitConjunction(arg.get(), conjuncts);
+      }
+      return;
+    }
+  }
+  conjuncts->push_back(expr);
+}
+
+// The key column compared by a conjunct of a filter over a table scan.
+struct KeyComparison {
+  // The ordinal of the column in the table.
+  int column_ordinal;
+
+  // Whether the conjunct restricts the column to a set of points, which lets
+  // the scan seek on the next key column as well.
+  bool is_point;
+};
+
+// Returns the key column compared to constants by 'conjunct', or nullopt if it
+// does not bound the keys read by the scan. 'column_ordinals' maps the columns
+// produced by the scan to their ordinal in the table.
+std::optional<KeyComparison> GetKeyComparison(
+    const zetasql::ResolvedExpr* conjunct,
+    const absl::flat_hash_map<int, int>& column_ordinals) {
+  if (!conjunct->Is<zetasql::ResolvedFunctionCall>()) {
+    return std::nullopt;
+  }
+  auto call = conjunct->GetAs<zetasql::ResolvedFunctionCall>();
+  const std::string& name = call->function()->Name();
+  bool is_point = name == "$equal" || name == "$in";
+  bool is_range = name == "$less" || name == "$less_or_equal" ||
+                  name == "$greater" || name == "$greater_or_equal" ||
+                  name == "$between";
+  if ((!is_point && !is_range) || call->argument_list_size() < 2) {
+    return std::nullopt;
+  }
+
+  // The column may be on either side of a binary comparison.
+  std::vector<const zetasql::ResolvedExpr*> args;
+  for (const auto& arg : call->argument_list()) {
+    args.push_back(arg.get());
+  }
+  if (args.size() == 2 && !args[0]->Is<zetasql::ResolvedColumnRef>()) {
+    std::swap(args[0], args[1]);
+  }
+  if (!args[0]->Is<zetasql::ResolvedColumnRef>()) {
+    return std::nullopt;
+  }
+  auto it = column_ordinals.find(
+      args[0]->GetAs<zetasql::ResolvedColumnRef>()->column().column_id());
+  if (it == column_ordinals.end()) {
+    return std::nullopt;
+  }
+  for (int i = 1; i < args.size(); ++i) {
+    if (!IsConstant(args[i])) {
+      return std::nullopt;
+    }
+  }
+  return KeyComparison{it->second, is_point};
+}
+
+// Removes the conjuncts which bound the keys read by 'table_scan' from
+// 'conjuncts' and returns them. As when the filter is pushed down to the scan,
+// the key columns are bounded in order, and only points on a key column let
+// the next one be bounded as well.
+std::vector<const zetasql::ResolvedExpr*> ExtractSeekConditions(
+    const zetasql::ResolvedTableScan* table_scan,
+    std::vector<const zetasql::ResolvedExpr*>* conjuncts) {
+  std::vector<const zetasql::ResolvedExpr*> seek_conditions;
+  std::optional<std::vector<int>> primary_key =
+      table_scan->table()->PrimaryKey();
+  if (!primary_key.has_value()) {
+    return seek_conditions;
+  }
+  absl::flat_hash_map<int, int> column_ordinals;
+  for (int i = 0; i < table_scan->column_list_size() &&
+                  i < table_scan->column_index_list_size();
+       ++i) {
+    column_ordinals[table_scan->column_list(i).column_id()] =
+        table_scan->column_index_list(i);
+  }
+
+  for (int key_ordinal : *primary_key) {
+    bool has_point = false;
+    std::vector<const zetasql::ResolvedExpr*> residual_conditions;
+    for (const zetasql::ResolvedExpr* conjunct : *conjuncts) {
+      std::optional<KeyComparison> comparison =
+          GetKeyComparison(conjunct, column_ordinals);
+      if (!comparison.has_value() ||
+          comparison->column_ordinal != key_ordinal) {
+        residual_conditions.push_back(conjunct);
+        continue;
+      }
+      seek_conditions.push_back(conjunct);
+      has_point |= comparison->is_point;
+    }
+    *conjuncts = std::move(residual_conditions);
+    if (!has_point) {
+      break;
+    }
+  }
+  return seek_conditions;
+}
+
+// Appends the scans which are direct inputs of 'node' to 'scans', looking
+// through the non-scan nodes which hold them, such as the items of a set
+// operation.
+void CollectInputScans(const zetasql::ResolvedNode* node,
+                       std::vector<const zetasql::ResolvedScan*>* scans) {
+  std::vector<const zetasql::ResolvedNode*> children;
+  node->GetChildNodes(&children);
+  for (const zetasql::ResolvedNode* child : children) {
+    if (child->IsScan()) {
+      scans->push_back(child->GetAs<zetasql::ResolvedScan>());
+    } else if (!child->IsExpression()) {
+      CollectInputScans(child, scans);
+    }
+  }
+}
+
+// Returns the display name of a set operation.
+absl::string_view SetOperationDisplayName(
+    const zetasql::ResolvedSetOperationScan* scan) {
+  switch (scan->op_type()) {
+    case zetasql::ResolvedSetOperationScanEnums::UNION_ALL:
+      return "Union All";
+    case zetasql::ResolvedSetOperationScanEnums::UNION_DISTINCT:
+      return "Union";
+    case zetasql::ResolvedSetOperationScanEnums::INTERSECT_ALL:
+      return "Intersect All";
+    case zetasql::ResolvedSetOperationScanEnums::INTERSECT_DISTINCT:
+      return "Intersect";
+    case zetasql::ResolvedSetOperationScanEnums::EXCEPT_ALL:
+      return "Except All";
+    case zetasql::ResolvedSetOperationScanEnums::EXCEPT_DISTINCT:
+      return "Except";
+    default:
+      return "Set Operation";
+  }
+}
+
+// Builds the plan nodes of a resolved statement. Each node is added before its
+// children, so the root of the plan is its first node.
+class QueryPlanBuilder {
+ public:
+  v1::QueryPlan Build(const zetasql::ResolvedStatement* statement) {
+    AddStatement(statement);
+    return std::move(plan_);
+  }
+
+ private:
+  PlanNode* node(int index) { return plan_.mutable_plan_nodes(index); }
+
+  int AddNode(PlanNode::Kind kind, absl::string_view display_name) {
+    PlanNode* node = plan_.add_plan_nodes();
+    node->set_index(plan_.plan_nodes_size() - 1);
+    node->set_kind(kind);
+    node->set_display_name(std::string(display_name));
+    return node->index();
+  }
+
+  void AddChildLink(int parent, int child, absl::string_view type,
+                    absl::string_view variable = "") {
+    PlanNode::ChildLink* link = node(parent)->add_child_links();
+    link->set_child_index(child);
+    link->set_type(std::string(type));
+    link->set_variable(std::string(variable));
+  }
+
+  void SetMetadata(int index, absl::string_view name,
+                   absl::string_view value) {
+    (*node(index)->mutable_metadata()->mutable_fields())[std::string(name)]
+        .set_string_value(std::string(value));
+  }
+
+  void AddScalarNode(int parent, absl::string_view type,
+                     absl::string_view display_name,
+                     absl::string_view description,
+                     absl::string_view variable) {
+    int child = AddNode(PlanNode::SCALAR, display_name);
+    node(child)->mutable_short_representation()->set_description(
+        std::string(description));
+    AddChildLink(parent, child, type, variable);
+  }
+
+  // Adds a scalar node evaluating the conjunction of 'exprs' as a child of
+  // 'parent', followed by the plans of the subqueries it contains.
+  void AddScalar(int parent, absl::string_view type,
+                 const std::vector<const zetasql::ResolvedExpr*>& exprs,
+                 absl::string_view variable = "") {
+    ExpressionFormatter formatter;
+    std::vector<std::string> descriptions;
+    for (const zetasql::ResolvedExpr* expr : exprs) {
+      descriptions.push_back(exprs.size() > 1 && IsInfixCall(expr)
+                                 ? absl::StrCat("(", formatter.Format(expr),
+                                                ")")
+                                 : formatter.Format(expr));
+    }
+    AddScalarNode(parent, type,
+                  exprs.size() == 1 ? ScalarDisplayName(exprs[0]) : "Function",
+                  absl::StrJoin(descriptions, " AND "), variable);
+    for (const zetasql::ResolvedSubqueryExpr* subquery :
+         formatter.subqueries()) {
+      AddChildLink(parent, AddScan(subquery->subquery()), "Subquery");
+    }
+  }
+
+  void AddScalar(int parent, absl::string_view type,
+                 const zetasql::ResolvedExpr* expr,
+                 absl::string_view variable = "") {
+    AddScalar(parent, type, std::vector<const zetasql::ResolvedExpr*>{expr},
+              variable);
+  }
+
+  void AddStatement(const zetasql::ResolvedStatement* statement) {
+    switch (statement->node_kind()) {
+      case zetasql::RESOLVED_QUERY_STMT: {
+        int root = AddNode(PlanNode::RELATIONAL, "Serialize Result");
+        AddChildLink(
+            root,
+            AddScan(statement->GetAs<zetasql::ResolvedQueryStmt>()->query()),
+            "");
+        return;
+      }
+      case zetasql::RESOLVED_INSERT_STMT: {
+        auto insert = statement->GetAs<zetasql::ResolvedInsertStmt>();
+        int root = AddNode(PlanNode::RELATIONAL, "Insert");
+        SetMetadata(root, "table", insert->table_scan()->table()->Name());
+        if (insert->query() != nullptr) {
+          AddChildLink(root, AddScan(insert->query()), "");
+        }
+        return;
+      }
+      case zetasql::RESOLVED_UPDATE_STMT: {
+        auto update = statement->GetAs<zetasql::ResolvedUpdateStmt>();
+        int root = AddNode(PlanNode::RELATIONAL, "Update");
+        SetMetadata(root, "table", update->table_scan()->table()->Name());
+        AddChildLink(
+            root, AddTableScan(update->table_scan(), update->where_expr()),
+            "");
+        if (update->from_scan() != nullptr) {
+          AddChildLink(root, AddScan(update->from_scan()), "From");
+        }
+        return;
+      }
+      case zetasql::RESOLVED_DELETE_STMT: {
+        auto del = statement->GetAs<zetasql::ResolvedDeleteStmt>();
+        int root = AddNode(PlanNode::RELATIONAL, "Delete");
+        SetMetadata(root, "table", del->table_scan()->table()->Name());
+        AddChildLink(root,
+                     AddTableScan(del->table_scan(), del->where_expr()), "");
+        return;
+      }
+      default:
+        AddNode(PlanNode::RELATIONAL, statement->node_kind_string());
+        return;
+    }
+  }
+
+  // Adds the nodes of 'scan' and returns the index of the first of them.
+  int AddScan(const zetasql::ResolvedScan* scan) {
+    switch (scan->node_kind()) {
+      case zetasql::RESOLVED_TABLE_SCAN:
+        return AddTableScan(scan->GetAs<zetasql::ResolvedTableScan>(),
+                            /*filter_expr=*/nullptr);
+      case zetasql::RESOLVED_FILTER_SCAN: {
+        auto filter = scan->GetAs<zetasql::ResolvedFilterScan>();
+        if (filter->input_scan()->Is<zetasql::ResolvedTableScan>()) {
+          return AddTableScan(
+              filter->input_scan()->GetAs<zetasql::ResolvedTableScan>(),
+              filter->filter_expr());
+        }
+        int index = AddNode(PlanNode::RELATIONAL, "Filter");
+        AddChildLink(index, AddScan(filter->input_scan()), "");
+        AddScalar(index, "Condition", filter->filter_expr());
+        return index;
+      }
+      case zetasql::RESOLVED_PROJECT_SCAN: {
+        auto project = scan->GetAs<zetasql::ResolvedProjectScan>();
+        if (project->expr_list().empty()) {
+          return AddScan(project->input_scan());
+        }
+        int index = AddNode(PlanNode::RELATIONAL, "Compute");
+        AddChildLink(index, AddScan(project->input_scan()), "");
+        for (const auto& computed_column : project->expr_list()) {
+          AddScalar(index, "", computed_column->expr(),
+                    computed_column->column().name());
+        }
+        return index;
+      }
+      case zetasql::RESOLVED_JOIN_SCAN: {
+        auto join = scan->GetAs<zetasql::ResolvedJoinScan>();
+        int index = AddNode(PlanNode::RELATIONAL, "Join");
+        SetMetadata(index, "join_type",
+                    zetasql::ResolvedJoinScanEnums::JoinType_Name(
+                        join->join_type()));
+        AddChildLink(index, AddScan(join->left_scan()), "Left");
+        AddChildLink(index, AddScan(join->right_scan()), "Right");
+        if (join->join_expr() != nullptr) {
+          AddScalar(index, "Condition", join->join_expr());
+        }
+        return index;
+      }
+      case zetasql::RESOLVED_AGGREGATE_SCAN: {
+        auto aggregate = scan->GetAs<zetasql::ResolvedAggregateScan>();
+        int index = AddNode(PlanNode::RELATIONAL, "Aggregate");
+        if (aggregate->group_by_list().empty()) {
+          SetMetadata(index, "scalar_aggregate", "true");
+        } else {
+          SetMetadata(index, "iterator_type", "Hash");
+        }
+        AddChildLink(index, AddScan(aggregate->input_scan()), "");
+        for (const auto& key : aggregate->group_by_list()) {
+          AddScalar(index, "Key", key->expr(), key->column().name());
+        }
+        for (const auto& agg : aggregate->aggregate_list()) {
+          AddScalar(index, "Agg", agg->expr(), agg->column().name());
+        }
+        return index;
+      }
+      case zetasql::RESOLVED_ORDER_BY_SCAN:
+        return AddSort(scan->GetAs<zetasql::ResolvedOrderByScan>(),
+                       /*limit_offset=*/nullptr);
+      case zetasql::RESOLVED_LIMIT_OFFSET_SCAN: {
+        auto limit_offset = scan->GetAs<zetasql::ResolvedLimitOffsetScan>();
+        if (limit_offset->input_scan()->Is<zetasql::ResolvedOrderByScan>()) {
+          return AddSort(
+              limit_offset->input_scan()->GetAs<zetasql::ResolvedOrderByScan>(),
+              limit_offset);
+        }
+        int index = AddNode(PlanNode::RELATIONAL, "Limit");
+        AddChildLink(index, AddScan(limit_offset->input_scan()), "");
+        AddLimitOffset(index, limit_offset);
+        return index;
+      }
+      case zetasql::RESOLVED_SET_OPERATION_SCAN:
+        return AddNodeWithInputs(
+            scan, SetOperationDisplayName(
+                      scan->GetAs<zetasql::ResolvedSetOperationScan>()));
+      case zetasql::RESOLVED_SINGLE_ROW_SCAN:
+        return AddNode(PlanNode::RELATIONAL, "Unit Relation");
+      case zetasql::RESOLVED_ARRAY_SCAN:
+        return AddNodeWithInputs(scan, "Array Unnest");
+      case zetasql::RESOLVED_ANALYTIC_SCAN:
+        return AddNodeWithInputs(scan, "Analytic");
+      default:
+        return AddNodeWithInputs(scan, scan->node_kind_string());
+    }
+  }
+
+  // Adds a node for an operator whose expressions are not described, followed
+  // by its input scans.
+  int AddNodeWithInputs(const zetasql::ResolvedScan* scan,
+                        absl::string_view display_name) {
+    int index = AddNode(PlanNode::RELATIONAL, display_name);
+    std::vector<const zetasql::ResolvedScan*> inputs;
+    CollectInputScans(scan, &inputs);
+    for (const zetasql::ResolvedScan* input : inputs) {
+      AddChildLink(index, AddScan(input), "");
+    }
+    return index;
+  }
+
+  // Adds a scan of a table, filtered by 'filter_expr' unless it is null. The
+  // conditions which bound the keys read are reported as a seek condition, and
+  // the others as a residual condition.
+  int AddTableScan(const zetasql::ResolvedTableScan* table_scan,
+                   const zetasql::ResolvedExpr* filter_expr) {
+    std::vector<const zetasql::ResolvedExpr*> residual_conditions;
+    if (filter_expr != nullptr) {
+      SplitConjunction(filter_expr, &residual_conditions);
+    }
+    std::vector<const zetasql::ResolvedExpr*> seek_conditions =
+        ExtractSeekConditions(table_scan, &residual_conditions);
+
+    int filter_index = -1;
+    if (filter_expr != nullptr) {
+      filter_index = AddNode(PlanNode::RELATIONAL, "Filter Scan");
+    }
+    int scan_index = AddNode(PlanNode::RELATIONAL, "Scan");
+    SetMetadata(scan_index, "scan_type", "TableScan");
+    SetMetadata(scan_index, "scan_target", table_scan->table()->Name());
+    if (seek_conditions.empty()) {
+      SetMetadata(scan_index, "Full scan", "true");
+    }
+    if (filter_index < 0) {
+      return scan_index;
+    }
+    AddChildLink(filter_index, scan_index, "");
+    if (!seek_conditions.empty()) {
+      AddScalar(filter_index, "Seek Condition", seek_conditions);
+    }
+    if (!residual_conditions.empty()) {
+      AddScalar(filter_index, "Residual Condition", residual_conditions);
+    }
+    return filter_index;
+  }
+
+  // Adds a sort, limited by 'limit_offset' unless it is null.
+  int AddSort(const zetasql::ResolvedOrderByScan* order_by,
+              const zetasql::ResolvedLimitOffsetScan* limit_offset) {
+    int index = AddNode(PlanNode::RELATIONAL,
+                        limit_offset == nullptr ? "Sort" : "Sort Limit");
+    AddChildLink(index, AddScan(order_by->input_scan()), "");
+    for (const auto& item : order_by->order_by_item_list()) {
+      AddScalarNode(index, "Key", "Reference",
+                    absl::StrCat(item->column_ref()->column().name(),
+                                 item->is_descending() ? " DESC" : " ASC"),
+                    /*variable=*/"");
+    }
+    if (limit_offset != nullptr) {
+      AddLimitOffset(index, limit_offset);
+    }
+    return index;
+  }
+
+  void AddLimitOffset(int index,
+                      const zetasql::ResolvedLimitOffsetScan* limit_offset) {
+    if (limit_offset->limit() != nullptr) {
+      AddScalar(index, "Limit", limit_offset->limit());
+    }
+    if (limit_offset->offset() != nullptr) {
+      AddScalar(index, "Offset", limit_offset->offset());
+    }
+  }
+
+  v1::QueryPlan plan_;
+};
+
+// Sets the statistic 'name' of a plan node in the format used by Cloud
+// Spanner, e.g. {"total": "3", "unit": "rows"}.
+void SetExecutionStat(absl::string_view name, absl::string_view total,
+                      absl::string_view unit,
+                      google::protobuf::Struct* execution_stats) {
+  auto* fields = (*execution_stats->mutable_fields())[std::string(name)]
+                     .mutable_struct_value()
+                     ->mutable_fields();
+  (*fields)["total"].set_string_value(std::string(total));
+  (*fields)["unit"].set_string_value(std::string(unit));
+}
+
+void SetNumExecutions(int64_t num_executions,
+                      google::protobuf::Struct* execution_stats) {
+  (*(*execution_stats->mutable_fields())["execution_summary"]
+        .mutable_struct_value()
+        ->mutable_fields())["num_executions"]
+      .set_string_value(absl::StrCat(num_executions));
+}
+
+std::string FormatMilliseconds(absl::Duration duration) {
+  return absl::StrCat(absl::ToDoubleMilliseconds(duration));
+}
+
+}  // namespace
+
+v1::QueryPlan BuildQueryPlan(const zetasql::ResolvedStatement* statement) {
+  return QueryPlanBuilder().Build(statement);
+}
+
+void AddExecutionStats(const QueryProfile& profile, v1::QueryPlan* plan) {
+  if (plan->plan_nodes().empty()) {
+    return;
+  }
+  google::protobuf::Struct* root_stats =
+      plan->mutable_plan_nodes(0)->mutable_execution_stats();
+  SetExecutionStat("rows", absl::StrCat(profile.rows_returned), "rows",
+                   root_stats);
+  SetExecutionStat("latency", FormatMilliseconds(profile.latency), "msecs",
+                   root_stats);
+  SetNumExecutions(1, root_stats);
+
+  for (PlanNode& node : *plan->mutable_plan_nodes()) {
+    auto target = node.metadata().fields().find("scan_target");
+    if (target == node.metadata().fields().end()) {
+      continue;
+    }
+    auto scan = profile.scans.find(target->second.string_value());
+    if (scan == profile.scans.end()) {
+      continue;
+    }
+    google::protobuf::Struct* stats = node.mutable_execution_stats();
+    SetExecutionStat("scanned_rows", absl::StrCat(scan->second.rows_scanned),
+                     "rows", stats);
+    SetExecutionStat("latency", FormatMilliseconds(scan->second.latency),
+                     "msecs", stats);
+    SetNumExecutions(scan->second.executions, stats);
+  }
+}
+
+}  // namespace backend
+}  // namespace emulator
+}  // namespace spanner
+}  // namespace google
@@ -0,0 +1,77 @@
+//
+// Copyright 2026 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#ifndef THIRD_PARTY_CLOUD_SPANNER_EMULATOR_BACKEND_QUERY_QUERY_PLAN_H_
+#define THIRD_PARTY_CLOUD_SPANNER_EMULATOR_BACKEND_QUERY_QUERY_PLAN_H_
+
+#include <cstdint>
+#include <map>
+#include <string>
+
+#include "google/spanner/v1/query_plan.pb.h"
+#include "zetasql/resolved_ast/resolved_ast.h"
+#include "absl/time/time.h"
+
+namespace google {
+namespace spanner {
+namespace emulator {
+namespace backend {
+
+// Statistics of the reads of a single table made by a profiled execution.
+struct ScanProfile {
+  // Number of times the table was read, e.g. once per row of the outer side
+  // of a correlated join.
+  int64_t executions = 0;
+
+  // Rows read from the table, before residual filters are applied.
+  int64_t rows_scanned = 0;
+
+  // Time spent reading rows from the table.
+  absl::Duration latency;
+};
+
+// Runtime statistics gathered by an execution in PROFILE mode.
+//
+// The emulator evaluates queries with the ZetaSQL reference evaluator, whose
+// operators are not observable, so statistics are gathered where the evaluator
+// reads tables and where the rows leave the query engine.
+struct QueryProfile {
+  // Reads of each table or index, keyed by its name.
+  std::map<std::string, ScanProfile> scans;
+
+  // Rows returned by a query, or modified by a DML statement.
+  int64_t rows_returned = 0;
+
+  // Time from the start of the execution until its last row was produced.
+  absl::Duration latency;
+};
+
+// Returns the plan of 'statement' in the format used by Cloud Spanner: scans
+// with their key range (seek) conditions, filters, joins, aggregates, sorts and
+// the other operators of the resolved AST, with the expressions they evaluate
+// as scalar child nodes. The root of the plan is its first node.
+v1::QueryPlan BuildQueryPlan(const zetasql::ResolvedStatement* statement);
+
+// Adds the runtime statistics in 'profile' to the scans and the root of
+// 'plan', which was built by BuildQueryPlan.
+void AddExecutionStats(const QueryProfile& profile, v1::QueryPlan* plan);
+
+}  // namespace backend
+}  // namespace emulator
+}  // namespace spanner
+}  // namespace google
+
+#endif  // THIRD_PARTY_CLOUD_SPANNER_EMULATOR_BACKEND_QUERY_QUERY_PLAN_H_
@@ -0,0 +1,268 @@
+//
+// Copyright 2026 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "backend/query/query_stats.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "zetasql/public/value.h"
+#include "absl/strings/ascii.h"
+#include "absl/strings/match.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/string_view.h"
+#include "absl/synchronization/mutex.h"
+#include "absl/time/time.h"
+#include "backend/common/stats_intervals.h"
+#include "backend/query/spanner_sys_stats.h"
+#include "farmhash.h"
+
+namespace google {
+namespace spanner {
+namespace emulator {
+namespace backend {
+
+namespace {
+
+using zetasql::values::Bool;
+using zetasql::values::Double;
+using zetasql::values::Int64;
+using zetasql::values::String;
+using zetasql::values::Timestamp;
+
+// Query texts longer than this are truncated in the statistics tables.
+constexpr int kMaxTextBytes = 64 * 1024;
+
+// Maximum number of distinct queries tracked per interval.
+constexpr int kMaxQueriesPerInterval = 1000;
+
+// Maximum number of queries reported per interval by the TOP tables.
+constexpr int kMaxTopQueries = 100;
+
+// Returns the longest prefix of 'text' which is at most kMaxTextBytes long and
+// does not end in the middle of a UTF-8 character.
+absl::string_view TruncateText(absl::string_view text) {
+  if (text.size() <= kMaxTextBytes) {
+    return text;
+  }
+  int size = kMaxTextBytes;
+  // Continuation bytes of multi-byte characters are of the form 10xxxxxx.
+  while (size > 0 && (static_cast<unsigned char>(text[size]) & 0xC0) == 0x80) {
+    --size;
+  }
+  return text.substr(0, size);
+}
+
+// Returns the average of 'sum' over 'count' items, or zero if there are none.
+double Average(double sum, int64_t count) {
+  return count == 0 ? 0 : sum / count;
+}
+
+}  // namespace
+
+void QueryStats::Aggregate::Add(const QueryExecutionStats& stats) {
+  ++execution_count;
+  if (stats.in_read_write_transaction) {
+    ++read_write_execution_count;
+  }
+  if (stats.failed) {
+    ++failed_execution_count;
+    failed_latency_seconds += absl::ToDoubleSeconds(stats.latency);
+    return;
+  }
+  latency_seconds += absl::ToDoubleSeconds(stats.latency);
+  cpu_seconds += absl::ToDoubleSeconds(stats.cpu_time);
+  rows += stats.rows_returned;
+  bytes += stats.bytes_returned;
+  rows_scanned += stats.rows_scanned;
+}
+
+void QueryStats::Aggregate::AddToRow(SpannerSysStats::Row* row) const {
+  // Averages are over the executions which succeeded.
+  int64_t succeeded = execution_count - failed_execution_count;
+  (*row)["EXECUTION_COUNT"] = Int64(execution_count);
+  (*row)["AVG_LATENCY_SECONDS"] = Double(Average(latency_seconds, succeeded));
+  (*row)["AVG_ROWS"] = Double(Average(rows, succeeded));
+  (*row)["AVG_BYTES"] = Double(Average(bytes, succeeded));
+  (*row)["AVG_ROWS_SCANNED"] = Double(Average(rows_scanned, succeeded));
+  (*row)["AVG_CPU_SECONDS"] = Double(Average(cpu_seconds, succeeded));
+  (*row)["ALL_FAILED_EXECUTION_COUNT"] = Int64(failed_execution_count);
+  (*row)["ALL_FAILED_AVG_LATENCY_SECONDS"] =
+      Double(Average(failed_latency_seconds, failed_execution_count));
+  (*row)["CANCELLED_OR_DISCONNECTED_EXECUTION_COUNT"] = Int64(0);
+  (*row)["TIMED_OUT_EXECUTION_COUNT"] = Int64(0);
+  (*row)["RUN_IN_RW_TRANSACTION_EXECUTION_COUNT"] =
+      Int64(read_write_execution_count);
+}
+
+std::string QueryStats::NormalizeText(absl::string_view sql) {
+  std::string text;
+  text.reserve(sql.size());
+  char quote = 0;
+  bool pending_space = false;
+  for (int i = 0; i < sql.size(); ++i) {
+    char c = sql[i];
+    if (quote != 0) {
+      text.push_back(c);
+      if (c == '\\' && i + 1 < sql.size()) {
+        text.push_back(sql[++i]);
+      } else if (c == quote) {
+        quote = 0;
+      }
+      continue;
+    }
+    if (absl::ascii_isspace(c)) {
+      pending_space = !text.empty() && text.back() != '\n';
+      continue;
+    }
+    if (pending_space) {
+      text.push_back(' ');
+      pending_space = false;
+    }
+    // Comments are copied unchanged, so that quotes in them do not start a
+    // string literal. A line comment keeps the newline which ends it.
+    absl::string_view rest = sql.substr(i);
+    size_t comment_end = absl::string_view::npos;
+    if (absl::StartsWith(rest, "--") || c == '#') {
+      comment_end = std::min(rest.find('\n'), rest.size() - 1) + 1;
+    } else if (absl::StartsWith(rest, "/*")) {
+      comment_end = rest.find("*/", 2);
+      comment_end = comment_end == absl::string_view::npos ? rest.size()
+                                                           : comment_end + 2;
+    }
+    if (comment_end != absl::string_view::npos) {
+      absl::StrAppend(&text, rest.substr(0, comment_end));
+      i += comment_end - 1;
+      continue;
+    }
+    if (c == '\'' || c == '"' || c == '`') {
+      quote = c;
+    }
+    text.push_back(c);
+  }
+  return text;
+}
+
+void QueryStats::Record(absl::string_view sql, absl::Time end_time,
+                        const QueryExecutionStats& stats) {
+  std::string text = NormalizeText(sql);
+  int64_t fingerprint = static_cast<int64_t>(farmhash::Fingerprint64(text));
+
+  absl::MutexLock lock(&mu_);
+  for (StatsIntervals<Interval>& series : series_) {
+    // Executions which finished before the retained intervals are dropped.
+    Interval* interval = series.GetOrAdd(end_time);
+    if (interval == nullptr) {
+      continue;
+    }
+    interval->total.Add(stats);
+    auto query_itr = interval->queries.find(fingerprint);
+    if (query_itr == interval->queries.end()) {
+      if (interval->queries.size() >= kMaxQueriesPerInterval) {
+        continue;
+      }
+      query_itr = interval->queries.try_emplace(fingerprint).first;
+      query_itr->second.text = std::string(TruncateText(text));
+      query_itr->second.text_truncated = text.size() > kMaxTextBytes;
+    }
+    query_itr->second.aggregate.Add(stats);
+  }
+}
+
+std::vector<SpannerSysStats::Row> QueryStats::GetTopRows(
+    absl::Duration interval_length) const {
+  std::vector<SpannerSysStats::Row> rows;
+  absl::ReaderMutexLock lock(&mu_);
+  const StatsIntervals<Interval>* series =
+      FindStatsIntervals(series_, interval_length);
+  if (series == nullptr) {
+    return rows;
+  }
+  for (const auto& [interval_end, interval] : series->intervals()) {
+    std::vector<std::pair<int64_t, const QueryAggregate*>> queries;
+    for (const auto& [fingerprint, query] : interval.queries) {
+      queries.emplace_back(fingerprint, &query);
+    }
+    int num_top = std::min<int>(queries.size(), kMaxTopQueries);
+    std::partial_sort(queries.begin(), queries.begin() + num_top,
+                      queries.end(), [](const auto& a, const auto& b) {
+                        return a.second->aggregate.cpu_seconds >
+                               b.second->aggregate.cpu_seconds;
+                      });
+    for (int i = 0; i < num_top; ++i) {
+      const auto& [fingerprint, query] = queries[i];
+      SpannerSysStats::Row row;
+      row["INTERVAL_END"] = Timestamp(interval_end);
+      row["TEXT"] = String(query->text);
+      row["TEXT_TRUNCATED"] = Bool(query->text_truncated);
+      row["TEXT_FINGERPRINT"] = Int64(fingerprint);
+      row["QUERY_TYPE"] = String("QUERY");
+      query->aggregate.AddToRow(&row);
+      rows.push_back(std::move(row));
+    }
+  }
+  return rows;
+}
+
+std::vector<SpannerSysStats::Row> QueryStats::GetTotalRows(
+    absl::Duration interval_length) const {
+  std::vector<SpannerSysStats::Row> rows;
+  absl::ReaderMutexLock lock(&mu_);
+  const StatsIntervals<Interval>* series =
+      FindStatsIntervals(series_, interval_length);
+  if (series == nullptr) {
+    return rows;
+  }
+  for (const auto& [interval_end, interval] : series->intervals()) {
+    SpannerSysStats::Row row;
+    row["INTERVAL_END"] = Timestamp(interval_end);
+    interval.total.AddToRow(&row);
+    rows.push_back(std::move(row));
+  }
+  return rows;
+}
+
+void QueryStats::AddSources(SpannerSysStats* spanner_sys_stats) const {
+  struct Table {
+    const char* top;
+    const char* total;
+    absl::Duration interval_length;
+  };
+  for (const Table& table : {
+           Table{SpannerSysStats::kQueryStatsTopMinute,
+                 SpannerSysStats::kQueryStatsTotalMinute, absl::Minutes(1)},
+           Table{SpannerSysStats::kQueryStatsTop10Minute,
+                 SpannerSysStats::kQueryStatsTotal10Minute, absl::Minutes(10)},
+           Table{SpannerSysStats::kQueryStatsTopHour,
+                 SpannerSysStats::kQueryStatsTotalHour, absl::Hours(1)},
+       }) {
+    absl::Duration interval_length = table.interval_length;
+    spanner_sys_stats->SetSource(table.top, [this, interval_length]() {
+      return GetTopRows(interval_length);
+    });
+    spanner_sys_stats->SetSource(table.total, [this, interval_length]() {
+      return GetTotalRows(interval_length);
+    });
+  }
+}
+
+}  // namespace backend
+}  // namespace emulator
+}  // namespace spanner
+}  // namespace google
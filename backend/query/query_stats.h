@@ -0,0 +1,133 @@
+//
+// Copyright 2026 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#ifndef THIRD_PARTY_CLOUD_SPANNER_EMULATOR_BACKEND_QUERY_QUERY_STATS_H_
+#define THIRD_PARTY_CLOUD_SPANNER_EMULATOR_BACKEND_QUERY_QUERY_STATS_H_
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "absl/base/thread_annotations.h"
+#include "absl/container/flat_hash_map.h"
+#include "absl/strings/string_view.h"
+#include "absl/synchronization/mutex.h"
+#include "absl/time/time.h"
+#include "backend/common/stats_intervals.h"
+#include "backend/query/spanner_sys_stats.h"
+
+namespace google {
+namespace spanner {
+namespace emulator {
+namespace backend {
+
+// Measurements of a single execution of a query.
+struct QueryExecutionStats {
+  // Time from the start of the execution until its last row was consumed.
+  absl::Duration latency;
+
+  // Time spent analyzing and evaluating the query, excluding the time spent
+  // waiting for the caller to consume its rows.
+  absl::Duration cpu_time;
+
+  int64_t rows_returned = 0;
+  int64_t bytes_returned = 0;
+
+  // Rows read from tables by the query.
+  int64_t rows_scanned = 0;
+
+  bool failed = false;
+  bool in_read_write_transaction = false;
+};
+
+// QueryStats aggregates query executions per normalized query text into the
+// minute, 10 minute and hour intervals served by the SPANNER_SYS.QUERY_STATS_*
+// tables.
+//
+// Unlike Cloud Spanner, the interval which is still in progress is reported as
+// well, so that statistics are visible as soon as a query has run. Intervals
+// are kept for as long as Cloud Spanner retains them, and the number of
+// distinct queries tracked per interval is bounded; executions of queries
+// beyond that bound only count towards the totals.
+//
+// This class is thread-safe. Recording an execution only holds the lock to
+// update a few counters.
+class QueryStats {
+ public:
+  // Records an execution of 'sql' which finished at 'end_time'.
+  void Record(absl::string_view sql, absl::Time end_time,
+              const QueryExecutionStats& stats) ABSL_LOCKS_EXCLUDED(mu_);
+
+  // Returns the rows of QUERY_STATS_TOP_* for intervals of the given length:
+  // the queries which used the most CPU time in each interval.
+  std::vector<SpannerSysStats::Row> GetTopRows(
+      absl::Duration interval_length) const ABSL_LOCKS_EXCLUDED(mu_);
+
+  // Returns the rows of QUERY_STATS_TOTAL_* for intervals of the given length.
+  std::vector<SpannerSysStats::Row> GetTotalRows(
+      absl::Duration interval_length) const ABSL_LOCKS_EXCLUDED(mu_);
+
+  // Sets the sources of the SPANNER_SYS.QUERY_STATS_* tables.
+  void AddSources(SpannerSysStats* spanner_sys_stats) const;
+
+  // Returns 'sql' with runs of whitespace outside of literals and quoted
+  // identifiers collapsed into single spaces.
+  static std::string NormalizeText(absl::string_view sql);
+
+ private:
+  // Sums over a set of executions.
+  struct Aggregate {
+    int64_t execution_count = 0;
+    int64_t failed_execution_count = 0;
+    int64_t read_write_execution_count = 0;
+    double latency_seconds = 0;
+    double failed_latency_seconds = 0;
+    double cpu_seconds = 0;
+    int64_t rows = 0;
+    int64_t bytes = 0;
+    int64_t rows_scanned = 0;
+
+    void Add(const QueryExecutionStats& stats);
+
+    // Sets the columns shared by the TOP and TOTAL tables in 'row'.
+    void AddToRow(SpannerSysStats::Row* row) const;
+  };
+
+  struct QueryAggregate {
+    std::string text;
+    bool text_truncated = false;
+    Aggregate aggregate;
+  };
+
+  struct Interval {
+    // Aggregates of each query, keyed by text fingerprint.
+    absl::flat_hash_map<int64_t, QueryAggregate> queries;
+    Aggregate total;
+  };
+
+  mutable absl::Mutex mu_;
+
+  // The intervals of each length reported by the statistics tables.
+  std::vector<StatsIntervals<Interval>> series_ ABSL_GUARDED_BY(mu_) =
+      MakeStatsIntervals<Interval>();
+};
+
+}  // namespace backend
+}  // namespace emulator
+}  // namespace spanner
+}  // namespace google
+
+#endif  // THIRD_PARTY_CLOUD_SPANNER_EMULATOR_BACKEND_QUERY_QUERY_STATS_H_
@@ -0,0 +1,158 @@
+//
+// Copyright 2026 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "backend/query/query_stats.h"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "zetasql/public/value.h"
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "absl/time/time.h"
+#include "backend/query/spanner_sys_stats.h"
+
+namespace google {
+namespace spanner {
+namespace emulator {
+namespace backend {
+
+namespace {
+
+using zetasql::values::Bool;
+using zetasql::values::Double;
+using zetasql::values::Int64;
+using zetasql::values::String;
+using zetasql::values::Timestamp;
+
+QueryExecutionStats MakeStats(absl::Duration cpu_time, int64_t rows) {
+  QueryExecutionStats stats;
+  stats.latency = cpu_time * 2;
+  stats.cpu_time = cpu_time;
+  stats.rows_returned = rows;
+  stats.rows_scanned = rows * 10;
+  return stats;
+}
+
+TEST(QueryStatsTest, NormalizesWhitespaceOutsideOfLiterals) {
+  EXPECT_EQ(QueryStats::NormalizeText("  SELECT\n  a ,\tb  FROM t  "),
+            "SELECT a , b FROM t");
+  EXPECT_EQ(QueryStats::NormalizeText("SELECT 'a  b',  \"c\\\"  d\"  , `e  f`"),
+            "SELECT 'a  b', \"c\\\"  d\" , `e  f`");
+}
+
+TEST(QueryStatsTest, QuotesInCommentsDoNotStartLiterals) {
+  EXPECT_EQ(QueryStats::NormalizeText("SELECT 1 -- don't\n   FROM  T"),
+            "SELECT 1 -- don't\nFROM T");
+  EXPECT_EQ(QueryStats::NormalizeText("SELECT 1 # don't\n   FROM  T"),
+            "SELECT 1 # don't\nFROM T");
+  EXPECT_EQ(QueryStats::NormalizeText("SELECT /* it's  */ 1\n   FROM  T"),
+            "SELECT /* it's  */ 1 FROM T");
+  EXPECT_EQ(QueryStats::NormalizeText("SELECT 1 -- don't"),
+            "SELECT 1 -- don't");
+  EXPECT_EQ(QueryStats::NormalizeText("SELECT '--  x',  1"),
+            "SELECT '--  x', 1");
+}
+
+TEST(QueryStatsTest, AggregatesExecutionsPerQueryAndInterval) {
+  QueryStats query_stats;
+  absl::Time t0 = absl::FromUnixSeconds(3600);
+  query_stats.Record("SELECT 1", t0 + absl::Seconds(10),
+                     MakeStats(absl::Seconds(1), 1));
+  query_stats.Record("SELECT  1", t0 + absl::Seconds(20),
+                     MakeStats(absl::Seconds(3), 3));
+  query_stats.Record("SELECT 2", t0 + absl::Seconds(30),
+                     MakeStats(absl::Seconds(10), 1));
+  QueryExecutionStats failed = MakeStats(absl::Seconds(1), 0);
+  failed.failed = true;
+  query_stats.Record("SELECT 1", t0 + absl::Seconds(40), failed);
+
+  // Both queries ran in the minute ending at t0 + 1 minute. The query which
+  // used the most CPU time comes first.
+  std::vector<SpannerSysStats::Row> top =
+      query_stats.GetTopRows(absl::Minutes(1));
+  ASSERT_EQ(top.size(), 2);
+  EXPECT_EQ(top[0].at("TEXT"), String("SELECT 2"));
+  EXPECT_EQ(top[1].at("TEXT"), String("SELECT 1"));
+  EXPECT_EQ(top[1].at("INTERVAL_END"), Timestamp(t0 + absl::Minutes(1)));
+  EXPECT_EQ(top[1].at("EXECUTION_COUNT"), Int64(3));
+  EXPECT_EQ(top[1].at("ALL_FAILED_EXECUTION_COUNT"), Int64(1));
+  EXPECT_EQ(top[1].at("AVG_CPU_SECONDS"), Double(2));
+  EXPECT_EQ(top[1].at("AVG_LATENCY_SECONDS"), Double(4));
+  EXPECT_EQ(top[1].at("AVG_ROWS"), Double(2));
+  EXPECT_EQ(top[1].at("AVG_ROWS_SCANNED"), Double(20));
+  EXPECT_EQ(top[1].at("ALL_FAILED_AVG_LATENCY_SECONDS"), Double(2));
+  EXPECT_NE(top[0].at("TEXT_FINGERPRINT"), top[1].at("TEXT_FINGERPRINT"));
+
+  std::vector<SpannerSysStats::Row> total =
+      query_stats.GetTotalRows(absl::Hours(1));
+  ASSERT_EQ(total.size(), 1);
+  EXPECT_EQ(total[0].at("INTERVAL_END"), Timestamp(t0 + absl::Hours(1)));
+  EXPECT_EQ(total[0].at("EXECUTION_COUNT"), Int64(4));
+}
+
+TEST(QueryStatsTest, TruncatesTextAtCharacterBoundary) {
+  QueryStats query_stats;
+  absl::Time t0 = absl::FromUnixSeconds(3600);
+  // The two-byte character straddles the 64KiB limit.
+  std::string prefix = "SELECT '" + std::string(64 * 1024 - 9, 'a');
+  query_stats.Record(prefix + "\xc3\xa9'", t0, MakeStats(absl::Seconds(1), 1));
+
+  std::vector<SpannerSysStats::Row> top =
+      query_stats.GetTopRows(absl::Minutes(1));
+  ASSERT_EQ(top.size(), 1);
+  EXPECT_EQ(top[0].at("TEXT"), String(prefix));
+  EXPECT_EQ(top[0].at("TEXT_TRUNCATED"), Bool(true));
+}
+
+TEST(QueryStatsTest, SeparatesIntervals) {
+  QueryStats query_stats;
+  absl::Time t0 = absl::FromUnixSeconds(3600);
+  query_stats.Record("SELECT 1", t0 + absl::Seconds(10),
+                     MakeStats(absl::Seconds(1), 1));
+  query_stats.Record("SELECT 1", t0 + absl::Minutes(5),
+                     MakeStats(absl::Seconds(1), 1));
+
+  EXPECT_EQ(query_stats.GetTotalRows(absl::Minutes(1)).size(), 2);
+  EXPECT_EQ(query_stats.GetTotalRows(absl::Minutes(10)).size(), 1);
+  EXPECT_EQ(query_stats.GetTopRows(absl::Minutes(10)).size(), 1);
+}
+
+TEST(QueryStatsTest, ServesSpannerSysTables) {
+  QueryStats query_stats;
+  SpannerSysStats spanner_sys_stats;
+  query_stats.AddSources(&spanner_sys_stats);
+  EXPECT_TRUE(
+      spanner_sys_stats.GetRows(SpannerSysStats::kQueryStatsTopMinute).empty());
+
+  query_stats.Record("SELECT 1", absl::Now(), MakeStats(absl::Seconds(1), 1));
+  for (const char* table : {SpannerSysStats::kQueryStatsTopMinute,
+                            SpannerSysStats::kQueryStatsTop10Minute,
+                            SpannerSysStats::kQueryStatsTopHour,
+                            SpannerSysStats::kQueryStatsTotalMinute,
+                            SpannerSysStats::kQueryStatsTotal10Minute,
+                            SpannerSysStats::kQueryStatsTotalHour}) {
+    EXPECT_EQ(spanner_sys_stats.GetRows(table).size(), 1) << table;
+  }
+}
+
+}  // namespace
+
+}  // namespace backend
+}  // namespace emulator
+}  // namespace spanner
+}  // namespace google
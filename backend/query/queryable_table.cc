@@ -31,18 +31,24 @@
 #include "zetasql/public/types/type.h"
 #include "zetasql/public/types/type_factory.h"
 #include "zetasql/public/value.h"
+#include "absl/container/flat_hash_map.h"
 #include "absl/log/check.h"
 #include "absl/log/log.h"
+#include "absl/memory/memory.h"
 #include "absl/status/status.h"
 #include "absl/status/statusor.h"
 #include "absl/strings/match.h"
 #include "absl/strings/string_view.h"
 #include "absl/strings/strip.h"  //
+#include "absl/synchronization/mutex.h"
 #include "absl/types/span.h"
 #include "backend/access/read.h"
+#include "backend/datamodel/key.h"
+#include "backend/datamodel/key_range.h"
 #include "backend/datamodel/key_set.h"
 #include "backend/query/queryable_column.h"
 #include "backend/schema/catalog/column.h"
+#include "backend/schema/catalog/index.h"
 #include "common/constants.h"
 #include "common/feature_flags.h"
 #include "zetasql/base/ret_check.h"
@@ -53,52 +59,457 @@ namespace spanner {
 namespace emulator {
 namespace backend {
 
+namespace {
+
+using ColumnFilterMap =
+    absl::flat_hash_map<int, std::unique_ptr<zetasql::ColumnFilter>>;
+
+// Upper bound on the number of key prefixes enumerated from equality and
+// IN-list filters on the primary key. Past this, the remaining key columns are
+// left unconstrained and only the per-row predicate is applied.
+constexpr size_t kMaxPushdownKeyPrefixes = 1024;
+
+// Returns true if values of the given type have an ordering that agrees with
+// both the key order in storage and the SQL comparison used by the filter.
+bool SupportsFilterPushdown(const zetasql::Type* type) {
+  switch (type->kind()) {
+    case zetasql::TYPE_BOOL:
+    case zetasql::TYPE_INT64:
+    case zetasql::TYPE_STRING:
+    case zetasql::TYPE_BYTES:
+    case zetasql::TYPE_DATE:
+    case zetasql::TYPE_TIMESTAMP:
+    case zetasql::TYPE_NUMERIC:
+      return true;
+    default:
+      return false;
+  }
+}
+
+// Returns true if every bound or list element of the filter has the given
+// type. Filters that do not satisfy this are ignored.
+bool FilterMatchesType(const zetasql::ColumnFilter& filter,
+                       const zetasql::Type* type) {
+  auto has_type = [type](const zetasql::Value& value) {
+    return !value.is_valid() || value.type()->Equals(type);
+  };
+  if (filter.kind() == zetasql::ColumnFilter::kInList) {
+    return std::all_of(filter.in_list().begin(), filter.in_list().end(),
+                       has_type);
+  }
+  return has_type(filter.lower_bound()) && has_type(filter.upper_bound());
+}
+
+// Returns true if the given value satisfies the filter. NULL never satisfies a
+// filter since filters are derived from SQL comparisons.
+bool SatisfiesFilter(const zetasql::ColumnFilter& filter,
+                     const zetasql::Value& value) {
+  if (value.is_null()) {
+    return false;
+  }
+  if (filter.kind() == zetasql::ColumnFilter::kInList) {
+    return std::any_of(filter.in_list().begin(), filter.in_list().end(),
+                       [&value](const zetasql::Value& element) {
+                         return !element.is_null() && element.Equals(value);
+                       });
+  }
+  const zetasql::Value& lower = filter.lower_bound();
+  const zetasql::Value& upper = filter.upper_bound();
+  if (lower.is_valid() && (lower.is_null() || value.LessThan(lower))) {
+    return false;
+  }
+  if (upper.is_valid() && (upper.is_null() || upper.LessThan(value))) {
+    return false;
+  }
+  return true;
+}
+
+// Returns the set of point values accepted by the filter, or std::nullopt if
+// the filter is a range which cannot be enumerated.
+std::optional<std::vector<zetasql::Value>> FilterPointValues(
+    const zetasql::ColumnFilter& filter) {
+  std::vector<zetasql::Value> points;
+  if (filter.kind() == zetasql::ColumnFilter::kInList) {
+    for (const zetasql::Value& element : filter.in_list()) {
+      if (!element.is_null()) {
+        points.push_back(element);
+      }
+    }
+    return points;
+  }
+  const zetasql::Value& lower = filter.lower_bound();
+  const zetasql::Value& upper = filter.upper_bound();
+  if (lower.is_valid() && upper.is_valid() && !lower.is_null() &&
+      lower.Equals(upper)) {
+    points.push_back(lower);
+    return points;
+  }
+  return std::nullopt;
+}
+
+// Returns true if the filter accepts a single value.
+bool IsPointFilter(const zetasql::ColumnFilter& filter) {
+  std::optional<std::vector<zetasql::Value>> points = FilterPointValues(filter);
+  return points.has_value() && points->size() == 1;
+}
+
+// Returns the column of the data table of 'index' which holds the values of
+// 'column' of the indexed table, or null if the index does not store it.
+const Column* FindIndexDataColumn(const Index* index, const Column* column) {
+  for (const Column* data_column : index->index_data_table()->columns()) {
+    if (data_column->source_column() == column) {
+      return data_column;
+    }
+  }
+  return nullptr;
+}
+
+// Returns 'filters' on columns of the indexed table as filters on the
+// corresponding columns of the data table of 'index'.
+absl::flat_hash_map<const Column*, const zetasql::ColumnFilter*>
+IndexDataColumnFilters(
+    const Index* index,
+    const absl::flat_hash_map<const Column*, const zetasql::ColumnFilter*>&
+        filters) {
+  absl::flat_hash_map<const Column*, const zetasql::ColumnFilter*>
+      index_filters;
+  for (const auto& [column, filter] : filters) {
+    if (const Column* data_column = FindIndexDataColumn(index, column);
+        data_column != nullptr) {
+      index_filters[data_column] = filter;
+    }
+  }
+  return index_filters;
+}
+
+}  // namespace
+
+bool IndexesEveryRow(const Index* index) {
+  if (index->is_search_index() || index->is_vector_index()) {
+    return false;
+  }
+  if (index->is_null_filtered()) {
+    for (const KeyColumn* key_column : index->key_columns()) {
+      if (key_column->column()->source_column()->is_nullable()) {
+        return false;
+      }
+    }
+  }
+  for (const Column* column : index->null_filtered_columns()) {
+    const Column* source_column = column->source_column() != nullptr
+                                      ? column->source_column()
+                                      : column;
+    if (source_column->is_nullable()) {
+      return false;
+    }
+  }
+  return true;
+}
+
+bool IndexCoversColumns(const Index* index,
+                        absl::Span<const Column* const> columns) {
+  return std::all_of(columns.begin(), columns.end(),
+                     [index](const Column* column) {
+                       return FindIndexDataColumn(index, column) != nullptr;
+                     });
+}
+
+const Index* ChooseIndexForColumnFilters(
+    const Table* table, absl::Span<const Column* const> columns,
+    const absl::flat_hash_map<const Column*, const zetasql::ColumnFilter*>&
+        filters) {
+  if (table->primary_key().empty() ||
+      filters.contains(table->primary_key().front()->column())) {
+    return nullptr;
+  }
+  const Index* best_index = nullptr;
+  bool best_index_covers_columns = false;
+  for (const Index* index : table->indexes()) {
+    // The entries of an interleaved index lead with the key of its parent,
+    // which is left unconstrained here, so reading one is not narrower than
+    // reading the table.
+    if (!IndexesEveryRow(index) || index->parent() != nullptr) {
+      continue;
+    }
+    // Pinning every key column of the index keeps the entries it yields in
+    // the primary key order of the table, which is the order of a table scan.
+    bool pins_key_columns = std::all_of(
+        index->key_columns().begin(), index->key_columns().end(),
+        [&filters](const KeyColumn* key_column) {
+          auto it = filters.find(key_column->column()->source_column());
+          return it != filters.end() && IsPointFilter(*it->second);
+        });
+    if (!pins_key_columns || index->key_columns().empty()) {
+      continue;
+    }
+    bool covers_columns = IndexCoversColumns(index, columns);
+    if (best_index == nullptr ||
+        (covers_columns && !best_index_covers_columns) ||
+        (covers_columns == best_index_covers_columns &&
+         index->key_columns().size() > best_index->key_columns().size())) {
+      best_index = index;
+      best_index_covers_columns = covers_columns;
+    }
+  }
+  return best_index;
+}
+
+KeySet KeySetFromColumnFilters(
+    const Table* table,
+    const absl::flat_hash_map<const Column*, const zetasql::ColumnFilter*>&
+        filters) {
+  std::vector<Key> prefixes = {Key()};
+  for (const KeyColumn* key_column : table->primary_key()) {
+    auto it = filters.find(key_column->column());
+    if (it == filters.end()) {
+      break;
+    }
+    const zetasql::ColumnFilter& filter = *it->second;
+    std::optional<std::vector<zetasql::Value>> points =
+        FilterPointValues(filter);
+
+    if (!points.has_value()) {
+      // A range on this key column bounds the scan under each prefix, and no
+      // later key column can narrow it further.
+      const zetasql::Value& lower = filter.lower_bound();
+      const zetasql::Value& upper = filter.upper_bound();
+      if ((lower.is_valid() && lower.is_null()) ||
+          (upper.is_valid() && upper.is_null())) {
+        return KeySet();
+      }
+      const zetasql::Value& start =
+          key_column->is_descending() ? upper : lower;
+      const zetasql::Value& limit =
+          key_column->is_descending() ? lower : upper;
+      KeySet key_set;
+      for (const Key& prefix : prefixes) {
+        Key start_key = prefix;
+        Key limit_key = prefix;
+        if (start.is_valid()) {
+          start_key.AddColumn(start);
+        }
+        if (limit.is_valid()) {
+          limit_key.AddColumn(limit);
+        }
+        key_set.AddRange(KeyRange::ClosedClosed(start_key, limit_key));
+      }
+      return key_set;
+    }
+
+    if (points->empty()) {
+      return KeySet();
+    }
+    if (prefixes.size() * points->size() > kMaxPushdownKeyPrefixes) {
+      break;
+    }
+    std::vector<Key> extended_prefixes;
+    extended_prefixes.reserve(prefixes.size() * points->size());
+    for (const Key& prefix : prefixes) {
+      for (const zetasql::Value& point : *points) {
+        Key key = prefix;
+        key.AddColumn(point);
+        extended_prefixes.push_back(std::move(key));
+      }
+    }
+    prefixes = std::move(extended_prefixes);
+  }
+
+  if (prefixes.size() == 1 && prefixes[0].IsEmpty()) {
+    return KeySet::All();
+  }
+  KeySet key_set;
+  for (const Key& prefix : prefixes) {
+    if (prefix.NumColumns() ==
+        static_cast<int>(table->primary_key().size())) {
+      key_set.AddKey(prefix);
+    } else {
+      key_set.AddRange(KeyRange::Prefix(prefix));
+    }
+  }
+  return key_set;
+}
+
 // An implementation of EvaluatorTableIterator which wraps a RowCursor.
 //
+// The read is deferred until the first call to NextRow() so that column
+// filters handed down by the evaluator through SetColumnFilterMap() can narrow
+// the key set to primary key prefixes, or to the entries of an index, and skip
+// non-matching rows before their values are copied out.
+//
 // Used by QueryableTable::CreateEvaluatorTableIterator.
 class RowCursorEvaluatorTableIterator
     : public zetasql::EvaluatorTableIterator {
  public:
-  explicit RowCursorEvaluatorTableIterator(std::unique_ptr<RowCursor> cursor)
-      : cursor_(std::move(cursor)) {
-    values_.reserve(cursor_->NumColumns());
-    for (int i = 0; i < cursor_->NumColumns(); ++i) {
-      values_.push_back(zetasql::values::Null(cursor_->ColumnType(i)));
+  RowCursorEvaluatorTableIterator(
+      RowReader* reader, ReadArg read_arg, const backend::Table* table,
+      const Index* forced_index, std::vector<const QueryableColumn*> columns)
+      : reader_(reader),
+        read_arg_(std::move(read_arg)),
+        table_(table),
+        forced_index_(forced_index),
+        index_(forced_index),
+        columns_(std::move(columns)) {
+    values_.reserve(columns_.size());
+    for (const QueryableColumn* column : columns_) {
+      values_.push_back(zetasql::values::Null(column->GetType()));
     }
   }
 
-  int NumColumns() const override { return cursor_->NumColumns(); }
+  int NumColumns() const override { return columns_.size(); }
 
   std::string GetColumnName(int i) const override {
-    return cursor_->ColumnName(i);
+    return columns_[i]->Name();
   }
 
   const zetasql::Type* GetColumnType(int i) const override {
-    return cursor_->ColumnType(i);
+    return columns_[i]->GetType();
+  }
+
+  absl::Status SetColumnFilterMap(ColumnFilterMap filter_map) override {
+    ZETASQL_RET_CHECK(cursor_ == nullptr)
+        << "SetColumnFilterMap called after the first call to NextRow";
+    absl::flat_hash_map<const Column*, const zetasql::ColumnFilter*>
+        key_filters;
+    filters_.clear();
+    for (auto& [i, filter] : filter_map) {
+      if (i < 0 || i >= NumColumns() || filter == nullptr ||
+          !SupportsFilterPushdown(columns_[i]->GetType()) ||
+          !FilterMatchesType(*filter, columns_[i]->GetType())) {
+        continue;
+      }
+      key_filters[columns_[i]->wrapped_column()] = filter.get();
+      filters_.emplace_back(i, std::move(filter));
+    }
+    read_arg_.key_set = KeySetFromColumnFilters(table_, key_filters);
+    index_ = forced_index_ != nullptr
+                 ? forced_index_
+                 : ChooseIndexForColumnFilters(table_, WrappedColumns(),
+                                               key_filters);
+    if (index_ != nullptr) {
+      index_key_set_ = KeySetFromColumnFilters(
+          index_->index_data_table(),
+          IndexDataColumnFilters(index_, key_filters));
+    }
+    return absl::OkStatus();
   }
 
   bool NextRow() override {
-    if (cursor_->Next()) {
+    if (!status_.ok()) {
+      return false;
+    }
+    if (cursor_ == nullptr) {
+      status_ = OpenCursor();
+      if (!status_.ok()) {
+        return false;
+      }
+    }
+    while (cursor_->Next()) {
+      if (!RowSatisfiesFilters()) {
+        continue;
+      }
       for (int i = 0; i < cursor_->NumColumns(); ++i) {
         values_[i] = cursor_->ColumnValue(i);
       }
       return true;
-    } else {
-      return false;
     }
+    status_ = cursor_->Status();
+    return false;
   }
 
   const zetasql::Value& GetValue(int i) const override { return values_[i]; }
 
-  absl::Status Status() const override { return cursor_->Status(); }
+  absl::Status Status() const override { return status_; }
 
   // Cancel is best-effort and not required.
   absl::Status Cancel() override { return absl::OkStatus(); }
 
  private:
-  // The wrapped RowCursor.
+  // Returns the columns of the table returned by this iterator.
+  std::vector<const Column*> WrappedColumns() const {
+    std::vector<const Column*> columns;
+    columns.reserve(columns_.size());
+    for (const QueryableColumn* column : columns_) {
+      columns.push_back(column->wrapped_column());
+    }
+    return columns;
+  }
+
+  // Opens the cursor over the rows of the table, reading through index_ if
+  // set. An index which stores all of the returned columns is read directly.
+  // Otherwise the primary keys of the matching index entries are read first,
+  // and the rows are then read from the table by key.
+  absl::Status OpenCursor() {
+    if (index_ == nullptr) {
+      return reader_->Read(read_arg_, &cursor_);
+    }
+    ReadArg index_read_arg = read_arg_;
+    index_read_arg.index = index_->Name();
+    index_read_arg.key_set = index_key_set_;
+    index_read_arg.columns.clear();
+    if (IndexCoversColumns(index_, WrappedColumns())) {
+      for (const QueryableColumn* column : columns_) {
+        index_read_arg.columns.push_back(
+            FindIndexDataColumn(index_, column->wrapped_column())->Name());
+      }
+      return reader_->Read(index_read_arg, &cursor_);
+    }
+
+    for (const KeyColumn* key_column : table_->primary_key()) {
+      index_read_arg.columns.push_back(
+          FindIndexDataColumn(index_, key_column->column())->Name());
+    }
+    std::unique_ptr<RowCursor> index_cursor;
+    ZETASQL_RETURN_IF_ERROR(reader_->Read(index_read_arg, &index_cursor));
+    KeySet key_set;
+    while (index_cursor->Next()) {
+      Key key;
+      for (int i = 0; i < index_cursor->NumColumns(); ++i) {
+        key.AddColumn(index_cursor->ColumnValue(i));
+      }
+      key_set.AddKey(key);
+    }
+    ZETASQL_RETURN_IF_ERROR(index_cursor->Status());
+    read_arg_.key_set = std::move(key_set);
+    return reader_->Read(read_arg_, &cursor_);
+  }
+
+  // Returns true if the cursor's current row satisfies all pushed-down
+  // filters.
+  bool RowSatisfiesFilters() const {
+    for (const auto& [i, filter] : filters_) {
+      if (!SatisfiesFilter(*filter, cursor_->ColumnValue(i))) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  // The reader and arguments used to open the cursor on the first NextRow().
+  RowReader* reader_;
+  ReadArg read_arg_;
+
+  // The table being read, the index forced on its reads if any, and the
+  // columns returned by this iterator.
+  const backend::Table* table_;
+  const Index* forced_index_;
+
+  // The index read through, if any, and the key set of the index data table
+  // to read.
+  const Index* index_;
+  KeySet index_key_set_ = KeySet::All();
+
+  std::vector<const QueryableColumn*> columns_;
+
+  // Filters pushed down by the evaluator, keyed by iterator column index.
+  std::vector<std::pair<int, std::unique_ptr<zetasql::ColumnFilter>>>
+      filters_;
+
+  // The wrapped RowCursor. Null until the first call to NextRow().
   std::unique_ptr<RowCursor> cursor_;
 
+  // Status of the read.
+  absl::Status status_;
+
   // Values of the current row. EvaluatorTableIterator::GetValue need to return
   // a reference so we need to buffer the values instead of simply delegate to
   // RowCursor::ColumnValue.
@@ -191,8 +602,10 @@ QueryableTable::CreateEvaluatorTableIterator(
   ZETASQL_RET_CHECK_NE(reader_, nullptr);
 
   std::vector<std::string> column_names;
+  std::vector<const QueryableColumn*> columns;
   for (int idx : column_idxs) {
     column_names.push_back(GetColumn(idx)->Name());
+    columns.push_back(columns_[idx].get());
   }
 
   ReadArg read_arg;
@@ -218,9 +631,28 @@ QueryableTable::CreateEvaluatorTableIterator(
       read_arg.change_stream_for_data_table = change_stream_name;
     }
   }
-  std::unique_ptr<RowCursor> cursor;
-  ZETASQL_RETURN_IF_ERROR(reader_->Read(read_arg, &cursor));
-  return std::make_unique<RowCursorEvaluatorTableIterator>(std::move(cursor));
+  return std::make_unique<RowCursorEvaluatorTableIterator>(
+      reader_, std::move(read_arg), wrapped_table_, forced_index_,
+      std::move(columns));
+}
+
+QueryableTable::QueryableTable(const QueryableTable& table,
+                               const Index* forced_index)
+    : is_synonym_(table.is_synonym_),
+      wrapped_table_(table.wrapped_table_),
+      reader_(table.reader_),
+      columns_(table.columns_),
+      primary_key_column_indexes_(table.primary_key_column_indexes_),
+      forced_index_(forced_index) {}
+
+const QueryableTable* QueryableTable::WithForcedIndex(
+    const Index* index) const {
+  absl::MutexLock lock(&mu_);
+  std::unique_ptr<const QueryableTable>& table = forced_index_tables_[index];
+  if (table == nullptr) {
+    table = absl::WrapUnique(new QueryableTable(*this, index));
+  }
+  return table.get();
 }
 
 const zetasql::Column* QueryableTable::FindColumnByName(
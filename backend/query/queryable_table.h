@@ -24,11 +24,16 @@
 
 #include "zetasql/public/catalog.h"
 #include "zetasql/public/evaluator_table_iterator.h"
+#include "absl/base/thread_annotations.h"
+#include "absl/container/flat_hash_map.h"
 #include "absl/status/statusor.h"
+#include "absl/synchronization/mutex.h"
 #include "absl/types/span.h"
 #include "backend/access/read.h"
+#include "backend/datamodel/key_set.h"
 #include "backend/query/queryable_column.h"
 #include "backend/schema/catalog/change_stream.h"
+#include "backend/schema/catalog/index.h"
 #include "backend/schema/catalog/schema.h"
 #include "backend/schema/catalog/table.h"
 
@@ -37,9 +42,46 @@ namespace spanner {
 namespace emulator {
 namespace backend {
 
+// Returns the set of primary keys of 'table' which can hold rows satisfying
+// all of 'filters'. Equality and IN-list filters on a leading prefix of the
+// primary key are expanded into key prefixes, and a range filter on the next
+// key column bounds the scan under each of them. Returns KeySet::All() if no
+// filter applies to the first key column.
+KeySet KeySetFromColumnFilters(
+    const Table* table,
+    const absl::flat_hash_map<const Column*, const zetasql::ColumnFilter*>&
+        filters);
+
+// Returns true if every row of the indexed table has an entry in 'index', so
+// that reading through the index returns the same rows as reading the table.
+bool IndexesEveryRow(const Index* index);
+
+// Returns true if the data table of 'index' stores all of 'columns' of the
+// indexed table.
+bool IndexCoversColumns(const Index* index,
+                        absl::Span<const Column* const> columns);
+
+// Returns the index on 'table' to read 'columns' through given column
+// 'filters', or null if the table should be read directly. An index is chosen
+// only if the filters leave the primary key of the table unconstrained but pin
+// every key column of the index to a single value, so that the index returns
+// the rows in primary key order. Indexes which store all of 'columns' are
+// preferred, then indexes with more key columns.
+const Index* ChooseIndexForColumnFilters(
+    const Table* table, absl::Span<const Column* const> columns,
+    const absl::flat_hash_map<const Column*, const zetasql::ColumnFilter*>&
+        filters);
+
 // A wrapper over Table class which implements zetasql::Table.
 // QueryableTable builds instances of EvalutorTableIterator by reading data of
 // the table through a RowReader.
+//
+// Rows are read from the table itself unless an index serves the scan better:
+// either the index is forced through WithForcedIndex(), or the column filters
+// handed down by the evaluator pin every key column of an index while leaving
+// the table's own primary key unconstrained. An index read scans the matching
+// range of the index data table, and looks the rows up in the table by primary
+// key when the index does not store all of the requested columns.
 class QueryableTable : public zetasql::Table {
  public:
   // 'options' , 'catalog' , 'type_factory' must be non-null when specifying a
@@ -74,6 +116,16 @@ class QueryableTable : public zetasql::Table {
 
   const backend::Table* wrapped_table() const { return wrapped_table_; }
 
+  // The index which all reads of this table go through, if any.
+  const Index* forced_index() const { return forced_index_; }
+
+  // Returns a table with the same name and columns as this one whose rows are
+  // always read through 'index', which must be an index on the wrapped table.
+  // Used for table scans with a FORCE_INDEX hint. The returned table is owned
+  // by this one.
+  const QueryableTable* WithForcedIndex(const Index* index) const
+      ABSL_LOCKS_EXCLUDED(mu_);
+
   // Override CreateEvaluatorTableIterator.
   absl::StatusOr<std::unique_ptr<zetasql::EvaluatorTableIterator>>
   CreateEvaluatorTableIterator(
@@ -86,6 +138,10 @@ class QueryableTable : public zetasql::Table {
       zetasql::Catalog* catalog,
       std::optional<const zetasql::AnalyzerOptions> opt_options) const;
 
+  // Constructs a table sharing the columns of 'table' which reads its rows
+  // through 'forced_index'.
+  QueryableTable(const QueryableTable& table, const Index* forced_index);
+
   // Whether the table should be treated as a synonym.
   bool is_synonym_;
 
@@ -101,11 +157,23 @@ class QueryableTable : public zetasql::Table {
   // EvalutorTableIterator when CreateEvaluatorTableIterator is called.
   RowReader* reader_;
 
-  // The columns in the table.
-  std::vector<std::unique_ptr<const QueryableColumn>> columns_;
+  // The columns in the table. Shared with the tables returned by
+  // WithForcedIndex() so that the column expressions are analyzed only once.
+  std::vector<std::shared_ptr<const QueryableColumn>> columns_;
 
   // A list of ordinal indexes of the primary key columns of the table.
   std::vector<int> primary_key_column_indexes_;
+
+  // The index which all reads of the table go through, or null if the index is
+  // chosen per read.
+  const Index* forced_index_ = nullptr;
+
+  mutable absl::Mutex mu_;
+
+  // The tables returned by WithForcedIndex(), keyed by index.
+  mutable absl::flat_hash_map<const Index*,
+                              std::unique_ptr<const QueryableTable>>
+      forced_index_tables_ ABSL_GUARDED_BY(mu_);
 };
 
 }  // namespace backend
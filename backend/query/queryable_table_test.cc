@@ -17,15 +17,25 @@
 #include "backend/query/queryable_table.h"
 
 #include <memory>
+#include <utility>
+#include <vector>
 
+#include "zetasql/public/evaluator_table_iterator.h"
 #include "zetasql/public/type.h"
 #include "zetasql/public/value.h"
 #include "gmock/gmock.h"
 #include "gtest/gtest.h"
 #include "zetasql/base/testing/status_matchers.h"
+#include "absl/container/flat_hash_map.h"
+#include "absl/status/status.h"
 #include "backend/access/read.h"
+#include "backend/datamodel/key.h"
+#include "backend/datamodel/key_range.h"
+#include "backend/datamodel/key_set.h"
 #include "backend/query/catalog.h"
 #include "backend/query/queryable_column.h"
+#include "backend/schema/catalog/index.h"
+#include "backend/schema/catalog/table.h"
 #include "tests/common/row_cursor.h"
 #include "tests/common/row_reader.h"
 #include "tests/common/schema_constructor.h"
@@ -39,16 +49,34 @@ namespace {
 
 using testing::ElementsAre;
 
+// A TestRowReader which records the arguments of its reads.
+class RecordingRowReader : public test::TestRowReader {
+ public:
+  using test::TestRowReader::TestRowReader;
+
+  absl::Status Read(const ReadArg& read_arg,
+                    std::unique_ptr<RowCursor>* cursor) override {
+    read_args_.push_back(read_arg);
+    return test::TestRowReader::Read(read_arg, cursor);
+  }
+
+  const std::vector<ReadArg>& read_args() const { return read_args_; }
+
+ private:
+  std::vector<ReadArg> read_args_;
+};
+
 class QueryableTableTest : public testing::Test {
  public:
   const Schema* schema() { return schema_.get(); }
   RowReader* reader() { return &reader_; }
+  const std::vector<ReadArg>& read_args() const { return reader_.read_args(); }
 
  private:
   zetasql::TypeFactory type_factory_;
   std::unique_ptr<const Schema> schema_ =
       test::CreateSchemaWithOneTable(&type_factory_);
-  test::TestRowReader reader_{
+  RecordingRowReader reader_{
       {{"test_table",
         {{"int64_col", "string_col"},
          {zetasql::types::Int64Type(), zetasql::types::StringType()},
@@ -114,6 +142,152 @@ TEST_F(QueryableTableTest, CreateEvaluatorTableIteratorWithAllColumns) {
   ASSERT_FALSE(iterator->NextRow());
 }
 
+TEST_F(QueryableTableTest, KeySetFromColumnFiltersWithoutKeyFilterReadsAll) {
+  const Table* schema_table = schema()->FindTable("test_table");
+  zetasql::ColumnFilter filter({zetasql::values::String("foo")});
+  KeySet key_set = KeySetFromColumnFilters(
+      schema_table, {{schema_table->FindColumn("string_col"), &filter}});
+  EXPECT_EQ(key_set.DebugString(), KeySet::All().DebugString());
+}
+
+TEST_F(QueryableTableTest, KeySetFromColumnFiltersWithKeyEquality) {
+  const Table* schema_table = schema()->FindTable("test_table");
+  zetasql::ColumnFilter filter(zetasql::values::Int64(42),
+                                 zetasql::values::Int64(42));
+  KeySet key_set = KeySetFromColumnFilters(
+      schema_table, {{schema_table->FindColumn("int64_col"), &filter}});
+  EXPECT_THAT(key_set.keys(), ElementsAre(Key({zetasql::values::Int64(42)})));
+  EXPECT_TRUE(key_set.ranges().empty());
+}
+
+TEST_F(QueryableTableTest, KeySetFromColumnFiltersWithKeyInList) {
+  const Table* schema_table = schema()->FindTable("test_table");
+  zetasql::ColumnFilter filter(
+      {zetasql::values::Int64(1), zetasql::values::NullInt64(),
+       zetasql::values::Int64(3)});
+  KeySet key_set = KeySetFromColumnFilters(
+      schema_table, {{schema_table->FindColumn("int64_col"), &filter}});
+  EXPECT_THAT(key_set.keys(), ElementsAre(Key({zetasql::values::Int64(1)}),
+                                          Key({zetasql::values::Int64(3)})));
+}
+
+TEST_F(QueryableTableTest, KeySetFromColumnFiltersWithKeyRange) {
+  const Table* schema_table = schema()->FindTable("test_table");
+  zetasql::ColumnFilter filter(zetasql::values::Int64(10), zetasql::Value());
+  KeySet key_set = KeySetFromColumnFilters(
+      schema_table, {{schema_table->FindColumn("int64_col"), &filter}});
+  EXPECT_TRUE(key_set.keys().empty());
+  EXPECT_THAT(key_set.ranges(),
+              ElementsAre(KeyRange::ClosedClosed(
+                  Key({zetasql::values::Int64(10)}), Key())));
+}
+
+TEST_F(QueryableTableTest, KeySetFromColumnFiltersWithNullBoundIsEmpty) {
+  const Table* schema_table = schema()->FindTable("test_table");
+  zetasql::ColumnFilter filter(zetasql::values::NullInt64(),
+                                 zetasql::values::Int64(10));
+  KeySet key_set = KeySetFromColumnFilters(
+      schema_table, {{schema_table->FindColumn("int64_col"), &filter}});
+  EXPECT_TRUE(key_set.keys().empty());
+  EXPECT_TRUE(key_set.ranges().empty());
+}
+
+TEST_F(QueryableTableTest, EvaluatorTableIteratorAppliesColumnFilters) {
+  QueryableTable table{schema()->FindTable("test_table"), reader()};
+  auto iterator =
+      table.CreateEvaluatorTableIterator(/*column_idxs=*/{0, 1}).value();
+  absl::flat_hash_map<int, std::unique_ptr<zetasql::ColumnFilter>> filters;
+  filters[1] = std::make_unique<zetasql::ColumnFilter>(
+      std::vector<zetasql::Value>{zetasql::values::String("bar")});
+  ZETASQL_ASSERT_OK(iterator->SetColumnFilterMap(std::move(filters)));
+  ASSERT_FALSE(iterator->NextRow());
+  ZETASQL_ASSERT_OK(iterator->Status());
+}
+
+TEST_F(QueryableTableTest, EvaluatorTableIteratorReturnsRowsMatchingFilters) {
+  QueryableTable table{schema()->FindTable("test_table"), reader()};
+  auto iterator =
+      table.CreateEvaluatorTableIterator(/*column_idxs=*/{0, 1}).value();
+  absl::flat_hash_map<int, std::unique_ptr<zetasql::ColumnFilter>> filters;
+  filters[0] = std::make_unique<zetasql::ColumnFilter>(
+      zetasql::values::Int64(40), zetasql::values::Int64(50));
+  ZETASQL_ASSERT_OK(iterator->SetColumnFilterMap(std::move(filters)));
+  ASSERT_TRUE(iterator->NextRow());
+  EXPECT_EQ(iterator->GetValue(0).int64_value(), 42);
+  ASSERT_FALSE(iterator->NextRow());
+  ZETASQL_ASSERT_OK(iterator->Status());
+}
+
+TEST_F(QueryableTableTest, ChooseIndexForColumnFiltersWithIndexKeyEquality) {
+  const Table* schema_table = schema()->FindTable("test_table");
+  zetasql::ColumnFilter filter({zetasql::values::String("foo")});
+  EXPECT_EQ(ChooseIndexForColumnFilters(
+                schema_table, {schema_table->FindColumn("int64_col")},
+                {{schema_table->FindColumn("string_col"), &filter}}),
+            schema_table->FindIndex("test_index"));
+}
+
+TEST_F(QueryableTableTest, ChooseIndexForColumnFiltersWithIndexKeyRange) {
+  const Table* schema_table = schema()->FindTable("test_table");
+  zetasql::ColumnFilter filter(zetasql::values::String("a"),
+                                 zetasql::values::String("b"));
+  EXPECT_EQ(ChooseIndexForColumnFilters(
+                schema_table, {schema_table->FindColumn("int64_col")},
+                {{schema_table->FindColumn("string_col"), &filter}}),
+            nullptr);
+}
+
+TEST_F(QueryableTableTest, ChooseIndexForColumnFiltersWithKeyFilter) {
+  const Table* schema_table = schema()->FindTable("test_table");
+  zetasql::ColumnFilter key_filter(zetasql::values::Int64(42),
+                                     zetasql::values::Int64(42));
+  zetasql::ColumnFilter filter({zetasql::values::String("foo")});
+  EXPECT_EQ(ChooseIndexForColumnFilters(
+                schema_table, {schema_table->FindColumn("int64_col")},
+                {{schema_table->FindColumn("int64_col"), &key_filter},
+                 {schema_table->FindColumn("string_col"), &filter}}),
+            nullptr);
+}
+
+TEST_F(QueryableTableTest, EvaluatorTableIteratorReadsIndexForIndexKeyFilter) {
+  QueryableTable table{schema()->FindTable("test_table"), reader()};
+  auto iterator =
+      table.CreateEvaluatorTableIterator(/*column_idxs=*/{0, 1}).value();
+  absl::flat_hash_map<int, std::unique_ptr<zetasql::ColumnFilter>> filters;
+  filters[1] = std::make_unique<zetasql::ColumnFilter>(
+      std::vector<zetasql::Value>{zetasql::values::String("foo")});
+  ZETASQL_ASSERT_OK(iterator->SetColumnFilterMap(std::move(filters)));
+  ASSERT_TRUE(iterator->NextRow());
+  EXPECT_EQ(iterator->GetValue(0).int64_value(), 42);
+  ASSERT_FALSE(iterator->NextRow());
+  ZETASQL_ASSERT_OK(iterator->Status());
+  ASSERT_EQ(read_args().size(), 1);
+  EXPECT_EQ(read_args()[0].index, "test_index");
+  EXPECT_THAT(read_args()[0].key_set.ranges(),
+              ElementsAre(KeyRange::Prefix(
+                  Key({zetasql::values::String("foo")}))));
+}
+
+TEST_F(QueryableTableTest, EvaluatorTableIteratorReadsThroughForcedIndex) {
+  const Table* schema_table = schema()->FindTable("test_table");
+  const Index* index = schema_table->FindIndex("test_index");
+  QueryableTable table{schema_table, reader()};
+  const QueryableTable* indexed_table = table.WithForcedIndex(index);
+  EXPECT_EQ(indexed_table, table.WithForcedIndex(index));
+  EXPECT_EQ(indexed_table->forced_index(), index);
+  EXPECT_EQ(indexed_table->Name(), table.Name());
+  EXPECT_EQ(indexed_table->GetColumn(1), table.GetColumn(1));
+
+  auto iterator =
+      indexed_table->CreateEvaluatorTableIterator(/*column_idxs=*/{1}).value();
+  ASSERT_TRUE(iterator->NextRow());
+  EXPECT_EQ(iterator->GetValue(0).string_value(), "foo");
+  ASSERT_FALSE(iterator->NextRow());
+  ZETASQL_ASSERT_OK(iterator->Status());
+  ASSERT_EQ(read_args().size(), 1);
+  EXPECT_EQ(read_args()[0].index, "test_index");
+}
+
 }  // namespace
 
 }  // namespace backend
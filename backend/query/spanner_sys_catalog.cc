@@ -16,16 +16,25 @@
 
 #include "backend/query/spanner_sys_catalog.h"
 
+#include <memory>
 #include <string>
+#include <utility>
 #include <vector>
 
+#include "zetasql/public/catalog.h"
+#include "zetasql/public/evaluator_table_iterator.h"
 #include "zetasql/public/simple_catalog.h"
+#include "zetasql/public/types/type.h"
 #include "zetasql/public/value.h"
 #include "zetasql/base/no_destructor.h"
 #include "absl/container/flat_hash_set.h"
 #include "absl/log/check.h"
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
 #include "absl/strings/str_cat.h"
+#include "absl/types/span.h"
 #include "backend/query/info_schema_columns_metadata_values.h"
+#include "backend/query/spanner_sys_stats.h"
 #include "backend/query/tables_from_metadata.h"
 
 namespace google {
@@ -42,13 +51,117 @@ using ::zetasql::values::Int64;
 static constexpr char kSupportedOptimizerVersions[] =
     "SUPPORTED_OPTIMIZER_VERSIONS";
 
+// Tables whose rows are read from SpannerSysStats.
+static const zetasql_base::NoDestructor<absl::flat_hash_set<std::string>>
+    kStatsTables{{
+        SpannerSysStats::kTableSizesStats1Hour,
+        SpannerSysStats::kSchemaVersionStats,
+        SpannerSysStats::kQueryStatsTopMinute,
+        SpannerSysStats::kQueryStatsTop10Minute,
+        SpannerSysStats::kQueryStatsTopHour,
+        SpannerSysStats::kQueryStatsTotalMinute,
+        SpannerSysStats::kQueryStatsTotal10Minute,
+        SpannerSysStats::kQueryStatsTotalHour,
+        SpannerSysStats::kTxnStatsTopMinute,
+        SpannerSysStats::kTxnStatsTop10Minute,
+        SpannerSysStats::kTxnStatsTopHour,
+        SpannerSysStats::kTxnStatsTotalMinute,
+        SpannerSysStats::kTxnStatsTotal10Minute,
+        SpannerSysStats::kTxnStatsTotalHour,
+        SpannerSysStats::kLockStatsTopMinute,
+        SpannerSysStats::kLockStatsTop10Minute,
+        SpannerSysStats::kLockStatsTopHour,
+        SpannerSysStats::kLockStatsTotalMinute,
+        SpannerSysStats::kLockStatsTotal10Minute,
+        SpannerSysStats::kLockStatsTotalHour,
+    }};
+
 static const zetasql_base::NoDestructor<absl::flat_hash_set<std::string>>
     kSupportedTables{{
         kSupportedOptimizerVersions,
+        SpannerSysStats::kTableSizesStats1Hour,
+        SpannerSysStats::kSchemaVersionStats,
+        SpannerSysStats::kQueryStatsTopMinute,
+        SpannerSysStats::kQueryStatsTop10Minute,
+        SpannerSysStats::kQueryStatsTopHour,
+        SpannerSysStats::kQueryStatsTotalMinute,
+        SpannerSysStats::kQueryStatsTotal10Minute,
+        SpannerSysStats::kQueryStatsTotalHour,
+        SpannerSysStats::kTxnStatsTopMinute,
+        SpannerSysStats::kTxnStatsTop10Minute,
+        SpannerSysStats::kTxnStatsTopHour,
+        SpannerSysStats::kTxnStatsTotalMinute,
+        SpannerSysStats::kTxnStatsTotal10Minute,
+        SpannerSysStats::kTxnStatsTotalHour,
+        SpannerSysStats::kLockStatsTopMinute,
+        SpannerSysStats::kLockStatsTop10Minute,
+        SpannerSysStats::kLockStatsTopHour,
+        SpannerSysStats::kLockStatsTotalMinute,
+        SpannerSysStats::kLockStatsTotal10Minute,
+        SpannerSysStats::kLockStatsTotalHour,
     }};
+
+// An implementation of EvaluatorTableIterator over the rows of a statistics
+// table read from SpannerSysStats when the table is scanned.
+class StatsEvaluatorTableIterator : public zetasql::EvaluatorTableIterator {
+ public:
+  StatsEvaluatorTableIterator(const zetasql::Table* table,
+                              absl::Span<const int> column_idxs,
+                              std::vector<SpannerSysStats::Row> rows)
+      : rows_(std::move(rows)) {
+    for (int idx : column_idxs) {
+      columns_.push_back(table->GetColumn(idx));
+      values_.push_back(zetasql::Value::Null(columns_.back()->GetType()));
+    }
+  }
+
+  int NumColumns() const override { return columns_.size(); }
+
+  std::string GetColumnName(int i) const override {
+    return columns_[i]->Name();
+  }
+
+  const zetasql::Type* GetColumnType(int i) const override {
+    return columns_[i]->GetType();
+  }
+
+  bool NextRow() override {
+    if (next_row_ >= rows_.size()) {
+      return false;
+    }
+    const SpannerSysStats::Row& row = rows_[next_row_++];
+    for (int i = 0; i < columns_.size(); ++i) {
+      auto it = row.find(columns_[i]->Name());
+      values_[i] = it != row.end()
+                       ? it->second
+                       : zetasql::Value::Null(columns_[i]->GetType());
+    }
+    return true;
+  }
+
+  const zetasql::Value& GetValue(int i) const override {
+    return values_.at(i);
+  }
+
+  absl::Status Status() const override { return absl::OkStatus(); }
+  absl::Status Cancel() override { return absl::OkStatus(); }
+
+ private:
+  // The columns emitted by the iterator.
+  std::vector<const zetasql::Column*> columns_;
+
+  // The rows of the table, and the index of the next row to emit.
+  std::vector<SpannerSysStats::Row> rows_;
+  int next_row_ = 0;
+
+  // Values of the current row.
+  std::vector<zetasql::Value> values_;
+};
+
 }  // namespace
 
-SpannerSysCatalog::SpannerSysCatalog() : zetasql::SimpleCatalog(kName) {
+SpannerSysCatalog::SpannerSysCatalog(const SpannerSysStats* stats)
+    : zetasql::SimpleCatalog(kName) {
   // TODO: Use inheritance and pass SpannerSysColumnsMetadata
   // directly to AddTablesFromMetadata.
   std::vector<ColumnsMetaEntry> columns;
@@ -67,6 +180,7 @@ SpannerSysCatalog::SpannerSysCatalog() : zetasql::SimpleCatalog(kName) {
   }
 
   FillOptimizerVersionsTable();
+  SetStatsTableSources(stats);
 }
 
 void SpannerSysCatalog::FillOptimizerVersionsTable() {
@@ -83,6 +197,22 @@ void SpannerSysCatalog::FillOptimizerVersionsTable() {
   table->SetContents(rows);
 }
 
+void SpannerSysCatalog::SetStatsTableSources(const SpannerSysStats* stats) {
+  if (stats == nullptr) {
+    return;
+  }
+  for (const std::string& name : *kStatsTables) {
+    zetasql::SimpleTable* table = tables_by_name_.at(name).get();
+    table->SetEvaluatorTableIteratorFactory(
+        [table, stats](absl::Span<const int> column_idxs)
+            -> absl::StatusOr<
+                std::unique_ptr<zetasql::EvaluatorTableIterator>> {
+          return std::make_unique<StatsEvaluatorTableIterator>(
+              table, column_idxs, stats->GetRows(table->Name()));
+        });
+  }
+}
+
 }  // namespace backend
 }  // namespace emulator
 }  // namespace spanner
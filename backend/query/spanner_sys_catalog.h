@@ -22,6 +22,7 @@
 
 #include "zetasql/public/simple_catalog.h"
 #include "absl/container/flat_hash_map.h"
+#include "backend/query/spanner_sys_stats.h"
 
 namespace google {
 namespace spanner {
@@ -32,7 +33,9 @@ class SpannerSysCatalog : public zetasql::SimpleCatalog {
  public:
   static constexpr char kName[] = "SPANNER_SYS";
 
-  explicit SpannerSysCatalog();
+  // The rows of the statistics tables are read from 'stats' when the tables
+  // are queried. Statistics tables are empty if 'stats' is nullptr.
+  explicit SpannerSysCatalog(const SpannerSysStats* stats = nullptr);
 
  private:
   // Explicitly storing the tables because we are using SimpleCatalog::AddTable
@@ -41,6 +44,9 @@ class SpannerSysCatalog : public zetasql::SimpleCatalog {
       tables_by_name_;
 
   void FillOptimizerVersionsTable();
+
+  // Makes the statistics tables read their rows from 'stats'.
+  void SetStatsTableSources(const SpannerSysStats* stats);
 };
 
 }  // namespace backend
@@ -0,0 +1,54 @@
+//
+// Copyright 2026 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "backend/query/spanner_sys_stats.h"
+
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "absl/synchronization/mutex.h"
+
+namespace google {
+namespace spanner {
+namespace emulator {
+namespace backend {
+
+void SpannerSysStats::SetSource(const std::string& table_name,
+                                RowsFn rows_fn) {
+  absl::MutexLock lock(&mu_);
+  sources_[table_name] = std::move(rows_fn);
+}
+
+std::vector<SpannerSysStats::Row> SpannerSysStats::GetRows(
+    const std::string& table_name) const {
+  RowsFn rows_fn;
+  {
+    absl::MutexLock lock(&mu_);
+    auto it = sources_.find(table_name);
+    if (it == sources_.end()) {
+      return {};
+    }
+    rows_fn = it->second;
+  }
+  // Sources may take their own locks, so they are called without holding mu_.
+  return rows_fn();
+}
+
+}  // namespace backend
+}  // namespace emulator
+}  // namespace spanner
+}  // namespace google
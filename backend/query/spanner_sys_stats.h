@@ -0,0 +1,94 @@
+//
+// Copyright 2026 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#ifndef THIRD_PARTY_CLOUD_SPANNER_EMULATOR_BACKEND_QUERY_SPANNER_SYS_STATS_H_
+#define THIRD_PARTY_CLOUD_SPANNER_EMULATOR_BACKEND_QUERY_SPANNER_SYS_STATS_H_
+
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "zetasql/public/value.h"
+#include "absl/base/thread_annotations.h"
+#include "absl/container/flat_hash_map.h"
+#include "absl/synchronization/mutex.h"
+
+namespace google {
+namespace spanner {
+namespace emulator {
+namespace backend {
+
+// SpannerSysStats holds the sources of the rows of the SPANNER_SYS statistics
+// tables of a database.
+//
+// The rows of a table are produced by its source each time the table is read,
+// so queries always see the current statistics, including queries which were
+// prepared earlier and cached. Tables without a source are empty.
+//
+// This class is thread-safe.
+class SpannerSysStats {
+ public:
+  // Names of the statistics tables.
+  static constexpr char kTableSizesStats1Hour[] = "TABLE_SIZES_STATS_1HOUR";
+  static constexpr char kSchemaVersionStats[] = "SCHEMA_VERSION_STATS";
+  static constexpr char kQueryStatsTopMinute[] = "QUERY_STATS_TOP_MINUTE";
+  static constexpr char kQueryStatsTop10Minute[] = "QUERY_STATS_TOP_10MINUTE";
+  static constexpr char kQueryStatsTopHour[] = "QUERY_STATS_TOP_HOUR";
+  static constexpr char kQueryStatsTotalMinute[] = "QUERY_STATS_TOTAL_MINUTE";
+  static constexpr char kQueryStatsTotal10Minute[] =
+      "QUERY_STATS_TOTAL_10MINUTE";
+  static constexpr char kQueryStatsTotalHour[] = "QUERY_STATS_TOTAL_HOUR";
+  static constexpr char kTxnStatsTopMinute[] = "TXN_STATS_TOP_MINUTE";
+  static constexpr char kTxnStatsTop10Minute[] = "TXN_STATS_TOP_10MINUTE";
+  static constexpr char kTxnStatsTopHour[] = "TXN_STATS_TOP_HOUR";
+  static constexpr char kTxnStatsTotalMinute[] = "TXN_STATS_TOTAL_MINUTE";
+  static constexpr char kTxnStatsTotal10Minute[] = "TXN_STATS_TOTAL_10MINUTE";
+  static constexpr char kTxnStatsTotalHour[] = "TXN_STATS_TOTAL_HOUR";
+  static constexpr char kLockStatsTopMinute[] = "LOCK_STATS_TOP_MINUTE";
+  static constexpr char kLockStatsTop10Minute[] = "LOCK_STATS_TOP_10MINUTE";
+  static constexpr char kLockStatsTopHour[] = "LOCK_STATS_TOP_HOUR";
+  static constexpr char kLockStatsTotalMinute[] = "LOCK_STATS_TOTAL_MINUTE";
+  static constexpr char kLockStatsTotal10Minute[] = "LOCK_STATS_TOTAL_10MINUTE";
+  static constexpr char kLockStatsTotalHour[] = "LOCK_STATS_TOTAL_HOUR";
+
+  // A row of a statistics table, keyed by column name. Columns which are not
+  // set are NULL.
+  using Row = absl::flat_hash_map<std::string, zetasql::Value>;
+
+  // Returns the current rows of a statistics table.
+  using RowsFn = std::function<std::vector<Row>()>;
+
+  // Sets the source of the rows of the SPANNER_SYS table 'table_name'.
+  void SetSource(const std::string& table_name, RowsFn rows_fn)
+      ABSL_LOCKS_EXCLUDED(mu_);
+
+  // Returns the current rows of the SPANNER_SYS table 'table_name'.
+  std::vector<Row> GetRows(const std::string& table_name) const
+      ABSL_LOCKS_EXCLUDED(mu_);
+
+ private:
+  mutable absl::Mutex mu_;
+
+  // Sources of the rows of the statistics tables, keyed by table name.
+  absl::flat_hash_map<std::string, RowsFn> sources_ ABSL_GUARDED_BY(mu_);
+};
+
+}  // namespace backend
+}  // namespace emulator
+}  // namespace spanner
+}  // namespace google
+
+#endif  // THIRD_PARTY_CLOUD_SPANNER_EMULATOR_BACKEND_QUERY_SPANNER_SYS_STATS_H_
@@ -40,10 +40,12 @@ namespace backend {
 static const zetasql_base::NoDestructor<
     absl::flat_hash_map<std::string, const zetasql::Type*>>
     kSpannerTypeToGSQLType{{
+        {"ARRAY<STRING(MAX)>", zetasql::types::StringArrayType()},
         {"BOOL", zetasql::types::BoolType()},
+        {"BYTES(MAX)", zetasql::types::BytesType()},
         {"DATE", zetasql::types::DateType()},
         {"INT64", zetasql::types::Int64Type()},
-        {"FLOAT64", zetasql::types::FloatType()},
+        {"FLOAT64", zetasql::types::DoubleType()},
         {"STRING(32)", zetasql::types::StringType()},
         {"STRING(100)", zetasql::types::StringType()},
         {"STRING(MAX)", zetasql::types::StringType()},
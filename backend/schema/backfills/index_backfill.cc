@@ -16,17 +16,27 @@
 
 #include "backend/schema/backfills/index_backfill.h"
 
+#include <algorithm>
+#include <cstdint>
+#include <deque>
+#include <iterator>
 #include <memory>
+#include <optional>
 #include <queue>
-#include <set>
+#include <thread>  // NOLINT
+#include <utility>
 #include <vector>
 
 #include "zetasql/public/functions/string.h"
 #include "zetasql/public/type.pb.h"
 #include "zetasql/public/value.h"
+#include "absl/base/thread_annotations.h"
 #include "absl/container/flat_hash_set.h"
 #include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/synchronization/mutex.h"
 #include "absl/time/time.h"
+#include "absl/types/span.h"
 #include "absl/types/optional.h"
 #include "backend/common/ids.h"
 #include "backend/common/indexing.h"
@@ -39,6 +49,7 @@
 #include "backend/schema/updater/schema_validation_context.h"
 #include "backend/storage/in_memory_storage.h"
 #include "backend/storage/iterator.h"
+#include "backend/storage/storage.h"
 #include "common/errors.h"
 #include "common/limits.h"
 #include "zetasql/base/ret_check.h"
@@ -50,6 +61,171 @@ namespace spanner {
 namespace emulator {
 namespace backend {
 
+namespace {
+
+// Number of consecutive rows of the indexed table in each chunk of a backfill.
+constexpr int kBackfillChunkRows = 4096;
+
+// Maximum number of threads computing the index rows of a backfill.
+constexpr int kMaxBackfillWorkers = 8;
+
+int NumBackfillWorkers() {
+  return std::clamp<int>(std::thread::hardware_concurrency(), 1,
+                         kMaxBackfillWorkers);
+}
+
+// A row of an index data table.
+struct IndexRow {
+  Key key;
+  ValueList values;
+};
+
+// The index rows computed from a chunk of the indexed table, sorted by key, and
+// the status of computing them.
+struct SortedRun {
+  std::vector<IndexRow> rows;
+  absl::Status status;
+};
+
+// A chunk of consecutive rows of the indexed table, and the run its index rows
+// are computed into.
+struct BackfillChunk {
+  std::vector<ValueList> rows;
+  SortedRun* run = nullptr;
+};
+
+// The chunks of a backfill which were read but not yet taken by a worker. The
+// table is read while the workers compute the runs of earlier chunks, and the
+// reader waits while the queue is full, so that only a bounded number of
+// chunks of the table are held in memory at once.
+class BackfillChunkQueue {
+ public:
+  explicit BackfillChunkQueue(size_t capacity) : capacity_(capacity) {}
+
+  // Adds a chunk to the queue, waiting until the queue has room for it.
+  void Push(BackfillChunk chunk) {
+    absl::MutexLock lock(&mu_);
+    auto has_room = [this]() ABSL_EXCLUSIVE_LOCKS_REQUIRED(mu_) {
+      return chunks_.size() < capacity_;
+    };
+    mu_.Await(absl::Condition(&has_room));
+    chunks_.push_back(std::move(chunk));
+  }
+
+  // Marks that no more chunks will be added.
+  void Close() {
+    absl::MutexLock lock(&mu_);
+    closed_ = true;
+  }
+
+  // Takes the next chunk off the queue, waiting until one is added. Returns
+  // false once the queue is closed and empty.
+  bool Pop(BackfillChunk* chunk) {
+    absl::MutexLock lock(&mu_);
+    auto has_chunk = [this]() ABSL_EXCLUSIVE_LOCKS_REQUIRED(mu_) {
+      return !chunks_.empty() || closed_;
+    };
+    mu_.Await(absl::Condition(&has_chunk));
+    if (chunks_.empty()) {
+      return false;
+    }
+    *chunk = std::move(chunks_.front());
+    chunks_.pop_front();
+    return true;
+  }
+
+ private:
+  const size_t capacity_;
+  absl::Mutex mu_;
+  std::deque<BackfillChunk> chunks_ ABSL_GUARDED_BY(mu_);
+  bool closed_ ABSL_GUARDED_BY(mu_) = false;
+};
+
+// Returns the columns of the indexed table which the index data table of
+// 'index' is computed from: its primary key, and the indexed and stored
+// columns.
+std::vector<const Column*> IndexBaseColumns(const Index* index) {
+  std::vector<const Column*> base_columns;
+  for (const Column* column : index->index_data_table()->columns()) {
+    const Column* source_column = column->source_column();
+    if (std::find(base_columns.begin(), base_columns.end(), source_column) ==
+        base_columns.end()) {
+      base_columns.push_back(source_column);
+    }
+  }
+  return base_columns;
+}
+
+// Converts the values of 'base_columns' returned by storage into a row of the
+// indexed table. Storage returns invalid values if a value is not present, in
+// which case it is converted into a typed NULL.
+ValueList BaseRowValues(absl::Span<const Column* const> base_columns,
+                        ValueList values) {
+  for (int i = 0; i < values.size(); ++i) {
+    if (!values[i].is_valid()) {
+      values[i] = zetasql::Value::Null(base_columns[i]->GetType());
+    }
+  }
+  return values;
+}
+
+// Computes the index row of a row of the indexed table which has the values
+// 'row_values' of 'base_columns'. Returns nullopt if the row is filtered out
+// of the index.
+absl::StatusOr<std::optional<IndexRow>> ComputeIndexRow(
+    const Index* index, absl::Span<const Column* const> base_columns,
+    const ValueList& row_values) {
+  // Compute the index key and column values.
+  Row base_row = MakeRow(base_columns, row_values);
+  // Backfill should return failed precondition error for invalid index keys.
+  ZETASQL_ASSIGN_OR_RETURN(Key index_data_table_key, ComputeIndexKey(base_row, index),
+                   _.SetErrorCode(absl::StatusCode::kFailedPrecondition));
+  if (ShouldFilterIndexKeyOrValue(index, index_data_table_key, base_row)) {
+    return std::nullopt;
+  }
+  return IndexRow{std::move(index_data_table_key),
+                  ComputeIndexValues(base_row, index)};
+}
+
+// Computes the index rows of the rows of 'chunk', which have the values of
+// 'base_columns', and adds them to 'index_rows' in key order.
+absl::Status ComputeSortedRun(const Index* index,
+                              absl::Span<const Column* const> base_columns,
+                              const std::vector<ValueList>& chunk,
+                              std::vector<IndexRow>* index_rows) {
+  index_rows->reserve(chunk.size());
+  for (const ValueList& row_values : chunk) {
+    ZETASQL_ASSIGN_OR_RETURN(std::optional<IndexRow> index_row,
+                     ComputeIndexRow(index, base_columns, row_values));
+    if (index_row.has_value()) {
+      index_rows->push_back(*std::move(index_row));
+    }
+  }
+  std::sort(index_rows->begin(), index_rows->end(),
+            [](const IndexRow& a, const IndexRow& b) { return a.key < b.key; });
+  return absl::OkStatus();
+}
+
+// Returns the index row of the row of the indexed table with 'key' at
+// 'timestamp', or nullopt if the row does not exist or is filtered out of the
+// index.
+absl::StatusOr<std::optional<IndexRow>> ReadIndexRow(
+    const Index* index, absl::Span<const Column* const> base_columns,
+    const Key& key, absl::Time timestamp, Storage* storage) {
+  ValueList values;
+  absl::Status status =
+      storage->Lookup(timestamp, index->indexed_table()->id(), key,
+                      GetColumnIDs(base_columns), &values);
+  if (absl::IsNotFound(status)) {
+    return std::nullopt;
+  }
+  ZETASQL_RETURN_IF_ERROR(status);
+  return ComputeIndexRow(index, base_columns,
+                         BaseRowValues(base_columns, std::move(values)));
+}
+
+}  // namespace
+
 absl::Status BackfillIndexAddedColumn(const Index* index,
                                       const Column* added_column,
                                       const SchemaValidationContext* context) {
@@ -99,12 +275,12 @@ absl::Status BackfillIndexAddedColumn(const Index* index,
 
 absl::Status BackfillIndex(const Index* index,
                            const SchemaValidationContext* context) {
-  absl::Span<const Column* const> base_columns =
-      index->indexed_table()->columns();
-  absl::Span<const Column* const> index_columns =
-      index->index_data_table()->columns();
+  // Only the columns of the indexed table which the index data table is
+  // computed from are read.
+  std::vector<const Column*> base_columns = IndexBaseColumns(index);
   std::vector<ColumnID> base_column_ids = GetColumnIDs(base_columns);
-  std::vector<ColumnID> index_column_ids = GetColumnIDs(index_columns);
+  std::vector<ColumnID> index_column_ids =
+      GetColumnIDs(index->index_data_table()->columns());
 
   // TODO: Use actions framework for index backfills.
   std::unique_ptr<StorageIterator> itr;
@@ -112,47 +288,166 @@ absl::Status BackfillIndex(const Index* index,
       context->pending_commit_timestamp(), index->indexed_table()->id(),
       KeyRange::All(), base_column_ids, &itr));
 
-  // List of index keys used for verifying index uniqueness.
-  std::set<Key> index_keys;
+  // Split the table into chunks of consecutive rows, and hand each chunk to
+  // the workers as soon as it is read. Each worker computes a sorted run of
+  // index rows from each chunk it takes. Workers are started as chunks are
+  // read, so that a small table is backfilled by a single worker.
+  const int num_workers = NumBackfillWorkers();
+  BackfillChunkQueue queue(/*capacity=*/2 * num_workers);
+  // Runs are added as chunks are read; a deque does not move them, so that the
+  // workers can fill them in the meantime.
+  std::deque<SortedRun> runs;
+  std::vector<std::thread> workers;
+  workers.reserve(num_workers);
+  auto compute_runs = [&]() {
+    BackfillChunk chunk;
+    while (queue.Pop(&chunk)) {
+      chunk.run->status = ComputeSortedRun(index, base_columns, chunk.rows,
+                                           &chunk.run->rows);
+      // The values of the chunk are no longer needed.
+      chunk = BackfillChunk();
+    }
+  };
+  BackfillChunk chunk;
+  auto push_chunk = [&]() {
+    chunk.run = &runs.emplace_back();
+    if (workers.size() < num_workers) {
+      workers.emplace_back(compute_runs);
+    }
+    queue.Push(std::move(chunk));
+    chunk = BackfillChunk();
+  };
   while (itr->Next()) {
-    std::vector<zetasql::Value> row_values;
+    if (chunk.rows.empty()) {
+      chunk.rows.reserve(kBackfillChunkRows);
+    }
+    ValueList row_values;
     row_values.reserve(itr->NumColumns());
     for (int i = 0; i < itr->NumColumns(); ++i) {
-      // Storage returns invalid values if a value is not present, in which case
-      // we convert it into a typed NULL.
-      row_values.emplace_back(
-          itr->ColumnValue(i).is_valid()
-              ? itr->ColumnValue(i)
-              : zetasql::Value::Null(base_columns[i]->GetType()));
+      row_values.push_back(itr->ColumnValue(i));
+    }
+    chunk.rows.push_back(BaseRowValues(base_columns, std::move(row_values)));
+    if (chunk.rows.size() == kBackfillChunkRows) {
+      push_chunk();
     }
+  }
+  if (!chunk.rows.empty()) {
+    push_chunk();
+  }
+  queue.Close();
+  for (std::thread& worker : workers) {
+    worker.join();
+  }
+  ZETASQL_RETURN_IF_ERROR(itr->Status());
+  for (const SortedRun& run : runs) {
+    ZETASQL_RETURN_IF_ERROR(run.status);
+  }
 
-    // Compute the index key and column values.
-    Row base_row = MakeRow(base_columns, row_values);
-    // Backfill should return failed precondition error for invalid index keys.
-    ZETASQL_ASSIGN_OR_RETURN(Key index_data_table_key, ComputeIndexKey(base_row, index),
-                     _.SetErrorCode(absl::StatusCode::kFailedPrecondition));
-    ValueList index_values = ComputeIndexValues(base_row, index);
-    if (ShouldFilterIndexKeyOrValue(index, index_data_table_key, base_row)) {
-      continue;
+  // Merge the runs into the index rows in key order, in which the rows with
+  // the same index key are adjacent, and write them in a single batch.
+  using RunPosition = std::pair<int, int>;
+  auto greater_key = [&](const RunPosition& a, const RunPosition& b) {
+    return runs[b.first].rows[b.second].key < runs[a.first].rows[a.second].key;
+  };
+  std::priority_queue<RunPosition, std::vector<RunPosition>,
+                      decltype(greater_key)>
+      positions(greater_key);
+  int64_t num_index_rows = 0;
+  for (int i = 0; i < runs.size(); ++i) {
+    if (!runs[i].rows.empty()) {
+      positions.push({i, 0});
+      num_index_rows += runs[i].rows.size();
+    }
+  }
+  std::vector<StorageWriteOp> ops;
+  ops.reserve(num_index_rows);
+  const int num_key_columns = index->key_columns().size();
+  while (!positions.empty()) {
+    auto [run, row] = positions.top();
+    positions.pop();
+    IndexRow& index_row = runs[run].rows[row];
+    if (row + 1 < runs[run].rows.size()) {
+      positions.push({run, row + 1});
     }
 
     // Check uniqueness constraints.
-    if (index->is_unique()) {
-      Key index_key = index_data_table_key.Prefix(index->key_columns().size());
-      if (index_keys.find(index_key) != index_keys.end()) {
+    if (index->is_unique() && !ops.empty()) {
+      Key index_key = index_row.key.Prefix(num_key_columns);
+      if (ops.back().key.Prefix(num_key_columns) == index_key) {
         return error::UniqueIndexViolationOnIndexCreation(
             index->Name(), index_key.DebugString());
       }
-      // Add key to current list of index keys.
-      index_keys.insert(index_key);
     }
+    ops.push_back(StorageWriteOp{.table_id = index->index_data_table()->id(),
+                                 .key = std::move(index_row.key),
+                                 .column_ids = index_column_ids,
+                                 .values = std::move(index_row.values)});
+  }
+  return context->storage()->ApplyBatch(context->pending_commit_timestamp(),
+                                        std::move(ops));
+}
 
-    // Insert the new row in the index.
-    ZETASQL_RETURN_IF_ERROR(context->storage()->Write(
-        context->pending_commit_timestamp(), index->index_data_table()->id(),
-        index_data_table_key, index_column_ids, index_values));
+absl::Status CatchUpIndex(const Index* index, absl::Span<const Key> keys,
+                          absl::Time backfill_timestamp, absl::Time timestamp,
+                          Storage* storage) {
+  std::vector<const Column*> base_columns = IndexBaseColumns(index);
+  const TableID& index_data_table_id = index->index_data_table()->id();
+  std::vector<ColumnID> index_column_ids =
+      GetColumnIDs(index->index_data_table()->columns());
+
+  // Replace the index row computed from each row at the backfill timestamp by
+  // the one computed from the row at 'timestamp'. All the stale index rows are
+  // deleted before the new ones are written, since a row may take the index
+  // key another row had at the backfill timestamp.
+  std::vector<StorageWriteOp> deletes;
+  std::vector<StorageWriteOp> writes;
+  for (const Key& key : keys) {
+    ZETASQL_ASSIGN_OR_RETURN(
+        std::optional<IndexRow> stale_row,
+        ReadIndexRow(index, base_columns, key, backfill_timestamp, storage));
+    if (stale_row.has_value()) {
+      deletes.push_back(StorageWriteOp{.table_id = index_data_table_id,
+                                       .key = std::move(stale_row->key),
+                                       .is_delete = true});
+    }
+    ZETASQL_ASSIGN_OR_RETURN(
+        std::optional<IndexRow> index_row,
+        ReadIndexRow(index, base_columns, key, timestamp, storage));
+    if (index_row.has_value()) {
+      writes.push_back(StorageWriteOp{.table_id = index_data_table_id,
+                                      .key = std::move(index_row->key),
+                                      .column_ids = index_column_ids,
+                                      .values = std::move(index_row->values)});
+    }
   }
+  std::vector<Key> written_keys;
+  if (index->is_unique()) {
+    for (const StorageWriteOp& write : writes) {
+      written_keys.push_back(write.key);
+    }
+  }
+  deletes.insert(deletes.end(), std::make_move_iterator(writes.begin()),
+                 std::make_move_iterator(writes.end()));
+  ZETASQL_RETURN_IF_ERROR(storage->ApplyBatch(timestamp, std::move(deletes)));
 
+  // Rows which were not written since the backfill kept their index rows, so
+  // only the index keys written need to be checked for uniqueness.
+  const int num_key_columns = index->key_columns().size();
+  for (const Key& written_key : written_keys) {
+    Key index_key = written_key.Prefix(num_key_columns);
+    std::unique_ptr<StorageIterator> itr;
+    ZETASQL_RETURN_IF_ERROR(storage->Read(timestamp, index_data_table_id,
+                                  KeyRange::Prefix(index_key),
+                                  /*column_ids=*/{}, &itr));
+    int num_rows = 0;
+    while (itr->Next()) {
+      if (++num_rows > 1) {
+        return error::UniqueIndexViolationOnIndexCreation(
+            index->Name(), index_key.DebugString());
+      }
+    }
+    ZETASQL_RETURN_IF_ERROR(itr->Status());
+  }
   return absl::OkStatus();
 }
 
@@ -17,8 +17,12 @@
 #ifndef THIRD_PARTY_CLOUD_SPANNER_EMULATOR_BACKEND_SCHEMA_UPDATER_BACKFILL_BACKFILL_H_
 #define THIRD_PARTY_CLOUD_SPANNER_EMULATOR_BACKEND_SCHEMA_UPDATER_BACKFILL_BACKFILL_H_
 
+#include "absl/time/time.h"
+#include "absl/types/span.h"
+#include "backend/datamodel/key.h"
 #include "backend/schema/catalog/index.h"
 #include "backend/schema/updater/schema_validation_context.h"
+#include "backend/storage/storage.h"
 #include "absl/status/status.h"
 
 namespace google {
@@ -35,6 +39,14 @@ absl::Status BackfillIndexAddedColumn(const Index* index,
                                       const Column* added_column,
                                       const SchemaValidationContext* context);
 
+// Catches up the data of a newly created index, which was backfilled at
+// 'backfill_timestamp', with the rows of the indexed table with 'keys' which
+// were written since, and writes the changes at 'timestamp'. Returns an error
+// if the rows written violate the uniqueness of the index.
+absl::Status CatchUpIndex(const Index* index, absl::Span<const Key> keys,
+                          absl::Time backfill_timestamp, absl::Time timestamp,
+                          Storage* storage);
+
 }  // namespace backend
 }  // namespace emulator
 }  // namespace spanner
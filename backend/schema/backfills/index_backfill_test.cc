@@ -16,8 +16,11 @@
 
 #include "backend/schema/backfills/index_backfill.h"
 
+#include <algorithm>
+#include <atomic>
 #include <memory>
 #include <string>
+#include <thread>  // NOLINT
 #include <utility>
 #include <vector>
 
@@ -27,11 +30,14 @@
 #include "tests/common/proto_matchers.h"
 #include "absl/status/status.h"
 #include "absl/status/statusor.h"
+#include "absl/strings/str_format.h"
 #include "absl/time/time.h"
 #include "absl/types/span.h"
 #include "backend/access/read.h"
 #include "backend/access/write.h"
 #include "backend/database/database.h"
+#include "backend/datamodel/key.h"
+#include "backend/datamodel/key_set.h"
 #include "backend/datamodel/value.h"
 #include "backend/schema/catalog/schema.h"
 #include "backend/schema/updater/schema_updater.h"
@@ -244,6 +250,101 @@ TEST(BackfillTest, BackfillUniqueIndex) {
                 "TestIndex", R"({String("value")↓})"));
 }
 
+TEST(BackfillTest, BackfillsTablesLargerThanAChunk) {
+  ZETASQL_ASSERT_OK_AND_ASSIGN(DbInfo db_info, CreateTestDb({kCreateTestTable}));
+  constexpr int kNumRows = 10000;
+  std::vector<ValueList> rows;
+  std::vector<ValueList> expected_index_rows;
+  for (int i = 0; i < kNumRows; ++i) {
+    // The first and last rows have the same extra_string_col.
+    rows.push_back(
+        {Int64(i), String(absl::StrFormat("value%05d", i)),
+         String(absl::StrFormat("extra%05d", i == kNumRows - 1 ? 0 : i))});
+    expected_index_rows.push_back(
+        {String(absl::StrFormat("value%05d", kNumRows - 1 - i)),
+         Int64(kNumRows - 1 - i)});
+  }
+  ZETASQL_ASSERT_OK(InsertValues(db_info, "TestTable",
+                         {"int64_col", "string_col", "extra_string_col"},
+                         rows));
+
+  ZETASQL_ASSERT_OK(UpdateSchema(db_info, {R"(
+                            CREATE UNIQUE INDEX TestIndex ON
+                            TestTable(string_col DESC)
+                    )"}));
+  EXPECT_THAT(
+      ReadAllRows(db_info, ReadArg{.table = "TestTable",
+                                   .index = "TestIndex",
+                                   .columns = {"string_col", "int64_col"}}),
+      IsOkAndHolds(ElementsAreArray(expected_index_rows)));
+
+  // Duplicates are found across the chunks of the table.
+  EXPECT_EQ(UpdateSchema(db_info, {R"(
+                            CREATE UNIQUE INDEX AnotherIndex ON
+                            TestTable(extra_string_col)
+                    )"}),
+            error::UniqueIndexViolationOnIndexCreation(
+                "AnotherIndex", R"({String("extra00000")})"));
+}
+
+TEST(BackfillTest, CatchesUpWithWritesDuringTheBackfill) {
+  ZETASQL_ASSERT_OK_AND_ASSIGN(DbInfo db_info, CreateTestDb({kCreateTestTable}));
+  constexpr int kNumRows = 10000;
+  std::vector<ValueList> rows;
+  for (int i = 0; i < kNumRows; ++i) {
+    rows.push_back({Int64(i), String(absl::StrFormat("value%05d", i))});
+  }
+  ZETASQL_ASSERT_OK(
+      InsertValues(db_info, "TestTable", {"int64_col", "string_col"}, rows));
+
+  // Update, insert and delete rows while the index is created. Transactions
+  // aborted by the schema change are not retried.
+  std::atomic<bool> done = false;
+  std::thread writer([&]() {
+    for (int i = 0; !done && 2 * i + 1 < kNumRows; ++i) {
+      absl::StatusOr<std::unique_ptr<ReadWriteTransaction>> txn =
+          db_info.database->CreateReadWriteTransaction(ReadWriteOptions(),
+                                                       RetryState());
+      ASSERT_TRUE(txn.ok());
+      Mutation m;
+      m.AddWriteOp(MutationOpType::kUpdate, "TestTable",
+                   {"int64_col", "string_col"},
+                   {{Int64(2 * i + 1), String(absl::StrFormat("new%05d", i))}});
+      m.AddWriteOp(MutationOpType::kInsert, "TestTable",
+                   {"int64_col", "string_col"},
+                   {{Int64(kNumRows + i), String("inserted")}});
+      m.AddDeleteOp("TestTable", KeySet(Key({Int64(2 * i)})));
+      if ((*txn)->Write(m).ok()) {
+        (*txn)->Commit().IgnoreError();
+      }
+    }
+  });
+  absl::Status status = UpdateSchema(db_info, {R"(
+                            CREATE INDEX TestIndex ON
+                            TestTable(string_col)
+                    )"});
+  done = true;
+  writer.join();
+  ZETASQL_ASSERT_OK(status);
+
+  // The index has the rows of the table as of the schema change and the writes
+  // which followed it.
+  ZETASQL_ASSERT_OK_AND_ASSIGN(
+      std::vector<ValueList> expected_index_rows,
+      ReadAllRows(db_info, ReadArg{.table = "TestTable",
+                                   .columns = {"string_col", "int64_col"}}));
+  std::sort(expected_index_rows.begin(), expected_index_rows.end(),
+            [](const ValueList& a, const ValueList& b) {
+              return std::make_pair(a[0].string_value(), a[1].int64_value()) <
+                     std::make_pair(b[0].string_value(), b[1].int64_value());
+            });
+  EXPECT_THAT(
+      ReadAllRows(db_info, ReadArg{.table = "TestTable",
+                                   .index = "TestIndex",
+                                   .columns = {"string_col", "int64_col"}}),
+      IsOkAndHolds(ElementsAreArray(expected_index_rows)));
+}
+
 TEST(BackfillTest, AlterIndexDropColumn) {
   ZETASQL_ASSERT_OK_AND_ASSIGN(DbInfo db_info, CreateTestDb({kCreateTestTable}));
   ZETASQL_ASSERT_OK(InsertValues(
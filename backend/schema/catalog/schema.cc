@@ -16,7 +16,9 @@
 
 #include "backend/schema/catalog/schema.h"
 
+#include <atomic>
 #include <cstddef>
+#include <cstdint>
 #include <memory>
 #include <string>
 #include <utility>
@@ -691,11 +693,17 @@ ddl::DDLStatementList Schema::Dump() const {
   return ddl_statements;
 }
 
+int64_t Schema::NextGeneration() {
+  static std::atomic<int64_t> next_generation{1};
+  return next_generation.fetch_add(1);
+}
+
 Schema::Schema(const SchemaGraph* graph,
                std::shared_ptr<const ProtoBundle> proto_bundle,
                const database_api::DatabaseDialect& dialect,
                std::string_view database_id)
     : graph_(graph),
+      generation_(NextGeneration()),
       proto_bundle_(proto_bundle),
       dialect_(dialect),
       database_id_(database_id) {
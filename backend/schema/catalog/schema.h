@@ -59,6 +59,7 @@ class Schema {
  public:
   Schema()
       : graph_(SchemaGraph::CreateEmpty()),
+        generation_(NextGeneration()),
         proto_bundle_(ProtoBundle::CreateEmpty()),
         dialect_(database_api::DatabaseDialect::GOOGLE_STANDARD_SQL),
         // Only populated for PostgreSQL databases (mirrors production)
@@ -71,7 +72,9 @@ class Schema {
 
   virtual ~Schema() = default;
 
-  // Returns the generation number of this schema.
+  // Returns the generation number of this schema. Generation numbers are
+  // unique within the process and increase with every schema created, so a
+  // newer schema of a database always has a larger generation number.
   int64_t generation() const { return generation_; }
 
   // Dumps the schema to ddl::DDLStatementList.
@@ -278,6 +281,9 @@ class Schema {
   // in which the nodes were added to the graph. Must outlive *this.
   const SchemaGraph* graph_;
 
+  // Returns the generation number for a new schema.
+  static int64_t NextGeneration();
+
   // The generation number of this schema.
   int64_t generation_ = 0;
 
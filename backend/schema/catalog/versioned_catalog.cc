@@ -16,10 +16,13 @@
 
 #include "backend/schema/catalog/versioned_catalog.h"
 
+#include <algorithm>
 #include <cstdint>
 #include <memory>
 #include <utility>
+#include <vector>
 
+#include "absl/container/flat_hash_set.h"
 #include "absl/log/log.h"
 #include "absl/status/status.h"
 #include "absl/status/statusor.h"
@@ -29,6 +32,9 @@
 #include "absl/time/time.h"
 #include "backend/common/utils.h"
 #include "backend/schema/catalog/schema.h"
+#include "backend/schema/graph/schema_graph.h"
+#include "backend/schema/graph/schema_node.h"
+#include "backend/schema/graph/schema_objects_pool.h"
 #include "zetasql/base/ret_check.h"
 
 namespace google {
@@ -71,10 +77,15 @@ VersionedCatalog::VersionedCatalog(
 }
 
 const Schema* VersionedCatalog::GetSchema(absl::Time timestamp) const {
+  return PinSchema(timestamp).get();
+}
+
+std::shared_ptr<const Schema> VersionedCatalog::PinSchema(
+    absl::Time timestamp) const {
   absl::MutexLock lock(&mu_);
   auto itr = schemas_.upper_bound(timestamp);
   itr--;
-  return itr->second.get();
+  return itr->second;
 }
 
 const Schema* VersionedCatalog::GetLatestSchema() const {
@@ -109,8 +120,52 @@ void VersionedCatalog::RemoveExpiredSchemas(absl::Time timestamp) {
       // The current schema needs to be kept to cover the retention period.
       break;
     }
+    removed_schemas_.push_back(it->second);
     it = schemas_.erase(it);
   }
+
+  // Forget the removed schemas which are no longer pinned.
+  removed_schemas_.erase(
+      std::remove_if(removed_schemas_.begin(), removed_schemas_.end(),
+                     [](const std::weak_ptr<const Schema>& schema) {
+                       return schema.expired();
+                     }),
+      removed_schemas_.end());
+}
+
+SchemaVersionStats VersionedCatalog::GetSchemaVersionStats() const {
+  std::vector<std::shared_ptr<const Schema>> schemas;
+  SchemaVersionStats stats;
+  {
+    absl::MutexLock lock(&mu_);
+    for (const auto& [creation_time, schema] : schemas_) {
+      schemas.push_back(schema);
+    }
+    stats.num_versions = schemas.size();
+    for (const auto& removed_schema : removed_schemas_) {
+      if (std::shared_ptr<const Schema> schema = removed_schema.lock()) {
+        schemas.push_back(std::move(schema));
+        ++stats.num_pinned_versions;
+      }
+    }
+  }
+
+  // Count the objects outside of the lock, as versions may have many objects.
+  absl::flat_hash_set<const SchemaNode*> schema_objects;
+  absl::flat_hash_set<const SchemaObjectsPool*> pools;
+  for (const auto& schema : schemas) {
+    const SchemaGraph* graph = schema->GetSchemaGraph();
+    for (const SchemaNode* node : graph->GetSchemaNodes()) {
+      schema_objects.insert(node);
+    }
+    for (const SchemaObjectsPool* pool : graph->GetPools()) {
+      if (pools.insert(pool).second) {
+        stats.used_bytes += pool->EstimatedSizeBytes();
+      }
+    }
+  }
+  stats.num_schema_objects = schema_objects.size();
+  return stats;
 }
 
 }  // namespace backend
@@ -17,8 +17,10 @@
 #ifndef THIRD_PARTY_CLOUD_SPANNER_EMULATOR_BACKEND_SCHEMA_CATALOG_VERSIONED_CATALOG_H_
 #define THIRD_PARTY_CLOUD_SPANNER_EMULATOR_BACKEND_SCHEMA_CATALOG_VERSIONED_CATALOG_H_
 
+#include <cstdint>
 #include <map>
 #include <memory>
+#include <vector>
 
 #include "absl/base/thread_annotations.h"
 #include "absl/status/status.h"
@@ -31,8 +33,31 @@ namespace spanner {
 namespace emulator {
 namespace backend {
 
+// Statistics of the schema versions held in memory by a VersionedCatalog.
+struct SchemaVersionStats {
+  // Number of schema versions in the catalog.
+  int64_t num_versions = 0;
+
+  // Number of schema versions removed from the catalog which are still pinned.
+  int64_t num_pinned_versions = 0;
+
+  // Number of distinct schema objects held by the versions above. Objects
+  // shared by several versions are counted once.
+  int64_t num_schema_objects = 0;
+
+  // Estimated memory used by the schema objects of the versions above, in
+  // bytes. This includes the objects of earlier versions which are no longer
+  // used but are kept alive along with the objects shared with them.
+  int64_t used_bytes = 0;
+};
+
 // VersionedCatalog owns schemas that belongs to a single database, and keep a
 // mapping between the schema creation time and the schema object.
+//
+// Schemas which are no longer needed to cover the version retention period are
+// removed by RemoveExpiredSchemas(). Transactions which may use a schema after
+// it is removed pin it with PinSchema(), so that its memory is reclaimed when
+// the last pin is released.
 class VersionedCatalog {
  public:
   // The default constructor creates an empty schema in the catalog and assigns
@@ -51,6 +76,11 @@ class VersionedCatalog {
   // GetSchema never returns a nullptr.
   const Schema* GetSchema(absl::Time timestamp) const ABSL_LOCKS_EXCLUDED(mu_);
 
+  // Same as GetSchema, but the returned schema stays valid for as long as the
+  // returned pointer, even if it is removed from the catalog.
+  std::shared_ptr<const Schema> PinSchema(absl::Time timestamp) const
+      ABSL_LOCKS_EXCLUDED(mu_);
+
   // Returns the latest schema object in the catalog. Will return the first
   // schema initialized if there are no subsequent new schema. Therefore,
   // GetLatestSchema never returns a nullptr.
@@ -63,8 +93,14 @@ class VersionedCatalog {
                          std::unique_ptr<const Schema> schema)
       ABSL_LOCKS_EXCLUDED(mu_);
 
+  // Removes the schemas which are not needed to cover the version retention
+  // period as of 'timestamp'. Removed schemas which are pinned are freed when
+  // their last pin is released.
   void RemoveExpiredSchemas(absl::Time timestamp) ABSL_LOCKS_EXCLUDED(mu_);
 
+  // Returns statistics of the schema versions held in memory.
+  SchemaVersionStats GetSchemaVersionStats() const ABSL_LOCKS_EXCLUDED(mu_);
+
   absl::Duration version_retention_period() const {
     absl::MutexLock lock(&mu_);
     return version_retention_period_;
@@ -82,7 +118,11 @@ class VersionedCatalog {
   // Note that this cannot be changed into a hash map (e.g. std::unordered_map)
   // because the lookup of schemas by creation timestamp depends on the ordering
   // of keys in this map.
-  std::map<absl::Time, std::unique_ptr<const Schema>> schemas_
+  std::map<absl::Time, std::shared_ptr<const Schema>> schemas_
+      ABSL_GUARDED_BY(mu_);
+
+  // Schemas removed from the catalog which may still be pinned.
+  std::vector<std::weak_ptr<const Schema>> removed_schemas_
       ABSL_GUARDED_BY(mu_);
 
   // The retention period for schema versions.
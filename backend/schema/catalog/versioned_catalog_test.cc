@@ -128,6 +128,37 @@ TEST(VersionedCatalogTest, ExpiredSchemasThatCoverRetentionPeriodAreKept) {
   EXPECT_EQ(catalog.GetSchema(t0), catalog.GetSchema(absl::InfinitePast()));
 }
 
+TEST(VersionedCatalogTest, PinnedSchemasOutliveTheirRemoval) {
+  VersionedCatalog catalog;
+  absl::Time t0 = absl::Now();
+  absl::Time t1 = t0 + absl::Minutes(10);
+  absl::Time t2 = t1 + absl::Minutes(10);
+  ZETASQL_EXPECT_OK(catalog.AddSchema(t0, std::make_unique<const Schema>()));
+  ZETASQL_EXPECT_OK(catalog.AddSchema(t1, std::make_unique<const Schema>()));
+  ZETASQL_EXPECT_OK(catalog.AddSchema(t2, std::make_unique<const Schema>()));
+  std::shared_ptr<const Schema> pinned = catalog.PinSchema(t0);
+  EXPECT_EQ(pinned.get(), catalog.GetSchema(t0));
+
+  SchemaVersionStats stats = catalog.GetSchemaVersionStats();
+  EXPECT_EQ(stats.num_versions, 4);
+  EXPECT_EQ(stats.num_pinned_versions, 0);
+
+  // The schemas created at t0 and t1 are no longer needed to cover the
+  // retention period, but the one created at t0 is still pinned.
+  catalog.RemoveExpiredSchemas(t2 + absl::Hours(1));
+  EXPECT_EQ(catalog.GetSchema(t0), catalog.GetSchema(absl::InfinitePast()));
+  stats = catalog.GetSchemaVersionStats();
+  EXPECT_EQ(stats.num_versions, 2);
+  EXPECT_EQ(stats.num_pinned_versions, 1);
+
+  pinned.reset();
+  stats = catalog.GetSchemaVersionStats();
+  EXPECT_EQ(stats.num_versions, 2);
+  EXPECT_EQ(stats.num_pinned_versions, 0);
+  EXPECT_EQ(stats.num_schema_objects, 0);
+  EXPECT_EQ(stats.used_bytes, 0);
+}
+
 }  // namespace
 }  // namespace backend
 }  // namespace emulator
@@ -17,8 +17,14 @@
 #ifndef THIRD_PARTY_CLOUD_SPANNER_EMULATOR_BACKEND_SCHEMA_GRAPH_SCHEMA_GRAPH_H_
 #define THIRD_PARTY_CLOUD_SPANNER_EMULATOR_BACKEND_SCHEMA_GRAPH_SCHEMA_GRAPH_H_
 
+#include <cstdint>
 #include <memory>
+#include <utility>
+#include <vector>
 
+#include "absl/container/flat_hash_map.h"
+#include "absl/container/flat_hash_set.h"
+#include "absl/types/span.h"
 #include "backend/schema/graph/schema_node.h"
 #include "backend/schema/graph/schema_objects_pool.h"
 
@@ -29,7 +35,14 @@ namespace backend {
 
 class SchemaGraph {
  public:
-  SchemaGraph() : pool_(std::make_unique<SchemaObjectsPool>()) {}
+  // For each node of a graph, the nodes of the graph which hold references to
+  // it.
+  using Dependents =
+      absl::flat_hash_map<const SchemaNode*, std::vector<const SchemaNode*>>;
+
+  SchemaGraph()
+      : pool_(std::make_shared<SchemaObjectsPool>()),
+        dependents_(std::make_shared<const DependentsLayer>()) {}
 
   // Constructor for creating a graph from an externally-maintained list of
   // nodes.
@@ -37,17 +50,85 @@ class SchemaGraph {
               std::unique_ptr<SchemaObjectsPool> pool)
       : schema_nodes_(std::move(schema_nodes)), pool_(std::move(pool)) {}
 
+  // Constructor for creating a graph which shares nodes with 'base'. The nodes
+  // in 'schema_nodes' are either owned by 'pool' or by the pools of 'base',
+  // which are kept alive for as long as this graph.
+  SchemaGraph(std::vector<const SchemaNode*> schema_nodes,
+              std::unique_ptr<SchemaObjectsPool> pool, const SchemaGraph& base)
+      : schema_nodes_(std::move(schema_nodes)),
+        pool_(std::move(pool)),
+        shared_pools_(base.shared_pools_) {
+    shared_pools_.push_back(base.pool_);
+  }
+
   // Get a list of all the nodes in the graph in the order in which they were
   // added.
   absl::Span<const SchemaNode* const> GetSchemaNodes() const {
     return schema_nodes_;
   }
 
-  // Adds a new node to the graph.
+  // Adds a new node to the graph. The dependents of the nodes are no longer
+  // known afterwards.
   void Add(std::unique_ptr<const SchemaNode> node_ptr) {
     const SchemaNode* node = node_ptr.get();
     schema_nodes_.push_back(node);
     pool_->Add(std::move(node_ptr));
+    dependents_.reset();
+  }
+
+  // Returns true if the dependents of the nodes of the graph are known.
+  bool has_dependents() const { return dependents_ != nullptr; }
+
+  // Returns the nodes which hold references to 'node', or null if there are
+  // none. The returned nodes may include nodes which are not in the graph, and
+  // which must be ignored. Requires has_dependents().
+  const std::vector<const SchemaNode*>* GetDependents(
+      const SchemaNode* node) const {
+    for (const DependentsLayer* layer = dependents_.get(); layer != nullptr;
+         layer = layer->base.get()) {
+      auto it = layer->dependents.find(node);
+      if (it != layer->dependents.end()) {
+        return &it->second;
+      }
+    }
+    return nullptr;
+  }
+
+  // Sets the dependents of the nodes of the graph. If 'base' is not null,
+  // 'dependents' only holds the nodes whose dependents differ from those in
+  // 'base', which this graph shares nodes with.
+  void SetDependents(Dependents dependents, const SchemaGraph* base) {
+    auto layer = std::make_shared<DependentsLayer>();
+    layer->dependents = std::move(dependents);
+    if (base != nullptr && base->dependents_ != nullptr) {
+      layer->base = base->dependents_;
+      layer->depth = base->dependents_->depth + 1;
+    }
+    dependents_ = std::move(layer);
+    if (dependents_->depth >= kMaxDependentsLayers) {
+      FlattenDependents();
+    }
+  }
+
+  // Returns the number of nodes owned by the pools which keep the nodes of the
+  // graph alive. This includes the nodes of earlier graphs which this graph
+  // no longer shares, but whose pools it still shares.
+  int64_t num_pooled_nodes() const {
+    int64_t num_pooled_nodes = pool_->size();
+    for (const auto& pool : shared_pools_) {
+      num_pooled_nodes += pool->size();
+    }
+    return num_pooled_nodes;
+  }
+
+  // Returns the pools which keep the nodes of the graph alive, including the
+  // pools shared with earlier graphs.
+  std::vector<const SchemaObjectsPool*> GetPools() const {
+    std::vector<const SchemaObjectsPool*> pools = {pool_.get()};
+    for (const auto& pool : shared_pools_) {
+      pools.push_back(pool.get());
+    }
+    return pools;
   }
 
   // A schema graph with no nodes.
@@ -61,7 +142,46 @@ class SchemaGraph {
   std::vector<const SchemaNode*> schema_nodes_;
 
   // Pool for managing the lifetime of the nodes in the graph.
-  std::unique_ptr<SchemaObjectsPool> pool_;
+  std::shared_ptr<SchemaObjectsPool> pool_;
+
+  // Pools of the graphs this graph shares nodes with.
+  std::vector<std::shared_ptr<const SchemaObjectsPool>> shared_pools_;
+
+  // The dependents of the nodes of a graph which differ from those in the
+  // graph it shares nodes with.
+  struct DependentsLayer {
+    Dependents dependents;
+    std::shared_ptr<const DependentsLayer> base;
+    int depth = 0;
+  };
+
+  // The number of layers of dependents after which they are merged into one,
+  // which bounds the cost of looking them up.
+  static constexpr int kMaxDependentsLayers = 8;
+
+  // Merges the layers of dependents, dropping the nodes which are not in the
+  // graph.
+  void FlattenDependents() {
+    absl::flat_hash_set<const SchemaNode*> nodes(schema_nodes_.begin(),
+                                                 schema_nodes_.end());
+    auto layer = std::make_shared<DependentsLayer>();
+    for (const SchemaNode* node : schema_nodes_) {
+      const std::vector<const SchemaNode*>* dependents = GetDependents(node);
+      if (dependents == nullptr) {
+        continue;
+      }
+      std::vector<const SchemaNode*>& flattened = layer->dependents[node];
+      for (const SchemaNode* dependent : *dependents) {
+        if (nodes.contains(dependent)) {
+          flattened.push_back(dependent);
+        }
+      }
+    }
+    dependents_ = std::move(layer);
+  }
+
+  // The dependents of the nodes, or null if they are not known.
+  std::shared_ptr<const DependentsLayer> dependents_;
 };
 
 }  // namespace backend
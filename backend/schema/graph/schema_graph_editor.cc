@@ -44,23 +44,106 @@ SchemaNode* SchemaGraphEditor::MakeNewClone(const SchemaNode* node) {
   return mutable_clone;
 }
 
-absl::Status SchemaGraphEditor::InitCloneMap() {
-  // First, make a clone of the graph.
-  ZETASQL_VLOG(2) << "First cloning pass";
-  for (const auto* schema_node : original_graph_->GetSchemaNodes()) {
-    ZETASQL_ASSIGN_OR_RETURN(const auto* cloned_node, Clone(schema_node));
-    new_nodes_.push_back(cloned_node);
+absl::Status SchemaGraphEditor::CloneWithDependents(const SchemaNode* node) {
+  // Find the nodes which reference 'node' directly or indirectly, and which
+  // are not cloned yet.
+  std::vector<const SchemaNode*> new_nodes_to_clone;
+  if (clone_all_nodes_) {
+    for (const auto* original : original_graph_->GetSchemaNodes()) {
+      if (nodes_to_clone_.insert(original).second) {
+        new_nodes_to_clone.push_back(original);
+      }
+    }
+  } else if (nodes_to_clone_.insert(node).second) {
+    new_nodes_to_clone.push_back(node);
+    std::vector<const SchemaNode*> stack = {node};
+    while (!stack.empty()) {
+      const SchemaNode* current = stack.back();
+      stack.pop_back();
+      const auto* dependents = original_graph_->GetDependents(current);
+      if (dependents == nullptr) {
+        continue;
+      }
+      for (const SchemaNode* dependent : *dependents) {
+        if (IsOriginalNode(dependent) &&
+            nodes_to_clone_.insert(dependent).second) {
+          new_nodes_to_clone.push_back(dependent);
+          stack.push_back(dependent);
+        }
+      }
+    }
+  }
+
+  // Clone them in the order of the original graph. Cloning a node clones the
+  // other nodes to clone which it references, and shares the rest.
+  std::sort(new_nodes_to_clone.begin(), new_nodes_to_clone.end(),
+            [this](const SchemaNode* a, const SchemaNode* b) {
+              return original_node_index_.at(a) < original_node_index_.at(b);
+            });
+  ZETASQL_VLOG(2) << "Cloning " << new_nodes_to_clone.size() << " of "
+          << num_original_nodes() << " nodes";
+  for (const auto* original : new_nodes_to_clone) {
+    ZETASQL_RETURN_IF_ERROR(Clone(original).status());
   }
-  ZETASQL_RET_CHECK_EQ(clone_map_.size(), num_original_nodes());
   return absl::OkStatus();
 }
 
+std::vector<const SchemaNode*> SchemaGraphEditor::ClonedOriginalNodes() const {
+  std::vector<const SchemaNode*> cloned(nodes_to_clone_.begin(),
+                                        nodes_to_clone_.end());
+  std::sort(cloned.begin(), cloned.end(),
+            [this](const SchemaNode* a, const SchemaNode* b) {
+              return original_node_index_.at(a) < original_node_index_.at(b);
+            });
+  return cloned;
+}
+
+SchemaGraph::Dependents SchemaGraphEditor::NewGraphDependents() const {
+  SchemaGraph::Dependents dependents;
+  for (const auto& [node, references] : references_) {
+    if (node->is_deleted()) {
+      continue;
+    }
+    for (const SchemaNode* reference : references) {
+      if (reference->is_deleted()) {
+        continue;
+      }
+      auto [it, inserted] = dependents.try_emplace(reference);
+      // The dependents of a shared node are those in the original graph,
+      // less the cloned nodes, which are replaced by their references.
+      if (inserted && !clone_all_nodes_ && IsOriginalNode(reference)) {
+        const auto* original_dependents =
+            original_graph_->GetDependents(reference);
+        if (original_dependents != nullptr) {
+          for (const SchemaNode* dependent : *original_dependents) {
+            if (IsOriginalNode(dependent) &&
+                !nodes_to_clone_.contains(dependent)) {
+              it->second.push_back(dependent);
+            }
+          }
+        }
+      }
+      it->second.push_back(node);
+    }
+  }
+  for (auto& [node, node_dependents] : dependents) {
+    std::sort(node_dependents.begin(), node_dependents.end());
+    node_dependents.erase(
+        std::unique(node_dependents.begin(), node_dependents.end()),
+        node_dependents.end());
+  }
+  return dependents;
+}
+
 absl::Status SchemaGraphEditor::FixupInternal(const SchemaNode* original,
                                               SchemaNode* mutable_clone) {
   ZETASQL_VLOG(4) << std::string(depth_, ' ') << "Fixing "
           << NodeKindString(mutable_clone) << " node :" << mutable_clone;
   ++depth_;
+  references_[mutable_clone].clear();
+  fixup_stack_.push_back(mutable_clone);
   ZETASQL_RETURN_IF_ERROR(mutable_clone->DeepClone(this, original));
+  fixup_stack_.pop_back();
   --depth_;
   ZETASQL_VLOG(4) << std::string(depth_, ' ')
           << "Finished fixing node: " << mutable_clone->DebugString();
@@ -83,6 +166,7 @@ absl::StatusOr<const SchemaNode*> SchemaGraphEditor::Clone(
 
   // During the delete_fixup_ phase, we don't do any recursive calls.
   if (delete_fixup_) {
+    RecordReference(node);
     return node;
   }
 
@@ -99,6 +183,11 @@ absl::StatusOr<const SchemaNode*> SchemaGraphEditor::Clone(
     clone_map_[node] = node;
     ZETASQL_RETURN_IF_ERROR(FixupInternal(node, mutable_node));
     ret = node;
+  } else if (!nodes_to_clone_.contains(node)) {
+    // Nodes shared with the original graph neither reference edited nor
+    // deleted nodes, so they need no fixup.
+    ZETASQL_RET_CHECK_EQ(kind, kOriginal);
+    ret = node;
   } else {
     ZETASQL_RET_CHECK_EQ(kind, kOriginal);
     ZETASQL_RET_CHECK(!node->is_deleted());
@@ -111,16 +200,24 @@ absl::StatusOr<const SchemaNode*> SchemaGraphEditor::Clone(
             << "Finished cloning node: " << node->DebugString();
     ret = mutable_clone;
   }
+  RecordReference(ret);
   return ret;
 }
 
+void SchemaGraphEditor::RecordReference(const SchemaNode* node) {
+  if (!fixup_stack_.empty()) {
+    references_[fixup_stack_.back()].push_back(node);
+  }
+}
+
 absl::Status SchemaGraphEditor::DeleteNode(const SchemaNode* node) {
   ZETASQL_RET_CHECK(edited_clones_.empty() && added_nodes_.empty())
       << "Graph already contains modifications. It must be canonicalized "
       << "before making further changes.";
   ZETASQL_RET_CHECK(IsOriginalNode(node));
   deleted_nodes_.emplace_back(node);
-  return absl::OkStatus();
+  deleted_node_set_.insert(node);
+  return CloneWithDependents(node);
 }
 
 absl::Status SchemaGraphEditor::AddNode(
@@ -128,17 +225,13 @@ absl::Status SchemaGraphEditor::AddNode(
   ZETASQL_RET_CHECK(deleted_nodes_.empty())
       << "Graph already has deleted nodes. It must be canonicalized before "
       << "making further changes.";
+  added_node_set_.insert(node.get());
   added_nodes_.emplace_back(std::move(node));
   return absl::OkStatus();
 }
 
 bool SchemaGraphEditor::IsOriginalNode(const SchemaNode* node) const {
-  for (const auto* schema_node : original_graph_->GetSchemaNodes()) {
-    if (schema_node == node) {
-      return true;
-    }
-  }
-  return false;
+  return original_node_index_.contains(node);
 }
 
 absl::StatusOr<std::unique_ptr<SchemaGraph>>
@@ -165,13 +258,22 @@ SchemaGraphEditor::CanonicalizeGraph() {
       std::remove_if(new_nodes_.begin(), new_nodes_.end(),
                      [](const SchemaNode* node) { return node->is_deleted(); }),
       new_nodes_.end());
-  cloned_graph = std::make_unique<SchemaGraph>(std::move(new_nodes_),
-                                               std::move(cloned_pool_));
+  SchemaGraph::Dependents dependents = NewGraphDependents();
+  const int num_cloned_nodes = nodes_to_clone_.size();
+  if (clone_all_nodes_) {
+    cloned_graph = std::make_unique<SchemaGraph>(std::move(new_nodes_),
+                                                 std::move(cloned_pool_));
+    cloned_graph->SetDependents(std::move(dependents), /*base=*/nullptr);
+  } else {
+    cloned_graph = std::make_unique<SchemaGraph>(
+        std::move(new_nodes_), std::move(cloned_pool_), *original_graph_);
+    cloned_graph->SetDependents(std::move(dependents), original_graph_);
+  }
   context_->MakeNewTempSchemaSnapshot(cloned_graph.get());
 
   // Validate the update on cloned nodes which still includes edited and
-  // deleted nodes.
-  for (const auto* orig_node : original_graph_->GetSchemaNodes()) {
+  // deleted nodes. Shared nodes are not updated.
+  for (const auto* orig_node : ClonedOriginalNodes()) {
     auto clone = FindClone(orig_node);
     ZETASQL_RET_CHECK_NE(clone, nullptr);
     ZETASQL_RETURN_IF_ERROR(clone->ValidateUpdate(orig_node, context_));
@@ -183,45 +285,58 @@ SchemaGraphEditor::CanonicalizeGraph() {
   }
 
   // Do a final pass on the canonicalized set of nodes to perform per-node
-  // validation.
+  // validation. Shared nodes, and the nodes they reference, are unchanged
+  // since they were validated as part of the original graph.
   for (const auto* node : cloned_graph->GetSchemaNodes()) {
+    if (IsOriginalNode(node)) {
+      continue;
+    }
     ZETASQL_RETURN_IF_ERROR(node->Validate(context_));
   }
   context_->ClearNewTempSchemaSnapshot();
 
   // Check the invariants around the nodes.
-  ZETASQL_RET_CHECK_EQ(cloned_pool_ptr->size(), cloned_graph->GetSchemaNodes().size())
-      << "\nNodes:\n"
-      << cloned_pool_ptr->DebugString();
-
   ZETASQL_RET_CHECK_EQ(cloned_pool_ptr->size(),
-               num_original_nodes() - trimmed_ + added_nodes_.size())
+               num_cloned_nodes - trimmed_ + added_nodes_.size())
       << "Internal error while cloning schema graph "
       << "Original: " << num_original_nodes() << "\n"
-      << "Cloned: " << cloned_pool_ptr->size() << "\n"
+      << "Cloned: " << num_cloned_nodes << "\n"
       << "Added: " << added_nodes_.size() << "\n"
       << "Trimmed: " << trimmed_ << "\n"
       << "Nodes:\n"
       << cloned_pool_ptr->DebugString();
 
+  ZETASQL_RET_CHECK_EQ(cloned_graph->GetSchemaNodes().size(),
+               num_original_nodes() - trimmed_ + added_nodes_.size())
+      << "\nNodes:\n"
+      << cloned_pool_ptr->DebugString();
+
   return cloned_graph;
 }
 
 absl::Status SchemaGraphEditor::CanonicalizeEdits() {
-  if (clone_map_.empty()) {
-    ZETASQL_RETURN_IF_ERROR(InitCloneMap());
-  }
-
   // Run a fixup/cloning pass so that changes from edit nodes in the cloned
-  // graph are propagated to their neighbors.
+  // graph are propagated to their neighbors. The new graph holds the clones
+  // in place of the cloned nodes, and shares the other nodes.
   ZETASQL_VLOG(2) << "Fixing clones";
-  for (const auto* clone : new_nodes_) {
+  if (clone_all_nodes_ && num_original_nodes() > 0) {
+    ZETASQL_RETURN_IF_ERROR(
+        CloneWithDependents(original_graph_->GetSchemaNodes().front()));
+  }
+  new_nodes_.reserve(num_original_nodes() + added_nodes_.size());
+  for (const auto* node : original_graph_->GetSchemaNodes()) {
+    const SchemaNode* clone = FindClone(node);
+    if (clone == nullptr) {
+      ZETASQL_RET_CHECK(!nodes_to_clone_.contains(node));
+      new_nodes_.push_back(node);
+      continue;
+    }
     ZETASQL_RETURN_IF_ERROR(Fixup(clone));
+    new_nodes_.push_back(clone);
   }
 
   // No new clones were added.
-  ZETASQL_RET_CHECK_EQ(new_nodes_.size(), num_original_nodes());
-  ZETASQL_RET_CHECK_EQ(cloned_pool_->size(), num_original_nodes());
+  ZETASQL_RET_CHECK_EQ(cloned_pool_->size(), nodes_to_clone_.size());
 
   ZETASQL_VLOG(2) << "Fixing added nodes";
   for (auto& added_node : added_nodes_) {
@@ -230,7 +345,7 @@ absl::Status SchemaGraphEditor::CanonicalizeEdits() {
     cloned_pool_->Add(std::move(added_node));
   }
   ZETASQL_RET_CHECK_EQ(cloned_pool_->size(),
-               num_original_nodes() + added_nodes_.size());
+               nodes_to_clone_.size() + added_nodes_.size());
   return absl::OkStatus();
 }
 
@@ -241,10 +356,6 @@ absl::Status SchemaGraphEditor::Fixup(const SchemaNode* node) {
 }
 
 absl::Status SchemaGraphEditor::CanonicalizeDeletion() {
-  if (clone_map_.empty()) {
-    ZETASQL_RETURN_IF_ERROR(InitCloneMap());
-  }
-
   // Mark the clone of the node as deleted.
   for (const auto* node : deleted_nodes_) {
     const SchemaNode* deleted_clone = FindClone(node);
@@ -255,12 +366,15 @@ absl::Status SchemaGraphEditor::CanonicalizeDeletion() {
   // To propagate the deletion information across the graph so that every node
   // can take action on deletion of its neighbor, we run Fixup as many times as
   // the number of nodes (the length of the longest non-cyclical path in the
-  // graph or until the number of deletions has converged).
+  // graph or until the number of deletions has converged). Only the clones
+  // reference the deleted nodes, directly or indirectly.
+  const std::vector<const SchemaNode*> cloned_nodes = ClonedOriginalNodes();
+  const int num_cloned_nodes = cloned_nodes.size();
   delete_fixup_ = true;
   int deletions = 1;
-  for (int i = 0; i < num_original_nodes(); ++i) {
+  for (int i = 0; i < num_cloned_nodes; ++i) {
     int new_deletions = 0;
-    for (const auto* node : original_graph_->GetSchemaNodes()) {
+    for (const auto* node : cloned_nodes) {
       const SchemaNode* clone = FindClone(node);
       ZETASQL_RET_CHECK_NE(clone, nullptr);
       ZETASQL_RETURN_IF_ERROR(FixupInternal(clone, const_cast<SchemaNode*>(clone)));
@@ -279,6 +393,13 @@ absl::Status SchemaGraphEditor::CanonicalizeDeletion() {
     ZETASQL_VLOG(5) << "Fixup pass " << i + 1 << " deletions: " << new_deletions;
   }
   delete_fixup_ = false;
+
+  // The new graph holds the clones in place of the cloned nodes, and shares
+  // the other nodes.
+  for (const auto* node : original_graph_->GetSchemaNodes()) {
+    const SchemaNode* clone = FindClone(node);
+    new_nodes_.push_back(clone != nullptr ? clone : node);
+  }
   return absl::OkStatus();
 }
 
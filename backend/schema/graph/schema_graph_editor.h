@@ -18,6 +18,7 @@
 #define THIRD_PARTY_CLOUD_SPANNER_EMULATOR_BACKEND_SCHEMA_GRAPH_SCHEMA_GRAPH_EDITOR_H_
 
 #include <algorithm>
+#include <cstdint>
 #include <memory>
 #include <vector>
 
@@ -55,6 +56,18 @@ namespace backend {
 // Deletions maintain the same relative order of nodes in the new graph as in
 // the original graph.
 //
+// The new graph shares the nodes of the original graph which a change leaves
+// untouched. Only the edited and deleted nodes, and the nodes which reference
+// them directly or indirectly, are cloned; the references of the clones to the
+// other nodes are kept as is. This keeps the cost of canonicalizing a change
+// proportional to the part of the graph it touches rather than the size of the
+// graph, which matters for large schemas and large batches of DDL statements.
+// The nodes which reference a node are looked up in the dependents of the
+// original graph, which the editor records for the new graph as it fixes up the
+// cloned and added nodes. The whole graph is cloned if the dependents of the
+// original graph are not known, or if the pools it shares with earlier graphs
+// hold as many nodes which are no longer used as nodes which are.
+//
 // During CanonicalizeGraph(), this class may call Validate() and
 // ValidateUpdate() on the SchemaNodes(s) in the new and old graph respectively.
 // Validate() and ValidateUpdate() are called in the same order in which the
@@ -67,6 +80,13 @@ class SchemaGraphEditor {
         context_(context),
         cloned_pool_(std::make_unique<SchemaObjectsPool>()) {
     context_->set_added_nodes(&added_nodes_);
+    original_node_index_.reserve(num_original_nodes());
+    for (const SchemaNode* node : original_graph_->GetSchemaNodes()) {
+      original_node_index_.emplace(node, original_node_index_.size());
+    }
+    clone_all_nodes_ = !original_graph_->has_dependents() ||
+                       original_graph_->num_pooled_nodes() >
+                           2 * static_cast<int64_t>(num_original_nodes());
   }
 
   template <typename T>
@@ -92,12 +112,10 @@ class SchemaGraphEditor {
     T* editable = const_cast<SchemaNode*>(node)->As<T>();
     ZETASQL_RET_CHECK_NE(editable, nullptr);
 
-    // Clone the node if it already exists.
+    // Clone the node if it already exists, along with the nodes which
+    // reference it.
     if (IsOriginalNode(node)) {
-      // Create a clone of the schema first.
-      if (clone_map_.empty()) {
-        ZETASQL_RETURN_IF_ERROR(InitCloneMap());
-      }
+      ZETASQL_RETURN_IF_ERROR(CloneWithDependents(node));
 
       // Edit the clone.
       const auto* clone = FindClone(node);
@@ -223,18 +241,10 @@ class SchemaGraphEditor {
     if (IsOriginalNode(node)) {
       return kOriginal;
     }
-    auto it = std::find_if(
-        added_nodes_.begin(), added_nodes_.end(),
-        [&node](const std::unique_ptr<const SchemaNode>& node_ptr) {
-          return node_ptr.get() == node;
-        });
-    if (it != added_nodes_.end()) {
+    if (added_node_set_.contains(node)) {
       return kAdded;
     }
-    auto it_deleted = std::find_if(
-        deleted_nodes_.begin(), deleted_nodes_.end(),
-        [&node](const SchemaNode* node_ptr) { return node_ptr == node; });
-    if (it_deleted != deleted_nodes_.end()) {
+    if (deleted_node_set_.contains(node)) {
       return kDropped;
     }
     const auto* clone = FindClone(node);
@@ -248,9 +258,19 @@ class SchemaGraphEditor {
     return original_graph_->GetSchemaNodes().size();
   }
 
-  // Clones the original schema and creates the mapping of
-  // original nodes to clones.
-  absl::Status InitCloneMap();
+  // Clones 'node' of the original graph, and the nodes of the original graph
+  // which reference it directly or indirectly, unless they are cloned already.
+  absl::Status CloneWithDependents(const SchemaNode* node);
+
+  // Returns the cloned nodes of the original graph, in the order of the
+  // original graph.
+  std::vector<const SchemaNode*> ClonedOriginalNodes() const;
+
+  // Returns the dependents of the nodes of the new graph.
+  SchemaGraph::Dependents NewGraphDependents() const;
+
+  // Records that the node being fixed up, if any, references 'node'.
+  void RecordReference(const SchemaNode* node);
 
   // Returns OK if 'node' is present in the original graph.
   bool IsOriginalNode(const SchemaNode* node) const;
@@ -289,6 +309,23 @@ class SchemaGraphEditor {
   // Number of deleted nodes.
   int trimmed_ = 0;
 
+  // The position of each node of the original graph.
+  absl::flat_hash_map<const SchemaNode*, int> original_node_index_;
+
+  // If true, every node of the original graph is cloned.
+  bool clone_all_nodes_ = false;
+
+  // The nodes of the original graph which are cloned. The other nodes are
+  // shared with the new graph, and are returned by Clone() as is.
+  absl::flat_hash_set<const SchemaNode*> nodes_to_clone_;
+
+  // The nodes referenced by each cloned and added node, as of its last fixup.
+  absl::flat_hash_map<const SchemaNode*, std::vector<const SchemaNode*>>
+      references_;
+
+  // The nodes being fixed up, innermost last.
+  std::vector<const SchemaNode*> fixup_stack_;
+
   // Mapping of original nodes to clones.
   absl::flat_hash_map<const SchemaNode*, const SchemaNode*> clone_map_;
 
@@ -307,10 +344,15 @@ class SchemaGraphEditor {
 
   // The nodes being deleted.
   std::vector<const SchemaNode*> deleted_nodes_;
+  absl::flat_hash_set<const SchemaNode*> deleted_node_set_;
 
   // The nodes added to the graph.
   std::vector<std::unique_ptr<const SchemaNode>> added_nodes_;
 
+  // The nodes added to the graph, which remain in this set after their
+  // ownership is moved from 'added_nodes_' to the new graph.
+  absl::flat_hash_set<const SchemaNode*> added_node_set_;
+
   // Clones that were modified/edited.
   absl::flat_hash_set<const SchemaNode*> edited_clones_;
 };
@@ -18,6 +18,7 @@
 #define THIRD_PARTY_CLOUD_SPANNER_EMULATOR_BACKEND_SCHEMA_GRAPH_SCHEMA_OBJECTS_POOL_H_
 
 #include <algorithm>
+#include <cstdint>
 #include <memory>
 #include <string>
 #include <vector>
@@ -59,6 +60,18 @@ class SchemaObjectsPool {
 
   int size() const { return schema_node_pool_.size(); }
 
+  // Returns an estimate of the memory used by the nodes in the pool. Nodes
+  // have no uniform size, so each is estimated from the length of its debug
+  // string, which holds its names, types and expressions, plus a fixed
+  // overhead for the node and its containers.
+  int64_t EstimatedSizeBytes() const {
+    int64_t size_bytes = 0;
+    for (const auto& node : schema_node_pool_) {
+      size_bytes += kNodeOverheadBytes + node->DebugString().size();
+    }
+    return size_bytes;
+  }
+
   std::string DebugString() const {
     std::string out;
     for (const auto& node : schema_node_pool_) {
@@ -68,6 +81,9 @@ class SchemaObjectsPool {
   }
 
  private:
+  // The estimated memory used by a node besides its debug string.
+  static constexpr int64_t kNodeOverheadBytes = 256;
+
   absl::flat_hash_set<std::unique_ptr<const SchemaNode>> schema_node_pool_;
 };
 
@@ -25,14 +25,22 @@
 
 #include "google/spanner/admin/database/v1/common.pb.h"
 #include "zetasql/public/types/type_factory.h"
+#include "benchmark/benchmark.h"
 #include "gmock/gmock.h"
 #include "gtest/gtest.h"
 #include "zetasql/base/testing/status_matchers.h"
 #include "tests/common/proto_matchers.h"
+#include "absl/log/check.h"
 #include "absl/status/status.h"
 #include "absl/status/statusor.h"
+#include "absl/strings/string_view.h"
+#include "absl/strings/substitute.h"
+#include "backend/common/ids.h"
+#include "backend/database/pg_oid_assigner/pg_oid_assigner.h"
 #include "backend/schema/catalog/schema.h"
+#include "backend/schema/updater/schema_updater.h"
 #include "backend/schema/updater/schema_updater_tests/base.h"
+#include "backend/storage/in_memory_storage.h"
 #include "common/errors.h"
 #include "common/feature_flags.h"
 #include "tests/common/scoped_feature_flags_setter.h"
@@ -2240,8 +2248,187 @@ TEST_P(SchemaUpdaterTest, CreateTable_IntervalStruct_Column_Fail) {
   EXPECT_FALSE(status.ok());
 }
 
+TEST_P(SchemaUpdaterTest, CreateTable_SharesUnchangedTables) {
+  ZETASQL_ASSERT_OK_AND_ASSIGN(auto base_schema, CreateSchema({R"(
+    CREATE TABLE T1(
+      col1 INT64,
+      col2 STRING(MAX)
+    ) PRIMARY KEY(col1))"}));
+  const Table* t1 = base_schema->FindTable("T1");
+  ASSERT_NE(t1, nullptr);
+
+  ZETASQL_ASSERT_OK_AND_ASSIGN(
+      auto schema,
+      UpdateSchema(base_schema.get(),
+                   {"CREATE TABLE T2(col1 INT64) PRIMARY KEY(col1)",
+                    "CREATE TABLE T3(col1 INT64) PRIMARY KEY(col1)"}));
+
+  // Tables are shared with the base schema, and outlive it.
+  EXPECT_EQ(schema->FindTable("T1"), t1);
+  base_schema.reset();
+  const Table* t2 = schema->FindTable("T2");
+  ASSERT_NE(t2, nullptr);
+  EXPECT_NE(schema->FindTable("T3"), nullptr);
+  EXPECT_THAT(t1->columns()[1], ColumnIs("col2", types::StringType()));
+
+  // Altering a table clones it, but not the tables unrelated to it.
+  ZETASQL_ASSERT_OK_AND_ASSIGN(
+      auto altered_schema,
+      UpdateSchema(schema.get(), {"ALTER TABLE T1 ADD COLUMN col3 INT64"}));
+  EXPECT_NE(altered_schema->FindTable("T1"), t1);
+  EXPECT_EQ(altered_schema->FindTable("T2"), t2);
+  EXPECT_EQ(altered_schema->FindTable("T1")->columns().size(), 3);
+  EXPECT_EQ(altered_schema->FindTable("T2")->columns().size(), 1);
+}
+
+TEST_P(SchemaUpdaterTest, AlterTable_ClonesOnlyTablesReferencingIt) {
+  ZETASQL_ASSERT_OK_AND_ASSIGN(auto base_schema, CreateSchema({R"(
+    CREATE TABLE Parent(
+      k1 INT64,
+      c1 STRING(MAX)
+    ) PRIMARY KEY(k1))",
+                                                        R"(
+    CREATE TABLE Child(
+      k1 INT64,
+      k2 INT64,
+      c1 STRING(MAX)
+    ) PRIMARY KEY(k1, k2), INTERLEAVE IN PARENT Parent)",
+                                                        R"(
+    CREATE TABLE Other(
+      k1 INT64,
+      c1 STRING(MAX)
+    ) PRIMARY KEY(k1))"}));
+  const Table* parent = base_schema->FindTable("Parent");
+  const Table* child = base_schema->FindTable("Child");
+  const Table* other = base_schema->FindTable("Other");
+
+  // The parent references the altered child, so both are cloned.
+  ZETASQL_ASSERT_OK_AND_ASSIGN(
+      auto altered_schema,
+      UpdateSchema(base_schema.get(),
+                   {"ALTER TABLE Child ADD COLUMN c2 INT64"}));
+  const Table* altered_child = altered_schema->FindTable("Child");
+  EXPECT_NE(altered_child, child);
+  EXPECT_NE(altered_schema->FindTable("Parent"), parent);
+  EXPECT_EQ(altered_schema->FindTable("Other"), other);
+  EXPECT_EQ(altered_child->parent(), altered_schema->FindTable("Parent"));
+  EXPECT_THAT(altered_schema->FindTable("Parent")->children(),
+              testing::ElementsAre(altered_child));
+
+  // Indexing a table clones it and the tables referencing it.
+  ZETASQL_ASSERT_OK_AND_ASSIGN(
+      auto indexed_schema,
+      UpdateSchema(altered_schema.get(),
+                   {"CREATE INDEX Idx ON Other(c1)"}));
+  EXPECT_NE(indexed_schema->FindTable("Other"), other);
+  EXPECT_EQ(indexed_schema->FindTable("Child"), altered_child);
+  EXPECT_NE(indexed_schema->FindIndex("Idx"), nullptr);
+
+  // Dropping the child clones the parent, which no longer references it.
+  ZETASQL_ASSERT_OK_AND_ASSIGN(
+      auto dropped_schema,
+      UpdateSchema(indexed_schema.get(), {"DROP TABLE Child"}));
+  EXPECT_EQ(dropped_schema->FindTable("Child"), nullptr);
+  EXPECT_THAT(dropped_schema->FindTable("Parent")->children(),
+              testing::IsEmpty());
+  EXPECT_EQ(dropped_schema->FindTable("Other"),
+            indexed_schema->FindTable("Other"));
+}
+
 }  // namespace
 
+void BM_CreateTablesInOneBatch(benchmark::State& state) {
+  int num_tables = state.range(0);
+  std::vector<std::string> statements;
+  for (int i = 0; i < num_tables; ++i) {
+    statements.push_back(absl::Substitute(
+        "CREATE TABLE T$0 (col1 INT64, col2 STRING(MAX)) PRIMARY KEY (col1)",
+        i));
+  }
+
+  for (auto _ : state) {
+    zetasql::TypeFactory type_factory;
+    TableIDGenerator table_id_generator;
+    ColumnIDGenerator column_id_generator;
+    InMemoryStorage storage;
+    PgOidAssigner pg_oid_assigner(/*enabled=*/false);
+    SchemaChangeContext context{.type_factory = &type_factory,
+                                .table_id_generator = &table_id_generator,
+                                .column_id_generator = &column_id_generator,
+                                .storage = &storage,
+                                .pg_oid_assigner = &pg_oid_assigner};
+    SchemaUpdater updater;
+    absl::StatusOr<std::unique_ptr<const Schema>> schema =
+        updater.ValidateSchemaFromDDL(
+            SchemaChangeOperation{.statements = statements}, context,
+            /*existing_schema=*/nullptr);
+    ABSL_CHECK_OK(schema.status());
+    benchmark::DoNotOptimize(schema);
+  }
+  state.SetItemsProcessed(state.iterations() * num_tables);
+}
+BENCHMARK(BM_CreateTablesInOneBatch)->Arg(10)->Arg(100)->Arg(1000);
+
+// Creates a schema with 'num_tables' unrelated tables, and a table 'Parent'
+// with an interleaved table 'Child'.
+std::unique_ptr<const Schema> CreateBenchmarkSchema(
+    int num_tables, const SchemaChangeContext& context) {
+  std::vector<std::string> statements = {
+      "CREATE TABLE Parent (k1 INT64, c1 STRING(MAX)) PRIMARY KEY (k1)",
+      "CREATE TABLE Child (k1 INT64, k2 INT64, c1 STRING(MAX)) "
+      "PRIMARY KEY (k1, k2), INTERLEAVE IN PARENT Parent"};
+  for (int i = 0; i < num_tables; ++i) {
+    statements.push_back(absl::Substitute(
+        "CREATE TABLE T$0 (col1 INT64, col2 STRING(MAX)) PRIMARY KEY (col1)",
+        i));
+  }
+  SchemaUpdater updater;
+  absl::StatusOr<std::unique_ptr<const Schema>> schema =
+      updater.ValidateSchemaFromDDL(
+          SchemaChangeOperation{.statements = statements}, context,
+          /*existing_schema=*/nullptr);
+  ABSL_CHECK_OK(schema.status());
+  return *std::move(schema);
+}
+
+// Measures a single statement applied to a schema with 'state.range(0)'
+// tables which it does not touch.
+void RunSchemaUpdateBenchmark(benchmark::State& state,
+                              absl::string_view statement) {
+  zetasql::TypeFactory type_factory;
+  TableIDGenerator table_id_generator;
+  ColumnIDGenerator column_id_generator;
+  InMemoryStorage storage;
+  PgOidAssigner pg_oid_assigner(/*enabled=*/false);
+  SchemaChangeContext context{.type_factory = &type_factory,
+                              .table_id_generator = &table_id_generator,
+                              .column_id_generator = &column_id_generator,
+                              .storage = &storage,
+                              .pg_oid_assigner = &pg_oid_assigner};
+  std::unique_ptr<const Schema> existing_schema =
+      CreateBenchmarkSchema(state.range(0), context);
+
+  for (auto _ : state) {
+    SchemaUpdater updater;
+    absl::StatusOr<std::unique_ptr<const Schema>> schema =
+        updater.ValidateSchemaFromDDL(
+            SchemaChangeOperation{.statements = {std::string(statement)}},
+            context, existing_schema.get());
+    ABSL_CHECK_OK(schema.status());
+    benchmark::DoNotOptimize(schema);
+  }
+}
+
+void BM_CreateIndex(benchmark::State& state) {
+  RunSchemaUpdateBenchmark(state, "CREATE INDEX Idx ON T0(col2)");
+}
+BENCHMARK(BM_CreateIndex)->Arg(10)->Arg(100)->Arg(1000);
+
+void BM_AlterInterleavedTable(benchmark::State& state) {
+  RunSchemaUpdateBenchmark(state, "ALTER TABLE Child ADD COLUMN c2 INT64");
+}
+BENCHMARK(BM_AlterInterleavedTable)->Arg(10)->Arg(100)->Arg(1000);
+
 }  // namespace test
 }  // namespace backend
 }  // namespace emulator
@@ -16,13 +16,20 @@
 
 #include "backend/storage/in_memory_storage.h"
 
+#include <algorithm>
+#include <cstdint>
+#include <iterator>
 #include <memory>
+#include <optional>
 #include <utility>
 #include <vector>
 
 #include "zetasql/public/value.h"
+#include "absl/container/btree_map.h"
+#include "absl/container/inlined_vector.h"
 #include "absl/status/status.h"
 #include "absl/strings/str_cat.h"
+#include "absl/synchronization/mutex.h"
 #include "absl/time/time.h"
 #include "backend/storage/in_memory_iterator.h"
 #include "common/errors.h"
@@ -34,56 +41,305 @@ namespace backend {
 
 namespace {
 
-static constexpr char kExistsColumn[] = "_exists";
+// Maximum number of rows buffered by a RowIterator per acquisition of the
+// storage lock.
+static constexpr int kRowIteratorBatchSize = 64;
+
+// Maximum number of keys a RowIterator visits per acquisition of the storage
+// lock, including keys which do not exist at the read timestamp. This bounds
+// the time the lock is held when scanning over many deleted rows.
+static constexpr int kRowIteratorMaxKeysVisitedPerBatch = 1024;
+
+// Returns the version of 'versions' visible at 'timestamp', or nullptr if the
+// versions all start after 'timestamp'.
+template <typename T>
+const T* FindVersion(
+    const absl::InlinedVector<std::pair<absl::Time, T>, 1>& versions,
+    absl::Time timestamp) {
+  // Versions are almost always read at or after the latest version.
+  if (versions.empty()) {
+    return nullptr;
+  }
+  if (versions.back().first <= timestamp) {
+    return &versions.back().second;
+  }
+  auto itr = std::upper_bound(
+      versions.begin(), versions.end(), timestamp,
+      [](absl::Time t, const auto& version) { return t < version.first; });
+  if (itr == versions.begin()) {
+    return nullptr;
+  }
+  return &std::prev(itr)->second;
+}
+
+// Returns the estimated memory held by a single version.
+int64_t VersionByteSize(const std::pair<absl::Time, bool>& version) {
+  return sizeof(version);
+}
+int64_t VersionByteSize(const std::pair<absl::Time, zetasql::Value>& version) {
+  // Deletes are recorded as invalid values, which have no type to size.
+  const zetasql::Value& value = version.second;
+  return sizeof(absl::Time) +
+         (value.is_valid() ? value.physical_byte_size() : sizeof(value));
+}
+
+// Returns the estimated memory held by all the versions of 'versions'.
+template <typename T>
+int64_t VersionsByteSize(
+    const absl::InlinedVector<std::pair<absl::Time, T>, 1>& versions) {
+  int64_t bytes = 0;
+  for (const auto& version : versions) {
+    bytes += VersionByteSize(version);
+  }
+  return bytes;
+}
+
+// Sets the version of 'versions' at 'timestamp' to 'value', and returns the
+// change in the estimated memory held by the versions. Versions which fell out
+// of the retention period are left for CollectExpiredVersions.
+template <typename T>
+int64_t SetVersion(absl::InlinedVector<std::pair<absl::Time, T>, 1>& versions,
+                   absl::Time timestamp, T value) {
+  // Versions are almost always written after the latest version.
+  if (versions.empty() || versions.back().first < timestamp) {
+    versions.emplace_back(timestamp, std::move(value));
+    return VersionByteSize(versions.back());
+  }
+  auto itr = std::lower_bound(
+      versions.begin(), versions.end(), timestamp,
+      [](const auto& version, absl::Time t) { return version.first < t; });
+  if (itr != versions.end() && itr->first == timestamp) {
+    int64_t old_bytes = VersionByteSize(*itr);
+    itr->second = std::move(value);
+    return VersionByteSize(*itr) - old_bytes;
+  }
+  itr = versions.emplace(itr, timestamp, std::move(value));
+  return VersionByteSize(*itr);
+}
+
+// Removes the versions of 'versions' which are no longer visible at or after
+// 'expiration_time', and returns the estimated memory they held.
+template <typename T>
+int64_t TrimVersions(
+    absl::InlinedVector<std::pair<absl::Time, T>, 1>& versions,
+    absl::Time expiration_time) {
+  // The last version at or before the expiration time needs to be kept to
+  // cover the retention period.
+  auto expired_end = std::upper_bound(
+      versions.begin(), versions.end(), expiration_time,
+      [](absl::Time t, const auto& version) { return t < version.first; });
+  if (expired_end - versions.begin() <= 1) {
+    return 0;
+  }
+  int64_t bytes = 0;
+  for (auto itr = versions.begin(); itr != std::prev(expired_end); ++itr) {
+    bytes += VersionByteSize(*itr);
+  }
+  versions.erase(versions.begin(), std::prev(expired_end));
+  return bytes;
+}
 
 }  // namespace
 
-void InMemoryStorage::RemoveExpiredVersions(Cell& cell, absl::Time timestamp) {
-  absl::MutexLock lock(&version_retention_period_mu_);
-  auto it = cell.begin();
-  auto upper_bound = cell.upper_bound(timestamp - version_retention_period_);
-  while (it != upper_bound) {
-    auto next = it;
-    if (++next == upper_bound) {
-      // The current value needs to be kept to cover the retention period.
-      break;
+// RowIterator yields the rows of a table within a ClosedOpen key range as they
+// existed at a given timestamp.
+//
+// Rows are fetched in small batches. Each batch re-seeks into the table under
+// a reader lock on the table just past the last key visited, so the iterator
+// never holds the lock between calls to Next() and is unaffected by concurrent
+// inserts.
+//
+// Rows visible at the read timestamp may still change between batches, as
+// writes are not always made at later timestamps: reads by read-write
+// transactions are made at absl::InfiniteFuture(), and index backfills write
+// at a past timestamp. Callers keep lazy iteration consistent as follows:
+// - Snapshot reads wait for pending commits before the read timestamp, and
+//   commits are made at later timestamps.
+// - Read-write transactions hold locks on the ranges they read, and drain the
+//   iterator before releasing the locks.
+// - Backfills write to the data tables of indexes which are not yet visible to
+//   any reader.
+class InMemoryStorage::RowIterator : public StorageIterator {
+ public:
+  RowIterator(const InMemoryStorage* storage, absl::Time timestamp,
+              const TableID& table_id, const KeyRange& key_range,
+              const std::vector<ColumnID>& column_ids)
+      : storage_(storage),
+        timestamp_(timestamp),
+        table_id_(table_id),
+        key_range_(key_range),
+        column_ids_(column_ids) {}
+
+  bool Next() override {
+    if (++pos_ < static_cast<int>(batch_.size())) {
+      return true;
     }
-    it = cell.erase(it);
+    while (!done_) {
+      FetchBatch();
+      if (!batch_.empty()) {
+        pos_ = 0;
+        return true;
+      }
+    }
+    return false;
+  }
+
+  absl::Status Status() const override { return absl::OkStatus(); }
+
+  const class Key& Key() const override { return batch_[pos_].first; }
+
+  int NumColumns() const override { return column_ids_.size(); }
+
+  const zetasql::Value& ColumnValue(int i) const override {
+    return batch_[pos_].second[i];
   }
+
+ private:
+  // Replaces the current batch with the next rows from the table.
+  void FetchBatch() {
+    batch_.clear();
+    if (table_ == nullptr) {
+      table_ = storage_->FindTable(table_id_);
+      if (table_ == nullptr) {
+        done_ = true;
+        return;
+      }
+    }
+    absl::ReaderMutexLock lock(&table_->mu);
+    const absl::btree_map<class Key, Row>& table = table_->rows;
+
+    // Column slots are resolved once per batch rather than once per row.
+    std::vector<int> slots = table_->FindColumnSlots(column_ids_);
+
+    auto row_itr = last_visited_key_.has_value()
+                       ? table.upper_bound(*last_visited_key_)
+                       : table.lower_bound(key_range_.start_key());
+    auto row_end_itr = table.lower_bound(key_range_.limit_key());
+    const class Key* last_visited_key = nullptr;
+    for (int visited = 0;
+         row_itr != row_end_itr &&
+         static_cast<int>(batch_.size()) < kRowIteratorBatchSize &&
+         visited < kRowIteratorMaxKeysVisitedPerBatch;
+         ++row_itr, ++visited) {
+      last_visited_key = &row_itr->first;
+      const Row& row = row_itr->second;
+      if (!Exists(row, timestamp_)) {
+        continue;
+      }
+      std::vector<zetasql::Value> values;
+      values.reserve(slots.size());
+      for (int slot : slots) {
+        values.emplace_back(GetCellValueAtTimestamp(row, slot, timestamp_));
+      }
+      batch_.emplace_back(row_itr->first, std::move(values));
+    }
+    if (row_itr == row_end_itr) {
+      done_ = true;
+    } else if (last_visited_key != nullptr) {
+      last_visited_key_ = *last_visited_key;
+    }
+  }
+
+  // The storage being read. Must outlive the iterator.
+  const InMemoryStorage* storage_;
+
+  // Parameters of the read.
+  const absl::Time timestamp_;
+  const TableID table_id_;
+  const KeyRange key_range_;
+  const std::vector<ColumnID> column_ids_;
+
+  // The table being read, resolved by the first batch.
+  std::shared_ptr<const Table> table_;
+
+  // Rows of the current batch and the position of the iterator within it.
+  std::vector<FixedRowStorageIterator::Row> batch_;
+  int pos_ = -1;
+
+  // The last key visited by a previous batch. The next batch starts after it.
+  std::optional<class Key> last_visited_key_;
+
+  // True once the key range has been exhausted.
+  bool done_ = false;
+};
+
+std::shared_ptr<InMemoryStorage::Table> InMemoryStorage::FindTable(
+    const TableID& table_id) const {
+  absl::ReaderMutexLock lock(&mu_);
+  auto table_itr = tables_.find(table_id);
+  if (table_itr == tables_.end()) {
+    return nullptr;
+  }
+  return table_itr->second;
+}
+
+std::shared_ptr<InMemoryStorage::Table> InMemoryStorage::FindOrCreateTable(
+    const TableID& table_id) {
+  if (std::shared_ptr<Table> table = FindTable(table_id); table != nullptr) {
+    return table;
+  }
+  absl::MutexLock lock(&mu_);
+  std::shared_ptr<Table>& table = tables_[table_id];
+  if (table == nullptr) {
+    table = std::make_shared<Table>();
+  }
+  return table;
+}
+
+std::vector<int> InMemoryStorage::Table::FindColumnSlots(
+    const std::vector<ColumnID>& column_ids) const {
+  std::vector<int> slots;
+  slots.reserve(column_ids.size());
+  for (const ColumnID& column_id : column_ids) {
+    auto slot_itr = column_slots.find(column_id);
+    slots.push_back(slot_itr == column_slots.end() ? -1 : slot_itr->second);
+  }
+  return slots;
+}
+
+int InMemoryStorage::Table::FindOrAddColumnSlot(const ColumnID& column_id) {
+  auto [slot_itr, inserted] =
+      column_slots.try_emplace(column_id, num_column_slots);
+  if (inserted) {
+    ++num_column_slots;
+  }
+  return slot_itr->second;
+}
+
+std::vector<int> InMemoryStorage::Table::FindOrAddColumnSlots(
+    const std::vector<ColumnID>& column_ids) {
+  std::vector<int> slots;
+  slots.reserve(column_ids.size());
+  for (const ColumnID& column_id : column_ids) {
+    slots.push_back(FindOrAddColumnSlot(column_id));
+  }
+  return slots;
 }
 
 zetasql::Value InMemoryStorage::GetCellValueAtTimestamp(
-    const Row& row, const ColumnID& column_id, absl::Time timestamp) const {
-  // Perform the lookup for given cell.
-  auto cell_itr = row.find(column_id);
-  if (cell_itr == row.end()) {
+    const Row& row, int slot, absl::Time timestamp) {
+  // Columns never written to the table or the row have no value.
+  if (slot < 0 || slot >= static_cast<int>(row.cells.size())) {
     return zetasql::Value();
   }
-  const Cell& cell = cell_itr->second;
-  auto val_itr = cell.upper_bound(timestamp);
 
   // Timestamp is earlier than the time the cell was first written to.
-  if (val_itr == cell.begin()) {
+  const zetasql::Value* value = FindVersion(row.cells[slot], timestamp);
+  if (value == nullptr) {
     return zetasql::Value();
   }
-
-  // Fetch the value from the column.
-  --val_itr;
-  return val_itr->second;
+  return *value;
 }
 
-bool InMemoryStorage::Exists(const Row& row, absl::Time timestamp) const {
-  zetasql::Value value =
-      GetCellValueAtTimestamp(row, kExistsColumn, timestamp);
-  return value.is_valid() && value.bool_value();
+bool InMemoryStorage::Exists(const Row& row, absl::Time timestamp) {
+  const bool* exists = FindVersion(row.exists, timestamp);
+  return exists != nullptr && *exists;
 }
 
 absl::Status InMemoryStorage::Lookup(
     absl::Time timestamp, const TableID& table_id, const Key& key,
     const std::vector<ColumnID>& column_ids,
     std::vector<zetasql::Value>* values) const {
-  absl::MutexLock lock(&mu_);
-
   // Validate the request.
   if (!column_ids.empty() && values == nullptr) {
     return error::Internal(
@@ -95,18 +351,18 @@ absl::Status InMemoryStorage::Lookup(
   }
 
   // Lookup for given table.
-  auto table_itr = tables_.find(table_id);
-  if (table_itr == tables_.end()) {
+  std::shared_ptr<const Table> table = FindTable(table_id);
+  if (table == nullptr) {
     return absl::Status(
         absl::StatusCode::kNotFound,
         absl::StrCat("Key: ", key.DebugString(), " not found for table: ",
                      table_id, " at timestamp: ", absl::FormatTime(timestamp)));
   }
-  const Table& table = table_itr->second;
+  absl::ReaderMutexLock lock(&table->mu);
 
   // Lookup for given key.
-  auto row_itr = table.find(key);
-  if (row_itr == table.end()) {
+  auto row_itr = table->rows.find(key);
+  if (row_itr == table->rows.end()) {
     return absl::Status(
         absl::StatusCode::kNotFound,
         absl::StrCat("Key: ", key.DebugString(), " not found for table: ",
@@ -129,9 +385,8 @@ absl::Status InMemoryStorage::Lookup(
   }
 
   // Fetch the value from the cell at the given timestamp.
-  for (int i = 0; i < column_ids.size(); ++i) {
-    values->emplace_back(
-        GetCellValueAtTimestamp(row, column_ids[i], timestamp));
+  for (int slot : table->FindColumnSlots(column_ids)) {
+    values->emplace_back(GetCellValueAtTimestamp(row, slot, timestamp));
   }
 
   return absl::OkStatus();
@@ -141,8 +396,6 @@ absl::Status InMemoryStorage::Read(
     absl::Time timestamp, const TableID& table_id, const KeyRange& key_range,
     const std::vector<ColumnID>& column_ids,
     std::unique_ptr<StorageIterator>* itr) const {
-  absl::MutexLock lock(&mu_);
-
   // Validate the request.
   if (!key_range.IsClosedOpen()) {
     return error::Internal(
@@ -151,64 +404,67 @@ absl::Status InMemoryStorage::Read(
                      key_range.DebugString()));
   }
 
-  std::vector<FixedRowStorageIterator::Row> rows;
   // Return an empty iterator for empty key_range.
   if (key_range.start_key() >= key_range.limit_key()) {
     *itr = std::make_unique<FixedRowStorageIterator>();
     return absl::OkStatus();
   }
 
-  // Lookup for given table.
-  auto table_itr = tables_.find(table_id);
-  if (table_itr == tables_.end()) {
-    *itr = std::make_unique<FixedRowStorageIterator>();
-    return absl::OkStatus();
+  // Rows are fetched from the table lazily as the iterator advances.
+  *itr = std::make_unique<RowIterator>(this, timestamp, table_id, key_range,
+                                       column_ids);
+  return absl::OkStatus();
+}
+
+int64_t InMemoryStorage::WriteRow(Row& row, absl::Time timestamp,
+                                  const std::vector<int>& slots,
+                                  const std::vector<zetasql::Value>& values) {
+  // Mark the row as existing if it does not exist.
+  int64_t bytes = 0;
+  if (!Exists(row, timestamp)) {
+    bytes += SetVersion(row.exists, timestamp, true);
   }
-  const Table& table = table_itr->second;
 
-  // Lookup keys from the given key range.
-  auto row_start_itr = table.lower_bound(key_range.start_key());
-  auto row_end_itr = table.lower_bound(key_range.limit_key());
-  for (auto itr = row_start_itr; itr != row_end_itr; ++itr) {
-    const InMemoryStorage::Row& row = itr->second;
-    if (!Exists(row, timestamp)) {
-      continue;
+  // Add the values for the given columns.
+  for (int i = 0; i < slots.size(); ++i) {
+    int slot = slots[i];
+    if (slot >= static_cast<int>(row.cells.size())) {
+      row.cells.resize(slot + 1);
     }
+    bytes += SetVersion(row.cells[slot], timestamp, values[i]);
+  }
+  return bytes;
+}
 
-    std::vector<zetasql::Value> values;
-    values.reserve(column_ids.size());
-    for (const ColumnID& column_id : column_ids) {
-      values.emplace_back(GetCellValueAtTimestamp(row, column_id, timestamp));
+int64_t InMemoryStorage::DeleteRow(Row& row, absl::Time timestamp) {
+  if (!Exists(row, timestamp)) {
+    return 0;
+  }
+  int64_t bytes = SetVersion(row.exists, timestamp, false);
+  for (Cell& cell : row.cells) {
+    // Column values are marked invalid zetasql::Value to avoid reading
+    // the value of the cell before the delete.
+    if (!cell.empty()) {
+      bytes += SetVersion(cell, timestamp, zetasql::Value());
     }
-    rows.emplace_back(std::make_pair(itr->first, values));
   }
-  *itr = std::make_unique<FixedRowStorageIterator>(std::move(rows));
-  return absl::OkStatus();
+  return bytes;
 }
 
 absl::Status InMemoryStorage::Write(
     absl::Time timestamp, const TableID& table_id, const Key& key,
     const std::vector<ColumnID>& column_ids,
     const std::vector<zetasql::Value>& values) {
-  absl::MutexLock lock(&mu_);
-
   // Add the table if it does not exist.
-  Table& table = tables_[table_id];
+  std::shared_ptr<Table> table = FindOrCreateTable(table_id);
+  absl::MutexLock lock(&table->mu);
 
-  // Add the row with _exists system column if it does not exist.
-  Row& row = table[key];
-  if (!Exists(row, timestamp)) {
-    Cell& cell = row[kExistsColumn];
-    cell[timestamp] = zetasql::values::Bool(true);
-    RemoveExpiredVersions(cell, timestamp);
-  }
-
-  // Add the values for the given columns.
-  for (int i = 0; i < column_ids.size(); ++i) {
-    Cell& cell = row[column_ids[i]];
-    cell[timestamp] = values[i];
-    RemoveExpiredVersions(cell, timestamp);
-  }
+  // Add the row if it does not exist.
+  auto [row_itr, inserted] = table->rows.try_emplace(key);
+  int64_t bytes = inserted ? RowOverheadBytes(key) : 0;
+  bytes += WriteRow(row_itr->second, timestamp,
+                    table->FindOrAddColumnSlots(column_ids), values);
+  AddSizeBytes(table.get(), bytes);
 
   return absl::OkStatus();
 }
@@ -216,8 +472,6 @@ absl::Status InMemoryStorage::Write(
 absl::Status InMemoryStorage::Delete(absl::Time timestamp,
                                      const TableID& table_id,
                                      const KeyRange& key_range) {
-  absl::MutexLock lock(&mu_);
-
   if (!key_range.IsClosedOpen()) {
     return error::Internal(
         absl::StrCat("InMemoryStorage::Delete should be called "
@@ -229,38 +483,106 @@ absl::Status InMemoryStorage::Delete(absl::Time timestamp,
   }
 
   // Lookup for given table.
-  auto table_itr = tables_.find(table_id);
-  if (table_itr == tables_.end()) {
+  std::shared_ptr<Table> table = FindTable(table_id);
+  if (table == nullptr) {
     return absl::OkStatus();
   }
-  Table& table = table_itr->second;
+  absl::MutexLock lock(&table->mu);
 
   // Lookup keys from the given key range.
-  auto row_start_itr = table.lower_bound(key_range.start_key());
-  if (row_start_itr == table.end()) {
+  auto row_start_itr = table->rows.lower_bound(key_range.start_key());
+  if (row_start_itr == table->rows.end()) {
     return absl::OkStatus();
   }
-  auto row_end_itr = table.lower_bound(key_range.limit_key());
+  auto row_end_itr = table->rows.lower_bound(key_range.limit_key());
 
   // Mark the keys as deleted.
+  int64_t bytes = 0;
   for (auto itr = row_start_itr; itr != row_end_itr; ++itr) {
-    if (!Exists(itr->second, timestamp)) {
-      continue;
+    bytes += DeleteRow(itr->second, timestamp);
+  }
+  AddSizeBytes(table.get(), bytes);
+  return absl::OkStatus();
+}
+
+absl::Status InMemoryStorage::ApplyBatch(absl::Time timestamp,
+                                         std::vector<StorageWriteOp> ops) {
+  // Group the ops by table, in key order. The sort is stable so that ops on
+  // the same row are applied in the order they were given.
+  std::stable_sort(ops.begin(), ops.end(),
+                   [](const StorageWriteOp& a, const StorageWriteOp& b) {
+                     if (a.table_id != b.table_id) {
+                       return a.table_id < b.table_id;
+                     }
+                     return a.key < b.key;
+                   });
+
+  // Find the tables of all the ops under a single acquisition of the table map
+  // lock. Tables which are only deleted from are not created.
+  struct TableOps {
+    std::shared_ptr<Table> table;
+    std::vector<StorageWriteOp>::const_iterator begin;
+    std::vector<StorageWriteOp>::const_iterator end;
+  };
+  std::vector<TableOps> tables;
+  {
+    absl::MutexLock lock(&mu_);
+    for (auto begin = ops.cbegin(); begin != ops.cend();) {
+      auto end = std::find_if(begin, ops.cend(), [&](const StorageWriteOp& op) {
+        return op.table_id != begin->table_id;
+      });
+      bool has_writes = std::any_of(
+          begin, end, [](const StorageWriteOp& op) { return !op.is_delete; });
+      auto table_itr = tables_.find(begin->table_id);
+      if (table_itr != tables_.end()) {
+        tables.push_back({table_itr->second, begin, end});
+      } else if (has_writes) {
+        auto table = std::make_shared<Table>();
+        tables_[begin->table_id] = table;
+        tables.push_back({std::move(table), begin, end});
+      }
+      begin = end;
     }
+  }
 
-    for (const auto& columns : itr->second) {
-      if (columns.first == kExistsColumn) {
-        Cell& cell = itr->second[kExistsColumn];
-        cell[timestamp] = zetasql::values::Bool(false);
-        RemoveExpiredVersions(cell, timestamp);
-      } else {
-        // Column values are marked invalid zetasql::Value to avoid reading
-        // the value of the cell before the delete.
-        Cell& cell = itr->second[columns.first];
-        cell[timestamp] = zetasql::Value();
-        RemoveExpiredVersions(cell, timestamp);
+  for (const TableOps& table_ops : tables) {
+    Table* table = table_ops.table.get();
+    absl::MutexLock lock(&table->mu);
+    absl::btree_map<Key, Row>& rows = table->rows;
+
+    // Rows are visited in key order, so each row is found by starting from the
+    // row of the previous op, which is constant time when rows are appended to
+    // the table or written in a dense key range.
+    auto hint = rows.end();
+    const std::vector<ColumnID>* column_ids = nullptr;
+    std::vector<int> slots;
+    int64_t bytes = 0;
+    for (auto op = table_ops.begin; op != table_ops.end; ++op) {
+      if (op->is_delete) {
+        auto row_itr = hint != rows.end() && hint->first == op->key
+                           ? hint
+                           : rows.find(op->key);
+        if (row_itr != rows.end()) {
+          bytes += DeleteRow(row_itr->second, timestamp);
+          hint = row_itr;
+        }
+        continue;
+      }
+
+      // Ops of the same table usually write the same columns.
+      if (column_ids == nullptr || *column_ids != op->column_ids) {
+        column_ids = &op->column_ids;
+        slots = table->FindOrAddColumnSlots(*column_ids);
       }
+      size_t num_rows = rows.size();
+      auto row_itr = rows.try_emplace(hint, op->key);
+      if (rows.size() > num_rows) {
+        bytes += RowOverheadBytes(op->key);
+      }
+      bytes += WriteRow(row_itr->second, timestamp, slots, op->values);
+      hint = row_itr;
     }
+    AddSizeBytes(table, bytes);
   }
   return absl::OkStatus();
 }
@@ -271,47 +593,198 @@ void InMemoryStorage::SetVersionRetentionPeriod(
   version_retention_period_ = version_retention_period;
 }
 
+absl::Time InMemoryStorage::RetentionExpirationTime(absl::Time timestamp) {
+  absl::MutexLock lock(&version_retention_period_mu_);
+  return timestamp - version_retention_period_;
+}
+
+bool InMemoryStorage::IsExpired(const Row& row, absl::Time expiration_time) {
+  return row.exists.size() == 1 && !row.exists.front().second &&
+         row.exists.front().first <= expiration_time;
+}
+
+int64_t InMemoryStorage::RemoveExpiredVersions(Row& row,
+                                               absl::Time expiration_time) {
+  int64_t bytes = TrimVersions(row.exists, expiration_time);
+  for (Cell& cell : row.cells) {
+    bytes += TrimVersions(cell, expiration_time);
+  }
+  return bytes;
+}
+
+int64_t InMemoryStorage::CollectExpiredVersions(absl::Time timestamp,
+                                                int max_rows) {
+  absl::Time expiration_time = RetentionExpirationTime(timestamp);
+  absl::MutexLock gc_lock(&gc_mu_);
+
+  // Tables are swept in order of their ids, so that the sweep resumes where the
+  // previous call left off even as tables are added and dropped.
+  std::vector<std::pair<TableID, std::shared_ptr<Table>>> tables;
+  {
+    absl::ReaderMutexLock lock(&mu_);
+    tables.assign(tables_.begin(), tables_.end());
+  }
+  std::sort(tables.begin(), tables.end(),
+            [](const auto& a, const auto& b) { return a.first < b.first; });
+
+  int64_t bytes = 0;
+  int rows_visited = 0;
+  auto table_itr = std::lower_bound(
+      tables.begin(), tables.end(), gc_table_id_,
+      [](const auto& table, const TableID& id) { return table.first < id; });
+  for (; table_itr != tables.end() && rows_visited < max_rows; ++table_itr) {
+    const auto& [table_id, table] = *table_itr;
+    int64_t table_bytes = 0;
+    if (table_id != gc_table_id_) {
+      gc_table_id_ = table_id;
+      gc_last_key_.reset();
+    }
+    absl::MutexLock lock(&table->mu);
+    auto row_itr = gc_last_key_.has_value()
+                       ? table->rows.upper_bound(*gc_last_key_)
+                       : table->rows.begin();
+    for (; row_itr != table->rows.end() && rows_visited < max_rows;
+         ++rows_visited) {
+      Row& row = row_itr->second;
+      table_bytes += RemoveExpiredVersions(row, expiration_time);
+      gc_last_key_ = row_itr->first;
+
+      // Rows which have been deleted for longer than the retention period can
+      // no longer be read, and are dropped along with their key.
+      if (IsExpired(row, expiration_time)) {
+        table_bytes +=
+            RowOverheadBytes(row_itr->first) + VersionsByteSize(row.exists);
+        for (const Cell& cell : row.cells) {
+          table_bytes += VersionsByteSize(cell);
+        }
+        row_itr = table->rows.erase(row_itr);
+      } else {
+        ++row_itr;
+      }
+    }
+    AddSizeBytes(table.get(), -table_bytes);
+    bytes += table_bytes;
+    if (row_itr != table->rows.end()) {
+      break;
+    }
+  }
+
+  // Start over from the first table once all tables have been swept.
+  if (table_itr == tables.end()) {
+    gc_table_id_.clear();
+    gc_last_key_.reset();
+  }
+  reclaimed_version_bytes_ += bytes;
+  return bytes;
+}
+
+int64_t InMemoryStorage::reclaimed_version_bytes() const {
+  return reclaimed_version_bytes_;
+}
+
+int64_t InMemoryStorage::RowOverheadBytes(const Key& key) {
+  return key.LogicalSizeInBytes() + sizeof(Row);
+}
+
+void InMemoryStorage::AddSizeBytes(Table* table, int64_t bytes) {
+  table->size_bytes += bytes;
+  size_bytes_ += bytes;
+}
+
+int64_t InMemoryStorage::size_bytes() const { return size_bytes_; }
+
+int64_t InMemoryStorage::TableSizeBytes(const TableID& table_id) const {
+  std::shared_ptr<const Table> table = FindTable(table_id);
+  if (table == nullptr) {
+    return 0;
+  }
+  absl::ReaderMutexLock lock(&table->mu);
+  return table->size_bytes;
+}
+
+absl::Status InMemoryStorage::CheckMemoryLimit(int64_t bytes) const {
+  int64_t size_bytes = size_bytes_ + bytes;
+  if (max_size_bytes_ > 0 && size_bytes > max_size_bytes_) {
+    return error::DatabaseMemoryLimitExceeded(size_bytes, max_size_bytes_);
+  }
+  return absl::OkStatus();
+}
+
 void InMemoryStorage::CleanUpDeletedTables(absl::Time timestamp) {
-  absl::MutexLock lock(&mu_);
-  absl::MutexLock version_retention_period_lock(&version_retention_period_mu_);
-  absl::Time expiration_time = timestamp - version_retention_period_;
+  absl::Time expiration_time = RetentionExpirationTime(timestamp);
+
+  // Remove expired dropped tables. Readers still holding a table keep it alive
+  // until they are done.
+  std::vector<std::shared_ptr<Table>> expired_tables;
+  {
+    absl::MutexLock lock(&mu_);
+    for (auto it = dropped_tables_.begin();
+         it != dropped_tables_.upper_bound(expiration_time);) {
+      auto table_itr = tables_.find(it->second);
+      if (table_itr != tables_.end()) {
+        expired_tables.push_back(std::move(table_itr->second));
+        tables_.erase(table_itr);
+      }
+      it = dropped_tables_.erase(it);
+    }
+  }
 
-  // Remove expired dropped tables.
-  for (auto it = dropped_tables_.begin();
-       it != dropped_tables_.upper_bound(expiration_time);) {
-    tables_.erase(it->second);
-    it = dropped_tables_.erase(it);
+  for (const std::shared_ptr<Table>& table : expired_tables) {
+    absl::MutexLock lock(&table->mu);
+    AddSizeBytes(table.get(), -table->size_bytes);
   }
 }
 
 void InMemoryStorage::CleanUpDeletedColumns(absl::Time timestamp) {
-  absl::MutexLock lock(&mu_);
-  absl::MutexLock version_retention_period_lock(&version_retention_period_mu_);
-  absl::Time expiration_time = timestamp - version_retention_period_;
-
-  // Remove expired dropped columns.
-  for (auto it = dropped_columns_.begin();
-       it != dropped_columns_.upper_bound(expiration_time);) {
-    auto [table_id, column_id] = it->second;
-    for (auto& [_, row] : tables_[table_id]) {
-      row.erase(column_id);
+  absl::Time expiration_time = RetentionExpirationTime(timestamp);
+
+  // Collect the expired dropped columns under mu_, and erase their cells under
+  // the lock of each table so that other tables remain accessible.
+  std::vector<std::pair<std::shared_ptr<Table>, ColumnID>> expired_columns;
+  {
+    absl::MutexLock lock(&mu_);
+    for (auto it = dropped_columns_.begin();
+         it != dropped_columns_.upper_bound(expiration_time);) {
+      auto [table_id, column_id] = it->second;
+      auto table_itr = tables_.find(table_id);
+      if (table_itr != tables_.end()) {
+        expired_columns.emplace_back(table_itr->second, column_id);
+      }
+      it = dropped_columns_.erase(it);
+    }
+  }
+
+  for (const auto& [table, column_id] : expired_columns) {
+    absl::MutexLock lock(&table->mu);
+    auto slot_itr = table->column_slots.find(column_id);
+    if (slot_itr == table->column_slots.end()) {
+      continue;
+    }
+    int slot = slot_itr->second;
+    table->column_slots.erase(slot_itr);
+    int64_t bytes = 0;
+    for (auto& [_, row] : table->rows) {
+      if (slot < static_cast<int>(row.cells.size())) {
+        bytes += VersionsByteSize(row.cells[slot]);
+        row.cells[slot] = Cell();
+      }
     }
-    it = dropped_columns_.erase(it);
+    AddSizeBytes(table.get(), -bytes);
   }
 }
 
 void InMemoryStorage::MarkDroppedTable(absl::Time timestamp,
                                        TableID dropped_table_id) {
   absl::MutexLock lock(&mu_);
-  dropped_tables_[timestamp] = dropped_table_id;
+  dropped_tables_.emplace(timestamp, dropped_table_id);
 }
 
 void InMemoryStorage::MarkDroppedColumn(absl::Time timestamp,
                                         TableID dropped_table_id,
                                         ColumnID dropped_column_id) {
   absl::MutexLock lock(&mu_);
-  dropped_columns_[timestamp] =
-      std::make_pair(dropped_table_id, dropped_column_id);
+  dropped_columns_.emplace(timestamp,
+                           std::make_pair(dropped_table_id, dropped_column_id));
 }
 
 }  // namespace backend
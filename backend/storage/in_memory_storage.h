@@ -17,7 +17,20 @@
 #ifndef THIRD_PARTY_CLOUD_SPANNER_EMULATOR_BACKEND_STORAGE_IN_MEMORY_STORAGE_H_
 #define THIRD_PARTY_CLOUD_SPANNER_EMULATOR_BACKEND_STORAGE_IN_MEMORY_STORAGE_H_
 
+#include <atomic>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <optional>
+#include <utility>
+#include <vector>
+
 #include "zetasql/public/value.h"
+#include "absl/base/thread_annotations.h"
+#include "absl/container/btree_map.h"
+#include "absl/container/flat_hash_map.h"
+#include "absl/container/inlined_vector.h"
+#include "absl/synchronization/mutex.h"
 #include "absl/time/time.h"
 #include "backend/common/ids.h"
 #include "backend/datamodel/key.h"
@@ -33,15 +46,34 @@ namespace backend {
 
 // InMemoryStorage implements an in-memory multi-version data store.
 //
-// Keys are stored in sorted order. Value versions for a given column are also
-// sorted in order of the timestamp written. Keys are never deleted, but are
-// marked deleted for multi-version lookup.
+// Keys are stored in sorted order in a B-tree. Each table assigns its columns
+// a slot the first time they are written, and a row holds its cells in a
+// vector indexed by slot. Value versions for a given cell are kept in a small
+// vector sorted in order of the timestamp written, with a single version
+// stored inline. Deleted keys are marked deleted for multi-version lookup.
+//
+// Writes never remove old versions. Versions which fell out of the version
+// retention period, and keys which have been deleted for longer than it, are
+// reclaimed incrementally by CollectExpiredVersions, which sweeps the tables in
+// key order a bounded number of rows at a time.
+//
+// The memory used by each table is estimated as it is written to, and can be
+// capped for the whole storage.
 //
 // Lookup and Read return invalid zetasql::Value(s) for non-existent columns.
+// Iterators returned by Read walk the table lazily and must not outlive the
+// storage they were read from.
 //
-// This class is thread-safe.
+// This class is thread-safe. Each table is guarded by its own reader/writer
+// lock, so reads of a table proceed in parallel with each other and with
+// writes to other tables. The table map itself is guarded by mu_, which is
+// only held long enough to find or create a table.
 class InMemoryStorage : public Storage {
  public:
+  // A 'max_size_bytes' of zero means the storage has no memory limit.
+  explicit InMemoryStorage(int64_t max_size_bytes = 0)
+      : max_size_bytes_(max_size_bytes) {}
+
   absl::Status Lookup(absl::Time timestamp, const TableID& table_id,
                       const Key& key, const std::vector<ColumnID>& column_ids,
                       std::vector<zetasql::Value>* values) const override
@@ -62,6 +94,10 @@ class InMemoryStorage : public Storage {
                       const KeyRange& key_range) override
       ABSL_LOCKS_EXCLUDED(mu_);
 
+  absl::Status ApplyBatch(absl::Time timestamp,
+                          std::vector<StorageWriteOp> ops) override
+      ABSL_LOCKS_EXCLUDED(mu_);
+
   void SetVersionRetentionPeriod(
       absl::Duration version_retention_period) override;
 
@@ -78,35 +114,144 @@ class InMemoryStorage : public Storage {
                          ColumnID dropped_column_id) override
       ABSL_LOCKS_EXCLUDED(mu_);
 
+  int64_t CollectExpiredVersions(absl::Time timestamp, int max_rows) override
+      ABSL_LOCKS_EXCLUDED(mu_, gc_mu_);
+
+  int64_t reclaimed_version_bytes() const override;
+
+  int64_t size_bytes() const override;
+
+  int64_t TableSizeBytes(const TableID& table_id) const override
+      ABSL_LOCKS_EXCLUDED(mu_);
+
+  absl::Status CheckMemoryLimit(int64_t bytes) const override;
+
  private:
-  using Cell = std::map<absl::Time, zetasql::Value>;
-  using Row = absl::flat_hash_map<ColumnID, Cell>;
-  using Table = std::map<Key, Row>;
-  using Tables = absl::flat_hash_map<TableID, Table>;
+  // StorageIterator which walks a key range of a table lazily. Defined in
+  // in_memory_storage.cc.
+  class RowIterator;
+
+  // Versions of a value sorted by commit timestamp. Most cells are written
+  // once between version cleanups, so a single version is stored inline.
+  template <typename T>
+  using Versions = absl::InlinedVector<std::pair<absl::Time, T>, 1>;
+  using Cell = Versions<zetasql::Value>;
+
+  struct Row {
+    // Versions of the existence of the row.
+    Versions<bool> exists;
+
+    // Cells of the row indexed by column slot. Columns which were never
+    // written to in this row may be missing or empty.
+    std::vector<Cell> cells;
+  };
+
+  // The rows of a single table, guarded by a per-table reader/writer lock.
+  // Tables are shared with in-flight readers so that dropping a table does not
+  // invalidate their iterators.
+  struct Table {
+    mutable absl::Mutex mu;
+
+    // Slot of each column written to the table. Slots are never reused, so
+    // that cells of dropped columns are never read back as another column.
+    absl::flat_hash_map<ColumnID, int> column_slots ABSL_GUARDED_BY(mu);
+    int num_column_slots ABSL_GUARDED_BY(mu) = 0;
+
+    absl::btree_map<Key, Row> rows ABSL_GUARDED_BY(mu);
+
+    // Estimated memory used by the rows of the table.
+    int64_t size_bytes ABSL_GUARDED_BY(mu) = 0;
+
+    // Returns the slots of the given columns, with -1 for columns which were
+    // never written to the table.
+    std::vector<int> FindColumnSlots(const std::vector<ColumnID>& column_ids)
+        const ABSL_SHARED_LOCKS_REQUIRED(mu);
+
+    // Returns the slot of the given column, assigning one if needed.
+    int FindOrAddColumnSlot(const ColumnID& column_id)
+        ABSL_EXCLUSIVE_LOCKS_REQUIRED(mu);
+
+    // Returns the slots of the given columns, assigning them if needed.
+    std::vector<int> FindOrAddColumnSlots(
+        const std::vector<ColumnID>& column_ids)
+        ABSL_EXCLUSIVE_LOCKS_REQUIRED(mu);
+  };
+  using Tables = absl::flat_hash_map<TableID, std::shared_ptr<Table>>;
+
+  // Returns the table with the given id, or nullptr if it does not exist.
+  std::shared_ptr<Table> FindTable(const TableID& table_id) const
+      ABSL_LOCKS_EXCLUDED(mu_);
+
+  // Returns the table with the given id, creating it if it does not exist.
+  std::shared_ptr<Table> FindOrCreateTable(const TableID& table_id)
+      ABSL_LOCKS_EXCLUDED(mu_);
+
+  // Adds 'bytes' to the estimated memory used by 'table' and the storage.
+  void AddSizeBytes(Table* table, int64_t bytes)
+      ABSL_EXCLUSIVE_LOCKS_REQUIRED(table->mu);
+
+  // Returns the estimated memory used by a row with the given key, excluding
+  // its versions.
+  static int64_t RowOverheadBytes(const Key& key);
+
+  // Sets the cells of 'row' in the given column slots at 'timestamp', marking
+  // the row as existing, and returns the change in its estimated memory.
+  static int64_t WriteRow(Row& row, absl::Time timestamp,
+                          const std::vector<int>& slots,
+                          const std::vector<zetasql::Value>& values);
+
+  // Marks 'row' as deleted at 'timestamp' if it exists, and returns the change
+  // in its estimated memory.
+  static int64_t DeleteRow(Row& row, absl::Time timestamp);
 
   // Returns true if the given row is valid at the specified timestamp.
-  bool Exists(const Row& row, absl::Time timestamp) const
-      ABSL_EXCLUSIVE_LOCKS_REQUIRED(mu_);
+  static bool Exists(const Row& row, absl::Time timestamp);
+
+  // Returns the value for given row and column slot at the specified
+  // timestamp.
+  static zetasql::Value GetCellValueAtTimestamp(const Row& row, int slot,
+                                                  absl::Time timestamp);
 
-  // Returns the value for given row and column_id at the specified timestamp.
-  zetasql::Value GetCellValueAtTimestamp(const Row& row,
-                                           const ColumnID& column_id,
-                                           absl::Time timestamp) const
-      ABSL_EXCLUSIVE_LOCKS_REQUIRED(mu_);
+  // Removes the versions of 'row' which are no longer visible at or after
+  // 'expiration_time', and returns the estimated memory they held.
+  static int64_t RemoveExpiredVersions(Row& row, absl::Time expiration_time);
 
-  void RemoveExpiredVersions(Cell& cell, absl::Time timestamp);
+  // Returns true if 'row' does not exist at any timestamp at or after
+  // 'expiration_time'. Expects expired versions to have been removed.
+  static bool IsExpired(const Row& row, absl::Time expiration_time);
+
+  // Returns the timestamp before which versions fall out of the retention
+  // period, as of 'timestamp'.
+  absl::Time RetentionExpirationTime(absl::Time timestamp)
+      ABSL_LOCKS_EXCLUDED(version_retention_period_mu_);
 
   mutable absl::Mutex mu_;
   Tables tables_ ABSL_GUARDED_BY(mu_);
 
-  // Tracks when tables were dropped so that we can clean up the data.
-  std::map<absl::Time, TableID> dropped_tables_ ABSL_GUARDED_BY(mu_);
+  // Tracks when tables were dropped so that we can clean up the data. A single
+  // schema change may drop several tables at the same timestamp.
+  std::multimap<absl::Time, TableID> dropped_tables_ ABSL_GUARDED_BY(mu_);
 
   // Tracks when columns were dropped so that we can clean up the data.
-  std::map<absl::Time, std::pair<TableID, ColumnID>> dropped_columns_
+  std::multimap<absl::Time, std::pair<TableID, ColumnID>> dropped_columns_
       ABSL_GUARDED_BY(mu_);
 
-  mutable absl::Mutex version_retention_period_mu_ ABSL_ACQUIRED_AFTER(mu_);
+  // Position of the version garbage collection sweep: the table being swept,
+  // and the last key swept in it. Tables with smaller ids have already been
+  // swept in the current pass.
+  absl::Mutex gc_mu_ ABSL_ACQUIRED_BEFORE(mu_);
+  TableID gc_table_id_ ABSL_GUARDED_BY(gc_mu_);
+  std::optional<Key> gc_last_key_ ABSL_GUARDED_BY(gc_mu_);
+
+  // Estimated memory reclaimed by CollectExpiredVersions so far.
+  std::atomic<int64_t> reclaimed_version_bytes_ = 0;
+
+  // Estimated memory used by all tables, and the limit on it. A limit of zero
+  // means no limit.
+  std::atomic<int64_t> size_bytes_ = 0;
+  const int64_t max_size_bytes_;
+
+  mutable absl::Mutex version_retention_period_mu_;
   absl::Duration version_retention_period_
       ABSL_GUARDED_BY(version_retention_period_mu_) = absl::Hours(1);
 };
@@ -16,13 +16,19 @@
 
 #include "backend/storage/in_memory_storage.h"
 
+#include <cstdint>
 #include <memory>
+#include <thread>  // NOLINT
+#include <utility>
 #include <vector>
 
+#include "benchmark/benchmark.h"
 #include "gmock/gmock.h"
 #include "gtest/gtest.h"
 #include "zetasql/base/testing/status_matchers.h"
 #include "tests/common/proto_matchers.h"
+#include "absl/log/check.h"
+#include "absl/strings/str_cat.h"
 #include "absl/time/clock.h"
 #include "absl/time/time.h"
 #include "backend/datamodel/key_range.h"
@@ -680,6 +686,65 @@ TEST_F(InMemoryStorageTest, ReadUsingPrefixKeyRange) {
   EXPECT_FALSE(itr_->Next());
 }
 
+TEST_F(InMemoryStorageTest, ReadSpanningManyBatchesSkipsDeletedRows) {
+  absl::Time write_ts = absl::Now();
+  absl::Time delete_ts = write_ts + absl::Seconds(1);
+  absl::Time read_ts = delete_ts + absl::Seconds(1);
+  constexpr int kNumRows = 5000;
+
+  for (int i = 0; i < kNumRows; i++) {
+    ZETASQL_EXPECT_OK(storage_.Write(write_ts, kTableId0, Key({Int64(i)}),
+                             {kColumnID}, {Int64(i)}));
+  }
+  // Delete a long run of rows so that whole batches contain no live rows.
+  ZETASQL_EXPECT_OK(storage_.Delete(
+      delete_ts, kTableId0,
+      KeyRange::ClosedOpen(Key({Int64(10)}), Key({Int64(kNumRows - 10)}))));
+
+  ZETASQL_EXPECT_OK(
+      storage_.Read(read_ts, kTableId0, KeyRange::All(), {kColumnID}, &itr_));
+  std::vector<int64_t> keys;
+  while (itr_->Next()) {
+    EXPECT_EQ(itr_->Key().ColumnValue(0), itr_->ColumnValue(0));
+    keys.push_back(itr_->ColumnValue(0).int64_value());
+  }
+  ZETASQL_EXPECT_OK(itr_->Status());
+  ASSERT_EQ(keys.size(), 20);
+  EXPECT_EQ(keys.front(), 0);
+  EXPECT_EQ(keys.back(), kNumRows - 1);
+}
+
+TEST_F(InMemoryStorageTest, ReadIsUnaffectedByLaterWritesDuringIteration) {
+  absl::Time write_ts = absl::Now();
+  absl::Time read_ts = write_ts + absl::Seconds(1);
+  absl::Time later_ts = read_ts + absl::Seconds(1);
+  constexpr int kNumRows = 1000;
+
+  for (int i = 0; i < kNumRows; i += 2) {
+    ZETASQL_EXPECT_OK(storage_.Write(write_ts, kTableId0, Key({Int64(i)}),
+                             {kColumnID}, {String("old")}));
+  }
+
+  ZETASQL_EXPECT_OK(
+      storage_.Read(read_ts, kTableId0, KeyRange::All(), {kColumnID}, &itr_));
+  int num_rows = 0;
+  while (itr_->Next()) {
+    EXPECT_EQ(itr_->ColumnValue(0), String("old"));
+    // Interleave writes at a later timestamp with the iteration: new keys,
+    // overwrites of existing keys and deletes must not be visible.
+    int64_t key = itr_->Key().ColumnValue(0).int64_value();
+    ZETASQL_EXPECT_OK(storage_.Write(later_ts, kTableId0, Key({Int64(key + 1)}),
+                             {kColumnID}, {String("new")}));
+    ZETASQL_EXPECT_OK(storage_.Write(later_ts, kTableId0, Key({Int64(key + 2)}),
+                             {kColumnID}, {String("new")}));
+    ZETASQL_EXPECT_OK(storage_.Delete(later_ts, kTableId0,
+                              KeyRange::Point(Key({Int64(key)}))));
+    ++num_rows;
+  }
+  ZETASQL_EXPECT_OK(itr_->Status());
+  EXPECT_EQ(num_rows, kNumRows / 2);
+}
+
 TEST_F(InMemoryStorageTest,
        ReadUsingInvalidKeyRangeEndpointsReturnsInternalError) {
   absl::Time t0 = absl::Now();
@@ -726,6 +791,92 @@ TEST_F(InMemoryStorageTest, DroppedTablesAreRemovedAfterRetentionPeriod) {
       storage_.Lookup(t0, kTableId1, Key({Int64(10)}), {kColumnID}, &values));
 }
 
+TEST_F(InMemoryStorageTest, TablesDroppedAtTheSameTimestampAreAllRemoved) {
+  absl::Time t0 = absl::Now();
+  ZETASQL_EXPECT_OK(storage_.Write(t0, kTableId0, Key({Int64(1)}), {kColumnID},
+                           {String("value-1")}));
+  ZETASQL_EXPECT_OK(storage_.Write(t0, kTableId1, Key({Int64(10)}), {kColumnID},
+                           {String("value-10")}));
+
+  // A schema change drops both tables at once.
+  storage_.MarkDroppedTable(t0, kTableId0);
+  storage_.MarkDroppedTable(t0, kTableId1);
+  storage_.CleanUpDeletedTables(t0 + absl::Hours(1) + absl::Seconds(1));
+
+  std::vector<zetasql::Value> values;
+  EXPECT_THAT(
+      storage_.Lookup(t0, kTableId0, Key({Int64(1)}), {kColumnID}, &values),
+      zetasql_base::testing::StatusIs(absl::StatusCode::kNotFound));
+  EXPECT_THAT(
+      storage_.Lookup(t0, kTableId1, Key({Int64(10)}), {kColumnID}, &values),
+      zetasql_base::testing::StatusIs(absl::StatusCode::kNotFound));
+  EXPECT_EQ(storage_.size_bytes(), 0);
+}
+
+TEST_F(InMemoryStorageTest, InFlightReadSurvivesDroppedTableCleanup) {
+  absl::Time t0 = absl::Now();
+  for (int i = 0; i < 3; i++) {
+    ZETASQL_EXPECT_OK(storage_.Write(t0, kTableId0, Key({Int64(i)}), {kColumnID},
+                             {Int64(i)}));
+  }
+
+  ZETASQL_EXPECT_OK(storage_.Read(t0, kTableId0, kKeyRange0To5, {kColumnID}, &itr_));
+  ASSERT_TRUE(itr_->Next());
+  EXPECT_EQ(itr_->Key(), Key({Int64(0)}));
+
+  // Drop and expire the table while the read is in progress.
+  storage_.MarkDroppedTable(t0, kTableId0);
+  storage_.CleanUpDeletedTables(t0 + absl::Hours(1) + absl::Seconds(1));
+
+  // The read still sees the rest of the table.
+  ASSERT_TRUE(itr_->Next());
+  EXPECT_EQ(itr_->Key(), Key({Int64(1)}));
+  ASSERT_TRUE(itr_->Next());
+  EXPECT_EQ(itr_->Key(), Key({Int64(2)}));
+  EXPECT_FALSE(itr_->Next());
+  ZETASQL_EXPECT_OK(itr_->Status());
+}
+
+TEST_F(InMemoryStorageTest, ConcurrentReadsAndWritesOnDifferentTables) {
+  absl::Time t0 = absl::Now();
+  constexpr int kNumThreads = 8;
+  constexpr int kNumRows = 100;
+
+  // Each thread writes its own table and reads it back, while also reading a
+  // table shared by all threads. Concurrent access issues are expected to be
+  // caught by tsan.
+  for (int i = 0; i < kNumRows; ++i) {
+    ZETASQL_EXPECT_OK(storage_.Write(t0, kTableId0, Key({Int64(i)}), {kColumnID},
+                             {Int64(i)}));
+  }
+  std::vector<std::thread> threads;
+  for (int t = 0; t < kNumThreads; ++t) {
+    threads.emplace_back([this, t, t0]() {
+      TableID table_id = absl::StrCat("thread_table:", t);
+      for (int i = 0; i < kNumRows; ++i) {
+        ZETASQL_EXPECT_OK(storage_.Write(t0, table_id, Key({Int64(i)}),
+                                 {kColumnID}, {Int64(i)}));
+      }
+      for (const TableID& read_table_id : {table_id, kTableId0}) {
+        std::unique_ptr<StorageIterator> itr;
+        ZETASQL_EXPECT_OK(storage_.Read(
+            t0, read_table_id,
+            KeyRange::ClosedOpen(Key({Int64(0)}), Key({Int64(kNumRows)})),
+            {kColumnID}, &itr));
+        int num_rows = 0;
+        while (itr->Next()) {
+          EXPECT_EQ(itr->ColumnValue(0), Int64(num_rows));
+          ++num_rows;
+        }
+        EXPECT_EQ(num_rows, kNumRows);
+      }
+    });
+  }
+  for (std::thread& thread : threads) {
+    thread.join();
+  }
+}
+
 TEST_F(InMemoryStorageTest, DroppedColumnsAreRemovedAfterRetentionPeriod) {
   absl::Time t0 = absl::Now();
 
@@ -748,6 +899,29 @@ TEST_F(InMemoryStorageTest, DroppedColumnsAreRemovedAfterRetentionPeriod) {
   }
 }
 
+TEST_F(InMemoryStorageTest, ColumnsAddedAfterDroppedColumnsAreReadBack) {
+  absl::Time t0 = absl::Now();
+  const ColumnID kColumnID1 = "test_column:1";
+  const ColumnID kColumnID2 = "test_column:2";
+  ZETASQL_EXPECT_OK(storage_.Write(t0, kTableId0, Key({Int64(1)}),
+                           {kColumnID, kColumnID1},
+                           {String("value-0"), String("value-1")}));
+
+  // Drop and expire the first column, then write to a new column.
+  storage_.MarkDroppedColumn(t0, kTableId0, kColumnID);
+  absl::Time t1 = t0 + absl::Hours(1) + absl::Seconds(1);
+  storage_.CleanUpDeletedColumns(t1);
+  ZETASQL_EXPECT_OK(storage_.Write(t1, kTableId0, Key({Int64(1)}), {kColumnID2},
+                           {String("value-2")}));
+
+  std::vector<zetasql::Value> values;
+  ZETASQL_EXPECT_OK(storage_.Lookup(t1, kTableId0, Key({Int64(1)}),
+                            {kColumnID, kColumnID1, kColumnID2}, &values));
+  EXPECT_THAT(values,
+              testing::ElementsAre(zetasql::Value(), String("value-1"),
+                                   String("value-2")));
+}
+
 TEST_F(InMemoryStorageTest, ExpiredCellsThatCoverRetentionPeriodAreKept) {
   absl::Time t0 = absl::Now();
   absl::Time t1 = t0 + absl::Minutes(10);
@@ -761,9 +935,10 @@ TEST_F(InMemoryStorageTest, ExpiredCellsThatCoverRetentionPeriodAreKept) {
   ZETASQL_EXPECT_OK(storage_.Write(t2, kTableId0, Key({Int64(1)}), {kColumnID},
                            {String("value-2")}));
 
-  // Write to remove expired values.
+  // Remove expired values.
   ZETASQL_EXPECT_OK(storage_.Write(t3, kTableId0, Key({Int64(1)}), {kColumnID},
                            {String("value-3")}));
+  storage_.CollectExpiredVersions(t3, /*max_rows=*/100);
 
   // Lookup of t1 should return the first value which shouldn't be cleaned up
   // because it covers the retention period.
@@ -774,6 +949,7 @@ TEST_F(InMemoryStorageTest, ExpiredCellsThatCoverRetentionPeriodAreKept) {
 
   ZETASQL_EXPECT_OK(storage_.Write(t4, kTableId0, Key({Int64(1)}), {kColumnID},
                            {String("value-4")}));
+  storage_.CollectExpiredVersions(t4, /*max_rows=*/100);
 
   // Lookup of t1 should return an empty value because the first value was
   // cleaned up as it doesn't cover the retention period.
@@ -783,7 +959,26 @@ TEST_F(InMemoryStorageTest, ExpiredCellsThatCoverRetentionPeriodAreKept) {
   EXPECT_THAT(values, testing::ElementsAre(zetasql::Value()));
 }
 
-TEST_F(InMemoryStorageTest, RemoveExpiredVersionsFromCellOnWrite) {
+TEST_F(InMemoryStorageTest, WritesDoNotRemoveExpiredVersions) {
+  absl::Time t0 = absl::Now();
+  absl::Time t1 = t0 + absl::Seconds(1);
+  absl::Time t2 = t1 + absl::Hours(1);
+
+  ZETASQL_EXPECT_OK(storage_.Write(t0, kTableId0, Key({Int64(1)}), {kColumnID},
+                           {String("value-0")}));
+  ZETASQL_EXPECT_OK(storage_.Write(t1, kTableId0, Key({Int64(1)}), {kColumnID},
+                           {String("value-1")}));
+  ZETASQL_EXPECT_OK(storage_.Write(t2, kTableId0, Key({Int64(1)}), {kColumnID},
+                           {String("value-2")}));
+
+  // The t0 value expired, but is only removed by CollectExpiredVersions.
+  std::vector<zetasql::Value> values;
+  ZETASQL_EXPECT_OK(
+      storage_.Lookup(t0, kTableId0, Key({Int64(1)}), {kColumnID}, &values));
+  EXPECT_THAT(values, testing::ElementsAre(String("value-0")));
+}
+
+TEST_F(InMemoryStorageTest, CollectExpiredVersionsFromWrittenCell) {
   absl::Time t0 = absl::Now();
   absl::Time t1 = t0 + absl::Seconds(1);
   absl::Time t2 = t1 + absl::Hours(1);
@@ -794,9 +989,10 @@ TEST_F(InMemoryStorageTest, RemoveExpiredVersionsFromCellOnWrite) {
   ZETASQL_EXPECT_OK(storage_.Write(t1, kTableId0, Key({Int64(1)}), {kColumnID},
                            {String("value-1")}));
 
-  // Write should remove the t0 value as that will be expired.
+  // Collection should remove the t0 value as that will be expired.
   ZETASQL_EXPECT_OK(storage_.Write(t2, kTableId0, Key({Int64(1)}), {kColumnID},
                            {String("value-2")}));
+  EXPECT_GT(storage_.CollectExpiredVersions(t2, /*max_rows=*/100), 0);
 
   // Lookup of t0 should return an empty value because the value was cleaned up.
   std::vector<zetasql::Value> values;
@@ -805,7 +1001,7 @@ TEST_F(InMemoryStorageTest, RemoveExpiredVersionsFromCellOnWrite) {
   EXPECT_THAT(values, testing::ElementsAre(zetasql::Value()));
 }
 
-TEST_F(InMemoryStorageTest, RemoveExpiredVersionsFromCellOnDelete) {
+TEST_F(InMemoryStorageTest, CollectExpiredVersionsFromDeletedCell) {
   absl::Time t0 = absl::Now();
   absl::Time t1 = t0 + absl::Seconds(1);
   absl::Time t2 = t1 + absl::Hours(1);
@@ -816,8 +1012,9 @@ TEST_F(InMemoryStorageTest, RemoveExpiredVersionsFromCellOnDelete) {
   ZETASQL_EXPECT_OK(storage_.Write(t1, kTableId0, Key({Int64(1)}), {kColumnID},
                            {String("value-1")}));
 
-  // Delete should remove the t0 value as that will be expired.
+  // Collection should remove the t0 value as that will be expired.
   ZETASQL_EXPECT_OK(storage_.Delete(t2, kTableId0, KeyRange::Point(Key({Int64(1)}))));
+  EXPECT_GT(storage_.CollectExpiredVersions(t2, /*max_rows=*/100), 0);
 
   // Lookup of t0 should return an empty value because the value was cleaned up.
   std::vector<zetasql::Value> values;
@@ -826,8 +1023,314 @@ TEST_F(InMemoryStorageTest, RemoveExpiredVersionsFromCellOnDelete) {
   EXPECT_THAT(values, testing::ElementsAre(zetasql::Value()));
 }
 
+TEST_F(InMemoryStorageTest, CollectExpiredVersionsDropsExpiredDeletedRows) {
+  absl::Time t0 = absl::Now();
+  absl::Time t1 = t0 + absl::Seconds(1);
+  absl::Time t2 = t1 + absl::Hours(1) + absl::Seconds(1);
+
+  ZETASQL_EXPECT_OK(storage_.Write(t0, kTableId0, Key({Int64(1)}), {kColumnID},
+                           {String("value-1")}));
+  ZETASQL_EXPECT_OK(storage_.Write(t0, kTableId0, Key({Int64(2)}), {kColumnID},
+                           {String("value-2")}));
+  ZETASQL_EXPECT_OK(storage_.Delete(t1, kTableId0, KeyRange::Point(Key({Int64(1)}))));
+
+  // The deleted row is still within the retention period.
+  EXPECT_EQ(storage_.CollectExpiredVersions(t1, /*max_rows=*/100), 0);
+
+  // Once the delete expires the row can no longer be read and is dropped,
+  // while the live row keeps its only version.
+  int64_t reclaimed = storage_.CollectExpiredVersions(t2, /*max_rows=*/100);
+  EXPECT_GT(reclaimed, 0);
+  EXPECT_EQ(storage_.reclaimed_version_bytes(), reclaimed);
+  EXPECT_EQ(storage_.CollectExpiredVersions(t2, /*max_rows=*/100), 0);
+
+  std::unique_ptr<StorageIterator> itr;
+  ZETASQL_EXPECT_OK(storage_.Read(t1 - absl::Microseconds(1), kTableId0,
+                          KeyRange::All(), {kColumnID}, &itr));
+  std::vector<Key> keys;
+  while (itr->Next()) {
+    keys.push_back(itr->Key());
+  }
+  EXPECT_THAT(keys, testing::ElementsAre(Key({Int64(2)})));
+
+  // The key can be written again.
+  ZETASQL_EXPECT_OK(storage_.Write(t2, kTableId0, Key({Int64(1)}), {kColumnID},
+                           {String("value-3")}));
+  std::vector<zetasql::Value> values;
+  ZETASQL_EXPECT_OK(
+      storage_.Lookup(t2, kTableId0, Key({Int64(1)}), {kColumnID}, &values));
+  EXPECT_THAT(values, testing::ElementsAre(String("value-3")));
+}
+
+TEST_F(InMemoryStorageTest, CollectExpiredVersionsResumesAcrossCalls) {
+  absl::Time t0 = absl::Now();
+  absl::Time t1 = t0 + absl::Seconds(1);
+  absl::Time t2 = t1 + absl::Hours(1) + absl::Seconds(1);
+
+  // Delete 3 rows of each of two tables.
+  for (const TableID& table_id : {kTableId0, kTableId1}) {
+    for (int i = 0; i < 3; ++i) {
+      ZETASQL_EXPECT_OK(storage_.Write(t0, table_id, Key({Int64(i)}), {kColumnID},
+                               {String("value")}));
+    }
+    ZETASQL_EXPECT_OK(storage_.Delete(t1, table_id, KeyRange::All()));
+  }
+
+  // Each call reclaims at most 'max_rows' rows, continuing from the last row
+  // visited by the previous call, including into the next table.
+  int64_t reclaimed = storage_.CollectExpiredVersions(t2, /*max_rows=*/2);
+  EXPECT_GT(reclaimed, 0);
+  for (int i = 0; i < 2; ++i) {
+    EXPECT_EQ(storage_.CollectExpiredVersions(t2, /*max_rows=*/2), reclaimed);
+  }
+
+  // All rows have been dropped, so the next pass has nothing to reclaim.
+  EXPECT_EQ(storage_.CollectExpiredVersions(t2, /*max_rows=*/2), 0);
+  EXPECT_EQ(storage_.reclaimed_version_bytes(), 3 * reclaimed);
+}
+
+TEST_F(InMemoryStorageTest, TracksEstimatedMemoryOfTables) {
+  absl::Time t0 = absl::Now();
+  absl::Time t1 = t0 + absl::Seconds(1);
+  absl::Time t2 = t1 + absl::Hours(1) + absl::Seconds(1);
+  EXPECT_EQ(storage_.size_bytes(), 0);
+  EXPECT_EQ(storage_.TableSizeBytes(kTableId0), 0);
+
+  ZETASQL_EXPECT_OK(storage_.Write(t0, kTableId0, Key({Int64(1)}), {kColumnID},
+                           {String("value-1")}));
+  int64_t row_bytes = storage_.TableSizeBytes(kTableId0);
+  EXPECT_GT(row_bytes, 0);
+
+  // Overwriting a version with a larger value grows the table.
+  ZETASQL_EXPECT_OK(storage_.Write(t0, kTableId0, Key({Int64(1)}), {kColumnID},
+                           {String("a much longer value-1")}));
+  int64_t overwritten_row_bytes = storage_.TableSizeBytes(kTableId0);
+  EXPECT_GT(overwritten_row_bytes, row_bytes);
+
+  ZETASQL_EXPECT_OK(storage_.Write(t0, kTableId1, Key({Int64(1)}), {kColumnID},
+                           {String("value-1")}));
+  EXPECT_EQ(storage_.TableSizeBytes(kTableId1), row_bytes);
+  EXPECT_EQ(storage_.size_bytes(), overwritten_row_bytes + row_bytes);
+
+  // Deleted rows keep their versions until they expire.
+  ZETASQL_EXPECT_OK(storage_.Delete(t1, kTableId0, KeyRange::Point(Key({Int64(1)}))));
+  EXPECT_GT(storage_.TableSizeBytes(kTableId0), overwritten_row_bytes);
+
+  storage_.CollectExpiredVersions(t2, /*max_rows=*/100);
+  EXPECT_EQ(storage_.TableSizeBytes(kTableId0), 0);
+  EXPECT_EQ(storage_.size_bytes(), row_bytes);
+
+  // Dropped tables no longer count once they are cleaned up.
+  storage_.MarkDroppedTable(t1, kTableId1);
+  storage_.CleanUpDeletedTables(t2);
+  EXPECT_EQ(storage_.TableSizeBytes(kTableId1), 0);
+  EXPECT_EQ(storage_.size_bytes(), 0);
+}
+
+TEST_F(InMemoryStorageTest, ApplyBatchWritesAndDeletesAcrossTables) {
+  absl::Time t0 = absl::Now();
+  absl::Time t1 = t0 + absl::Seconds(1);
+  ZETASQL_EXPECT_OK(storage_.Write(t0, kTableId0, Key({Int64(2)}), {kColumnID},
+                           {String("old-2")}));
+  ZETASQL_EXPECT_OK(storage_.Write(t0, kTableId0, Key({Int64(3)}), {kColumnID},
+                           {String("old-3")}));
+
+  // Ops are given out of key and table order. The delete and the insert of key
+  // 3 apply in the order given.
+  std::vector<StorageWriteOp> ops;
+  ops.push_back({.table_id = kTableId0,
+                 .key = Key({Int64(4)}),
+                 .column_ids = {kColumnID},
+                 .values = {String("value-4")}});
+  ops.push_back({.table_id = kTableId1,
+                 .key = Key({Int64(1)}),
+                 .column_ids = {kColumnID},
+                 .values = {String("value-10")}});
+  ops.push_back(
+      {.table_id = kTableId0, .key = Key({Int64(3)}), .is_delete = true});
+  ops.push_back({.table_id = kTableId0,
+                 .key = Key({Int64(3)}),
+                 .column_ids = {kColumnID},
+                 .values = {String("value-3")}});
+  ops.push_back(
+      {.table_id = kTableId0, .key = Key({Int64(2)}), .is_delete = true});
+  ops.push_back({.table_id = kTableId0,
+                 .key = Key({Int64(1)}),
+                 .column_ids = {kColumnID},
+                 .values = {String("value-1")}});
+  ZETASQL_EXPECT_OK(storage_.ApplyBatch(t1, std::move(ops)));
+
+  ZETASQL_EXPECT_OK(storage_.Read(t1, kTableId0, kKeyRange0To5, {kColumnID}, &itr_));
+  std::vector<std::pair<Key, zetasql::Value>> rows;
+  while (itr_->Next()) {
+    rows.emplace_back(itr_->Key(), itr_->ColumnValue(0));
+  }
+  EXPECT_THAT(rows, testing::ElementsAre(
+                        testing::Pair(Key({Int64(1)}), String("value-1")),
+                        testing::Pair(Key({Int64(3)}), String("value-3")),
+                        testing::Pair(Key({Int64(4)}), String("value-4"))));
+
+  std::vector<zetasql::Value> values;
+  ZETASQL_EXPECT_OK(
+      storage_.Lookup(t1, kTableId1, Key({Int64(1)}), {kColumnID}, &values));
+  EXPECT_THAT(values, testing::ElementsAre(String("value-10")));
+
+  // Older versions are still visible.
+  ZETASQL_EXPECT_OK(
+      storage_.Lookup(t0, kTableId0, Key({Int64(2)}), {kColumnID}, &values));
+  EXPECT_THAT(values, testing::ElementsAre(String("old-2")));
+}
+
+TEST_F(InMemoryStorageTest, ApplyBatchAccountsForMemoryLikeWrites) {
+  InMemoryStorage batched_storage;
+  absl::Time t0 = absl::Now();
+  std::vector<StorageWriteOp> ops;
+  for (int i = 0; i < 10; ++i) {
+    ZETASQL_EXPECT_OK(storage_.Write(t0, kTableId0, Key({Int64(i)}), {kColumnID},
+                             {String(absl::StrCat("value-", i))}));
+    ops.push_back({.table_id = kTableId0,
+                   .key = Key({Int64(i)}),
+                   .column_ids = {kColumnID},
+                   .values = {String(absl::StrCat("value-", i))}});
+  }
+  ZETASQL_EXPECT_OK(batched_storage.ApplyBatch(t0, std::move(ops)));
+  EXPECT_EQ(batched_storage.size_bytes(), storage_.size_bytes());
+
+  // Deleting from a table which does not exist does not create it.
+  std::vector<StorageWriteOp> deletes = {
+      {.table_id = kTableId1, .key = Key({Int64(1)}), .is_delete = true}};
+  ZETASQL_EXPECT_OK(batched_storage.ApplyBatch(t0, std::move(deletes)));
+  EXPECT_EQ(batched_storage.TableSizeBytes(kTableId1), 0);
+}
+
+TEST_F(InMemoryStorageTest, ChecksMemoryLimit) {
+  InMemoryStorage storage(/*max_size_bytes=*/1000);
+  ZETASQL_EXPECT_OK(storage.CheckMemoryLimit(1000));
+  EXPECT_THAT(
+      storage.CheckMemoryLimit(1001),
+      zetasql_base::testing::StatusIs(absl::StatusCode::kResourceExhausted));
+
+  ZETASQL_EXPECT_OK(storage.Write(absl::Now(), kTableId0, Key({Int64(1)}),
+                          {kColumnID}, {String("value-1")}));
+  EXPECT_THAT(
+      storage.CheckMemoryLimit(1000),
+      zetasql_base::testing::StatusIs(absl::StatusCode::kResourceExhausted));
+
+  // Storage without a limit accepts any write.
+  ZETASQL_EXPECT_OK(storage_.CheckMemoryLimit(int64_t{1} << 40));
+}
+
 }  // namespace
 
+// Populates 'storage' with a table of the given number of rows and INT64
+// columns, each cell written 'num_versions' times, and returns its column ids.
+std::vector<ColumnID> PopulateWideTable(InMemoryStorage* storage,
+                                        const TableID& table_id, int num_rows,
+                                        int num_columns, int num_versions,
+                                        absl::Time t0) {
+  std::vector<ColumnID> column_ids;
+  for (int c = 0; c < num_columns; ++c) {
+    column_ids.push_back(absl::StrCat(table_id, ":column:", c));
+  }
+  for (int v = 0; v < num_versions; ++v) {
+    std::vector<zetasql::Value> values(num_columns, Int64(v));
+    for (int r = 0; r < num_rows; ++r) {
+      ABSL_CHECK_OK(storage->Write(t0 + absl::Seconds(v), table_id,
+                                   Key({Int64(r)}), column_ids, values));
+    }
+  }
+  return column_ids;
+}
+
+void BM_InMemoryStorageScanWideTable(benchmark::State& state) {
+  int num_rows = state.range(0);
+  int num_columns = state.range(1);
+  int num_versions = state.range(2);
+
+  InMemoryStorage storage;
+  const TableID table_id = "wide_table";
+  absl::Time t0 = absl::Now();
+  std::vector<ColumnID> column_ids = PopulateWideTable(
+      &storage, table_id, num_rows, num_columns, num_versions, t0);
+  absl::Time read_time = t0 + absl::Seconds(num_versions);
+
+  for (auto _ : state) {
+    std::unique_ptr<StorageIterator> itr;
+    ABSL_CHECK_OK(storage.Read(read_time, table_id,
+                               KeyRange::All().ToClosedOpen(), column_ids,
+                               &itr));
+    int64_t sum = 0;
+    while (itr->Next()) {
+      for (int i = 0; i < itr->NumColumns(); ++i) {
+        sum += itr->ColumnValue(i).int64_value();
+      }
+    }
+    benchmark::DoNotOptimize(sum);
+  }
+  state.SetItemsProcessed(state.iterations() * num_rows * num_columns);
+}
+BENCHMARK(BM_InMemoryStorageScanWideTable)
+    ->Args({1000, 10, 1})
+    ->Args({1000, 100, 1})
+    ->Args({1000, 100, 4})
+    ->Args({100, 1000, 1});
+
+void BM_InMemoryStorageLookupWideTable(benchmark::State& state) {
+  int num_rows = state.range(0);
+  int num_columns = state.range(1);
+
+  InMemoryStorage storage;
+  const TableID table_id = "wide_table";
+  absl::Time t0 = absl::Now();
+  std::vector<ColumnID> column_ids = PopulateWideTable(
+      &storage, table_id, num_rows, num_columns, /*num_versions=*/1, t0);
+
+  int row = 0;
+  std::vector<zetasql::Value> values;
+  for (auto _ : state) {
+    ABSL_CHECK_OK(storage.Lookup(t0, table_id, Key({Int64(row)}), column_ids,
+                                 &values));
+    benchmark::DoNotOptimize(values);
+    row = (row + 1) % num_rows;
+  }
+  state.SetItemsProcessed(state.iterations() * num_columns);
+}
+BENCHMARK(BM_InMemoryStorageLookupWideTable)
+    ->Args({1000, 10})
+    ->Args({1000, 100})
+    ->Args({100, 1000});
+
+void BM_InMemoryStorageBulkLoad(benchmark::State& state) {
+  int num_rows = state.range(0);
+  bool batched = state.range(1);
+  const TableID table_id = "bulk_table";
+  std::vector<ColumnID> column_ids = {"bulk_table:column:0",
+                                      "bulk_table:column:1"};
+  absl::Time t0 = absl::Now();
+
+  for (auto _ : state) {
+    InMemoryStorage storage;
+    if (batched) {
+      std::vector<StorageWriteOp> ops;
+      ops.reserve(num_rows);
+      for (int r = 0; r < num_rows; ++r) {
+        ops.push_back({.table_id = table_id,
+                       .key = Key({Int64(r)}),
+                       .column_ids = column_ids,
+                       .values = {Int64(r), String("value")}});
+      }
+      ABSL_CHECK_OK(storage.ApplyBatch(t0, std::move(ops)));
+    } else {
+      for (int r = 0; r < num_rows; ++r) {
+        ABSL_CHECK_OK(storage.Write(t0, table_id, Key({Int64(r)}), column_ids,
+                                    {Int64(r), String("value")}));
+      }
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * num_rows);
+}
+BENCHMARK(BM_InMemoryStorageBulkLoad)->Args({10000, 0})->Args({10000, 1});
+
 }  // namespace backend
 }  // namespace emulator
 }  // namespace spanner
@@ -17,6 +17,10 @@
 #ifndef THIRD_PARTY_CLOUD_SPANNER_EMULATOR_BACKEND_STORAGE_STORAGE_H_
 #define THIRD_PARTY_CLOUD_SPANNER_EMULATOR_BACKEND_STORAGE_STORAGE_H_
 
+#include <cstdint>
+#include <memory>
+#include <vector>
+
 #include "zetasql/public/value.h"
 #include "absl/status/status.h"
 #include "absl/time/time.h"
@@ -31,10 +35,21 @@ namespace spanner {
 namespace emulator {
 namespace backend {
 
+// A change to a single row applied by Storage::ApplyBatch: either a write of
+// the given column values, or a delete of the row.
+struct StorageWriteOp {
+  TableID table_id;
+  Key key;
+  bool is_delete = false;
+  std::vector<ColumnID> column_ids;
+  std::vector<zetasql::Value> values;
+};
+
 // Storage defines the interface for a multi-version data store.
 //
-// There will be a Storage instance for each database created. The current
-// interface is grow-only, i.e. once data is added, it will not be deleted.
+// There will be a Storage instance for each database created. Data is only
+// removed once it falls out of the version retention period, either by
+// CollectExpiredVersions or when dropped tables and columns are cleaned up.
 // Storage is thread-safe.
 class Storage {
  public:
@@ -74,11 +89,43 @@ class Storage {
   virtual absl::Status Delete(absl::Time timestamp, const TableID& table_id,
                               const KeyRange& key_range) = 0;
 
+  // Applies the writes and deletes of 'ops' at the specified timestamp, with
+  // the same effect as calling Write and Delete for each of them in order. The
+  // ops are sorted by table and key, so that each table is locked once and its
+  // rows are visited in key order, while ops on the same row are applied in
+  // their order in 'ops'.
+  virtual absl::Status ApplyBatch(absl::Time timestamp,
+                                  std::vector<StorageWriteOp> ops) = 0;
+
   // Sets the version retention period from the database options.
   // This is used to determine when to delete expired data from storage.
   virtual void SetVersionRetentionPeriod(
       absl::Duration version_retention_period) = 0;
 
+  // Removes versions which fell out of the version retention period as of
+  // 'timestamp', visiting at most 'max_rows' rows. Successive calls resume
+  // where the previous one left off, and wrap around once all tables have
+  // been visited. Returns the estimated number of bytes reclaimed.
+  virtual int64_t CollectExpiredVersions(absl::Time timestamp,
+                                         int max_rows) = 0;
+
+  // Returns the estimated number of bytes reclaimed by CollectExpiredVersions
+  // over the lifetime of the storage.
+  virtual int64_t reclaimed_version_bytes() const = 0;
+
+  // Returns the estimated memory in bytes used by the keys, cell values and
+  // retained versions of all tables.
+  virtual int64_t size_bytes() const = 0;
+
+  // Returns the estimated memory in bytes used by the given table, or zero if
+  // the table does not exist.
+  virtual int64_t TableSizeBytes(const TableID& table_id) const = 0;
+
+  // Returns RESOURCE_EXHAUSTED if writing about 'bytes' more bytes would take
+  // the storage over its memory limit. Commits check this before writing any of
+  // their mutations, so that a commit is never partially applied.
+  virtual absl::Status CheckMemoryLimit(int64_t bytes) const = 0;
+
   virtual void CleanUpDeletedTables(absl::Time timestamp) = 0;
   virtual void CleanUpDeletedColumns(absl::Time timestamp) = 0;
 
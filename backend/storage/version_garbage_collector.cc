@@ -0,0 +1,81 @@
+//
+// Copyright 2026 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+
+#include "backend/storage/version_garbage_collector.h"
+
+#include <thread>  // NOLINT
+
+#include "absl/flags/flag.h"
+#include "absl/synchronization/mutex.h"
+#include "absl/time/time.h"
+#include "backend/storage/storage.h"
+#include "common/clock.h"
+
+ABSL_FLAG(absl::Duration, version_gc_interval, absl::Seconds(1),
+          "How often to reclaim versions which fell out of the version "
+          "retention period.");
+
+ABSL_FLAG(int, version_gc_rows_per_interval, 10000,
+          "Maximum number of rows visited by each version garbage collection "
+          "sweep.");
+
+ABSL_FLAG(bool, enable_version_gc, true,
+          "Whether to reclaim versions which fell out of the version "
+          "retention period in the background.");
+
+namespace google {
+namespace spanner {
+namespace emulator {
+namespace backend {
+
+VersionGarbageCollector::VersionGarbageCollector(Storage* storage,
+                                                 Clock* clock)
+    : storage_(storage), clock_(clock) {
+  if (absl::GetFlag(FLAGS_enable_version_gc)) {
+    thread_ = std::thread(&VersionGarbageCollector::Run, this);
+  }
+}
+
+VersionGarbageCollector::~VersionGarbageCollector() {
+  {
+    absl::MutexLock l(&mu_);
+    stop_thread_ = true;
+  }
+  if (thread_.joinable()) {
+    thread_.join();
+  }
+}
+
+void VersionGarbageCollector::Run() {
+  while (true) {
+    {
+      absl::MutexLock l(&mu_);
+      mu_.AwaitWithTimeout(absl::Condition(&stop_thread_),
+                           absl::GetFlag(FLAGS_version_gc_interval));
+      if (stop_thread_) {
+        return;
+      }
+    }
+    storage_->CollectExpiredVersions(
+        clock_->Now(), absl::GetFlag(FLAGS_version_gc_rows_per_interval));
+  }
+}
+
+}  // namespace backend
+}  // namespace emulator
+}  // namespace spanner
+}  // namespace google
@@ -0,0 +1,79 @@
+//
+// Copyright 2026 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+
+#ifndef THIRD_PARTY_CLOUD_SPANNER_EMULATOR_BACKEND_STORAGE_VERSION_GARBAGE_COLLECTOR_H_
+#define THIRD_PARTY_CLOUD_SPANNER_EMULATOR_BACKEND_STORAGE_VERSION_GARBAGE_COLLECTOR_H_
+
+#include <thread>  // NOLINT
+
+#include "absl/base/thread_annotations.h"
+#include "absl/flags/declare.h"
+#include "absl/synchronization/mutex.h"
+#include "absl/time/time.h"
+#include "backend/storage/storage.h"
+#include "common/clock.h"
+
+// How often the version garbage collector sweeps the storage.
+ABSL_DECLARE_FLAG(absl::Duration, version_gc_interval);
+
+// Maximum number of rows the version garbage collector visits per sweep.
+ABSL_DECLARE_FLAG(int, version_gc_rows_per_interval);
+
+// Whether the version garbage collector should be enabled.
+ABSL_DECLARE_FLAG(bool, enable_version_gc);
+
+namespace google {
+namespace spanner {
+namespace emulator {
+namespace backend {
+
+// VersionGarbageCollector reclaims versions which fell out of the version
+// retention period from a storage in a background thread.
+//
+// Each sweep visits a bounded number of rows and picks up where the previous
+// sweep left off, so that old versions are eventually reclaimed from all rows
+// without holding a table lock for long, and without adding to the latency of
+// the commits which wrote them.
+class VersionGarbageCollector {
+ public:
+  // 'storage' and 'clock' must outlive the collector.
+  VersionGarbageCollector(Storage* storage, Clock* clock);
+
+  // Stops the background thread.
+  ~VersionGarbageCollector();
+
+ private:
+  // Sweeps the storage every interval until stopped.
+  void Run();
+
+  Storage* storage_;
+
+  // Clock shared across emulator components.
+  Clock* clock_;
+
+  absl::Mutex mu_;
+  bool stop_thread_ ABSL_GUARDED_BY(mu_) = false;
+
+  std::thread thread_;
+};
+
+}  // namespace backend
+}  // namespace emulator
+}  // namespace spanner
+}  // namespace google
+
+#endif  // THIRD_PARTY_CLOUD_SPANNER_EMULATOR_BACKEND_STORAGE_VERSION_GARBAGE_COLLECTOR_H_
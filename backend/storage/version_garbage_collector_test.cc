@@ -0,0 +1,92 @@
+//
+// Copyright 2026 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+
+#include "backend/storage/version_garbage_collector.h"
+
+#include <vector>
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "zetasql/base/testing/status_matchers.h"
+#include "tests/common/proto_matchers.h"
+#include "absl/flags/flag.h"
+#include "absl/time/clock.h"
+#include "absl/time/time.h"
+#include "backend/datamodel/key.h"
+#include "backend/datamodel/key_range.h"
+#include "backend/storage/in_memory_storage.h"
+#include "common/clock.h"
+
+namespace google {
+namespace spanner {
+namespace emulator {
+namespace backend {
+
+namespace {
+
+using zetasql::values::Int64;
+using zetasql::values::String;
+
+TEST(VersionGarbageCollectorTest, ReclaimsExpiredVersionsInBackground) {
+  absl::SetFlag(&FLAGS_version_gc_interval, absl::Milliseconds(1));
+  Clock clock;
+  InMemoryStorage storage;
+  storage.SetVersionRetentionPeriod(absl::Milliseconds(1));
+
+  absl::Time t0 = clock.Now();
+  ZETASQL_EXPECT_OK(storage.Write(t0, "table", Key({Int64(1)}), {"column"},
+                          {String("value")}));
+  ZETASQL_EXPECT_OK(
+      storage.Delete(clock.Now(), "table", KeyRange::Point(Key({Int64(1)}))));
+
+  VersionGarbageCollector collector(&storage, &clock);
+  absl::Time deadline = absl::Now() + absl::Seconds(10);
+  while (storage.reclaimed_version_bytes() == 0 && absl::Now() < deadline) {
+    absl::SleepFor(absl::Milliseconds(1));
+  }
+  EXPECT_GT(storage.reclaimed_version_bytes(), 0);
+
+  std::vector<zetasql::Value> values;
+  EXPECT_FALSE(
+      storage.Lookup(t0, "table", Key({Int64(1)}), {"column"}, &values).ok());
+}
+
+TEST(VersionGarbageCollectorTest, DoesNothingWhenDisabled) {
+  absl::SetFlag(&FLAGS_enable_version_gc, false);
+  absl::SetFlag(&FLAGS_version_gc_interval, absl::Milliseconds(1));
+  Clock clock;
+  InMemoryStorage storage;
+  storage.SetVersionRetentionPeriod(absl::Milliseconds(1));
+  ZETASQL_EXPECT_OK(storage.Write(clock.Now(), "table", Key({Int64(1)}),
+                          {"column"}, {String("value")}));
+  ZETASQL_EXPECT_OK(
+      storage.Delete(clock.Now(), "table", KeyRange::Point(Key({Int64(1)}))));
+
+  {
+    VersionGarbageCollector collector(&storage, &clock);
+    absl::SleepFor(absl::Milliseconds(20));
+  }
+  EXPECT_EQ(storage.reclaimed_version_bytes(), 0);
+  absl::SetFlag(&FLAGS_enable_version_gc, true);
+}
+
+}  // namespace
+
+}  // namespace backend
+}  // namespace emulator
+}  // namespace spanner
+}  // namespace google
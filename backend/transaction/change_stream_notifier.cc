@@ -0,0 +1,142 @@
+//
+// Copyright 2026 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "backend/transaction/change_stream_notifier.h"
+
+#include <algorithm>
+#include <memory>
+#include <string>
+#include <utility>
+
+#include "absl/container/flat_hash_map.h"
+#include "absl/synchronization/mutex.h"
+#include "absl/time/time.h"
+
+namespace google {
+namespace spanner {
+namespace emulator {
+namespace backend {
+
+ChangeStreamNotifier::Subscription::Subscription(ChangeStreamNotifier* notifier,
+                                                 std::string change_stream,
+                                                 std::string partition_token,
+                                                 absl::Time subscribed_at)
+    : notifier_(notifier),
+      change_stream_(std::move(change_stream)),
+      partition_token_(std::move(partition_token)),
+      subscribed_at_(subscribed_at) {}
+
+ChangeStreamNotifier::Subscription::~Subscription() {
+  absl::MutexLock lock(&notifier_->mu_);
+  notifier_->subscriptions_.erase(this);
+}
+
+bool ChangeStreamNotifier::Subscription::HasUnreadCommits() const {
+  return unread_records_end_ != absl::InfinitePast() ||
+         unread_partitions_end_ != absl::InfinitePast();
+}
+
+absl::Time ChangeStreamNotifier::Subscription::WaitForCommit(
+    absl::Time deadline) {
+  absl::MutexLock lock(&notifier_->mu_);
+  if (!notifier_->mu_.AwaitWithDeadline(
+          absl::Condition(this, &Subscription::HasUnreadCommits), deadline)) {
+    return deadline;
+  }
+  return std::max(unread_records_end_, unread_partitions_end_);
+}
+
+bool ChangeStreamNotifier::Subscription::MayHaveRecords(absl::Time start,
+                                                        absl::Time end) const {
+  absl::MutexLock lock(&notifier_->mu_);
+  if (start < subscribed_at_) {
+    return true;
+  }
+  return unread_records_start_ <= end && start <= unread_records_end_;
+}
+
+bool ChangeStreamNotifier::Subscription::MayHaveChangedPartitions() const {
+  absl::MutexLock lock(&notifier_->mu_);
+  return unread_partitions_end_ != absl::InfinitePast();
+}
+
+void ChangeStreamNotifier::Subscription::MarkRecordsRead(absl::Time timestamp) {
+  absl::MutexLock lock(&notifier_->mu_);
+  if (unread_records_end_ <= timestamp) {
+    unread_records_start_ = absl::InfiniteFuture();
+    unread_records_end_ = absl::InfinitePast();
+  } else {
+    // Only the range of the unread commits is kept, so the commits after
+    // 'timestamp' are assumed to start right after it.
+    unread_records_start_ = std::max(unread_records_start_,
+                                     timestamp + absl::Microseconds(1));
+  }
+}
+
+void ChangeStreamNotifier::Subscription::MarkPartitionsRead(
+    absl::Time timestamp) {
+  absl::MutexLock lock(&notifier_->mu_);
+  if (unread_partitions_end_ <= timestamp) {
+    unread_partitions_end_ = absl::InfinitePast();
+  }
+}
+
+std::unique_ptr<ChangeStreamNotifier::Subscription>
+ChangeStreamNotifier::Subscribe(const std::string& change_stream,
+                                const std::string& partition_token) {
+  absl::MutexLock lock(&mu_);
+  // Commits published from now on are recorded by the subscription. Those
+  // published earlier have a commit timestamp of at most last_published_.
+  std::unique_ptr<Subscription> subscription(new Subscription(
+      this, change_stream, partition_token,
+      last_published_ == absl::InfinitePast()
+          ? absl::InfinitePast()
+          : last_published_ + absl::Microseconds(1)));
+  subscriptions_.insert(subscription.get());
+  return subscription;
+}
+
+void ChangeStreamNotifier::Publish(
+    absl::Time commit_timestamp,
+    const absl::flat_hash_map<std::string, ChangeStreamWrites>& writes) {
+  if (writes.empty()) {
+    return;
+  }
+  absl::MutexLock lock(&mu_);
+  last_published_ = std::max(last_published_, commit_timestamp);
+  for (Subscription* subscription : subscriptions_) {
+    auto itr = writes.find(subscription->change_stream_);
+    if (itr == writes.end()) {
+      continue;
+    }
+    if (itr->second.partition_tokens.contains(
+            subscription->partition_token_)) {
+      subscription->unread_records_start_ =
+          std::min(subscription->unread_records_start_, commit_timestamp);
+      subscription->unread_records_end_ =
+          std::max(subscription->unread_records_end_, commit_timestamp);
+    }
+    if (itr->second.partitions_changed) {
+      subscription->unread_partitions_end_ =
+          std::max(subscription->unread_partitions_end_, commit_timestamp);
+    }
+  }
+}
+
+}  // namespace backend
+}  // namespace emulator
+}  // namespace spanner
+}  // namespace google
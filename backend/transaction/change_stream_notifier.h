@@ -0,0 +1,147 @@
+//
+// Copyright 2026 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#ifndef THIRD_PARTY_CLOUD_SPANNER_EMULATOR_BACKEND_TRANSACTION_CHANGE_STREAM_NOTIFIER_H_
+#define THIRD_PARTY_CLOUD_SPANNER_EMULATOR_BACKEND_TRANSACTION_CHANGE_STREAM_NOTIFIER_H_
+
+#include <memory>
+#include <string>
+
+#include "absl/base/thread_annotations.h"
+#include "absl/container/flat_hash_map.h"
+#include "absl/container/flat_hash_set.h"
+#include "absl/synchronization/mutex.h"
+#include "absl/time/time.h"
+
+namespace google {
+namespace spanner {
+namespace emulator {
+namespace backend {
+
+// The writes of a single commit to the tables of a change stream.
+struct ChangeStreamWrites {
+  // Partitions the commit wrote data change records to.
+  absl::flat_hash_set<std::string> partition_tokens;
+
+  // Whether the commit wrote to the partition table, e.g. to churn partitions.
+  bool partitions_changed = false;
+};
+
+// ChangeStreamNotifier lets change stream queries wait for the commits which
+// write to the partitions they read, instead of polling the change stream
+// tables.
+//
+// Read-write transactions publish their writes to change streams after they
+// are flushed to storage and before the transaction is marked committed. Since
+// a read at a timestamp waits for the transactions committing before it to be
+// marked committed, every commit before the timestamp of a read has been
+// published once the read has started.
+//
+// A subscription only keeps the range of the commit timestamps published to it
+// since it was last read, so publishing never waits for slow subscribers and
+// the memory used by a subscription does not grow with the commit rate.
+//
+// This class is thread-safe.
+class ChangeStreamNotifier {
+ public:
+  // A subscription to the commits to a single partition of a change stream.
+  // Unsubscribes when destroyed, which must happen before the notifier is
+  // destroyed.
+  class Subscription {
+   public:
+    ~Subscription();
+
+    // Waits until the subscription has unread commits, or until 'deadline'.
+    // Returns the commit timestamp of the latest unread commit, or 'deadline'
+    // if there is none.
+    absl::Time WaitForCommit(absl::Time deadline);
+
+    // Returns whether commits between 'start' and 'end', inclusive, may have
+    // written data change records to the partition. This is true for commits
+    // which were published before the subscription was made.
+    bool MayHaveRecords(absl::Time start, absl::Time end) const;
+
+    // Returns whether a commit which has not been read may have changed the
+    // partitions of the change stream.
+    bool MayHaveChangedPartitions() const;
+
+    // Marks the data change records committed up to 'timestamp' as read.
+    void MarkRecordsRead(absl::Time timestamp);
+
+    // Marks the partition changes committed up to 'timestamp' as read.
+    void MarkPartitionsRead(absl::Time timestamp);
+
+   private:
+    friend class ChangeStreamNotifier;
+
+    Subscription(ChangeStreamNotifier* notifier, std::string change_stream,
+                 std::string partition_token, absl::Time subscribed_at);
+
+    // Returns whether there are unread commits.
+    bool HasUnreadCommits() const ABSL_SHARED_LOCKS_REQUIRED(notifier_->mu_);
+
+    ChangeStreamNotifier* notifier_;
+    const std::string change_stream_;
+    const std::string partition_token_;
+
+    // Commits before this timestamp may have been published before the
+    // subscription was made.
+    const absl::Time subscribed_at_;
+
+    // The range of the commit timestamps of the unread commits which wrote
+    // data change records to the partition, empty if there are none.
+    absl::Time unread_records_start_ ABSL_GUARDED_BY(notifier_->mu_) =
+        absl::InfiniteFuture();
+    absl::Time unread_records_end_ ABSL_GUARDED_BY(notifier_->mu_) =
+        absl::InfinitePast();
+
+    // The latest commit timestamp of the unread commits which changed the
+    // partitions of the change stream, or InfinitePast() if there are none.
+    absl::Time unread_partitions_end_ ABSL_GUARDED_BY(notifier_->mu_) =
+        absl::InfinitePast();
+  };
+
+  ChangeStreamNotifier() = default;
+  ChangeStreamNotifier(const ChangeStreamNotifier&) = delete;
+  ChangeStreamNotifier& operator=(const ChangeStreamNotifier&) = delete;
+
+  // Subscribes to the commits to 'partition_token' of 'change_stream'.
+  std::unique_ptr<Subscription> Subscribe(const std::string& change_stream,
+                                          const std::string& partition_token)
+      ABSL_LOCKS_EXCLUDED(mu_);
+
+  // Publishes the writes of a commit at 'commit_timestamp', keyed by the name
+  // of the change stream written to.
+  void Publish(
+      absl::Time commit_timestamp,
+      const absl::flat_hash_map<std::string, ChangeStreamWrites>& writes)
+      ABSL_LOCKS_EXCLUDED(mu_);
+
+ private:
+  absl::Mutex mu_;
+
+  // The latest commit timestamp published.
+  absl::Time last_published_ ABSL_GUARDED_BY(mu_) = absl::InfinitePast();
+
+  absl::flat_hash_set<Subscription*> subscriptions_ ABSL_GUARDED_BY(mu_);
+};
+
+}  // namespace backend
+}  // namespace emulator
+}  // namespace spanner
+}  // namespace google
+
+#endif  // THIRD_PARTY_CLOUD_SPANNER_EMULATOR_BACKEND_TRANSACTION_CHANGE_STREAM_NOTIFIER_H_
@@ -0,0 +1,104 @@
+//
+// Copyright 2026 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "backend/transaction/change_stream_notifier.h"
+
+#include <memory>
+#include <string>
+
+#include "gtest/gtest.h"
+#include "absl/container/flat_hash_map.h"
+#include "absl/time/time.h"
+
+namespace google {
+namespace spanner {
+namespace emulator {
+namespace backend {
+
+namespace {
+
+absl::flat_hash_map<std::string, ChangeStreamWrites> RecordsWritten(
+    const std::string& change_stream, const std::string& partition_token) {
+  absl::flat_hash_map<std::string, ChangeStreamWrites> writes;
+  writes[change_stream].partition_tokens.insert(partition_token);
+  return writes;
+}
+
+TEST(ChangeStreamNotifierTest, NotifiesCommitsToThePartition) {
+  ChangeStreamNotifier notifier;
+  absl::Time t0 = absl::FromUnixSeconds(3600);
+  notifier.Publish(t0, RecordsWritten("cs", "p1"));
+
+  auto subscription = notifier.Subscribe("cs", "p1");
+  // Commits published before the subscription are not tracked, so their
+  // records must be read from the change stream tables.
+  EXPECT_TRUE(subscription->MayHaveRecords(t0, t0));
+  EXPECT_FALSE(subscription->MayHaveRecords(t0 + absl::Seconds(1),
+                                            t0 + absl::Seconds(2)));
+
+  // Commits to other partitions and change streams are not notified.
+  notifier.Publish(t0 + absl::Seconds(1), RecordsWritten("cs", "p2"));
+  notifier.Publish(t0 + absl::Seconds(1), RecordsWritten("other", "p1"));
+  EXPECT_EQ(subscription->WaitForCommit(absl::InfinitePast()),
+            absl::InfinitePast());
+
+  notifier.Publish(t0 + absl::Seconds(2), RecordsWritten("cs", "p1"));
+  notifier.Publish(t0 + absl::Seconds(4), RecordsWritten("cs", "p1"));
+  EXPECT_EQ(subscription->WaitForCommit(absl::InfiniteFuture()),
+            t0 + absl::Seconds(4));
+  EXPECT_TRUE(subscription->MayHaveRecords(t0 + absl::Seconds(1),
+                                           t0 + absl::Seconds(2)));
+  EXPECT_FALSE(subscription->MayHaveRecords(t0 + absl::Seconds(5),
+                                            t0 + absl::Seconds(6)));
+
+  subscription->MarkRecordsRead(t0 + absl::Seconds(3));
+  EXPECT_FALSE(subscription->MayHaveRecords(t0 + absl::Seconds(1),
+                                            t0 + absl::Seconds(3)));
+  EXPECT_TRUE(subscription->MayHaveRecords(t0 + absl::Seconds(4),
+                                           t0 + absl::Seconds(4)));
+
+  subscription->MarkRecordsRead(t0 + absl::Seconds(4));
+  EXPECT_FALSE(subscription->MayHaveRecords(t0 + absl::Seconds(4),
+                                            t0 + absl::Seconds(4)));
+  EXPECT_EQ(subscription->WaitForCommit(absl::InfinitePast()),
+            absl::InfinitePast());
+}
+
+TEST(ChangeStreamNotifierTest, NotifiesPartitionChanges) {
+  ChangeStreamNotifier notifier;
+  absl::Time t0 = absl::FromUnixSeconds(3600);
+  auto subscription = notifier.Subscribe("cs", "p1");
+  EXPECT_FALSE(subscription->MayHaveChangedPartitions());
+
+  absl::flat_hash_map<std::string, ChangeStreamWrites> writes;
+  writes["cs"].partitions_changed = true;
+  notifier.Publish(t0, writes);
+  EXPECT_TRUE(subscription->MayHaveChangedPartitions());
+  EXPECT_EQ(subscription->WaitForCommit(absl::InfiniteFuture()), t0);
+  EXPECT_FALSE(subscription->MayHaveRecords(t0, t0));
+
+  subscription->MarkPartitionsRead(t0 - absl::Seconds(1));
+  EXPECT_TRUE(subscription->MayHaveChangedPartitions());
+  subscription->MarkPartitionsRead(t0);
+  EXPECT_FALSE(subscription->MayHaveChangedPartitions());
+}
+
+}  // namespace
+
+}  // namespace backend
+}  // namespace emulator
+}  // namespace spanner
+}  // namespace google
@@ -16,9 +16,12 @@
 
 #include "backend/transaction/flush.h"
 
+#include <cstdint>
+#include <utility>
 #include <vector>
 
 #include "backend/common/variant.h"
+#include "backend/storage/storage.h"
 #include "backend/transaction/commit_timestamp.h"
 
 namespace google {
@@ -28,42 +31,38 @@ namespace backend {
 
 namespace {
 
-absl::Status FlushInsert(const InsertOp& insert_op, Storage* base_storage,
-                         absl::Time commit_timestamp) {
-  const Table* table = insert_op.table;
-  const Key key = MaybeSetCommitTimestamp(table->primary_key(), insert_op.key,
-                                          commit_timestamp);
-  std::vector<ColumnID> column_ids;
-  ValueList column_values;
-  for (int i = 0; i < insert_op.columns.size(); i++) {
-    column_ids.push_back(insert_op.columns[i]->id());
-    column_values.push_back(MaybeSetCommitTimestamp(
-        insert_op.columns[i], insert_op.values[i], commit_timestamp));
+// Returns the storage write of the columns of 'op', an InsertOp or UpdateOp,
+// with pending commit timestamps in its key and values replaced by
+// 'commit_timestamp'.
+template <typename Op>
+StorageWriteOp MakeStorageWrite(const Op& op, absl::Time commit_timestamp) {
+  const Table* table = op.table;
+  StorageWriteOp storage_op{
+      .table_id = table->id(),
+      .key = MaybeSetCommitTimestamp(table->primary_key(), op.key,
+                                     commit_timestamp)};
+  storage_op.column_ids.reserve(op.columns.size());
+  storage_op.values.reserve(op.columns.size());
+  for (int i = 0; i < op.columns.size(); i++) {
+    storage_op.column_ids.push_back(op.columns[i]->id());
+    storage_op.values.push_back(
+        MaybeSetCommitTimestamp(op.columns[i], op.values[i], commit_timestamp));
   }
-  return base_storage->Write(commit_timestamp, table->id(), key, column_ids,
-                             column_values);
+  return storage_op;
 }
 
-absl::Status FlushUpdate(const UpdateOp& update_op, Storage* base_storage,
-                         absl::Time commit_timestamp) {
-  const Table* table = update_op.table;
-  const Key key = MaybeSetCommitTimestamp(table->primary_key(), update_op.key,
-                                          commit_timestamp);
-  std::vector<ColumnID> column_ids;
-  ValueList column_values;
-  for (int i = 0; i < update_op.columns.size(); i++) {
-    column_ids.push_back(update_op.columns[i]->id());
-    column_values.push_back(MaybeSetCommitTimestamp(
-        update_op.columns[i], update_op.values[i], commit_timestamp));
-  }
-  return base_storage->Write(commit_timestamp, table->id(), key, column_ids,
-                             column_values);
+StorageWriteOp MakeStorageDelete(const DeleteOp& delete_op) {
+  return StorageWriteOp{.table_id = delete_op.table->id(),
+                        .key = delete_op.key,
+                        .is_delete = true};
 }
 
-absl::Status FlushDelete(const DeleteOp& delete_op, Storage* base_storage,
-                         absl::Time commit_timestamp) {
-  return base_storage->Delete(commit_timestamp, delete_op.table->id(),
-                              KeyRange::Point(delete_op.key));
+int64_t EstimateValuesSizeBytes(const Key& key, const ValueList& values) {
+  int64_t bytes = key.LogicalSizeInBytes();
+  for (const zetasql::Value& value : values) {
+    bytes += value.physical_byte_size();
+  }
+  return bytes;
 }
 
 }  // namespace
@@ -71,22 +70,42 @@ absl::Status FlushDelete(const DeleteOp& delete_op, Storage* base_storage,
 absl::Status FlushWriteOpsToStorage(const std::vector<WriteOp>& write_ops,
                                     Storage* base_storage,
                                     absl::Time commit_timestamp) {
+  std::vector<StorageWriteOp> storage_ops;
+  storage_ops.reserve(write_ops.size());
   for (const auto& write_op : write_ops) {
-    ZETASQL_RETURN_IF_ERROR(std::visit(
+    storage_ops.push_back(std::visit(
         overloaded{
             [&](const InsertOp& insert_op) {
-              return FlushInsert(insert_op, base_storage, commit_timestamp);
+              return MakeStorageWrite(insert_op, commit_timestamp);
             },
             [&](const UpdateOp& update_op) {
-              return FlushUpdate(update_op, base_storage, commit_timestamp);
+              return MakeStorageWrite(update_op, commit_timestamp);
             },
-            [&](const DeleteOp& delete_op) {
-              return FlushDelete(delete_op, base_storage, commit_timestamp);
+            [](const DeleteOp& delete_op) {
+              return MakeStorageDelete(delete_op);
             },
         },
         write_op));
   }
-  return absl::OkStatus();
+  return base_storage->ApplyBatch(commit_timestamp, std::move(storage_ops));
+}
+
+int64_t EstimateWriteOpsSizeBytes(const std::vector<WriteOp>& write_ops) {
+  int64_t bytes = 0;
+  for (const auto& write_op : write_ops) {
+    bytes += std::visit(
+        overloaded{
+            [&](const InsertOp& insert_op) {
+              return EstimateValuesSizeBytes(insert_op.key, insert_op.values);
+            },
+            [&](const UpdateOp& update_op) {
+              return EstimateValuesSizeBytes(update_op.key, update_op.values);
+            },
+            [](const DeleteOp&) { return int64_t{0}; },
+        },
+        write_op);
+  }
+  return bytes;
 }
 
 }  // namespace backend
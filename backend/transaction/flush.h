@@ -17,6 +17,9 @@
 #ifndef THIRD_PARTY_CLOUD_SPANNER_EMULATOR_BACKEND_TRANSACTION_FLUSH_H_
 #define THIRD_PARTY_CLOUD_SPANNER_EMULATOR_BACKEND_TRANSACTION_FLUSH_H_
 
+#include <cstdint>
+#include <vector>
+
 #include "backend/actions/ops.h"
 
 namespace google {
@@ -24,16 +27,18 @@ namespace spanner {
 namespace emulator {
 namespace backend {
 
-// TODO : Add support to write multiple ops to base storage
-// atomically.
-
-// Flushes each of the write ops to base storage at the given timestamp. Note
-// that calling this function isn't thread safe and appropriate database locks
-// should be acquired.
+// Flushes the write ops to base storage at the given timestamp, as a single
+// batch. Note that calling this function isn't thread safe and appropriate
+// database locks should be acquired.
 absl::Status FlushWriteOpsToStorage(const std::vector<WriteOp>& write_ops,
                                     Storage* base_storage,
                                     absl::Time commit_timestamp);
 
+// Returns an estimate of the memory in bytes that flushing the write ops to
+// base storage would add. Deletes are counted as adding nothing, since the
+// memory they free is only reclaimed once their versions expire.
+int64_t EstimateWriteOpsSizeBytes(const std::vector<WriteOp>& write_ops);
+
 }  // namespace backend
 }  // namespace emulator
 }  // namespace spanner
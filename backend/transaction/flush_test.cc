@@ -16,6 +16,7 @@
 
 #include "backend/transaction/flush.h"
 
+#include <cstdint>
 #include <memory>
 #include <vector>
 
@@ -132,6 +133,22 @@ TEST_F(FlushTest, CanFlushWriteOpsToStorage) {
                                              {Int64(3), String("value")}}));
 }
 
+TEST_F(FlushTest, EstimatesSizeOfWriteOps) {
+  Key key({Int64(1)});
+  InsertOp insert_op{
+      table_, key, {int64_col_, string_col_}, {Int64(1), String("value")}};
+  UpdateOp update_op{table_, key, {string_col_}, {String("new-value")}};
+  DeleteOp delete_op{table_, key};
+
+  int64_t insert_bytes = EstimateWriteOpsSizeBytes({insert_op});
+  int64_t update_bytes = EstimateWriteOpsSizeBytes({update_op});
+  EXPECT_GT(insert_bytes, key.LogicalSizeInBytes());
+  EXPECT_GT(update_bytes, key.LogicalSizeInBytes());
+  EXPECT_EQ(EstimateWriteOpsSizeBytes({delete_op}), 0);
+  EXPECT_EQ(EstimateWriteOpsSizeBytes({insert_op, update_op, delete_op}),
+            insert_bytes + update_bytes);
+}
+
 }  // namespace
 }  // namespace backend
 }  // namespace emulator
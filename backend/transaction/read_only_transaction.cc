@@ -23,6 +23,7 @@
 #include "absl/random/random.h"
 #include "absl/status/status.h"
 #include "absl/strings/str_cat.h"
+#include "absl/synchronization/mutex.h"
 #include "absl/time/time.h"
 #include "backend/access/read.h"
 #include "backend/common/ids.h"
@@ -94,7 +95,11 @@ const Schema* ReadOnlyTransaction::schema() const {
   // Wait for any concurrent schema change or read-write transactions to commit
   // before accessing database state to read schemas in versioned_catalog.
   lock_handle_->WaitForSafeRead(read_timestamp_);
-  return versioned_catalog_->GetSchema(read_timestamp_);
+  absl::MutexLock lock(&schema_mu_);
+  if (schema_ == nullptr) {
+    schema_ = versioned_catalog_->PinSchema(read_timestamp_);
+  }
+  return schema_.get();
 }
 
 absl::Time ReadOnlyTransaction::PickReadTimestamp() {
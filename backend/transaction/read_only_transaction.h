@@ -89,6 +89,11 @@ class ReadOnlyTransaction : public RowReader {
   // VersionedCatalog for the database provided at transaction creation.
   const VersionedCatalog* const versioned_catalog_;
 
+  // The schema at the read timestamp, pinned on first use so that it is not
+  // freed while the transaction uses it.
+  mutable absl::Mutex schema_mu_;
+  mutable std::shared_ptr<const Schema> schema_ ABSL_GUARDED_BY(schema_mu_);
+
   // Transaction lock management.
   std::unique_ptr<LockHandle> lock_handle_;
   LockManager* lock_manager_;
@@ -20,12 +20,15 @@
 #include <memory>
 #include <optional>
 #include <queue>
+#include <set>
 #include <string>
 #include <utility>
+#include <variant>
 #include <vector>
 
 #include "zetasql/public/value.h"
 #include "absl/container/flat_hash_map.h"
+#include "absl/container/flat_hash_set.h"
 #include "absl/log/check.h"
 #include "absl/log/log.h"
 #include "absl/random/random.h"
@@ -45,25 +48,32 @@
 #include "backend/actions/ops.h"
 #include "backend/common/ids.h"
 #include "backend/common/rows.h"
+#include "backend/common/variant.h"
 #include "backend/datamodel/key.h"
 #include "backend/datamodel/key_range.h"
 #include "backend/datamodel/value.h"
 #include "backend/locking/manager.h"
+#include "backend/locking/request.h"
+#include "backend/schema/catalog/change_stream.h"
 #include "backend/schema/catalog/column.h"
 #include "backend/schema/catalog/foreign_key.h"
+#include "backend/schema/catalog/index.h"
 #include "backend/schema/catalog/schema.h"
 #include "backend/schema/catalog/table.h"
 #include "backend/schema/catalog/versioned_catalog.h"
 #include "backend/storage/iterator.h"
 #include "backend/storage/storage.h"
 #include "backend/transaction/actions.h"
+#include "backend/transaction/change_stream_notifier.h"
 #include "backend/transaction/commit_timestamp.h"
 #include "backend/transaction/flush.h"
 #include "backend/transaction/foreign_key_restrictions.h"
 #include "backend/transaction/options.h"
 #include "backend/transaction/resolve.h"
 #include "backend/transaction/row_cursor.h"
+#include "backend/transaction/transaction_stats.h"
 #include "backend/transaction/transaction_store.h"
+#include "backend/transaction/write_capture.h"
 #include "common/change_stream.h"
 #include "common/clock.h"
 #include "common/config.h"
@@ -205,13 +215,56 @@ absl::StatusOr<bool> IsMutationInvolvingForeignKeyAction(
   }
   return false;
 }
+
+// Returns the name of the table or index whose data table has the given id in
+// 'schema', or the id itself if there is none.
+std::string LockedTableName(const Schema* schema, const TableID& table_id) {
+  for (const Table* table : schema->tables()) {
+    if (table->id() == table_id) {
+      return table->Name();
+    }
+    for (const Index* index : table->indexes()) {
+      if (index->index_data_table()->id() == table_id) {
+        return index->Name();
+      }
+    }
+  }
+  return table_id;
+}
+
+// Returns the writes of 'write_ops' to the tables of change streams, keyed by
+// the name of the change stream.
+absl::flat_hash_map<std::string, ChangeStreamWrites> ChangeStreamWritesOf(
+    const std::vector<WriteOp>& write_ops) {
+  absl::flat_hash_map<std::string, ChangeStreamWrites> writes;
+  for (const WriteOp& op : write_ops) {
+    const Table* table = TableOf(op);
+    const ChangeStream* change_stream = table->owner_change_stream();
+    if (change_stream == nullptr) {
+      continue;
+    }
+    ChangeStreamWrites& change_stream_writes = writes[change_stream->Name()];
+    if (table == change_stream->change_stream_partition_table()) {
+      change_stream_writes.partitions_changed = true;
+      continue;
+    }
+    // The partition token is the first key column of the data table.
+    const zetasql::Value& partition_token = KeyOf(op).ColumnValue(0);
+    if (!partition_token.is_null()) {
+      change_stream_writes.partition_tokens.insert(
+          partition_token.string_value());
+    }
+  }
+  return writes;
+}
 }  // namespace
 
 ReadWriteTransaction::ReadWriteTransaction(
     const ReadWriteOptions& options, const RetryState& retry_state,
     TransactionID transaction_id, Clock* clock, Storage* storage,
     LockManager* lock_manager, const VersionedCatalog* const versioned_catalog,
-    ActionManager* action_manager)
+    ActionManager* action_manager, TransactionStats* transaction_stats,
+    ChangeStreamNotifier* change_stream_notifier, WriteCapture* write_capture)
     : options_(options),
       retry_state_(MakeRetryState(retry_state, clock)),
       id_(transaction_id),
@@ -229,7 +282,10 @@ ReadWriteTransaction::ReadWriteTransaction(
           std::make_unique<TransactionReadOnlyStore>(transaction_store_.get()),
           std::make_unique<TransactionEffectsBuffer>(&write_ops_queue_),
           clock)),
-      schema_(versioned_catalog_->GetLatestSchema()) {}
+      schema_(versioned_catalog_->PinSchema(absl::InfiniteFuture())),
+      transaction_stats_(transaction_stats),
+      change_stream_notifier_(change_stream_notifier),
+      write_capture_(write_capture) {}
 
 absl::StatusOr<absl::Time> ReadWriteTransaction::GetCommitTimestamp() {
   absl::MutexLock lock(&mu_);
@@ -248,7 +304,7 @@ absl::Status ReadWriteTransaction::Read(const ReadArg& read_arg,
     mu_.AssertHeld();
 
     ZETASQL_ASSIGN_OR_RETURN(const ResolvedReadArg& resolved_read_arg,
-                     ResolveReadArg(read_arg, schema_));
+                     ResolveReadArg(read_arg, schema_.get()));
 
     std::vector<std::unique_ptr<StorageIterator>> iterators;
     for (const auto& key_range : resolved_read_arg.key_ranges) {
@@ -290,12 +346,77 @@ const Schema* ReadWriteTransaction::schema() const {
   if (state_ == State::kUninitialized) {
     return versioned_catalog_->GetLatestSchema();
   }
-  return schema_;
+  return schema_.get();
+}
+
+void ReadWriteTransaction::RecordAttempt(OpType op,
+                                         absl::StatusCode status_code,
+                                         absl::Time op_start_time) {
+  if (transaction_stats_ == nullptr) {
+    return;
+  }
+  absl::Time end_time = absl::Now();
+  TransactionAttemptStats stats;
+  stats.transaction_tag = transaction_tag_;
+  stats.commit_attempted = op == OpType::kCommit;
+  stats.status_code = status_code;
+  stats.retry = retry_state_.abort_retry_count > 0;
+  stats.total_latency = end_time - attempt_start_time_;
+  if (stats.commit_attempted) {
+    stats.commit_latency = end_time - op_start_time;
+  }
+
+  std::vector<WriteOp> write_ops = transaction_store_->GetBufferedOps();
+  std::set<std::string> columns;
+  std::set<std::string> delete_tables;
+  absl::flat_hash_set<const Table*> tables;
+  for (const WriteOp& write_op : write_ops) {
+    // Writes to index and change stream tables are effects of the writes to
+    // user tables, which are reported on their own.
+    const Table* table = TableOf(write_op);
+    if (!table->is_public()) {
+      continue;
+    }
+    tables.insert(table);
+    std::visit(
+        overloaded{
+            [&](const DeleteOp&) { delete_tables.insert(table->Name()); },
+            [&](const auto& op) {
+              for (const Column* column : op.columns) {
+                columns.insert(
+                    absl::StrCat(table->Name(), ".", column->Name()));
+              }
+            },
+        },
+        write_op);
+  }
+  stats.write_constructive_columns.assign(columns.begin(), columns.end());
+  stats.write_delete_tables.assign(delete_tables.begin(), delete_tables.end());
+  stats.participants = tables.size();
+  stats.bytes = EstimateWriteOpsSizeBytes(write_ops);
+  transaction_stats_->RecordAttempt(end_time, stats);
+}
+
+void ReadWriteTransaction::RecordLockWaits() {
+  std::vector<LockWait> lock_waits = lock_handle_->TakeLockWaits();
+  if (transaction_stats_ == nullptr || lock_waits.empty()) {
+    return;
+  }
+  absl::Time end_time = absl::Now();
+  for (const LockWait& lock_wait : lock_waits) {
+    transaction_stats_->RecordLockWait(
+        end_time,
+        absl::StrCat(
+            LockedTableName(schema_.get(), lock_wait.request.table_id()),
+            lock_wait.request.key_range().start_key().DebugString()),
+        lock_wait.duration);
+  }
 }
 
 void ReadWriteTransaction::Reset() {
   mu_.AssertHeld();
 
+  RecordLockWaits();
   lock_handle_->UnlockAll();
   transaction_store_->Clear();
   std::queue<WriteOp> empty;
@@ -306,6 +427,7 @@ void ReadWriteTransaction::Reset() {
 absl::Status ReadWriteTransaction::GuardedCall(
     OpType op, const std::function<absl::Status()>& fn) {
   absl::MutexLock lock(&mu_);
+  absl::Time op_start_time = absl::Now();
   switch (state_) {
     case State::kRolledback: {
       return error::Internal(absl::StrCat(
@@ -324,24 +446,29 @@ absl::Status ReadWriteTransaction::GuardedCall(
           "Invalid call to Committed transaction. Transaction: ", id()));
     case State::kAborted: {
       if (op != OpType::kRollback) {
+        if (op == OpType::kCommit) {
+          RecordAttempt(op, absl::StatusCode::kAborted, op_start_time);
+        }
         return error::WoundedTransaction(id_);
       }
       break;
     }
     case State::kUninitialized: {
-      schema_ = versioned_catalog_->GetLatestSchema();
+      schema_ = versioned_catalog_->PinSchema(absl::InfiniteFuture());
       auto maybe_action_registry =
-          action_manager_->GetActionsForSchema(schema_);
+          action_manager_->GetActionsForSchema(schema_.get());
       if (!maybe_action_registry.ok()) {
         Reset();
         return maybe_action_registry.status();
       }
       action_registry_ = maybe_action_registry.value();
       state_ = State::kActive;
+      attempt_start_time_ = op_start_time;
       break;
     }
     case State::kActive: {
-      if (schema_ != versioned_catalog_->GetLatestSchema()) {
+      if (schema_.get() != versioned_catalog_->GetLatestSchema()) {
+        RecordAttempt(op, absl::StatusCode::kAborted, op_start_time);
         Reset();
         ++retry_state_.abort_retry_count;
         return error::AbortDueToConcurrentSchemaChange(id_);
@@ -352,6 +479,11 @@ absl::Status ReadWriteTransaction::GuardedCall(
 
   absl::Status status = fn();
 
+  // An attempt ends when it commits, fails to commit or is aborted.
+  if (op == OpType::kCommit || status.code() == absl::StatusCode::kAborted) {
+    RecordAttempt(op, status.code(), op_start_time);
+  }
+
   if (!status.ok()) {
     if (status.code() == absl::StatusCode::kAborted) {
       // Reset the transaction and release the lock handle. Always reset the
@@ -396,7 +528,8 @@ absl::Status ReadWriteTransaction::ProcessChangeStreamWriteOps() {
   mu_.AssertHeld();
   ZETASQL_ASSIGN_OR_RETURN(
       auto write_ops,
-      BuildChangeStreamWriteOps(schema_, transaction_store_->GetBufferedOps(),
+      BuildChangeStreamWriteOps(schema_.get(),
+                                transaction_store_->GetBufferedOps(),
                                 action_context_->store(), id_));
   for (const WriteOp& writeop : write_ops) {
     ZETASQL_RETURN_IF_ERROR(transaction_store_->BufferWriteOp(writeop));
@@ -486,12 +619,12 @@ absl::Status ReadWriteTransaction::Write(const Mutation& mutation) {
     for (const MutationOp& mutation_op : mutation.ops()) {
       ZETASQL_ASSIGN_OR_RETURN(
           bool has_delete_cascade_foreign_key,
-          IsMutationInvolvingForeignKeyAction(mutation_op, schema_));
+          IsMutationInvolvingForeignKeyAction(mutation_op, schema_.get()));
       if (mutation_op.type == MutationOpType::kDelete) {
         // Process Delete.
         ZETASQL_ASSIGN_OR_RETURN(
             ResolvedMutationOp resolved_mutation_op,
-            ResolveDeleteMutationOp(mutation_op, schema_, clock_->Now()));
+            ResolveDeleteMutationOp(mutation_op, schema_.get(), clock_->Now()));
         const std::string& table_name = resolved_mutation_op.table->Name();
 
         if (has_delete_cascade_foreign_key) {
@@ -511,9 +644,11 @@ absl::Status ReadWriteTransaction::Write(const Mutation& mutation) {
         ZETASQL_RETURN_IF_ERROR(ProcessWriteOps(write_ops));
       } else {
         // Process non-delete Mutation ops.
-        ZETASQL_RETURN_IF_ERROR(ValidateNonDeleteMutationOp(mutation_op, schema_));
-        ZETASQL_ASSIGN_OR_RETURN(ResolvedMutationOp resolved_mutation_op,
-                         ResolveNonDeleteMutationOp(mutation_op, schema_));
+        ZETASQL_RETURN_IF_ERROR(
+            ValidateNonDeleteMutationOp(mutation_op, schema_.get()));
+        ZETASQL_ASSIGN_OR_RETURN(
+            ResolvedMutationOp resolved_mutation_op,
+            ResolveNonDeleteMutationOp(mutation_op, schema_.get()));
         const std::string& table_name = resolved_mutation_op.table->Name();
 
         // Process Insert, Update, Replace and InsertOrUpdate.
@@ -559,7 +694,7 @@ absl::Status ReadWriteTransaction::Write(const Mutation& mutation) {
 
           if (has_delete_cascade_foreign_key) {
             ZETASQL_RETURN_IF_ERROR(fk_restrictions.ValidateReferencedMods(
-                write_ops, table_name, schema_));
+                write_ops, table_name, schema_.get()));
           }
 
           ZETASQL_RETURN_IF_ERROR(ProcessWriteOps(write_ops));
@@ -596,12 +731,30 @@ absl::Status ReadWriteTransaction::Commit() {
         std::unique_ptr<postgres_translator::interfaces::PGArena> arena,
         postgres_translator::spangres::MemoryContextPGArena::Init(nullptr));
 
+    // Reject the commit before writing any of its mutations if they would
+    // take the database over its memory limit.
+    ZETASQL_RETURN_IF_ERROR(base_storage_->CheckMemoryLimit(
+        EstimateWriteOpsSizeBytes(transaction_store_->GetBufferedOps())));
+
     // Pick a commit timestamp.
     ZETASQL_ASSIGN_OR_RETURN(commit_timestamp_, lock_handle_->ReserveCommitTimestamp());
 
     // Write the mutations to the base storage.
-    absl::Status flush_status = FlushWriteOpsToStorage(
-        transaction_store_->GetBufferedOps(), base_storage_, commit_timestamp_);
+    const std::vector<WriteOp> write_ops = transaction_store_->GetBufferedOps();
+    absl::Status flush_status =
+        FlushWriteOpsToStorage(write_ops, base_storage_, commit_timestamp_);
+    // Publish the change stream writes before marking the transaction
+    // committed, so that they are published before reads at later timestamps
+    // start.
+    if (flush_status.ok() && change_stream_notifier_ != nullptr) {
+      change_stream_notifier_->Publish(commit_timestamp_,
+                                       ChangeStreamWritesOf(write_ops));
+    }
+    // Record the written rows before the locks are released, which an online
+    // schema change waits for before it catches up on them.
+    if (flush_status.ok() && write_capture_ != nullptr) {
+      write_capture_->Record(write_ops);
+    }
     ZETASQL_RETURN_IF_ERROR(lock_handle_->MarkCommitted());
     if (!flush_status.ok()) {
       return flush_status;
@@ -611,6 +764,7 @@ absl::Status ReadWriteTransaction::Commit() {
     state_ = State::kCommitted;
 
     // Unlock all locks.
+    RecordLockWaits();
     lock_handle_->UnlockAll();
 
     return absl::OkStatus();
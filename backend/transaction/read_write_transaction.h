@@ -19,6 +19,7 @@
 
 #include <memory>
 #include <queue>
+#include <string>
 
 #include "absl/base/thread_annotations.h"
 #include "absl/status/status.h"
@@ -40,10 +41,13 @@
 #include "backend/schema/catalog/versioned_catalog.h"
 #include "backend/storage/storage.h"
 #include "backend/transaction/actions.h"
+#include "backend/transaction/change_stream_notifier.h"
 #include "backend/transaction/commit_timestamp.h"
 #include "backend/transaction/options.h"
 #include "backend/transaction/resolve.h"
+#include "backend/transaction/transaction_stats.h"
 #include "backend/transaction/transaction_store.h"
+#include "backend/transaction/write_capture.h"
 #include "common/clock.h"
 
 namespace google {
@@ -84,7 +88,10 @@ class ReadWriteTransaction : public RowReader, public RowWriter {
                        TransactionID transaction_id, Clock* clock,
                        Storage* storage, LockManager* lock_manager,
                        const VersionedCatalog* const versioned_catalog,
-                       ActionManager* action_manager);
+                       ActionManager* action_manager,
+                       TransactionStats* transaction_stats = nullptr,
+                       ChangeStreamNotifier* change_stream_notifier = nullptr,
+                       WriteCapture* write_capture = nullptr);
 
   absl::Status Read(const ReadArg& read_arg,
                     std::unique_ptr<RowCursor>* cursor) override
@@ -125,6 +132,14 @@ class ReadWriteTransaction : public RowReader, public RowWriter {
     return retry_state_;
   }
 
+  // Sets the tag under which the attempts of this transaction and their lock
+  // waits are recorded in the transaction statistics.
+  void set_transaction_tag(const std::string& transaction_tag)
+      ABSL_LOCKS_EXCLUDED(mu_) {
+    absl::MutexLock lock(&mu_);
+    transaction_tag_ = transaction_tag;
+  }
+
   // Returns the commit timestamp tracker for this transaction.
   const CommitTimestampTracker* commit_timestamp_tracker() const {
     return commit_timestamp_tracker_.get();
@@ -153,6 +168,17 @@ class ReadWriteTransaction : public RowReader, public RowWriter {
   absl::Status ApplyEffectors(const WriteOp& op);
   absl::Status ApplyStatementVerifiers();
 
+  // Records the current attempt of the transaction, which ended with
+  // 'status_code' in an operation of type 'op' started at 'op_start_time', in
+  // the transaction statistics.
+  void RecordAttempt(OpType op, absl::StatusCode status_code,
+                     absl::Time op_start_time)
+      ABSL_EXCLUSIVE_LOCKS_REQUIRED(mu_);
+
+  // Records the waits of the transaction for conflicting locks in the
+  // transaction statistics.
+  void RecordLockWaits() ABSL_EXCLUSIVE_LOCKS_REQUIRED(mu_);
+
   // Updates commit timestamp tracking to reflect currently buffered ops.
   void UpdateTrackedCommitTimestamps();
 
@@ -209,8 +235,24 @@ class ReadWriteTransaction : public RowReader, public RowWriter {
   // The state of this transaction.
   State state_ ABSL_GUARDED_BY(mu_) = State::kUninitialized;
 
-  // The schema that is in effect at the timestamp picked for this transaction.
-  const Schema* schema_ ABSL_GUARDED_BY(mu_);
+  // The schema that is in effect at the timestamp picked for this transaction,
+  // pinned so that it is not freed while the transaction uses it.
+  std::shared_ptr<const Schema> schema_ ABSL_GUARDED_BY(mu_);
+
+  // Statistics of the transactions of the database, if they are recorded.
+  TransactionStats* transaction_stats_;
+
+  // Notified of the writes to change streams on commit, if not null.
+  ChangeStreamNotifier* change_stream_notifier_;
+
+  // Records the rows written on commit for online schema changes, if not null.
+  WriteCapture* write_capture_;
+
+  // Tag of the transaction set by the client.
+  std::string transaction_tag_ ABSL_GUARDED_BY(mu_);
+
+  // The time at which the current attempt of the transaction started.
+  absl::Time attempt_start_time_ ABSL_GUARDED_BY(mu_);
 
   CaseInsensitiveStringMap<std::vector<KeyRange>> deleted_key_ranges_by_table_;
 };
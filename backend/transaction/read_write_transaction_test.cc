@@ -44,7 +44,9 @@
 #include "backend/schema/catalog/versioned_catalog.h"
 #include "backend/storage/in_memory_storage.h"
 #include "backend/transaction/actions.h"
+#include "backend/query/spanner_sys_stats.h"
 #include "backend/transaction/options.h"
+#include "backend/transaction/transaction_stats.h"
 #include "common/clock.h"
 #include "common/config.h"
 #include "tests/common/schema_constructor.h"
@@ -57,8 +59,10 @@ namespace emulator {
 namespace backend {
 namespace {
 
+using zetasql::values::Double;
 using zetasql::values::Int64;
 using zetasql::values::String;
+using zetasql::values::StringArray;
 using zetasql_base::testing::StatusIs;
 
 class ReadWriteTransactionTest : public testing::Test {
@@ -103,6 +107,7 @@ class ReadWriteTransactionTest : public testing::Test {
   std::unique_ptr<InMemoryStorage> storage_;
   std::unique_ptr<VersionedCatalog> versioned_catalog_;
   std::unique_ptr<ActionManager> action_manager_;
+  TransactionStats transaction_stats_;
 
   // Counter to generate TransactionID.
   std::atomic<int> id_counter_ = 0;
@@ -111,7 +116,7 @@ class ReadWriteTransactionTest : public testing::Test {
     return std::make_unique<ReadWriteTransaction>(
         ReadWriteOptions(), RetryState(), ++id_counter_, &clock_,
         storage_.get(), lock_manager_.get(), versioned_catalog_.get(),
-        action_manager_.get());
+        action_manager_.get(), &transaction_stats_);
   }
 
   absl::StatusOr<std::vector<ValueList>> ReadAll(
@@ -295,7 +300,9 @@ TEST_F(ReadWriteTransactionTest, CommitWithMultipleChangesToDatabase) {
 TEST_F(ReadWriteTransactionTest,
        ConcurrentReadWriteTransactionsReturnsAborted) {
   auto current_probability = config::abort_current_transaction_probability();
+  auto current_timeout = config::lock_wait_timeout_ms();
   config::set_abort_current_transaction_probability(0);
+  config::set_lock_wait_timeout_ms(10);
   // Started "writes" on first transaction.
   Mutation m1;
   m1.AddWriteOp(MutationOpType::kInsert, "test_table",
@@ -304,12 +311,13 @@ TEST_F(ReadWriteTransactionTest,
   auto txn1 = CreateReadWriteTransaction();
   ZETASQL_EXPECT_OK(txn1->Write(m1));
 
-  // Before commiting first transaction, starting another transaction is in
-  // progress. Write for second transaction should consistently ABORT.
+  // Before commiting first transaction, starting another transaction which
+  // writes the same row is in progress. Write for second transaction should
+  // consistently ABORT.
   auto txn2 = CreateReadWriteTransaction();
   Mutation m2;
-  m2.AddWriteOp(MutationOpType::kInsert, "test_table",
-                {"int64_col", "string_col"}, {{Int64(2), String("value-2")}});
+  m2.AddWriteOp(MutationOpType::kInsertOrUpdate, "test_table",
+                {"int64_col", "string_col"}, {{Int64(1), String("value-2")}});
   for (int i = 0; i < 5; i++) {
     EXPECT_THAT(txn2->Write(m2), StatusIs(absl::StatusCode::kAborted));
   }
@@ -323,6 +331,73 @@ TEST_F(ReadWriteTransactionTest,
   ZETASQL_EXPECT_OK(txn2->Commit());
   EXPECT_EQ(txn2->state(), ReadWriteTransaction::State::kCommitted);
 
+  config::set_abort_current_transaction_probability(current_probability);
+  config::set_lock_wait_timeout_ms(current_timeout);
+}
+
+TEST_F(ReadWriteTransactionTest,
+       ConcurrentReadWriteTransactionsOnDisjointRowsCommit) {
+  auto current_probability = config::abort_current_transaction_probability();
+  config::set_abort_current_transaction_probability(0);
+  Mutation m1;
+  m1.AddWriteOp(MutationOpType::kInsert, "test_table",
+                {"int64_col", "string_col"}, {{Int64(1), String("value-1")}});
+  Mutation m2;
+  m2.AddWriteOp(MutationOpType::kInsert, "test_table",
+                {"int64_col", "string_col"}, {{Int64(2), String("value-2")}});
+
+  // Both transactions hold locks on different rows at the same time.
+  auto txn1 = CreateReadWriteTransaction();
+  auto txn2 = CreateReadWriteTransaction();
+  ZETASQL_EXPECT_OK(txn1->Write(m1));
+  ZETASQL_EXPECT_OK(txn2->Write(m2));
+  ZETASQL_EXPECT_OK(txn2->Commit());
+  ZETASQL_EXPECT_OK(txn1->Commit());
+  EXPECT_EQ(txn1->state(), ReadWriteTransaction::State::kCommitted);
+  EXPECT_EQ(txn2->state(), ReadWriteTransaction::State::kCommitted);
+
+  config::set_abort_current_transaction_probability(current_probability);
+}
+
+TEST_F(ReadWriteTransactionTest,
+       ConcurrentUpdatesOfDisjointColumnsOfTheSameRowCommit) {
+  auto current_probability = config::abort_current_transaction_probability();
+  config::set_abort_current_transaction_probability(0);
+  Mutation m0;
+  m0.AddWriteOp(MutationOpType::kInsert, "test_table",
+                {"int64_col", "string_col", "int64_val_col"},
+                {{Int64(1), String("value-0"), Int64(0)}});
+  auto txn0 = CreateReadWriteTransaction();
+  ZETASQL_EXPECT_OK(txn0->Write(m0));
+  ZETASQL_EXPECT_OK(txn0->Commit());
+
+  Mutation m1;
+  m1.AddWriteOp(MutationOpType::kUpdate, "test_table",
+                {"int64_col", "int64_val_col"}, {{Int64(1), Int64(1)}});
+  Mutation m2;
+  m2.AddWriteOp(MutationOpType::kUpdate, "test_table",
+                {"int64_col", "string_col"}, {{Int64(1), String("value-2")}});
+
+  // Both transactions hold locks on different columns of the same row at the
+  // same time.
+  auto txn1 = CreateReadWriteTransaction();
+  auto txn2 = CreateReadWriteTransaction();
+  ZETASQL_EXPECT_OK(txn1->Write(m1));
+  ZETASQL_EXPECT_OK(txn2->Write(m2));
+  ZETASQL_EXPECT_OK(txn2->Commit());
+  ZETASQL_EXPECT_OK(txn1->Commit());
+
+  backend::ReadArg read_arg;
+  read_arg.table = "test_table";
+  read_arg.columns = {"string_col", "int64_val_col"};
+  read_arg.key_set = KeySet(Key({Int64(1)}));
+  auto txn3 = CreateReadWriteTransaction();
+  std::unique_ptr<backend::RowCursor> cursor;
+  ZETASQL_ASSERT_OK(txn3->Read(read_arg, &cursor));
+  ASSERT_TRUE(cursor->Next());
+  EXPECT_EQ(cursor->ColumnValue(0), String("value-2"));
+  EXPECT_EQ(cursor->ColumnValue(1), Int64(1));
+
   config::set_abort_current_transaction_probability(current_probability);
 }
 
@@ -580,6 +655,87 @@ TEST_F(ReadWriteTransactionTest, CommitAfterRollbackFails) {
   EXPECT_THAT(txn->Commit(), StatusIs(absl::StatusCode::kInternal));
 }
 
+TEST_F(ReadWriteTransactionTest, CommitOverMemoryLimitFailsWithoutWriting) {
+  storage_ = std::make_unique<InMemoryStorage>(/*max_size_bytes=*/1000);
+
+  Mutation m;
+  m.AddWriteOp(MutationOpType::kInsert, "test_table",
+               {"int64_col", "string_col"}, {{Int64(1), String("value1")}});
+  auto txn1 = CreateReadWriteTransaction();
+  ZETASQL_EXPECT_OK(txn1->Write(m));
+  ZETASQL_EXPECT_OK(txn1->Commit());
+
+  // A commit which would take the database over its limit writes nothing,
+  // including to the index.
+  Mutation m2;
+  m2.AddWriteOp(MutationOpType::kInsert, "test_table",
+                {"int64_col", "string_col"},
+                {{Int64(2), String(std::string(1000, 'a'))}});
+  auto txn2 = CreateReadWriteTransaction();
+  ZETASQL_EXPECT_OK(txn2->Write(m2));
+  EXPECT_THAT(txn2->Commit(), StatusIs(absl::StatusCode::kResourceExhausted));
+
+  auto txn3 = CreateReadWriteTransaction();
+  EXPECT_THAT(ReadAll(txn3.get(), {"int64_col", "string_col"}),
+              IsOkAndHoldsRows({{Int64(1), String("value1")}}));
+  EXPECT_THAT(ReadAllUsingIndex(txn3.get(), "test_index", {"string_col"}),
+              IsOkAndHoldsRows({{String("value1")}}));
+}
+
+TEST_F(ReadWriteTransactionTest, RecordsTransactionStats) {
+  Mutation m;
+  m.AddWriteOp(MutationOpType::kInsert, "test_table",
+               {"int64_col", "string_col"}, {{Int64(1), String("value")}});
+  m.AddDeleteOp("test_table", KeySet(Key({Int64(2)})));
+  auto txn = CreateReadWriteTransaction();
+  txn->set_transaction_tag("tag");
+  ZETASQL_EXPECT_OK(txn->Write(m));
+  ZETASQL_EXPECT_OK(txn->Commit());
+
+  std::vector<SpannerSysStats::Row> top =
+      transaction_stats_.GetTxnTopRows(absl::Minutes(1));
+  ASSERT_EQ(top.size(), 1);
+  EXPECT_EQ(top[0].at("TRANSACTION_TAG"), String("tag"));
+  EXPECT_EQ(top[0].at("WRITE_CONSTRUCTIVE_COLUMNS"),
+            StringArray({"test_table.int64_col", "test_table.string_col"}));
+  EXPECT_EQ(top[0].at("WRITE_DELETE_TABLES"), StringArray({"test_table"}));
+  EXPECT_EQ(top[0].at("ATTEMPT_COUNT"), Int64(1));
+  EXPECT_EQ(top[0].at("COMMIT_ATTEMPT_COUNT"), Int64(1));
+  EXPECT_EQ(top[0].at("AVG_PARTICIPANTS"), Double(1));
+}
+
+TEST_F(ReadWriteTransactionTest, RecordsLockWaitsOfConflictingTransactions) {
+  auto current_probability = config::abort_current_transaction_probability();
+  auto current_timeout = config::lock_wait_timeout_ms();
+  config::set_abort_current_transaction_probability(0);
+  config::set_lock_wait_timeout_ms(10);
+
+  Mutation m;
+  m.AddWriteOp(MutationOpType::kInsert, "test_table", {"int64_col"},
+               {{Int64(1)}});
+  auto txn1 = CreateReadWriteTransaction();
+  ZETASQL_EXPECT_OK(txn1->Write(m));
+
+  // The second transaction waits for the lock of the first one and gives up.
+  auto txn2 = CreateReadWriteTransaction();
+  EXPECT_THAT(txn2->Write(m), StatusIs(absl::StatusCode::kAborted));
+
+  std::vector<SpannerSysStats::Row> locks =
+      transaction_stats_.GetLockTopRows(absl::Minutes(1));
+  ASSERT_EQ(locks.size(), 1);
+  EXPECT_THAT(locks[0].at("ROW_RANGE_START_KEY").bytes_value(),
+              testing::StartsWith("test_"));
+
+  std::vector<SpannerSysStats::Row> total =
+      transaction_stats_.GetTxnTotalRows(absl::Minutes(1));
+  ASSERT_EQ(total.size(), 1);
+  EXPECT_EQ(total[0].at("ATTEMPT_COUNT"), Int64(1));
+  EXPECT_EQ(total[0].at("COMMIT_ATTEMPT_COUNT"), Int64(0));
+
+  config::set_abort_current_transaction_probability(current_probability);
+  config::set_lock_wait_timeout_ms(current_timeout);
+}
+
 TEST_F(ReadWriteTransactionTest, GetCommitTimestampWithoutTransactionCommit) {
   auto txn = CreateReadWriteTransaction();
   EXPECT_THAT(txn->GetCommitTimestamp(), StatusIs(absl::StatusCode::kInternal));
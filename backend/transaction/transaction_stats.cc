@@ -0,0 +1,319 @@
+//
+// Copyright 2026 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "backend/transaction/transaction_stats.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "zetasql/public/value.h"
+#include "absl/status/status.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/str_join.h"
+#include "absl/synchronization/mutex.h"
+#include "absl/time/time.h"
+#include "backend/common/stats_intervals.h"
+#include "backend/query/spanner_sys_stats.h"
+#include "farmhash.h"
+
+namespace google {
+namespace spanner {
+namespace emulator {
+namespace backend {
+
+namespace {
+
+using zetasql::values::Bytes;
+using zetasql::values::Double;
+using zetasql::values::Int64;
+using zetasql::values::String;
+using zetasql::values::StringArray;
+using zetasql::values::Timestamp;
+
+// Maximum number of distinct transactions and row ranges tracked per interval.
+constexpr int kMaxTransactionsPerInterval = 1000;
+constexpr int kMaxRowRangesPerInterval = 1000;
+
+// Maximum number of transactions and row ranges reported per interval by the
+// TOP tables.
+constexpr int kMaxTopTransactions = 100;
+constexpr int kMaxTopRowRanges = 100;
+
+// Returns the average of 'sum' over 'count' items, or zero if there are none.
+double Average(double sum, int64_t count) {
+  return count == 0 ? 0 : sum / count;
+}
+
+// Returns the fingerprint of the transactions with the given tag which write
+// the given columns and delete from the given tables.
+int64_t TransactionFingerprint(const TransactionAttemptStats& stats) {
+  return static_cast<int64_t>(farmhash::Fingerprint64(absl::StrCat(
+      stats.transaction_tag, "\n",
+      absl::StrJoin(stats.write_constructive_columns, ","), "\n",
+      absl::StrJoin(stats.write_delete_tables, ","))));
+}
+
+// Sorts the first 'max_top' items of 'items' by decreasing 'key', and drops
+// the others.
+template <typename T, typename KeyFn>
+void KeepTop(std::vector<T>* items, int max_top, KeyFn key) {
+  int num_top = std::min<int>(items->size(), max_top);
+  std::partial_sort(
+      items->begin(), items->begin() + num_top, items->end(),
+      [&key](const T& a, const T& b) { return key(a) > key(b); });
+  items->resize(num_top);
+}
+
+}  // namespace
+
+void TransactionStats::Aggregate::Add(const TransactionAttemptStats& stats) {
+  ++attempt_count;
+  if (stats.commit_attempted) {
+    ++commit_attempt_count;
+    if (stats.retry) {
+      ++commit_retry_count;
+    }
+    if (stats.status_code == absl::StatusCode::kAborted) {
+      ++commit_abort_count;
+    } else if (stats.status_code == absl::StatusCode::kFailedPrecondition) {
+      ++commit_failed_precondition_count;
+    }
+  }
+  if (!stats.commit_attempted || stats.status_code != absl::StatusCode::kOk) {
+    return;
+  }
+  ++committed_count;
+  total_latency_seconds += absl::ToDoubleSeconds(stats.total_latency);
+  commit_latency_seconds += absl::ToDoubleSeconds(stats.commit_latency);
+  participants += stats.participants;
+  bytes += stats.bytes;
+}
+
+void TransactionStats::Aggregate::AddToRow(SpannerSysStats::Row* row) const {
+  // Averages are over the attempts which committed.
+  (*row)["ATTEMPT_COUNT"] = Int64(attempt_count);
+  (*row)["COMMIT_ATTEMPT_COUNT"] = Int64(commit_attempt_count);
+  (*row)["COMMIT_ABORT_COUNT"] = Int64(commit_abort_count);
+  (*row)["COMMIT_FAILED_PRECONDITION_COUNT"] =
+      Int64(commit_failed_precondition_count);
+  (*row)["COMMIT_RETRY_COUNT"] = Int64(commit_retry_count);
+  (*row)["AVG_PARTICIPANTS"] =
+      Double(Average(participants, committed_count));
+  (*row)["AVG_TOTAL_LATENCY_SECONDS"] =
+      Double(Average(total_latency_seconds, committed_count));
+  (*row)["AVG_COMMIT_LATENCY_SECONDS"] =
+      Double(Average(commit_latency_seconds, committed_count));
+  (*row)["AVG_BYTES"] = Double(Average(bytes, committed_count));
+  // Read-write transactions in the emulator always lock pessimistically.
+  (*row)["SERIALIZABLE_PESSIMISTIC_TXN_COUNT"] = Int64(attempt_count);
+  (*row)["REPEATABLE_READ_OPTIMISTIC_TXN_COUNT"] = Int64(0);
+}
+
+void TransactionStats::RecordAttempt(absl::Time end_time,
+                                     const TransactionAttemptStats& stats) {
+  int64_t fingerprint = TransactionFingerprint(stats);
+
+  absl::MutexLock lock(&mu_);
+  for (StatsIntervals<Interval>& series : series_) {
+    Interval* interval = series.GetOrAdd(end_time);
+    if (interval == nullptr) {
+      continue;
+    }
+    interval->total.Add(stats);
+    auto txn_itr = interval->transactions.find(fingerprint);
+    if (txn_itr == interval->transactions.end()) {
+      if (interval->transactions.size() >= kMaxTransactionsPerInterval) {
+        continue;
+      }
+      txn_itr = interval->transactions.try_emplace(fingerprint).first;
+      txn_itr->second.transaction_tag = stats.transaction_tag;
+      txn_itr->second.write_constructive_columns =
+          stats.write_constructive_columns;
+      txn_itr->second.write_delete_tables = stats.write_delete_tables;
+    }
+    txn_itr->second.aggregate.Add(stats);
+  }
+}
+
+void TransactionStats::RecordLockWait(absl::Time end_time,
+                                      const std::string& row_range_start_key,
+                                      absl::Duration wait) {
+  double wait_seconds = absl::ToDoubleSeconds(wait);
+
+  absl::MutexLock lock(&mu_);
+  for (StatsIntervals<Interval>& series : series_) {
+    Interval* interval = series.GetOrAdd(end_time);
+    if (interval == nullptr) {
+      continue;
+    }
+    interval->total_lock_wait_seconds += wait_seconds;
+    auto range_itr = interval->lock_wait_seconds.find(row_range_start_key);
+    if (range_itr == interval->lock_wait_seconds.end()) {
+      if (interval->lock_wait_seconds.size() >= kMaxRowRangesPerInterval) {
+        continue;
+      }
+      range_itr =
+          interval->lock_wait_seconds.try_emplace(row_range_start_key).first;
+    }
+    range_itr->second += wait_seconds;
+  }
+}
+
+std::vector<SpannerSysStats::Row> TransactionStats::GetTxnTopRows(
+    absl::Duration interval_length) const {
+  std::vector<SpannerSysStats::Row> rows;
+  absl::ReaderMutexLock lock(&mu_);
+  const StatsIntervals<Interval>* series =
+      FindStatsIntervals(series_, interval_length);
+  if (series == nullptr) {
+    return rows;
+  }
+  for (const auto& [interval_end, interval] : series->intervals()) {
+    std::vector<std::pair<int64_t, const TransactionAggregate*>> transactions;
+    for (const auto& [fingerprint, transaction] : interval.transactions) {
+      transactions.emplace_back(fingerprint, &transaction);
+    }
+    KeepTop(&transactions, kMaxTopTransactions, [](const auto& transaction) {
+      return transaction.second->aggregate.total_latency_seconds;
+    });
+    for (const auto& [fingerprint, transaction] : transactions) {
+      SpannerSysStats::Row row;
+      row["INTERVAL_END"] = Timestamp(interval_end);
+      row["FPRINT"] = Int64(fingerprint);
+      row["TRANSACTION_TAG"] = String(transaction->transaction_tag);
+      row["WRITE_CONSTRUCTIVE_COLUMNS"] =
+          StringArray(transaction->write_constructive_columns);
+      row["WRITE_DELETE_TABLES"] =
+          StringArray(transaction->write_delete_tables);
+      transaction->aggregate.AddToRow(&row);
+      rows.push_back(std::move(row));
+    }
+  }
+  return rows;
+}
+
+std::vector<SpannerSysStats::Row> TransactionStats::GetTxnTotalRows(
+    absl::Duration interval_length) const {
+  std::vector<SpannerSysStats::Row> rows;
+  absl::ReaderMutexLock lock(&mu_);
+  const StatsIntervals<Interval>* series =
+      FindStatsIntervals(series_, interval_length);
+  if (series == nullptr) {
+    return rows;
+  }
+  for (const auto& [interval_end, interval] : series->intervals()) {
+    if (interval.total.attempt_count == 0) {
+      continue;
+    }
+    SpannerSysStats::Row row;
+    row["INTERVAL_END"] = Timestamp(interval_end);
+    interval.total.AddToRow(&row);
+    rows.push_back(std::move(row));
+  }
+  return rows;
+}
+
+std::vector<SpannerSysStats::Row> TransactionStats::GetLockTopRows(
+    absl::Duration interval_length) const {
+  std::vector<SpannerSysStats::Row> rows;
+  absl::ReaderMutexLock lock(&mu_);
+  const StatsIntervals<Interval>* series =
+      FindStatsIntervals(series_, interval_length);
+  if (series == nullptr) {
+    return rows;
+  }
+  for (const auto& [interval_end, interval] : series->intervals()) {
+    std::vector<std::pair<std::string, double>> row_ranges(
+        interval.lock_wait_seconds.begin(), interval.lock_wait_seconds.end());
+    KeepTop(&row_ranges, kMaxTopRowRanges,
+            [](const auto& row_range) { return row_range.second; });
+    for (const auto& [start_key, wait_seconds] : row_ranges) {
+      SpannerSysStats::Row row;
+      row["INTERVAL_END"] = Timestamp(interval_end);
+      row["ROW_RANGE_START_KEY"] = Bytes(start_key);
+      row["LOCK_WAIT_SECONDS"] = Double(wait_seconds);
+      rows.push_back(std::move(row));
+    }
+  }
+  return rows;
+}
+
+std::vector<SpannerSysStats::Row> TransactionStats::GetLockTotalRows(
+    absl::Duration interval_length) const {
+  std::vector<SpannerSysStats::Row> rows;
+  absl::ReaderMutexLock lock(&mu_);
+  const StatsIntervals<Interval>* series =
+      FindStatsIntervals(series_, interval_length);
+  if (series == nullptr) {
+    return rows;
+  }
+  for (const auto& [interval_end, interval] : series->intervals()) {
+    if (interval.lock_wait_seconds.empty()) {
+      continue;
+    }
+    SpannerSysStats::Row row;
+    row["INTERVAL_END"] = Timestamp(interval_end);
+    row["TOTAL_LOCK_WAIT_SECONDS"] = Double(interval.total_lock_wait_seconds);
+    rows.push_back(std::move(row));
+  }
+  return rows;
+}
+
+void TransactionStats::AddSources(SpannerSysStats* spanner_sys_stats) const {
+  struct Tables {
+    const char* txn_top;
+    const char* txn_total;
+    const char* lock_top;
+    const char* lock_total;
+    absl::Duration interval_length;
+  };
+  for (const Tables& tables : {
+           Tables{SpannerSysStats::kTxnStatsTopMinute,
+                  SpannerSysStats::kTxnStatsTotalMinute,
+                  SpannerSysStats::kLockStatsTopMinute,
+                  SpannerSysStats::kLockStatsTotalMinute, absl::Minutes(1)},
+           Tables{SpannerSysStats::kTxnStatsTop10Minute,
+                  SpannerSysStats::kTxnStatsTotal10Minute,
+                  SpannerSysStats::kLockStatsTop10Minute,
+                  SpannerSysStats::kLockStatsTotal10Minute, absl::Minutes(10)},
+           Tables{SpannerSysStats::kTxnStatsTopHour,
+                  SpannerSysStats::kTxnStatsTotalHour,
+                  SpannerSysStats::kLockStatsTopHour,
+                  SpannerSysStats::kLockStatsTotalHour, absl::Hours(1)},
+       }) {
+    absl::Duration interval_length = tables.interval_length;
+    spanner_sys_stats->SetSource(tables.txn_top, [this, interval_length]() {
+      return GetTxnTopRows(interval_length);
+    });
+    spanner_sys_stats->SetSource(tables.txn_total, [this, interval_length]() {
+      return GetTxnTotalRows(interval_length);
+    });
+    spanner_sys_stats->SetSource(tables.lock_top, [this, interval_length]() {
+      return GetLockTopRows(interval_length);
+    });
+    spanner_sys_stats->SetSource(tables.lock_total, [this, interval_length]() {
+      return GetLockTotalRows(interval_length);
+    });
+  }
+}
+
+}  // namespace backend
+}  // namespace emulator
+}  // namespace spanner
+}  // namespace google
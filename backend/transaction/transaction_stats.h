@@ -0,0 +1,162 @@
+//
+// Copyright 2026 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#ifndef THIRD_PARTY_CLOUD_SPANNER_EMULATOR_BACKEND_TRANSACTION_TRANSACTION_STATS_H_
+#define THIRD_PARTY_CLOUD_SPANNER_EMULATOR_BACKEND_TRANSACTION_TRANSACTION_STATS_H_
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "absl/base/thread_annotations.h"
+#include "absl/container/flat_hash_map.h"
+#include "absl/status/status.h"
+#include "absl/synchronization/mutex.h"
+#include "absl/time/time.h"
+#include "backend/common/stats_intervals.h"
+#include "backend/query/spanner_sys_stats.h"
+
+namespace google {
+namespace spanner {
+namespace emulator {
+namespace backend {
+
+// Measurements of a single attempt of a read-write transaction, which ends when
+// the transaction commits, fails to commit or is aborted.
+struct TransactionAttemptStats {
+  // The tag of the transaction set by the client, if any.
+  std::string transaction_tag;
+
+  // Columns written by inserts and updates, as "table.column", and tables
+  // deleted from, sorted and without duplicates.
+  std::vector<std::string> write_constructive_columns;
+  std::vector<std::string> write_delete_tables;
+
+  // Whether the attempt called Commit, and the status it ended with.
+  bool commit_attempted = false;
+  absl::StatusCode status_code = absl::StatusCode::kOk;
+
+  // Whether the attempt retries an attempt which was aborted.
+  bool retry = false;
+
+  // Time from the first operation of the attempt until it ended.
+  absl::Duration total_latency;
+
+  // Time spent in Commit.
+  absl::Duration commit_latency;
+
+  // Number of tables written. The emulator does not split tables, so this
+  // stands in for the number of participants of the commit.
+  int64_t participants = 0;
+
+  // Estimated size of the mutations of the attempt.
+  int64_t bytes = 0;
+};
+
+// TransactionStats aggregates transaction attempts per transaction fingerprint,
+// and waits for conflicting locks per row range, into the minute, 10 minute and
+// hour intervals served by the SPANNER_SYS.TXN_STATS_* and LOCK_STATS_*
+// tables.
+//
+// The fingerprint of a transaction is computed from its tag and the columns and
+// tables it writes. As with QueryStats, the interval which is still in progress
+// is reported as well, and the number of distinct transactions and row ranges
+// tracked per interval is bounded.
+//
+// This class is thread-safe.
+class TransactionStats {
+ public:
+  // Records an attempt of a transaction which ended at 'end_time'.
+  void RecordAttempt(absl::Time end_time, const TransactionAttemptStats& stats)
+      ABSL_LOCKS_EXCLUDED(mu_);
+
+  // Records a wait for a lock on the row range starting at
+  // 'row_range_start_key' which ended at 'end_time'.
+  void RecordLockWait(absl::Time end_time,
+                      const std::string& row_range_start_key,
+                      absl::Duration wait) ABSL_LOCKS_EXCLUDED(mu_);
+
+  // Returns the rows of TXN_STATS_TOP_* for intervals of the given length: the
+  // transactions with the highest total latency in each interval.
+  std::vector<SpannerSysStats::Row> GetTxnTopRows(
+      absl::Duration interval_length) const ABSL_LOCKS_EXCLUDED(mu_);
+
+  // Returns the rows of TXN_STATS_TOTAL_* for intervals of the given length.
+  std::vector<SpannerSysStats::Row> GetTxnTotalRows(
+      absl::Duration interval_length) const ABSL_LOCKS_EXCLUDED(mu_);
+
+  // Returns the rows of LOCK_STATS_TOP_* for intervals of the given length: the
+  // row ranges with the longest lock waits in each interval.
+  std::vector<SpannerSysStats::Row> GetLockTopRows(
+      absl::Duration interval_length) const ABSL_LOCKS_EXCLUDED(mu_);
+
+  // Returns the rows of LOCK_STATS_TOTAL_* for intervals of the given length.
+  std::vector<SpannerSysStats::Row> GetLockTotalRows(
+      absl::Duration interval_length) const ABSL_LOCKS_EXCLUDED(mu_);
+
+  // Sets the sources of the SPANNER_SYS.TXN_STATS_* and LOCK_STATS_* tables.
+  void AddSources(SpannerSysStats* spanner_sys_stats) const;
+
+ private:
+  // Sums over a set of transaction attempts.
+  struct Aggregate {
+    int64_t attempt_count = 0;
+    int64_t commit_attempt_count = 0;
+    int64_t commit_abort_count = 0;
+    int64_t commit_failed_precondition_count = 0;
+    int64_t commit_retry_count = 0;
+    int64_t committed_count = 0;
+    double total_latency_seconds = 0;
+    double commit_latency_seconds = 0;
+    int64_t participants = 0;
+    int64_t bytes = 0;
+
+    void Add(const TransactionAttemptStats& stats);
+
+    // Sets the columns shared by the TOP and TOTAL tables in 'row'.
+    void AddToRow(SpannerSysStats::Row* row) const;
+  };
+
+  struct TransactionAggregate {
+    std::string transaction_tag;
+    std::vector<std::string> write_constructive_columns;
+    std::vector<std::string> write_delete_tables;
+    Aggregate aggregate;
+  };
+
+  struct Interval {
+    // Aggregates of each transaction, keyed by fingerprint.
+    absl::flat_hash_map<int64_t, TransactionAggregate> transactions;
+    Aggregate total;
+
+    // Lock wait seconds of each row range, keyed by its start key.
+    absl::flat_hash_map<std::string, double> lock_wait_seconds;
+    double total_lock_wait_seconds = 0;
+  };
+
+  mutable absl::Mutex mu_;
+
+  // The intervals of each length reported by the statistics tables.
+  std::vector<StatsIntervals<Interval>> series_ ABSL_GUARDED_BY(mu_) =
+      MakeStatsIntervals<Interval>();
+};
+
+}  // namespace backend
+}  // namespace emulator
+}  // namespace spanner
+}  // namespace google
+
+#endif  // THIRD_PARTY_CLOUD_SPANNER_EMULATOR_BACKEND_TRANSACTION_TRANSACTION_STATS_H_
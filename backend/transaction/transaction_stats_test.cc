@@ -0,0 +1,157 @@
+//
+// Copyright 2026 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "backend/transaction/transaction_stats.h"
+
+#include <vector>
+
+#include "zetasql/public/value.h"
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "absl/status/status.h"
+#include "absl/time/time.h"
+#include "backend/query/spanner_sys_stats.h"
+
+namespace google {
+namespace spanner {
+namespace emulator {
+namespace backend {
+
+namespace {
+
+using zetasql::values::Bytes;
+using zetasql::values::Double;
+using zetasql::values::Int64;
+using zetasql::values::String;
+using zetasql::values::StringArray;
+using zetasql::values::Timestamp;
+
+TransactionAttemptStats Committed(absl::Duration latency) {
+  TransactionAttemptStats stats;
+  stats.write_constructive_columns = {"Users.Name"};
+  stats.commit_attempted = true;
+  stats.total_latency = latency;
+  stats.commit_latency = latency / 2;
+  stats.participants = 1;
+  stats.bytes = 100;
+  return stats;
+}
+
+TEST(TransactionStatsTest, AggregatesAttemptsPerFingerprint) {
+  TransactionStats transaction_stats;
+  absl::Time t0 = absl::FromUnixSeconds(3600);
+  transaction_stats.RecordAttempt(t0 + absl::Seconds(10),
+                                  Committed(absl::Seconds(1)));
+  TransactionAttemptStats aborted = Committed(absl::Seconds(5));
+  aborted.status_code = absl::StatusCode::kAborted;
+  transaction_stats.RecordAttempt(t0 + absl::Seconds(20), aborted);
+  TransactionAttemptStats retried = Committed(absl::Seconds(3));
+  retried.retry = true;
+  transaction_stats.RecordAttempt(t0 + absl::Seconds(30), retried);
+
+  TransactionAttemptStats tagged = Committed(absl::Seconds(1));
+  tagged.transaction_tag = "tag";
+  transaction_stats.RecordAttempt(t0 + absl::Seconds(40), tagged);
+
+  // The untagged transaction has the highest total latency.
+  std::vector<SpannerSysStats::Row> top =
+      transaction_stats.GetTxnTopRows(absl::Minutes(1));
+  ASSERT_EQ(top.size(), 2);
+  EXPECT_EQ(top[0].at("INTERVAL_END"), Timestamp(t0 + absl::Minutes(1)));
+  EXPECT_EQ(top[0].at("TRANSACTION_TAG"), String(""));
+  EXPECT_EQ(top[0].at("WRITE_CONSTRUCTIVE_COLUMNS"),
+            StringArray({"Users.Name"}));
+  EXPECT_EQ(top[0].at("ATTEMPT_COUNT"), Int64(3));
+  EXPECT_EQ(top[0].at("COMMIT_ATTEMPT_COUNT"), Int64(3));
+  EXPECT_EQ(top[0].at("COMMIT_ABORT_COUNT"), Int64(1));
+  EXPECT_EQ(top[0].at("COMMIT_RETRY_COUNT"), Int64(1));
+  EXPECT_EQ(top[0].at("AVG_TOTAL_LATENCY_SECONDS"), Double(2));
+  EXPECT_EQ(top[0].at("AVG_COMMIT_LATENCY_SECONDS"), Double(1));
+  EXPECT_EQ(top[0].at("AVG_BYTES"), Double(100));
+  EXPECT_EQ(top[1].at("TRANSACTION_TAG"), String("tag"));
+  EXPECT_NE(top[0].at("FPRINT"), top[1].at("FPRINT"));
+
+  std::vector<SpannerSysStats::Row> total =
+      transaction_stats.GetTxnTotalRows(absl::Hours(1));
+  ASSERT_EQ(total.size(), 1);
+  EXPECT_EQ(total[0].at("ATTEMPT_COUNT"), Int64(4));
+  EXPECT_EQ(total[0].at("AVG_PARTICIPANTS"), Double(1));
+}
+
+TEST(TransactionStatsTest, CountsAttemptsAbortedBeforeCommit) {
+  TransactionStats transaction_stats;
+  absl::Time t0 = absl::FromUnixSeconds(3600);
+  TransactionAttemptStats aborted;
+  aborted.status_code = absl::StatusCode::kAborted;
+  transaction_stats.RecordAttempt(t0, aborted);
+
+  std::vector<SpannerSysStats::Row> total =
+      transaction_stats.GetTxnTotalRows(absl::Minutes(1));
+  ASSERT_EQ(total.size(), 1);
+  EXPECT_EQ(total[0].at("ATTEMPT_COUNT"), Int64(1));
+  EXPECT_EQ(total[0].at("COMMIT_ATTEMPT_COUNT"), Int64(0));
+  EXPECT_EQ(total[0].at("COMMIT_ABORT_COUNT"), Int64(0));
+}
+
+TEST(TransactionStatsTest, AggregatesLockWaitsPerRowRange) {
+  TransactionStats transaction_stats;
+  absl::Time t0 = absl::FromUnixSeconds(3600);
+  transaction_stats.RecordLockWait(t0 + absl::Seconds(10), "Users(1)",
+                                   absl::Seconds(1));
+  transaction_stats.RecordLockWait(t0 + absl::Seconds(20), "Users(1)",
+                                   absl::Seconds(2));
+  transaction_stats.RecordLockWait(t0 + absl::Seconds(30), "Users(2)",
+                                   absl::Seconds(1));
+
+  std::vector<SpannerSysStats::Row> top =
+      transaction_stats.GetLockTopRows(absl::Minutes(10));
+  ASSERT_EQ(top.size(), 2);
+  EXPECT_EQ(top[0].at("ROW_RANGE_START_KEY"), Bytes("Users(1)"));
+  EXPECT_EQ(top[0].at("LOCK_WAIT_SECONDS"), Double(3));
+  EXPECT_EQ(top[1].at("ROW_RANGE_START_KEY"), Bytes("Users(2)"));
+
+  std::vector<SpannerSysStats::Row> total =
+      transaction_stats.GetLockTotalRows(absl::Minutes(10));
+  ASSERT_EQ(total.size(), 1);
+  EXPECT_EQ(total[0].at("TOTAL_LOCK_WAIT_SECONDS"), Double(4));
+
+  // Intervals with lock waits only have no transaction totals.
+  EXPECT_TRUE(transaction_stats.GetTxnTotalRows(absl::Minutes(10)).empty());
+}
+
+TEST(TransactionStatsTest, ServesSpannerSysTables) {
+  TransactionStats transaction_stats;
+  SpannerSysStats spanner_sys_stats;
+  transaction_stats.AddSources(&spanner_sys_stats);
+
+  transaction_stats.RecordAttempt(absl::Now(), Committed(absl::Seconds(1)));
+  transaction_stats.RecordLockWait(absl::Now(), "Users(1)", absl::Seconds(1));
+  for (const char* table : {SpannerSysStats::kTxnStatsTopMinute,
+                            SpannerSysStats::kTxnStatsTotal10Minute,
+                            SpannerSysStats::kTxnStatsTopHour,
+                            SpannerSysStats::kLockStatsTopMinute,
+                            SpannerSysStats::kLockStatsTotal10Minute,
+                            SpannerSysStats::kLockStatsTotalHour}) {
+    EXPECT_EQ(spanner_sys_stats.GetRows(table).size(), 1) << table;
+  }
+}
+
+}  // namespace
+
+}  // namespace backend
+}  // namespace emulator
+}  // namespace spanner
+}  // namespace google
@@ -72,29 +72,46 @@ void ResetInvalidValuesToNull(absl::Span<const Column* const> columns,
   }
 }
 
+// Returns the ids of the non-key columns of 'table' among 'columns'. Key
+// columns never change once a row exists, so they do not need to be locked.
+std::vector<ColumnID> GetLockedColumnIDs(
+    const Table* table, absl::Span<const Column* const> columns) {
+  std::vector<ColumnID> column_ids;
+  column_ids.reserve(columns.size());
+  for (const Column* column : columns) {
+    if (table->FindKeyColumn(column->Name()) == nullptr) {
+      column_ids.push_back(column->id());
+    }
+  }
+  return column_ids;
+}
+
 }  // namespace
 
 absl::Status TransactionStore::AcquireReadLock(
     const Table* table, const KeyRange& key_range,
     absl::Span<const Column* const> columns) const {
-  lock_handle_->EnqueueLock(LockRequest(LockMode::kShared, table->id(),
-                                        key_range, GetColumnIDs(columns)));
+  lock_handle_->EnqueueLock(
+      LockRequest(LockMode::kShared, table->id(), key_range,
+                  GetLockedColumnIDs(table, columns)));
   return lock_handle_->Wait();
 }
 
 absl::Status TransactionStore::AcquireWriteLock(
     const Table* table, const KeyRange& key_range,
     absl::Span<const Column* const> columns) const {
-  lock_handle_->EnqueueLock(LockRequest(LockMode::kExclusive, table->id(),
-                                        key_range, GetColumnIDs(columns)));
+  lock_handle_->EnqueueLock(
+      LockRequest(LockMode::kExclusive, table->id(), key_range,
+                  GetLockedColumnIDs(table, columns)));
   return lock_handle_->Wait();
 }
 
 absl::Status TransactionStore::BufferInsert(
     const Table* table, const Key& key, absl::Span<const Column* const> columns,
     const ValueList& values) {
-  // Acquire locks to prevent another transaction to modify this entity.
-  ZETASQL_RETURN_IF_ERROR(AcquireWriteLock(table, KeyRange::Point(key), columns));
+  // Acquire locks to prevent another transaction to modify this entity. An
+  // insert creates the row, so it locks the whole row.
+  ZETASQL_RETURN_IF_ERROR(AcquireWriteLock(table, KeyRange::Point(key), {}));
 
   RowOp row_op;
   bool row_exists = RowExistsInBuffer(table, key, &row_op);
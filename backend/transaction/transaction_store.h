@@ -126,7 +126,8 @@ class TransactionStore {
   absl::Status AcquireReadLock(const Table* table, const KeyRange& key_range,
                                absl::Span<const Column* const> columns) const;
 
-  // Acquires write locks for the specified column ranges.
+  // Acquires write locks for the specified column ranges. Without columns,
+  // whole rows are locked.
   absl::Status AcquireWriteLock(const Table* table, const KeyRange& key_range,
                                 absl::Span<const Column* const> columns) const;
 
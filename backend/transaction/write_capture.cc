@@ -0,0 +1,68 @@
+//
+// Copyright 2026 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "backend/transaction/write_capture.h"
+
+#include <set>
+#include <utility>
+#include <vector>
+
+#include "absl/container/flat_hash_map.h"
+#include "absl/container/flat_hash_set.h"
+#include "absl/synchronization/mutex.h"
+#include "backend/actions/ops.h"
+#include "backend/common/ids.h"
+#include "backend/datamodel/key.h"
+
+namespace google {
+namespace spanner {
+namespace emulator {
+namespace backend {
+
+void WriteCapture::Start(absl::flat_hash_set<TableID> table_ids) {
+  absl::MutexLock lock(&mu_);
+  table_ids_ = std::move(table_ids);
+  keys_.clear();
+}
+
+void WriteCapture::Record(const std::vector<WriteOp>& write_ops) {
+  absl::MutexLock lock(&mu_);
+  if (table_ids_.empty()) {
+    return;
+  }
+  for (const WriteOp& op : write_ops) {
+    const TableID& table_id = TableOf(op)->id();
+    if (table_ids_.contains(table_id)) {
+      keys_[table_id].insert(KeyOf(op));
+    }
+  }
+}
+
+absl::flat_hash_map<TableID, std::vector<Key>> WriteCapture::Stop() {
+  absl::MutexLock lock(&mu_);
+  absl::flat_hash_map<TableID, std::vector<Key>> keys;
+  for (auto& [table_id, table_keys] : keys_) {
+    keys[table_id] = std::vector<Key>(table_keys.begin(), table_keys.end());
+  }
+  table_ids_.clear();
+  keys_.clear();
+  return keys;
+}
+
+}  // namespace backend
+}  // namespace emulator
+}  // namespace spanner
+}  // namespace google
@@ -0,0 +1,75 @@
+//
+// Copyright 2026 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#ifndef THIRD_PARTY_CLOUD_SPANNER_EMULATOR_BACKEND_TRANSACTION_WRITE_CAPTURE_H_
+#define THIRD_PARTY_CLOUD_SPANNER_EMULATOR_BACKEND_TRANSACTION_WRITE_CAPTURE_H_
+
+#include <set>
+#include <vector>
+
+#include "absl/base/thread_annotations.h"
+#include "absl/container/flat_hash_map.h"
+#include "absl/container/flat_hash_set.h"
+#include "absl/synchronization/mutex.h"
+#include "backend/actions/ops.h"
+#include "backend/common/ids.h"
+#include "backend/datamodel/key.h"
+
+namespace google {
+namespace spanner {
+namespace emulator {
+namespace backend {
+
+// WriteCapture records the keys of the rows committed to a set of tables while
+// a schema change backfills them at an earlier snapshot, so that the schema
+// change can catch up on those rows before it is published.
+//
+// Read-write transactions record their writes after they are flushed to storage
+// and before they release their locks. Since a schema change waits for all
+// locks to be released before it is published, every commit before it has been
+// recorded by then.
+//
+// This class is thread-safe.
+class WriteCapture {
+ public:
+  // Starts capturing the rows written to the tables with 'table_ids'. Rows
+  // captured before are dropped.
+  void Start(absl::flat_hash_set<TableID> table_ids) ABSL_LOCKS_EXCLUDED(mu_);
+
+  // Records the rows written by a commit, if they are captured.
+  void Record(const std::vector<WriteOp>& write_ops) ABSL_LOCKS_EXCLUDED(mu_);
+
+  // Stops capturing and returns the keys of the rows written to each captured
+  // table since Start, in key order and without duplicates.
+  absl::flat_hash_map<TableID, std::vector<Key>> Stop()
+      ABSL_LOCKS_EXCLUDED(mu_);
+
+ private:
+  absl::Mutex mu_;
+
+  // The tables captured, empty if nothing is being captured.
+  absl::flat_hash_set<TableID> table_ids_ ABSL_GUARDED_BY(mu_);
+
+  // The keys of the rows written to each captured table.
+  absl::flat_hash_map<TableID, std::set<Key>> keys_ ABSL_GUARDED_BY(mu_);
+};
+
+}  // namespace backend
+}  // namespace emulator
+}  // namespace spanner
+}  // namespace google
+
+#endif  // THIRD_PARTY_CLOUD_SPANNER_EMULATOR_BACKEND_TRANSACTION_WRITE_CAPTURE_H_
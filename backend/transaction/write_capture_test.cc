@@ -0,0 +1,90 @@
+//
+// Copyright 2026 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "backend/transaction/write_capture.h"
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "zetasql/public/type.h"
+#include "zetasql/public/value.h"
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "backend/actions/ops.h"
+#include "backend/datamodel/key.h"
+#include "backend/schema/catalog/schema.h"
+#include "backend/schema/catalog/table.h"
+#include "tests/common/schema_constructor.h"
+
+namespace google {
+namespace spanner {
+namespace emulator {
+namespace backend {
+
+namespace {
+
+using ::testing::ElementsAre;
+using ::testing::IsEmpty;
+using zetasql::values::Int64;
+using zetasql::values::String;
+
+class WriteCaptureTest : public testing::Test {
+ protected:
+  WriteCaptureTest()
+      : schema_(test::CreateSchemaWithOneTable(&type_factory_)),
+        table_(schema_->FindTable("test_table")),
+        index_data_table_(
+            schema_->FindIndex("test_index")->index_data_table()) {}
+
+  WriteOp Insert(int64_t key) {
+    return InsertOp{table_, Key({Int64(key)}), {}, {}};
+  }
+
+  zetasql::TypeFactory type_factory_;
+  std::unique_ptr<const Schema> schema_;
+  const Table* table_;
+  const Table* index_data_table_;
+  WriteCapture capture_;
+};
+
+TEST_F(WriteCaptureTest, RecordsKeysOfCapturedTables) {
+  // Writes before the capture starts are not recorded.
+  capture_.Record({Insert(1)});
+
+  capture_.Start({table_->id()});
+  capture_.Record({Insert(3), DeleteOp{table_, Key({Int64(2)})}});
+  capture_.Record({Insert(3), InsertOp{index_data_table_,
+                                       Key({String("a"), Int64(3)}),
+                                       {},
+                                       {}}});
+  auto keys = capture_.Stop();
+  EXPECT_EQ(keys.size(), 1);
+  EXPECT_THAT(keys[table_->id()],
+              ElementsAre(Key({Int64(2)}), Key({Int64(3)})));
+
+  // Writes after the capture stops are not recorded.
+  capture_.Record({Insert(4)});
+  capture_.Start({table_->id()});
+  EXPECT_THAT(capture_.Stop(), IsEmpty());
+}
+
+}  // namespace
+
+}  // namespace backend
+}  // namespace emulator
+}  // namespace spanner
+}  // namespace google
@@ -63,6 +63,17 @@ var (
 	overrideChangeStreamPartitionTokenAliveSeconds = flag.Int("override_change_stream_partition_token_alive_seconds", -1,
 		"If set to X seconds, and X is greater than 0, then override the default partition token alive"+
 			"time from 20-40 seconds(default for Emulator only, not for production Spanner) to X-2X seconds.")
+	lockWaitTimeoutMs = flag.Int("lock_wait_timeout_ms", 1000,
+		"The maximum time in milliseconds that a transaction waits for a conflicting lock held "+
+			"by another transaction before it is aborted.")
+	preparedStatementCacheMaxBytes = flag.Int64("prepared_statement_cache_max_bytes", 64<<20,
+		"The maximum estimated memory in bytes used by the prepared statements that the query "+
+			"engine of a database keeps for reuse. A value of zero disables the prepared statement "+
+			"cache.")
+	maxDatabaseMemoryBytes = flag.Int64("max_database_memory_bytes", 0,
+		"The maximum estimated memory in bytes that the data of a single database may use. "+
+			"Commits which would exceed it fail with RESOURCE_EXHAUSTED. A value of zero means no "+
+			"limit.")
 	printNotices = flag.Bool("notices", false,
 		"If true, the emulator will print all third-party notices to stdout.")
 )
@@ -160,6 +171,9 @@ func main() {
 		DisableQueryNullFilteredIndexCheck: *disableQueryNullFilteredIndexCheck,
 		OverrideMaxDatabasesPerInstance:    instanceDbs,
 		OverrideChangeStreamPartitionTokenAliveSeconds: overrideChangeStreamPartitionTokenAliveSeconds,
+		LockWaitTimeoutMs:              *lockWaitTimeoutMs,
+		PreparedStatementCacheMaxBytes: *preparedStatementCacheMaxBytes,
+		MaxDatabaseMemoryBytes:         *maxDatabaseMemoryBytes,
 	}
 	gw := gateway.New(gwopts)
 	gw.Run()
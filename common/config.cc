@@ -16,6 +16,7 @@
 
 #include "common/config.h"
 
+#include <cstdint>
 #include <string>
 
 #include "absl/flags/flag.h"
@@ -51,6 +52,21 @@ ABSL_FLAG(
     "to the current transaction. A value of zero means that the emulator will "
     "never abort the current transaction.");
 
+ABSL_FLAG(int, lock_wait_timeout_ms, 1000,
+          "The maximum time in milliseconds that a transaction waits for a "
+          "conflicting lock held by another transaction before it is "
+          "aborted.");
+
+ABSL_FLAG(int64_t, prepared_statement_cache_max_bytes, 64 << 20,
+          "The maximum estimated memory in bytes used by the prepared "
+          "statements that the query engine of a database keeps for reuse. A "
+          "value of zero disables the prepared statement cache.");
+
+ABSL_FLAG(int64_t, max_database_memory_bytes, 0,
+          "The maximum estimated memory in bytes that the data of a single "
+          "database may use. Commits which would exceed it fail with "
+          "RESOURCE_EXHAUSTED. A value of zero means no limit.");
+
 namespace google {
 namespace spanner {
 namespace emulator {
@@ -76,6 +92,28 @@ void set_abort_current_transaction_probability(int probability) {
   absl::SetFlag(&FLAGS_abort_current_transaction_probability, probability);
 }
 
+int lock_wait_timeout_ms() { return absl::GetFlag(FLAGS_lock_wait_timeout_ms); }
+
+void set_lock_wait_timeout_ms(int timeout_ms) {
+  absl::SetFlag(&FLAGS_lock_wait_timeout_ms, timeout_ms);
+}
+
+int64_t prepared_statement_cache_max_bytes() {
+  return absl::GetFlag(FLAGS_prepared_statement_cache_max_bytes);
+}
+
+void set_prepared_statement_cache_max_bytes(int64_t max_bytes) {
+  absl::SetFlag(&FLAGS_prepared_statement_cache_max_bytes, max_bytes);
+}
+
+int64_t max_database_memory_bytes() {
+  return absl::GetFlag(FLAGS_max_database_memory_bytes);
+}
+
+void set_max_database_memory_bytes(int64_t max_bytes) {
+  absl::SetFlag(&FLAGS_max_database_memory_bytes, max_bytes);
+}
+
 }  // namespace config
 }  // namespace emulator
 }  // namespace spanner
@@ -17,6 +17,7 @@
 #ifndef THIRD_PARTY_CLOUD_SPANNER_EMULATOR_COMMON_CONFIG_H_
 #define THIRD_PARTY_CLOUD_SPANNER_EMULATOR_COMMON_CONFIG_H_
 
+#include <cstdint>
 #include <string>
 
 namespace google {
@@ -54,6 +55,25 @@ int abort_current_transaction_probability();
 
 void set_abort_current_transaction_probability(int probability);
 
+// The maximum time in milliseconds that a transaction waits for a conflicting
+// lock held by another transaction before it is aborted.
+int lock_wait_timeout_ms();
+
+void set_lock_wait_timeout_ms(int timeout_ms);
+
+// The maximum estimated memory in bytes used by the prepared statements that
+// the query engine of a database keeps for reuse. A value of zero disables
+// the prepared statement cache.
+int64_t prepared_statement_cache_max_bytes();
+
+void set_prepared_statement_cache_max_bytes(int64_t max_bytes);
+
+// The maximum estimated memory in bytes that the data of a single database may
+// use. A value of zero means no limit.
+int64_t max_database_memory_bytes();
+
+void set_max_database_memory_bytes(int64_t max_bytes);
+
 }  // namespace config
 }  // namespace emulator
 }  // namespace spanner
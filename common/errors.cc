@@ -180,6 +180,16 @@ absl::Status TooManyDatabasesPerInstance(absl::string_view instance_uri) {
           "more information."));
 }
 
+absl::Status DatabaseMemoryLimitExceeded(int64_t used_bytes,
+                                         int64_t limit_bytes) {
+  return absl::Status(
+      absl::StatusCode::kResourceExhausted,
+      absl::StrCat("The database would use about ", used_bytes,
+                   " bytes of memory, which exceeds its limit of ",
+                   limit_bytes,
+                   " bytes. See --max_database_memory_bytes."));
+}
+
 absl::Status InvalidDatabaseName(absl::string_view database_id) {
   return absl::Status(
       absl::StatusCode::kInvalidArgument,
@@ -521,7 +531,7 @@ absl::Status AbortConcurrentTransaction(int64_t requestor_id,
       absl::StatusCode::kAborted,
       absl::StrCat("Transaction ", requestor_id,
                    " aborted due to active transaction ", holder_id,
-                   ". The emulator only supports one transaction at a time."));
+                   " holding a conflicting lock."));
 }
 
 absl::Status AbortCurrentTransaction(backend::TransactionID holder_id,
@@ -530,16 +540,14 @@ absl::Status AbortCurrentTransaction(backend::TransactionID holder_id,
       absl::StatusCode::kAborted,
       absl::StrCat("Transaction: ", holder_id, " aborted due to transaction ",
                    requestor_id,
-                   " getting priority. "
-                   "The emulator only supports one transaction at a time."));
+                   " getting priority on a conflicting lock."));
 }
 
 absl::Status WoundedTransaction(backend::TransactionID id) {
   return absl::Status(
       absl::StatusCode::kAborted,
       absl::StrCat("Transaction: ", id,
-                   " aborted due to another transaction getting priority. "
-                   "The emulator only supports one transaction at a time."));
+                   " aborted due to another transaction getting priority."));
 }
 
 absl::Status CouldNotObtainLockHandleMutex(backend::TransactionID id) {
@@ -3507,6 +3515,18 @@ absl::Status InvalidPartitionedQueryMode() {
       "with partitioned queries.");
 }
 
+// Resume token errors.
+absl::Status InvalidResumeToken() {
+  return absl::Status(absl::StatusCode::kInvalidArgument,
+                      "Invalid resume token.");
+}
+
+absl::Status ResumeTokenForDifferentRequest() {
+  return absl::Status(
+      absl::StatusCode::kInvalidArgument,
+      "Resume token was created for a different read or sql request.");
+}
+
 absl::Status RowDeletionPolicyDoesNotExist(absl::string_view table_name) {
   return absl::Status(
       absl::StatusCode::kInvalidArgument,
@@ -61,6 +61,8 @@ absl::Status CreateDatabaseMissingCreateStatement();
 absl::Status InvalidCreateDatabaseStatement(absl::string_view statement);
 absl::Status UpdateDatabaseMissingStatements();
 absl::Status TooManyDatabasesPerInstance(absl::string_view instance_uri);
+absl::Status DatabaseMemoryLimitExceeded(int64_t used_bytes,
+                                         int64_t limit_bytes);
 absl::Status InvalidDatabaseName(absl::string_view database_id);
 absl::Status CannotCreatePostgreSQLDialectDatabase();
 
@@ -812,6 +814,10 @@ absl::Status ReadFromDifferentParameters();
 absl::Status InvalidPartitionedQueryMode();
 absl::Status InvalidTargetPartitionSizeBytes(absl::string_view message_name);
 
+// Resume token errors.
+absl::Status InvalidResumeToken();
+absl::Status ResumeTokenForDifferentRequest();
+
 // Row Deletion Policy errors.
 absl::Status RowDeletionPolicyDoesNotExist(absl::string_view table_name);
 absl::Status RowDeletionPolicyAlreadyExists(absl::string_view column_name,
@@ -17,6 +17,9 @@
 #ifndef THIRD_PARTY_CLOUD_SPANNER_EMULATOR_FRONTEND_CONVERTERS_CHUNKING_H_
 #define THIRD_PARTY_CLOUD_SPANNER_EMULATOR_FRONTEND_CONVERTERS_CHUNKING_H_
 
+#include <cstdint>
+#include <functional>
+#include <string>
 #include <vector>
 
 #include "google/protobuf/struct.pb.h"
@@ -30,6 +33,82 @@ namespace spanner {
 namespace emulator {
 namespace frontend {
 
+// PartialResultSetChunker encodes the values of a result into PartialResultSets
+// as they are added, splitting strings and lists which do not fit into the
+// current PartialResultSet. Each PartialResultSet is passed on as soon as it is
+// full, so that at most one of them is held in memory at a time.
+//
+// Data will be chunked as necessary to comply with the Cloud Spanner streaming
+// chunk size limit. Only Strings and Lists need to be chunked (Structs are not
+// a valid column type and will return an error if encountered).
+class PartialResultSetChunker {
+ public:
+  using ChunkCallback =
+      std::function<void(google::spanner::v1::PartialResultSet chunk)>;
+
+  // Full chunks are passed to 'on_chunk' in order. 'first_chunk' holds the
+  // fields of the first chunk other than its values, such as the metadata.
+  PartialResultSetChunker(int64_t max_chunk_size,
+                          google::spanner::v1::PartialResultSet first_chunk,
+                          ChunkCallback on_chunk);
+
+  PartialResultSetChunker(const PartialResultSetChunker&) = delete;
+  PartialResultSetChunker& operator=(const PartialResultSetChunker&) = delete;
+
+  // Adds the next value of the result.
+  absl::Status AddValue(const google::protobuf::Value& value);
+
+  // Returns true if the current chunk is full, so that the next value added
+  // would start a new chunk.
+  bool IsFull() const { return HasExceededChunkLimit(); }
+
+  // Passes on the current chunk with 'resume_token' and starts a new one. Must
+  // only be called between rows, since a stream resumes at the row following
+  // its resume token.
+  void EndChunk(std::string resume_token);
+
+  // Returns the last chunk, which is not passed to the callback so that the
+  // caller can add the stats of the result to it. No values may be added
+  // afterwards.
+  google::spanner::v1::PartialResultSet Finish();
+
+ private:
+  bool HasExceededChunkLimit() const;
+  bool IsListOpen() const;
+  void AddUnchunkedValue(const google::protobuf::Value& value,
+                         int64_t value_size);
+  void CheckListBoundary();
+  void CheckStringBoundary();
+  void AddString(absl::string_view str);
+  void AddUnchunkedString(absl::string_view str);
+  void StartList();
+  void FinishList();
+  void StartNewResultSet();
+
+  // The maximum allowed size of a chunk.
+  const int64_t max_chunk_size_;
+
+  // Receives the chunks which are full.
+  ChunkCallback on_chunk_;
+
+  // The chunk which is being appended to.
+  google::spanner::v1::PartialResultSet chunk_;
+
+  // The size of the current chunk. This is an estimate of the current chunk
+  // size. This estimate should work fine in practice since the max chunk size
+  // is 1MB and the default message size limit is 4MB for gRPC. Since we do not
+  // explicitly track the metadata, our size estimate could be off by as much
+  // as a factor of 2. However, this shouldn't be a problem since it will be
+  // well below the gRPC limit.
+  int64_t current_chunk_size_;
+
+  // The list stack is used to track nested lists. When a result set is chunked
+  // all current lists need to be truncated and matching versions created in
+  // the next chunk.
+  std::vector<google::protobuf::RepeatedPtrField<google::protobuf::Value>*>
+      stack_;
+};
+
 // Takes a ResultSet and chunks it into smaller pieces as necessary. Each
 // resulting piece will have a size <= max_chunk_size. Returns an ordered list
 // of PartialResultSets or an error.
@@ -18,6 +18,7 @@
 
 #include <random>
 #include <string>
+#include <utility>
 #include <vector>
 
 #include "google/protobuf/struct.pb.h"
@@ -675,6 +676,50 @@ TEST(ChunkingTest, CheckSizeLimit) {
   }
 }
 
+TEST(ChunkingTest, ChunkerPassesOnFullChunksAsValuesAreAdded) {
+  const size_t kChunkSize = 18;
+  PartialResultSet first_chunk = PARSE_TEXT_PROTO(R"(
+    metadata {
+      row_type {
+        fields {
+          name: "s"
+          type { code: STRING }
+        }
+      }
+    }
+  )");
+  std::vector<PartialResultSet> chunks;
+  PartialResultSetChunker chunker(
+      kChunkSize, first_chunk,
+      [&](PartialResultSet chunk) { chunks.push_back(std::move(chunk)); });
+
+  // A chunk is passed on once a value no longer fits into it, before the rest
+  // of the result is added.
+  google::protobuf::Value value;
+  value.set_string_value("abcdefghijklmnopqrstuvwxyz");
+  ZETASQL_ASSERT_OK(chunker.AddValue(value));
+  ASSERT_FALSE(chunks.empty());
+  EXPECT_TRUE(chunks[0].has_metadata());
+  EXPECT_TRUE(chunks[0].chunked_value());
+
+  value.set_string_value("xyz");
+  ZETASQL_ASSERT_OK(chunker.AddValue(value));
+  chunks.push_back(chunker.Finish());
+
+  // The chunks are the same as those of the whole result set.
+  ResultSet result;
+  *result.mutable_metadata() = first_chunk.metadata();
+  auto row = result.add_rows();
+  row->add_values()->set_string_value("abcdefghijklmnopqrstuvwxyz");
+  row->add_values()->set_string_value("xyz");
+  ZETASQL_ASSERT_OK_AND_ASSIGN(std::vector<PartialResultSet> expected_chunks,
+                       ChunkResultSet(result, kChunkSize));
+  ASSERT_EQ(chunks.size(), expected_chunks.size());
+  for (int i = 0; i < chunks.size(); ++i) {
+    EXPECT_THAT(chunks[i], test::EqualsProto(expected_chunks[i]));
+  }
+}
+
 TEST(ChunkingTest, RandomChunking) {
   int64_t time = absl::ToUnixNanos(absl::Now());
   std::seed_seq seed({time});
@@ -16,9 +16,15 @@
 
 #include "frontend/converters/reads.h"
 
+#include <cstdint>
 #include <limits>
+#include <optional>
+#include <string>
+#include <utility>
 #include <vector>
 
+#include "google/protobuf/io/coded_stream.h"
+#include "google/protobuf/io/zero_copy_stream_impl_lite.h"
 #include "google/protobuf/struct.pb.h"
 #include "google/spanner/v1/keys.pb.h"
 #include "google/spanner/v1/result_set.pb.h"
@@ -26,7 +32,10 @@
 #include "zetasql/public/type.h"
 #include "zetasql/public/value.h"
 #include "absl/status/statusor.h"
+#include "absl/strings/escaping.h"
 #include "absl/strings/str_cat.h"
+#include "absl/strings/string_view.h"
+#include "absl/time/time.h"
 #include "backend/access/write.h"
 #include "backend/datamodel/key.h"
 #include "backend/datamodel/key_range.h"
@@ -45,6 +54,8 @@
 #include "frontend/converters/types.h"
 #include "frontend/converters/values.h"
 #include "frontend/proto/partition_token.pb.h"
+#include "frontend/proto/resume_token.pb.h"
+#include "farmhash.h"
 #include "absl/status/status.h"
 #include "zetasql/base/status_macros.h"
 
@@ -57,17 +68,18 @@ namespace spanner_api = ::google::spanner::v1;
 
 namespace {
 
-absl::Status ResultSetMetadataToProto(backend::RowCursor* cursor,
-                                      v1::ResultSetMetadata* metadata_pb) {
-  for (int i = 0; i < cursor->NumColumns(); ++i) {
-    auto* field_pb = metadata_pb->mutable_row_type()->add_fields();
-    field_pb->set_name(cursor->ColumnName(i));
-    ZETASQL_RETURN_IF_ERROR(
-        TypeToProto(cursor->ColumnType(i), field_pb->mutable_type()))
-        << " when converting column " << cursor->ColumnName(i) << " of type "
-        << cursor->ColumnType(i) << " at position " << i << " in row cursor";
+// Returns the fingerprint of 'request', serialized deterministically since
+// Message::SerializeToString() may not order map entries consistently.
+template <typename Request>
+int64_t SerializeAndFingerprint(const Request& request) {
+  std::string serialized_request;
+  {
+    google::protobuf::io::StringOutputStream stream(&serialized_request);
+    google::protobuf::io::CodedOutputStream output(&stream);
+    output.SetSerializationDeterministic(true);
+    request.SerializeToCodedStream(&output);
   }
-  return absl::OkStatus();
+  return farmhash::Fingerprint64(serialized_request);
 }
 
 absl::Status ValidateStaleness(absl::Duration staleness) {
@@ -221,6 +233,19 @@ absl::Status ReadArgFromProto(const backend::Schema& schema,
   return absl::OkStatus();
 }
 
+absl::Status ResultSetMetadataToProto(backend::RowCursor* cursor,
+                                      v1::ResultSetMetadata* metadata_pb) {
+  for (int i = 0; i < cursor->NumColumns(); ++i) {
+    auto* field_pb = metadata_pb->mutable_row_type()->add_fields();
+    field_pb->set_name(cursor->ColumnName(i));
+    ZETASQL_RETURN_IF_ERROR(
+        TypeToProto(cursor->ColumnType(i), field_pb->mutable_type()))
+        << " when converting column " << cursor->ColumnName(i) << " of type "
+        << cursor->ColumnType(i) << " at position " << i << " in row cursor";
+  }
+  return absl::OkStatus();
+}
+
 absl::Status RowCursorToResultSetProto(backend::RowCursor* cursor, int limit,
                                        spanner_api::ResultSet* result_pb) {
   ZETASQL_RETURN_IF_ERROR(
@@ -236,18 +261,153 @@ absl::Status RowCursorToResultSetProto(backend::RowCursor* cursor, int limit,
     }
     ++row_count;
     if (limit > 0 && limit == row_count) {
-      break;
+      return absl::OkStatus();
     }
   }
 
-  return absl::OkStatus();
+  // Cursors may produce rows lazily and fail part way through.
+  return cursor->Status();
+}
+
+int64_t ResumeTokenFingerprint(const spanner_api::ReadRequest& request) {
+  spanner_api::ReadRequest copy = request;
+  // A stream may be resumed in the transaction begun by its first request.
+  copy.clear_transaction();
+  copy.clear_resume_token();
+  return SerializeAndFingerprint(copy);
+}
+
+int64_t ResumeTokenFingerprint(const spanner_api::ExecuteSqlRequest& request) {
+  spanner_api::ExecuteSqlRequest copy = request;
+  copy.clear_transaction();
+  copy.clear_resume_token();
+  copy.set_seqno(0);
+  return SerializeAndFingerprint(copy);
+}
+
+absl::StatusOr<std::string> ResumeTokenToString(
+    const ResumeToken& resume_token) {
+  std::string binary_string;
+  ZETASQL_RET_CHECK(resume_token.SerializeToString(&binary_string))
+      << "Failed to serialize proto: " << absl::StrCat(resume_token);
+  return absl::WebSafeBase64Escape(binary_string);
+}
+
+absl::StatusOr<ResumeToken> ResumeTokenFromString(
+    absl::string_view token, int64_t request_fingerprint) {
+  std::string binary_string;
+  if (!absl::WebSafeBase64Unescape(token, &binary_string)) {
+    return error::InvalidResumeToken();
+  }
+
+  ResumeToken resume_token;
+  if (!resume_token.ParseFromString(binary_string) ||
+      resume_token.row_count() < 0) {
+    return error::InvalidResumeToken();
+  }
+  if (resume_token.request_fingerprint() != request_fingerprint) {
+    return error::ResumeTokenForDifferentRequest();
+  }
+  return resume_token;
+}
+
+absl::StatusOr<ResumeToken> MakeResumeToken(
+    int64_t request_fingerprint, std::optional<absl::Time> read_timestamp,
+    const std::optional<ResumeToken>& resume_from) {
+  ResumeToken resume_token;
+  resume_token.set_request_fingerprint(request_fingerprint);
+  resume_token.set_row_count(0);
+  if (read_timestamp.has_value()) {
+    ZETASQL_ASSIGN_OR_RETURN(*resume_token.mutable_read_timestamp(),
+                     TimestampToProto(*read_timestamp));
+  }
+  if (!resume_from.has_value()) {
+    return resume_token;
+  }
+
+  // Rows read at another timestamp may not line up with the rows which were
+  // already sent.
+  if (resume_from->has_read_timestamp() != read_timestamp.has_value()) {
+    return error::ResumeTokenForDifferentRequest();
+  }
+  if (read_timestamp.has_value()) {
+    ZETASQL_ASSIGN_OR_RETURN(absl::Time resumed_timestamp,
+                     TimestampFromProto(resume_from->read_timestamp()));
+    if (resumed_timestamp != *read_timestamp) {
+      return error::ResumeTokenForDifferentRequest();
+    }
+  }
+  resume_token.set_row_count(resume_from->row_count());
+  return resume_token;
+}
+
+spanner_api::TransactionSelector ResumedTransactionSelector(
+    const spanner_api::TransactionSelector& selector,
+    const ResumeToken& resume_from) {
+  spanner_api::TransactionSelector resumed = selector;
+  if (!resume_from.has_read_timestamp()) {
+    return resumed;
+  }
+  spanner_api::TransactionOptions* options = nullptr;
+  if (resumed.has_single_use()) {
+    options = resumed.mutable_single_use();
+  } else if (resumed.has_begin()) {
+    options = resumed.mutable_begin();
+  }
+  if (options != nullptr && options->has_read_only()) {
+    *options->mutable_read_only()->mutable_read_timestamp() =
+        resume_from.read_timestamp();
+  }
+  return resumed;
+}
+
+absl::Status AddRowCursorToChunker(backend::RowCursor* cursor, int limit,
+                                   PartialResultSetChunker* chunker,
+                                   ResumeToken* resume_token) {
+  int64_t row_count = 0;
+  if (resume_token != nullptr) {
+    // Skip the rows which were sent before the stream was interrupted.
+    while (row_count < resume_token->row_count() && cursor->Next()) {
+      ++row_count;
+    }
+  }
+
+  while ((limit <= 0 || row_count < limit) && cursor->Next()) {
+    for (int i = 0; i < cursor->NumColumns(); ++i) {
+      ZETASQL_ASSIGN_OR_RETURN(google::protobuf::Value value_pb,
+                       ValueToProto(cursor->ColumnValue(i)));
+      ZETASQL_RETURN_IF_ERROR(chunker->AddValue(value_pb));
+    }
+    ++row_count;
+
+    // Chunks which fill up at the end of a row are the ones the stream can
+    // resume after, so only they carry a resume token.
+    if (resume_token != nullptr && chunker->IsFull()) {
+      resume_token->set_row_count(row_count);
+      ZETASQL_ASSIGN_OR_RETURN(std::string token,
+                       ResumeTokenToString(*resume_token));
+      chunker->EndChunk(std::move(token));
+    }
+  }
+
+  // Cursors may produce rows lazily and fail part way through.
+  return cursor->Status();
 }
 
 absl::StatusOr<std::vector<spanner_api::PartialResultSet>>
 RowCursorToPartialResultSetProtos(backend::RowCursor* cursor, int limit) {
-  spanner_api::ResultSet result_set;
-  ZETASQL_RETURN_IF_ERROR(RowCursorToResultSetProto(cursor, limit, &result_set));
-  return ChunkResultSet(result_set, limits::kMaxStreamingChunkSize);
+  spanner_api::PartialResultSet first_chunk;
+  ZETASQL_RETURN_IF_ERROR(
+      ResultSetMetadataToProto(cursor, first_chunk.mutable_metadata()));
+  std::vector<spanner_api::PartialResultSet> results;
+  PartialResultSetChunker chunker(
+      limits::kMaxStreamingChunkSize, std::move(first_chunk),
+      [&](spanner_api::PartialResultSet chunk) {
+        results.push_back(std::move(chunk));
+      });
+  ZETASQL_RETURN_IF_ERROR(AddRowCursorToChunker(cursor, limit, &chunker));
+  results.push_back(chunker.Finish());
+  return results;
 }
 
 }  // namespace frontend
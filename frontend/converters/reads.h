@@ -17,17 +17,26 @@
 #ifndef THIRD_PARTY_CLOUD_SPANNER_EMULATOR_FRONTEND_CONVERTERS_READS_H_
 #define THIRD_PARTY_CLOUD_SPANNER_EMULATOR_FRONTEND_CONVERTERS_READS_H_
 
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <vector>
+
 #include "google/spanner/v1/mutation.pb.h"
 #include "google/spanner/v1/result_set.pb.h"
 #include "google/spanner/v1/spanner.pb.h"
 #include "google/spanner/v1/transaction.pb.h"
 #include "absl/status/status.h"
 #include "absl/status/statusor.h"
+#include "absl/strings/string_view.h"
+#include "absl/time/time.h"
 #include "backend/access/read.h"
 #include "backend/access/write.h"
 #include "backend/common/ids.h"
 #include "backend/schema/catalog/schema.h"
 #include "backend/transaction/options.h"
+#include "frontend/converters/chunking.h"
+#include "frontend/proto/resume_token.pb.h"
 #include "absl/status/status.h"
 
 namespace google {
@@ -43,6 +52,11 @@ absl::Status ReadArgFromProto(const backend::Schema& schema,
                               const google::spanner::v1::ReadRequest& request,
                               backend::ReadArg* read_arg);
 
+// Populates the row type of 'metadata_pb' from the columns of 'cursor'.
+absl::Status ResultSetMetadataToProto(
+    backend::RowCursor* cursor,
+    google::spanner::v1::ResultSetMetadata* metadata_pb);
+
 // Converts a RowCursor to a ResultSet proto.
 //
 // Only handles the types and values supported by Cloud Spanner. Invalid types
@@ -62,6 +76,51 @@ absl::Status RowCursorToResultSetProto(
 absl::StatusOr<std::vector<google::spanner::v1::PartialResultSet>>
 RowCursorToPartialResultSetProtos(backend::RowCursor* cursor, int limit);
 
+// Returns the fingerprint of a streaming request which is recorded in its
+// resume tokens, so that a token is only accepted by retries of the request.
+int64_t ResumeTokenFingerprint(const google::spanner::v1::ReadRequest& request);
+int64_t ResumeTokenFingerprint(
+    const google::spanner::v1::ExecuteSqlRequest& request);
+
+// Converts a ResumeToken to the resume token returned to clients, and back.
+// ResumeTokenFromString returns an error if the token is malformed or was
+// created by a request with a different fingerprint.
+absl::StatusOr<std::string> ResumeTokenToString(
+    const ResumeToken& resume_token);
+absl::StatusOr<ResumeToken> ResumeTokenFromString(absl::string_view token,
+                                                  int64_t request_fingerprint);
+
+// Returns the resume token at the start of the rows of a request with the
+// given fingerprint, which are read at 'read_timestamp' if they are read at a
+// fixed timestamp. If the request resumes a stream from 'resume_from', the
+// token continues from there instead, once it is checked that the rows are read
+// at the same timestamp as before.
+absl::StatusOr<ResumeToken> MakeResumeToken(
+    int64_t request_fingerprint, std::optional<absl::Time> read_timestamp,
+    const std::optional<ResumeToken>& resume_from);
+
+// Returns the transaction selector with which a request resumes the stream of
+// 'resume_from': a new read-only transaction reads at the timestamp of the
+// stream it resumes rather than at its own timestamp bound.
+google::spanner::v1::TransactionSelector ResumedTransactionSelector(
+    const google::spanner::v1::TransactionSelector& selector,
+    const ResumeToken& resume_from);
+
+// Converts the rows of a RowCursor to values added to 'chunker' as they are
+// read, so that the rows are streamed rather than held in memory.
+//
+// Only handles the types and values supported by Cloud Spanner. If limit > 0,
+// will only convert first limit numbers of rows.
+//
+// If 'resume_token' is not null, the first resume_token->row_count() rows are
+// skipped, and each chunk which fills up at the end of a row carries a copy of
+// 'resume_token' with the number of rows sent up to the end of the chunk. The
+// cursor must then produce the same rows in the same order on every execution
+// of the request.
+absl::Status AddRowCursorToChunker(backend::RowCursor* cursor, int limit,
+                                   PartialResultSetChunker* chunker,
+                                   ResumeToken* resume_token = nullptr);
+
 }  // namespace frontend
 }  // namespace emulator
 }  // namespace spanner
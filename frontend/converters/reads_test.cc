@@ -16,7 +16,10 @@
 
 #include "frontend/converters/reads.h"
 
+#include <cstdint>
 #include <memory>
+#include <optional>
+#include <utility>
 #include <vector>
 
 #include "google/spanner/v1/mutation.pb.h"
@@ -995,6 +998,57 @@ TEST_F(AccessProtosTest, CanConvertEmptyUuidRowCursorToResultSet) {
                                   }
                              )pb"));
 }
+
+TEST_F(AccessProtosTest, ResumesStreamAfterResumeToken) {
+  ReadRequest request;
+  request.set_table("test_table");
+  int64_t fingerprint = ResumeTokenFingerprint(request);
+
+  // Each row fills a chunk, so that every chunk ends between rows.
+  std::vector<PartialResultSet> chunks;
+  PartialResultSetChunker chunker(
+      /*max_chunk_size=*/1, PartialResultSet(),
+      [&](PartialResultSet chunk) { chunks.push_back(std::move(chunk)); });
+  TestRowCursor cursor({"int64"}, {Int64Type()},
+                       {{Int64(1)}, {Int64(2)}, {Int64(3)}});
+  ZETASQL_ASSERT_OK_AND_ASSIGN(
+      ResumeToken resume_token,
+      MakeResumeToken(fingerprint, std::nullopt, std::nullopt));
+  ZETASQL_ASSERT_OK(
+      AddRowCursorToChunker(&cursor, /*limit=*/0, &chunker, &resume_token));
+  ASSERT_EQ(chunks.size(), 3);
+
+  // Resume as if the stream was interrupted after its first chunk.
+  ZETASQL_ASSERT_OK_AND_ASSIGN(
+      ResumeToken resume_from,
+      ResumeTokenFromString(chunks[0].resume_token(), fingerprint));
+  EXPECT_EQ(resume_from.row_count(), 1);
+  ZETASQL_ASSERT_OK_AND_ASSIGN(
+      resume_token, MakeResumeToken(fingerprint, std::nullopt, resume_from));
+
+  std::vector<PartialResultSet> resumed_chunks;
+  PartialResultSetChunker resumed_chunker(
+      /*max_chunk_size=*/1, PartialResultSet(),
+      [&](PartialResultSet chunk) {
+        resumed_chunks.push_back(std::move(chunk));
+      });
+  TestRowCursor resumed_cursor({"int64"}, {Int64Type()},
+                               {{Int64(1)}, {Int64(2)}, {Int64(3)}});
+  ZETASQL_ASSERT_OK(AddRowCursorToChunker(&resumed_cursor, /*limit=*/0,
+                                  &resumed_chunker, &resume_token));
+  ASSERT_EQ(resumed_chunks.size(), 2);
+  EXPECT_THAT(resumed_chunks[0].values(0),
+              test::EqualsProto(R"pb(string_value: "2")pb"));
+  EXPECT_EQ(resumed_chunks[1].resume_token(), chunks[2].resume_token());
+
+  // The token is not accepted by a different read.
+  request.set_table("other_table");
+  EXPECT_THAT(ResumeTokenFromString(chunks[0].resume_token(),
+                                    ResumeTokenFingerprint(request)),
+              StatusIs(absl::StatusCode::kInvalidArgument));
+  EXPECT_THAT(ResumeTokenFromString("not a token", fingerprint),
+              StatusIs(absl::StatusCode::kInvalidArgument));
+}
 }  // namespace
 
 }  // namespace frontend
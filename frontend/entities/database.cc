@@ -16,8 +16,13 @@
 
 #include "frontend/entities/database.h"
 
+#include <functional>
+#include <thread>  // NOLINT
+#include <utility>
+
 #include "google/spanner/admin/database/v1/spanner_database_admin.pb.h"
 #include "absl/status/status.h"
+#include "absl/synchronization/mutex.h"
 #include "zetasql/base/status_macros.h"
 
 namespace google {
@@ -25,6 +30,18 @@ namespace spanner {
 namespace emulator {
 namespace frontend {
 
+Database::~Database() {
+  std::thread schema_change_thread;
+  {
+    absl::MutexLock lock(&mu_);
+    stop_schema_change_thread_ = true;
+    schema_change_thread = std::move(schema_change_thread_);
+  }
+  if (schema_change_thread.joinable()) {
+    schema_change_thread.join();
+  }
+}
+
 absl::Status Database::ToProto(admin::database::v1::Database* database) {
   database->set_name(database_uri_);
   database->set_state(admin::database::v1::Database::READY);
@@ -32,6 +49,33 @@ absl::Status Database::ToProto(admin::database::v1::Database* database) {
   return absl::OkStatus();
 }
 
+void Database::EnqueueSchemaChange(std::function<void()> schema_change) {
+  absl::MutexLock lock(&mu_);
+  schema_changes_.push_back(std::move(schema_change));
+  if (!schema_change_thread_.joinable()) {
+    schema_change_thread_ = std::thread(&Database::RunSchemaChanges, this);
+  }
+}
+
+void Database::RunSchemaChanges() {
+  while (true) {
+    std::function<void()> schema_change;
+    {
+      absl::MutexLock lock(&mu_);
+      auto has_work = [this]() ABSL_EXCLUSIVE_LOCKS_REQUIRED(mu_) {
+        return !schema_changes_.empty() || stop_schema_change_thread_;
+      };
+      mu_.Await(absl::Condition(&has_work));
+      if (schema_changes_.empty()) {
+        return;
+      }
+      schema_change = std::move(schema_changes_.front());
+      schema_changes_.pop_front();
+    }
+    schema_change();
+  }
+}
+
 }  // namespace frontend
 }  // namespace emulator
 }  // namespace spanner
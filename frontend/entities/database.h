@@ -17,10 +17,16 @@
 #ifndef THIRD_PARTY_CLOUD_SPANNER_EMULATOR_FRONTEND_DATABASE_H_
 #define THIRD_PARTY_CLOUD_SPANNER_EMULATOR_FRONTEND_DATABASE_H_
 
+#include <deque>
+#include <functional>
+#include <memory>
 #include <string>
+#include <thread>  // NOLINT
 
 #include "google/spanner/admin/database/v1/spanner_database_admin.pb.h"
+#include "absl/base/thread_annotations.h"
 #include "absl/status/status.h"
+#include "absl/synchronization/mutex.h"
 #include "absl/time/time.h"
 #include "backend/database/database.h"
 #include "absl/status/status.h"
@@ -44,6 +50,9 @@ class Database {
         backend_(std::move(backend)),
         create_time_(create_time) {}
 
+  // Runs the schema changes still enqueued, and stops the schema change thread.
+  ~Database();
+
   // Returns the URI for this database.
   const std::string& database_uri() const { return database_uri_; }
 
@@ -53,7 +62,16 @@ class Database {
   // Converts this database object to its proto representation.
   absl::Status ToProto(admin::database::v1::Database* database);
 
+  // Runs 'schema_change' in a background thread, after the schema changes
+  // enqueued before it, so that long-running schema change operations can be
+  // returned before they are done.
+  void EnqueueSchemaChange(std::function<void()> schema_change)
+      ABSL_LOCKS_EXCLUDED(mu_);
+
  private:
+  // Runs the enqueued schema changes until the database is destroyed.
+  void RunSchemaChanges() ABSL_LOCKS_EXCLUDED(mu_);
+
   // The URI for this database.
   const std::string database_uri_;
 
@@ -62,6 +80,17 @@ class Database {
 
   // The time at which this database was created.
   const absl::Time create_time_;
+
+  // Mutex to guard state below.
+  absl::Mutex mu_;
+
+  // Schema changes which have not started yet, in the order they were enqueued.
+  std::deque<std::function<void()>> schema_changes_ ABSL_GUARDED_BY(mu_);
+
+  bool stop_schema_change_thread_ ABSL_GUARDED_BY(mu_) = false;
+
+  // Runs the schema changes. Started when the first one is enqueued.
+  std::thread schema_change_thread_ ABSL_GUARDED_BY(mu_);
 };
 
 }  // namespace frontend
@@ -33,11 +33,13 @@
 #include "backend/query/change_stream/change_stream_query_validator.h"
 #include "backend/query/query_engine.h"
 #include "backend/schema/catalog/schema.h"
+#include "backend/transaction/change_stream_notifier.h"
 #include "common/clock.h"
 #include "common/errors.h"
 #include "frontend/converters/change_streams.h"
 #include "frontend/converters/pg_change_streams.h"
 #include "frontend/converters/time.h"
+#include "frontend/entities/database.h"
 #include "frontend/entities/session.h"
 #include "frontend/entities/transaction.h"
 #include "frontend/server/handler.h"
@@ -137,17 +139,11 @@ absl::Status ChangeStreamsHandler::ProcessDataChangeRecordsAndStreamBack(
     const absl::Time scan_end, bool& expect_metadata,
     absl::Time* last_record_time,
     ServerStream<spanner_api::PartialResultSet>* stream) {
-  std::vector<spanner_api::PartialResultSet> responses;
   if (IsQueryResultEmpty(result) && expect_heartbeat) {
-    ZETASQL_ASSIGN_OR_RETURN(
-        responses,
-        metadata().is_pg
-            ? ConvertHeartbeatTimestampToJson(scan_end, metadata().tvf_name,
-                                              expect_metadata)
-            : ConvertHeartbeatTimestampToStruct(scan_end, expect_metadata));
-    expect_metadata = false;
-    *last_record_time = scan_end;
-  } else if (!IsQueryResultEmpty(result)) {
+    return SendHeartbeat(scan_end, expect_metadata, last_record_time, stream);
+  }
+  std::vector<spanner_api::PartialResultSet> responses;
+  if (!IsQueryResultEmpty(result)) {
     ZETASQL_ASSIGN_OR_RETURN(responses, metadata().is_pg
                                     ? ConvertDataTableRowCursorToJson(
                                           result.rows.get(),
@@ -163,6 +159,24 @@ absl::Status ChangeStreamsHandler::ProcessDataChangeRecordsAndStreamBack(
   return absl::OkStatus();
 }
 
+absl::Status ChangeStreamsHandler::SendHeartbeat(
+    absl::Time heartbeat_time, bool& expect_metadata,
+    absl::Time* last_record_time,
+    ServerStream<spanner_api::PartialResultSet>* stream) {
+  ZETASQL_ASSIGN_OR_RETURN(
+      std::vector<spanner_api::PartialResultSet> responses,
+      metadata().is_pg
+          ? ConvertHeartbeatTimestampToJson(heartbeat_time, metadata().tvf_name,
+                                            expect_metadata)
+          : ConvertHeartbeatTimestampToStruct(heartbeat_time, expect_metadata));
+  expect_metadata = false;
+  *last_record_time = heartbeat_time;
+  for (auto& response : responses) {
+    stream->Send(response);
+  }
+  return absl::OkStatus();
+}
+
 absl::Status ChangeStreamsHandler::ExecuteInitialQuery(
     std::shared_ptr<Session> session,
     ServerStream<spanner_api::PartialResultSet>* stream) {
@@ -309,7 +323,30 @@ absl::Status ChangeStreamsHandler::ExecutePartitionQuery(
   // Metadata is only expected for the first response to users in a single
   // query's lifetime.
   bool expect_metadata = true;
+  // Subscribe to the commits to the partition before its tables are first
+  // read, so that the commits after that read are all notified. The fake
+  // partition table used by tests is not written by commits, so it is polled.
+  std::unique_ptr<backend::ChangeStreamNotifier::Subscription> subscription;
+  if (!absl::GetFlag(
+          FLAGS_cloud_spanner_emulator_test_with_fake_partition_table)) {
+    subscription =
+        session->database()->backend()->change_stream_notifier()->Subscribe(
+            metadata().change_stream_name, metadata().partition_token.value());
+  }
+  bool first_scan = true;
   while (current_start <= tvf_end && current_start < partition_token_end_time) {
+    // Once the history of the partition has been read, wait for a commit to
+    // the partition or until a heartbeat is due instead of scanning every
+    // chopped interval.
+    if (subscription != nullptr && !first_scan) {
+      const absl::Time wait_deadline =
+          std::min({last_record_time + heartbeat_interval, tvf_end,
+                    partition_token_end_time});
+      current_end = std::max(
+          std::min({subscription->WaitForCommit(wait_deadline), tvf_end,
+                    partition_token_end_time}),
+          current_start);
+    }
     // For historical queries where tvf end is in the past, set the read
     // transaction snapshot time to now to prevent >1h stale read, which is now
     // allowed.
@@ -323,11 +360,17 @@ absl::Status ChangeStreamsHandler::ExecutePartitionQuery(
     spanner_api::TransactionOptions txn_options;
     // If the partition token hasn't been churned yet, we re-scan the partition
     // table to see if the end time has been churned and update the partition
-    // end time.
-    if (partition_token_end_time == absl::InfiniteFuture()) {
+    // end time. With a subscription, this is only done once a commit may have
+    // churned the partitions.
+    if (partition_token_end_time == absl::InfiniteFuture() &&
+        (subscription == nullptr || first_scan ||
+         subscription->MayHaveChangedPartitions())) {
       ZETASQL_ASSIGN_OR_RETURN(
           partition_token_end_time,
           TryGetPartitionTokenEndTime(session, current_txn_snapshot_time));
+      if (subscription != nullptr) {
+        subscription->MarkPartitionsRead(current_txn_snapshot_time);
+      }
     }
     ZETASQL_RETURN_IF_ERROR(ValidateTokenInRetentionWindow(
         metadata().start_timestamp, current_start, partition_token_end_time,
@@ -344,13 +387,26 @@ absl::Status ChangeStreamsHandler::ExecutePartitionQuery(
                      session->CreateSingleUseTransaction(txn_options));
     absl::Status status =
         txn->GuardedCall(Transaction::OpType::kSql, [&]() -> absl::Status {
-          backend::Query read_data_query =
-              ConstructDataTablePartitionQuery(current_start, scan_end);
-          ZETASQL_ASSIGN_OR_RETURN(auto data_records_results,
-                           txn->ExecuteSql(read_data_query));
-          ZETASQL_RETURN_IF_ERROR(ProcessDataChangeRecordsAndStreamBack(
-              data_records_results, expect_heartbeat, scan_end, expect_metadata,
-              &last_record_time, stream));
+          // Reading the schema waits for the transactions committing before
+          // the snapshot, which have published their change stream writes by
+          // then.
+          txn->schema();
+          if (subscription == nullptr ||
+              subscription->MayHaveRecords(current_start, scan_end)) {
+            backend::Query read_data_query =
+                ConstructDataTablePartitionQuery(current_start, scan_end);
+            ZETASQL_ASSIGN_OR_RETURN(auto data_records_results,
+                             txn->ExecuteSql(read_data_query));
+            ZETASQL_RETURN_IF_ERROR(ProcessDataChangeRecordsAndStreamBack(
+                data_records_results, expect_heartbeat, scan_end,
+                expect_metadata, &last_record_time, stream));
+          } else if (expect_heartbeat) {
+            ZETASQL_RETURN_IF_ERROR(SendHeartbeat(scan_end, expect_metadata,
+                                          &last_record_time, stream));
+          }
+          if (subscription != nullptr) {
+            subscription->MarkRecordsRead(scan_end);
+          }
           if (partition_token_end_time <= current_end) {
             // Get child partition records after all data records are returned
             // in current query.
@@ -379,6 +435,7 @@ absl::Status ChangeStreamsHandler::ExecutePartitionQuery(
           return absl::OkStatus();
         });
     ZETASQL_RETURN_IF_ERROR(status);
+    first_scan = false;
     // Increment by 1 microsecond gap to avoid repetitive records.
     current_start = scan_end + absl::Microseconds(1);
     current_end = std::min(
@@ -91,6 +91,12 @@ class ChangeStreamsHandler {
   }
 
  private:
+  // Streams back a heartbeat record at 'heartbeat_time'.
+  absl::Status SendHeartbeat(
+      absl::Time heartbeat_time, bool& expect_metadata,
+      absl::Time* last_record_time,
+      ServerStream<spanner_api::PartialResultSet>* stream);
+
   const backend::ChangeStreamQueryValidator::ChangeStreamMetadata& metadata_;
   std::string partition_table_;
 };
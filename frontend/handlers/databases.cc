@@ -203,47 +203,76 @@ absl::Status UpdateDatabaseDdl(
   for (const std::string& statement : request->statements()) {
     statements.push_back(statement);
   }
+  if (statements.empty()) {
+    return error::UpdateDatabaseMissingStatements();
+  }
 
+  // Statements which do not parse are rejected by the request itself, as only
+  // applying the statements runs in the background.
   backend::Database* backend_database = database->backend();
-  int num_succesful_statements;
-  absl::Time commit_timestamp;
-  absl::Status backfill_status;
-  ZETASQL_RETURN_IF_ERROR(backend_database->UpdateSchema(
-      backend::SchemaChangeOperation{
-          .statements = statements,
-          .proto_descriptor_bytes = request->proto_descriptors(),
-          .database_dialect = backend_database->dialect()},
-      &num_succesful_statements, &commit_timestamp, &backfill_status));
-
-  // Populate ResultSet metadata.
-  // For simplicity in emulator, we have implemented the schema updates in such
-  // a way that all the statements in update ddl execute at the same commit
-  // timestamp.
+  for (const std::string& statement : statements) {
+    ZETASQL_RETURN_IF_ERROR(
+        backend::ParseDDLByDialect(statement, backend_database->dialect())
+            .status());
+  }
+
+  // Populate ResultSet metadata. The commit timestamps are added once the
+  // statements are applied.
   database_api::UpdateDatabaseDdlMetadata update_md;
   update_md.set_database(request->database());
   for (const std::string& statement : statements) {
     update_md.add_statements(statement);
   }
 
-  // Only the timestamps of the successful statements are reported.
-  for (int i = 0; i < num_succesful_statements; ++i) {
-    ZETASQL_ASSIGN_OR_RETURN(*update_md.add_commit_timestamps(),
-                     TimestampToProto(commit_timestamp));
-  }
-
   // Create operation to be returned as part of the response.
   // A user-supplied operation_id would have already been validated above.
   ZETASQL_ASSIGN_OR_RETURN(std::shared_ptr<Operation> operation,
                    ctx->env()->operation_manager()->CreateOperation(
                        request->database(), request->operation_id()));
   operation->SetMetadata(update_md);
-  if (backfill_status.ok()) {
-    operation->SetResponse(protobuf_api::Empty());
-  } else {
-    operation->SetError(backfill_status);
-  }
   operation->ToProto(response);
 
+  // The schema change runs in the background, and completes the operation
+  // when it is done, so that backfills do not block the request.
+  database->EnqueueSchemaChange(
+      [backend_database, operation, update_md = std::move(update_md),
+       statements = std::move(statements),
+       proto_descriptors = request->proto_descriptors()]() mutable {
+        int num_succesful_statements;
+        absl::Time commit_timestamp;
+        absl::Status backfill_status;
+        absl::Status status = backend_database->UpdateSchema(
+            backend::SchemaChangeOperation{
+                .statements = statements,
+                .proto_descriptor_bytes = proto_descriptors,
+                .database_dialect = backend_database->dialect()},
+            &num_succesful_statements, &commit_timestamp, &backfill_status);
+        if (!status.ok()) {
+          operation->SetError(status);
+          return;
+        }
+
+        // For simplicity in emulator, we have implemented the schema updates
+        // in such a way that all the statements in update ddl execute at the
+        // same commit timestamp. Only the timestamps of the successful
+        // statements are reported.
+        absl::StatusOr<protobuf_api::Timestamp> commit_timestamp_proto =
+            TimestampToProto(commit_timestamp);
+        if (!commit_timestamp_proto.ok()) {
+          operation->SetError(commit_timestamp_proto.status());
+          return;
+        }
+        for (int i = 0; i < num_succesful_statements; ++i) {
+          *update_md.add_commit_timestamps() = *commit_timestamp_proto;
+        }
+        operation->SetMetadata(update_md);
+        if (backfill_status.ok()) {
+          operation->SetResponse(protobuf_api::Empty());
+        } else {
+          operation->SetError(backfill_status);
+        }
+      });
+
   return absl::OkStatus();
 }
 REGISTER_GRPC_HANDLER(DatabaseAdmin, UpdateDatabaseDdl);
@@ -414,6 +414,28 @@ TEST_F(DatabaseApiTest, UpdateDatabaseDdlPartialSuccess) {
   }
 }
 
+TEST_F(DatabaseApiTest, UpdateDatabaseDdlRejectsSyntaxErrors) {
+  ZETASQL_EXPECT_OK(CreateTestDatabase());
+
+  // The syntax error is returned by the request rather than by the operation,
+  // and no statement is applied.
+  grpc::ClientContext context;
+  database_api::UpdateDatabaseDdlRequest request;
+  request.set_database(test_database_uri_);
+  request.add_statements(
+      "CREATE TABLE another_table (int64_col INT64) PRIMARY KEY (int64_col)");
+  request.add_statements("CREATE TABL invalid_table");
+  operations_api::Operation operation;
+  absl::Status status = test_env()->database_admin_client()->UpdateDatabaseDdl(
+      &context, request, &operation);
+  EXPECT_THAT(status, StatusIs(absl::StatusCode::kInvalidArgument));
+
+  database_api::GetDatabaseDdlResponse response;
+  ZETASQL_ASSERT_OK(GetDatabaseDdl(test_database_uri_, &response));
+  EXPECT_THAT(response.statements(), testing::Not(testing::Contains(
+                                         testing::HasSubstr("another_table"))));
+}
+
 TEST_F(DatabaseApiTest, GetDatabaseNonExistentDatabase) {
   database_api::Database database;
   EXPECT_THAT(GetDatabase(test_database_uri_, &database),
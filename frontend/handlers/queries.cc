@@ -14,6 +14,7 @@
 // limitations under the License.
 //
 
+#include <cstdint>
 #include <memory>
 #include <optional>
 #include <string>
@@ -30,6 +31,7 @@
 #include "absl/status/status.h"
 #include "absl/status/statusor.h"
 #include "absl/strings/cord.h"
+#include "absl/time/time.h"
 #include "absl/types/optional.h"
 #include "absl/types/variant.h"
 #include "backend/access/read.h"
@@ -37,8 +39,10 @@
 #include "backend/query/query_engine.h"
 #include "common/constants.h"
 #include "common/errors.h"
+#include "common/limits.h"
 #include "frontend/common/protos.h"
 #include "frontend/common/validations.h"
+#include "frontend/converters/chunking.h"
 #include "frontend/converters/partition.h"
 #include "frontend/converters/query.h"
 #include "frontend/converters/reads.h"
@@ -48,6 +52,7 @@
 #include "frontend/entities/transaction.h"
 #include "frontend/handlers/change_streams.h"
 #include "frontend/proto/partition_token.pb.h"
+#include "frontend/proto/resume_token.pb.h"
 #include "frontend/server/handler.h"
 #include "frontend/server/request_context.h"
 #include "farmhash.h"
@@ -156,6 +161,15 @@ void AddEmptyQueryPlan(v1::ResultSetStats* stats) {
   node->set_kind(v1::PlanNode::KIND_UNSPECIFIED);
 }
 
+void AddQueryPlanFromQueryResult(const backend::QueryResult& result,
+                                 v1::ResultSetStats* stats) {
+  if (result.query_plan.plan_nodes().empty()) {
+    AddEmptyQueryPlan(stats);
+    return;
+  }
+  *stats->mutable_query_plan() = result.query_plan;
+}
+
 absl::Status AddUndeclaredParametersFromQueryResult(
     zetasql::QueryParametersMap* cursor, v1::ResultSetMetadata* metadata_pb) {
   for (auto const& param : *cursor) {
@@ -350,18 +364,17 @@ absl::Status ExecuteSql(RequestContext* ctx,
           }
         }
 
-        // Add basic stats for PROFILE mode. We do this to interoperate with
-        // REPL applications written for Cloud Spanner. The profile will not
-        // contain statistics for plan nodes.
+        // Add basic stats for PROFILE mode. The runtime statistics of the plan
+        // nodes are part of the query plan.
         if (request->query_mode() == spanner_api::ExecuteSqlRequest::PROFILE) {
           AddQueryStatsFromQueryResult(
               result, response->mutable_stats()->mutable_query_stats());
         }
-        // Add an empty query plan if the user requested either PLAN or PROFILE
+        // Add the query plan if the user requested either PLAN or PROFILE
         // query mode.
         if (request->query_mode() == spanner_api::ExecuteSqlRequest::PLAN ||
             request->query_mode() == spanner_api::ExecuteSqlRequest::PROFILE) {
-          AddEmptyQueryPlan(response->mutable_stats());
+          AddQueryPlanFromQueryResult(result, response->mutable_stats());
         }
 
         if (is_dml_query) {
@@ -372,11 +385,13 @@ absl::Status ExecuteSql(RequestContext* ctx,
 }
 REGISTER_GRPC_HANDLER(Spanner, ExecuteSql);
 
-// Executes a SQL statement, returning all results as a stream.
-//
-// resume_tokens is not supported in the emulator. This implementation does not
-// limit the size of the response and therefore, chunked_value will always be
-// false.
+// Executes a SQL statement, returning all results as a stream. Rows are sent as
+// they are produced, in chunks of at most the streaming chunk size. Chunks of
+// the rows of a query whose ORDER BY fixes the order of all its rows, and which
+// end between rows, carry a resume token with which the client can continue the
+// query after an interrupted stream. The rows of other queries and the results
+// of DML are not resumable; DML requests are instead replayed by sequence
+// number.
 absl::Status ExecuteStreamingSql(
     RequestContext* ctx, const spanner_api::ExecuteSqlRequest* request,
     ServerStream<spanner_api::PartialResultSet>* stream) {
@@ -393,8 +408,26 @@ absl::Status ExecuteStreamingSql(
 
   ZETASQL_RETURN_IF_ERROR(ValidateTransactionSelectorForQuery(request->transaction(),
                                                       is_dml_query));
+
+  // A query which resumes a stream continues it at the same read timestamp.
+  // Change stream queries return resume tokens of their own, so an invalid
+  // token is only reported once the query is known not to be one.
+  int64_t request_fingerprint = ResumeTokenFingerprint(*request);
+  std::optional<ResumeToken> resume_from;
+  absl::Status resume_token_status;
+  spanner_api::TransactionSelector selector = request->transaction();
+  if (!is_dml_query && !request->resume_token().empty()) {
+    absl::StatusOr<ResumeToken> resume_token =
+        ResumeTokenFromString(request->resume_token(), request_fingerprint);
+    if (resume_token.ok()) {
+      resume_from = *std::move(resume_token);
+      selector = ResumedTransactionSelector(selector, *resume_from);
+    } else {
+      resume_token_status = resume_token.status();
+    }
+  }
   ZETASQL_ASSIGN_OR_RETURN(std::shared_ptr<Transaction> txn,
-                   session->FindOrInitTransaction(request->transaction()));
+                   session->FindOrInitTransaction(selector));
   ZETASQL_RETURN_IF_ERROR(
       ValidateDirectedReadsOption(request->directed_read_options(), txn));
 
@@ -443,13 +476,14 @@ absl::Status ExecuteStreamingSql(
           }
           return error::CannotReadOrQueryAfterCommitOrRollback();
         }
+        std::optional<absl::Time> read_timestamp;
         if (txn->IsReadOnly()) {
           if (is_dml_query) {
             return error::ReadOnlyTransactionDoesNotSupportDml("ReadOnly");
           }
-          ZETASQL_ASSIGN_OR_RETURN(absl::Time read_timestamp, txn->GetReadTimestamp());
+          ZETASQL_ASSIGN_OR_RETURN(read_timestamp, txn->GetReadTimestamp());
           ZETASQL_RETURN_IF_ERROR(ValidateReadTimestampNotTooFarInFuture(
-              read_timestamp, ctx->env()->clock()->Now()));
+              *read_timestamp, ctx->env()->clock()->Now()));
         }
         // Convert and execute provided SQL statement.
         ZETASQL_ASSIGN_OR_RETURN(const backend::Query query,
@@ -459,13 +493,20 @@ absl::Status ExecuteStreamingSql(
                                         txn->schema()->proto_bundle()));
         bool in_read_write_txn = txn->IsReadWrite() || txn->IsPartitionedDml();
         ZETASQL_ASSIGN_OR_RETURN(change_stream_metadata,
-                         backend::QueryEngine::TryGetChangeStreamMetadata(
+                         txn->query_engine()->TryGetChangeStreamMetadata(
                              query, txn->schema(), in_read_write_txn));
         // if current query is a change stream query, return and exit current
         // transaction lambda to avoid nested transaction call.
         if (change_stream_metadata.is_change_stream_query) {
           return absl::OkStatus();
         }
+        ZETASQL_RETURN_IF_ERROR(resume_token_status);
+        std::optional<ResumeToken> resume_token;
+        if (!is_dml_query) {
+          ZETASQL_ASSIGN_OR_RETURN(resume_token,
+                           MakeResumeToken(request_fingerprint, read_timestamp,
+                                           resume_from));
+        }
         auto maybe_result = txn->ExecuteSql(query, request->query_mode());
         if (!maybe_result.ok()) {
           absl::Status error = maybe_result.status();
@@ -484,75 +525,104 @@ absl::Status ExecuteStreamingSql(
         }
         backend::QueryResult& result = maybe_result.value();
 
-        std::vector<spanner_api::PartialResultSet> responses;
-        if (is_dml_query) {
-          responses.emplace_back();
-          if (result.rows == nullptr) {
-            // Set empty row type.
-            responses.back().mutable_metadata()->mutable_row_type();
-          } else {
-            // It contains DML THEN RETURN row results.
-            ZETASQL_ASSIGN_OR_RETURN(responses, RowCursorToPartialResultSetProtos(
-                                            result.rows.get(), /*limit=*/0));
-          }
-          if (txn->IsPartitionedDml()) {
-            responses.back().mutable_stats()->set_row_count_lower_bound(
-                result.modified_row_count);
-          } else {
-            responses.back().mutable_stats()->set_row_count_exact(
-                result.modified_row_count);
-          }
-        } else {
-          ZETASQL_ASSIGN_OR_RETURN(responses, RowCursorToPartialResultSetProtos(
-                                          result.rows.get(), /*limit=*/0));
-        }
-        if (session->multiplexed() && txn->IsReadWrite()) {
-          for (auto& response : responses) {
-            response.mutable_precommit_token();
+        // A stream is resumed by re-executing the query and skipping the rows
+        // which were already sent, so only queries which produce the same
+        // rows in the same order on every execution are resumable. The rows
+        // of other queries carry no resume token, and an interrupted stream
+        // of them is retried from the start.
+        if (resume_token.has_value() && !result.has_deterministic_row_order) {
+          if (resume_from.has_value()) {
+            if (ShouldReturnTransaction(request->transaction())) {
+              txn->Rollback().IgnoreError();
+            }
+            return error::InvalidResumeToken();
           }
+          resume_token.reset();
         }
 
+        // Partitions of queries which only return rows from a single partition
+        // return only the metadata of the result.
+        bool empty_query_partition = false;
         if (!request->partition_token().empty()) {
           ZETASQL_ASSIGN_OR_RETURN(
               auto partition_token,
               PartitionTokenFromString(request->partition_token()));
           ZETASQL_RETURN_IF_ERROR(ValidatePartitionToken(partition_token, request));
-          if (partition_token.empty_query_partition()) {
-            // Clear all partial responses except the first one. Return only
-            // metadata in the first partial response.
-            responses.resize(1);
-            responses.front().clear_values();
-            responses.front().clear_chunked_value();
-          }
+          empty_query_partition = partition_token.empty_query_partition();
         }
 
-        // Populate transaction metadata.
+        // The metadata goes in the first response. A DML statement without a
+        // THEN RETURN clause has an empty row type.
+        spanner_api::PartialResultSet first_response;
+        spanner_api::ResultSetMetadata* metadata =
+            first_response.mutable_metadata();
+        if (result.rows == nullptr) {
+          metadata->mutable_row_type();
+        } else {
+          ZETASQL_RETURN_IF_ERROR(
+              ResultSetMetadataToProto(result.rows.get(), metadata));
+        }
         if (ShouldReturnTransaction(request->transaction())) {
-          ZETASQL_ASSIGN_OR_RETURN(
-              *responses.front().mutable_metadata()->mutable_transaction(),
-              txn->ToProto());
+          ZETASQL_ASSIGN_OR_RETURN(*metadata->mutable_transaction(),
+                           txn->ToProto());
         }
         // Return query parameter types.
-        ZETASQL_RETURN_IF_ERROR(AddUndeclaredParametersFromQueryResult(
-            &result.parameter_types, responses.front().mutable_metadata()));
+        ZETASQL_RETURN_IF_ERROR(
+            AddUndeclaredParametersFromQueryResult(&result.parameter_types,
+                                                   metadata));
+        spanner_api::ResultSetMetadata dml_replay_metadata;
+        if (is_dml_query) {
+          dml_replay_metadata = *metadata;
+        }
+
+        // Rows are sent as they are read, one chunk at a time.
+        bool add_precommit_token =
+            session->multiplexed() && txn->IsReadWrite();
+        PartialResultSetChunker chunker(
+            limits::kMaxStreamingChunkSize, std::move(first_response),
+            [&](spanner_api::PartialResultSet response) {
+              if (add_precommit_token) {
+                response.mutable_precommit_token();
+              }
+              stream->Send(response);
+            });
+        if (result.rows != nullptr && !empty_query_partition) {
+          ZETASQL_RETURN_IF_ERROR(AddRowCursorToChunker(
+              result.rows.get(), /*limit=*/0, &chunker,
+              resume_token.has_value() ? &*resume_token : nullptr));
+        }
 
-        // Add basic stats for PROFILE mode. We do this to interoperate with
-        // REPL applications written for Cloud Spanner. The profile will not
-        // contain statistics for plan nodes.
+        // The stats of the result go in the last response.
+        spanner_api::PartialResultSet last_response = chunker.Finish();
+        if (add_precommit_token) {
+          last_response.mutable_precommit_token();
+        }
+        if (is_dml_query) {
+          if (txn->IsPartitionedDml()) {
+            last_response.mutable_stats()->set_row_count_lower_bound(
+                result.modified_row_count);
+          } else {
+            last_response.mutable_stats()->set_row_count_exact(
+                result.modified_row_count);
+          }
+        }
+
+        // Add basic stats for PROFILE mode. The runtime statistics of the plan
+        // nodes are part of the query plan.
         if (request->query_mode() == spanner_api::ExecuteSqlRequest::PROFILE) {
           AddQueryStatsFromQueryResult(
-              result, responses.front().mutable_stats()->mutable_query_stats());
+              result, last_response.mutable_stats()->mutable_query_stats());
         }
-
-        // Send results back to client.
-        for (const auto& response : responses) {
-          stream->Send(response);
+        if (request->query_mode() == spanner_api::ExecuteSqlRequest::PLAN ||
+            request->query_mode() == spanner_api::ExecuteSqlRequest::PROFILE) {
+          AddQueryPlanFromQueryResult(result, last_response.mutable_stats());
         }
+        stream->Send(last_response);
 
         if (is_dml_query) {
           spanner_api::ResultSet replay_result;
-          *replay_result.mutable_stats() = responses[0].stats();
-          *replay_result.mutable_metadata() = responses[0].metadata();
+          *replay_result.mutable_stats() = last_response.stats();
+          *replay_result.mutable_metadata() = std::move(dml_replay_metadata);
           txn->SetDmlReplayOutcome(replay_result);
         }
         return absl::OkStatus();
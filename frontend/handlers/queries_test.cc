@@ -33,6 +33,7 @@
 #include "common/errors.h"
 #include "frontend/converters/types.h"
 #include "frontend/converters/values.h"
+#include "tests/common/chunking.h"
 #include "tests/common/proto_matchers.h"
 #include "tests/common/test_env.h"
 #include "grpcpp/client_context.h"
@@ -159,6 +160,28 @@ class QueryApiTest : public test::ServerTest,
 
   SessionType GetSessionType() { return GetParam(); }
 
+  // Reads the stream of 'request' up to the first response which carries a
+  // resume token, and then cancels the rest of the stream.
+  std::vector<spanner_api::PartialResultSet>
+  ExecuteStreamingSqlUntilResumeToken(
+      const spanner_api::ExecuteSqlRequest& request) {
+    grpc::ClientContext ctx;
+    auto client_reader =
+        test_env()->spanner_client()->ExecuteStreamingSql(&ctx, request);
+    std::vector<spanner_api::PartialResultSet> responses;
+    spanner_api::PartialResultSet response;
+    while (client_reader->Read(&response)) {
+      responses.push_back(response);
+      if (!response.resume_token().empty()) {
+        break;
+      }
+    }
+    ctx.TryCancel();
+    // The stream ends with a CANCELLED status.
+    client_reader->Finish();
+    return responses;
+  }
+
   std::string test_session_uri_;
   std::string test_multiplexed_session_uri_;
 
@@ -508,7 +531,7 @@ TEST_P(QueryApiTest, ExecuteSqlWithDmlAndParameters) {
               }
             }
             stats {
-              query_plan { plan_nodes { display_name: "No query plan" } }
+              query_plan { plan_nodes { display_name: "Insert" } }
               row_count_exact: 0
             }
           )pb")));
@@ -566,7 +589,7 @@ TEST_P(QueryApiTest, ExecuteSqlWithDmlReturningAndParameters) {
               }
             }
             stats {
-              query_plan { plan_nodes { display_name: "No query plan" } }
+              query_plan { plan_nodes { display_name: "Insert" } }
               row_count_exact: 0
             }
           )pb")));
@@ -747,7 +770,7 @@ TEST_P(QueryApiTest, ExecuteSqlWithDmlReturningStar) {
               }
             }
             stats {
-              query_plan { plan_nodes { display_name: "No query plan" } }
+              query_plan { plan_nodes { display_name: "Delete" } }
               row_count_exact: 0
             }
           )pb")));
@@ -801,7 +824,7 @@ TEST_P(QueryApiTest, ExecuteSqlUpdateReturning) {
               }
             }
             stats {
-              query_plan { plan_nodes { display_name: "No query plan" } }
+              query_plan { plan_nodes { display_name: "Update" } }
               row_count_exact: 0
             }
           )pb")));
@@ -850,7 +873,7 @@ TEST_P(QueryApiTest, ExecuteSqlDmlPlanWithoutReturning) {
               }
             }
             stats {
-              query_plan { plan_nodes { display_name: "No query plan" } }
+              query_plan { plan_nodes { display_name: "Update" } }
               row_count_exact: 0
             }
           )pb")));
@@ -901,7 +924,7 @@ TEST_P(QueryApiTest, ExecuteSqlWithDmlAndProtoParameters) {
               }
             }
             stats {
-              query_plan { plan_nodes { display_name: "No query plan" } }
+              query_plan { plan_nodes { display_name: "Insert" } }
               row_count_exact: 0
             }
           )pb")));
@@ -945,6 +968,91 @@ TEST_P(QueryApiTest, ExecuteStreamingSql) {
                             )pb"))));
 }
 
+TEST_P(QueryApiTest, ExecuteStreamingSqlResumesOrderedQuery) {
+  // The rows span several chunks. The evaluator scrambles the order of the
+  // unnested values, but the ORDER BY fixes the order of all the rows.
+  spanner_api::ExecuteSqlRequest request = PARSE_TEXT_PROTO(
+      R"(
+        transaction { single_use { read_only { strong: true } } }
+        sql: "SELECT x, REPEAT('a', 100000) AS s "
+             "FROM UNNEST(GENERATE_ARRAY(1, 30)) AS x ORDER BY x, s"
+      )");
+  request.set_session(
+      GetSessionUri(GetSessionType() == SessionType::kMultiplexedSession));
+  std::vector<spanner_api::PartialResultSet> expected;
+  ZETASQL_ASSERT_OK(ExecuteStreamingSql(request, &expected));
+
+  // Break the stream after the first resume token, and resume it from there.
+  std::vector<spanner_api::PartialResultSet> interrupted =
+      ExecuteStreamingSqlUntilResumeToken(request);
+  ASSERT_FALSE(interrupted.empty());
+  ASSERT_FALSE(interrupted.back().resume_token().empty());
+  spanner_api::ExecuteSqlRequest resumed_request = request;
+  resumed_request.set_resume_token(interrupted.back().resume_token());
+  std::vector<spanner_api::PartialResultSet> resumed;
+  ZETASQL_ASSERT_OK(ExecuteStreamingSql(resumed_request, &resumed));
+
+  ZETASQL_ASSERT_OK_AND_ASSIGN(
+      spanner_api::ResultSet expected_result,
+      backend::test::MergePartialResultSets(expected, /*columns_per_row=*/2));
+  ZETASQL_ASSERT_OK_AND_ASSIGN(
+      spanner_api::ResultSet interrupted_result,
+      backend::test::MergePartialResultSets(interrupted,
+                                            /*columns_per_row=*/2));
+  ZETASQL_ASSERT_OK_AND_ASSIGN(
+      spanner_api::ResultSet resumed_result,
+      backend::test::MergePartialResultSets(resumed, /*columns_per_row=*/2));
+  EXPECT_EQ(expected_result.rows_size(), 30);
+  EXPECT_GT(interrupted_result.rows_size(), 0);
+  EXPECT_LT(interrupted_result.rows_size(), expected_result.rows_size());
+
+  // The resumed stream continues with the rows after the resume token.
+  spanner_api::ResultSet expected_rows;
+  *expected_rows.mutable_rows() = expected_result.rows();
+  spanner_api::ResultSet rows;
+  *rows.mutable_rows() = interrupted_result.rows();
+  rows.mutable_rows()->MergeFrom(resumed_result.rows());
+  EXPECT_THAT(rows, EqualsProto(expected_rows));
+}
+
+TEST_P(QueryApiTest, ExecuteStreamingSqlDoesNotResumeUnorderedQuery) {
+  // Re-executing the query may return its rows in another order, so the
+  // stream can only be retried from the start.
+  spanner_api::ExecuteSqlRequest request = PARSE_TEXT_PROTO(
+      R"(
+        transaction { single_use { read_only { strong: true } } }
+        sql: "SELECT x, REPEAT('a', 100000) AS s "
+             "FROM UNNEST(GENERATE_ARRAY(1, 30)) AS x"
+      )");
+  request.set_session(
+      GetSessionUri(GetSessionType() == SessionType::kMultiplexedSession));
+  std::vector<spanner_api::PartialResultSet> response;
+  ZETASQL_ASSERT_OK(ExecuteStreamingSql(request, &response));
+  EXPECT_GT(response.size(), 1);
+  for (const spanner_api::PartialResultSet& chunk : response) {
+    EXPECT_EQ(chunk.resume_token(), "");
+  }
+}
+
+TEST_P(QueryApiTest, ExecuteStreamingSqlDoesNotResumeQueryWithRandomValues) {
+  // The ORDER BY fixes the order of the rows, but RAND() returns new values
+  // on every execution.
+  spanner_api::ExecuteSqlRequest request = PARSE_TEXT_PROTO(
+      R"(
+        transaction { single_use { read_only { strong: true } } }
+        sql: "SELECT x, REPEAT('a', 100000) AS s, RAND() AS r "
+             "FROM UNNEST(GENERATE_ARRAY(1, 30)) AS x ORDER BY x, s, r"
+      )");
+  request.set_session(
+      GetSessionUri(GetSessionType() == SessionType::kMultiplexedSession));
+  std::vector<spanner_api::PartialResultSet> response;
+  ZETASQL_ASSERT_OK(ExecuteStreamingSql(request, &response));
+  EXPECT_GT(response.size(), 1);
+  for (const spanner_api::PartialResultSet& chunk : response) {
+    EXPECT_EQ(chunk.resume_token(), "");
+  }
+}
+
 TEST_P(QueryApiTest, ExecuteStreamingSqlWithParameters) {
   spanner_api::ExecuteSqlRequest request = PARSE_TEXT_PROTO(
       R"(
@@ -1104,6 +1212,12 @@ TEST_P(QueryApiTest, AcceptsPlanMode) {
     if (GetSessionType() == SessionType::kMultiplexedSession) {
       ASSERT_FALSE(response.has_precommit_token());
     }
+    EXPECT_THAT(response.stats(), Partially(EqualsProto(R"pb(
+                  query_plan {
+                    plan_nodes { display_name: "Serialize Result" }
+                    plan_nodes { display_name: "Scan" }
+                  }
+                )pb")));
   }
 
   // PLAN mode accepted in streaming case.
@@ -1114,6 +1228,13 @@ TEST_P(QueryApiTest, AcceptsPlanMode) {
     if (GetSessionType() == SessionType::kMultiplexedSession) {
       ASSERT_FALSE(response.back().has_precommit_token());
     }
+    ASSERT_FALSE(response.empty());
+    EXPECT_THAT(response.front().stats(), Partially(EqualsProto(R"pb(
+                  query_plan {
+                    plan_nodes { display_name: "Serialize Result" }
+                    plan_nodes { display_name: "Scan" }
+                  }
+                )pb")));
   }
 }
 
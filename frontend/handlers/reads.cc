@@ -16,17 +16,23 @@
 
 #include "frontend/converters/reads.h"
 
+#include <cstdint>
 #include <memory>
+#include <optional>
+#include <utility>
 
 #include "google/spanner/v1/result_set.pb.h"
 #include "google/spanner/v1/spanner.pb.h"
 #include "google/spanner/v1/transaction.pb.h"
+#include "absl/time/time.h"
 #include "backend/common/ids.h"
 #include "common/errors.h"
+#include "common/limits.h"
 #include "frontend/common/protos.h"
 #include "frontend/common/validations.h"
 #include "frontend/entities/session.h"
 #include "frontend/entities/transaction.h"
+#include "frontend/proto/resume_token.pb.h"
 #include "frontend/server/handler.h"
 #include "absl/status/status.h"
 #include "zetasql/base/status_macros.h"
@@ -127,9 +133,9 @@ REGISTER_GRPC_HANDLER(Spanner, Read);
 
 // Reads rows from the database, returning all results as a stream.
 //
-// StreamingReads do not support resume_tokens in the emulator. This
-// implementation does not limit the size of the response and therefore,
-// chunked_value will always be false.
+// Rows are sent as they are read, in chunks of at most the streaming chunk
+// size. Chunks which end between rows carry a resume token, with which the
+// client can continue the read after an interrupted stream.
 absl::Status StreamingRead(
     RequestContext* ctx, const spanner_api::ReadRequest* request,
     ServerStream<spanner_api::PartialResultSet>* stream) {
@@ -137,10 +143,21 @@ absl::Status StreamingRead(
   ZETASQL_ASSIGN_OR_RETURN(std::shared_ptr<Session> session,
                    GetSession(ctx, request->session()));
 
+  // A read which resumes a stream continues it at the same read timestamp.
+  int64_t request_fingerprint = ResumeTokenFingerprint(*request);
+  std::optional<ResumeToken> resume_from;
+  spanner_api::TransactionSelector selector = request->transaction();
+  if (!request->resume_token().empty()) {
+    ZETASQL_ASSIGN_OR_RETURN(
+        resume_from,
+        ResumeTokenFromString(request->resume_token(), request_fingerprint));
+    selector = ResumedTransactionSelector(selector, *resume_from);
+  }
+
   // Get underlying transaction.
   ZETASQL_RETURN_IF_ERROR(ValidateTransactionSelectorForRead(request->transaction()));
   ZETASQL_ASSIGN_OR_RETURN(std::shared_ptr<Transaction> txn,
-                   session->FindOrInitTransaction(request->transaction()));
+                   session->FindOrInitTransaction(selector));
   ZETASQL_RETURN_IF_ERROR(
       ValidateDirectedReadsOption(request->directed_read_options(), txn));
 
@@ -153,11 +170,15 @@ absl::Status StreamingRead(
     if (txn->IsCommitted() || txn->IsRolledback()) {
       return error::CannotReadOrQueryAfterCommitOrRollback();
     }
+    std::optional<absl::Time> read_timestamp;
     if (txn->IsReadOnly()) {
-      ZETASQL_ASSIGN_OR_RETURN(absl::Time read_timestamp, txn->GetReadTimestamp());
+      ZETASQL_ASSIGN_OR_RETURN(read_timestamp, txn->GetReadTimestamp());
       ZETASQL_RETURN_IF_ERROR(ValidateReadTimestampNotTooFarInFuture(
-          read_timestamp, ctx->env()->clock()->Now()));
+          *read_timestamp, ctx->env()->clock()->Now()));
     }
+    ZETASQL_ASSIGN_OR_RETURN(
+        ResumeToken resume_token,
+        MakeResumeToken(request_fingerprint, read_timestamp, resume_from));
 
     // Parse read request.
     backend::ReadArg read_arg;
@@ -176,28 +197,33 @@ absl::Status StreamingRead(
       return read_status;
     }
 
-    // Convert read results to protos.
-    ZETASQL_ASSIGN_OR_RETURN(
-        std::vector<spanner_api::PartialResultSet> responses,
-        RowCursorToPartialResultSetProtos(cursor.get(), request->limit()));
+    // The metadata goes in the first response.
+    spanner_api::PartialResultSet first_response;
+    ZETASQL_RETURN_IF_ERROR(ResultSetMetadataToProto(
+        cursor.get(), first_response.mutable_metadata()));
 
     // Populate transaction metadata.
     if (ShouldReturnTransaction(request->transaction())) {
       ZETASQL_ASSIGN_OR_RETURN(
-          *responses.front().mutable_metadata()->mutable_transaction(),
+          *first_response.mutable_metadata()->mutable_transaction(),
           txn->ToProto());
     }
-    // Set an empty precommit token for multiplexed read-write transactions.
-    if (session->multiplexed() && txn->IsReadWrite()) {
-      for (auto& response : responses) {
+
+    // Convert read results to protos and send them back to the client as they
+    // are read. Set an empty precommit token for multiplexed read-write
+    // transactions.
+    bool add_precommit_token = session->multiplexed() && txn->IsReadWrite();
+    auto send = [&](spanner_api::PartialResultSet response) {
+      if (add_precommit_token) {
         response.mutable_precommit_token();
       }
-    }
-
-    // Send results back to client.
-    for (const auto& response : responses) {
       stream->Send(response);
-    }
+    };
+    PartialResultSetChunker chunker(limits::kMaxStreamingChunkSize,
+                                    std::move(first_response), send);
+    ZETASQL_RETURN_IF_ERROR(AddRowCursorToChunker(
+        cursor.get(), request->limit(), &chunker, &resume_token));
+    send(chunker.Finish());
     return absl::OkStatus();
   });
 }
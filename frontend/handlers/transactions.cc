@@ -56,6 +56,11 @@ absl::Status BeginTransaction(
       std::shared_ptr<Transaction> txn,
       session->CreateMultiUseTransaction(
           request->options(), Session::TransactionActivation::kInitializeOnly));
+  if (txn->IsReadWrite() &&
+      !request->request_options().transaction_tag().empty()) {
+    txn->read_write()->set_transaction_tag(
+        request->request_options().transaction_tag());
+  }
 
   // Populate transaction proto in response.
   ZETASQL_ASSIGN_OR_RETURN(*response, txn->ToProto());
@@ -147,6 +152,12 @@ absl::Status Commit(RequestContext* ctx,
       return absl::OkStatus();
     }
 
+    // The tag of single-use transactions is set on the commit request.
+    if (!request->request_options().transaction_tag().empty()) {
+      txn->read_write()->set_transaction_tag(
+          request->request_options().transaction_tag());
+    }
+
     // Actually commit the request.
     ZETASQL_RETURN_IF_ERROR(txn->Commit());
 
@@ -52,6 +52,9 @@ type Options struct {
 	DisableQueryNullFilteredIndexCheck             bool
 	OverrideMaxDatabasesPerInstance                int
 	OverrideChangeStreamPartitionTokenAliveSeconds int
+	LockWaitTimeoutMs                              int
+	PreparedStatementCacheMaxBytes                 int64
+	MaxDatabaseMemoryBytes                         int64
 }
 
 // Gateway implements the emulator gateway server.
@@ -85,6 +88,13 @@ func (gw *Gateway) Run() {
 	emulatorArgs = append(emulatorArgs,
 		fmt.Sprintf("--override_change_stream_partition_token_alive_seconds=%d",
 			gw.opts.OverrideChangeStreamPartitionTokenAliveSeconds))
+	emulatorArgs = append(emulatorArgs,
+		fmt.Sprintf("--lock_wait_timeout_ms=%d", gw.opts.LockWaitTimeoutMs))
+	emulatorArgs = append(emulatorArgs,
+		fmt.Sprintf("--prepared_statement_cache_max_bytes=%d",
+			gw.opts.PreparedStatementCacheMaxBytes))
+	emulatorArgs = append(emulatorArgs,
+		fmt.Sprintf("--max_database_memory_bytes=%d", gw.opts.MaxDatabaseMemoryBytes))
 
 	cmd := exec.Command(gw.opts.FrontendBinary, emulatorArgs...)
 
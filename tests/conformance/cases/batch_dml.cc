@@ -181,7 +181,7 @@ TEST_P(BatchDmlTest, MixDmlAndBatchDmlInTransactionSucceeds) {
               IsOkAndHoldsRows({{1, "Levin", 27}, {2, "Mark", 27}}));
 }
 
-TEST_P(BatchDmlTest, ConcurrentTransactionWithBatchDmlNotAllowed) {
+TEST_P(BatchDmlTest, ConcurrentTransactionsWithBatchDmlOnDisjointRows) {
   auto current_probability = config::abort_current_transaction_probability();
   config::set_abort_current_transaction_probability(0);
 
@@ -195,34 +195,21 @@ TEST_P(BatchDmlTest, ConcurrentTransactionWithBatchDmlNotAllowed) {
   ZETASQL_ASSERT_OK(result);
   ZETASQL_ASSERT_OK(ToUtilStatus(result.value().status));
 
-  // Subsequent transactions will abort.
+  // Transactions writing different rows do not conflict.
   result = BatchDmlTransaction(
       txn2, {SqlStatement(
                 "INSERT INTO users(id, name, age) VALUES (2, 'Mark', 37)")});
   // The Status can come from the call Status or the `BatchDmlResult`
   auto status = !result.ok() ? result.status() : ToUtilStatus(result->status);
-  EXPECT_THAT(status, StatusIs(in_prod_env() ? absl::StatusCode::kOk
-                                             : absl::StatusCode::kAborted));
-  // Commit first transaction succeeds.
-  ZETASQL_EXPECT_OK(CommitTransaction(txn1, {}));
-
-  if (status.code() == absl::StatusCode::kAborted) {
-    // A real application should use the Transaction runner which restarts the
-    // transaction after ABORTED; we have to do it ourselves.
-    txn2 = MakeReadWriteTransaction(txn2);
-
-    // Subsequent txn2 can now make progress.
-    result = BatchDmlTransaction(
-        txn2, {SqlStatement(
-                  "INSERT INTO users(id, name, age) VALUES (2, 'Mark', 37)")});
-    // The Status can come from the call Status or the `BatchDmlResult`
-    auto status = !result.ok() ? result.status() : ToUtilStatus(result->status);
-    EXPECT_THAT(status, StatusIs(absl::StatusCode::kOk));
-  }
+  EXPECT_THAT(status, StatusIs(absl::StatusCode::kOk));
 
-  // Commit second transaction succeeds.
+  // Both transactions commit.
+  ZETASQL_EXPECT_OK(CommitTransaction(txn1, {}));
   ZETASQL_EXPECT_OK(CommitTransaction(txn2, {}));
 
+  EXPECT_THAT(ReadAll("users", {"id", "name", "age"}),
+              IsOkAndHoldsRows({{1, "Levin", 27}, {2, "Mark", 37}}));
+
   config::set_abort_current_transaction_probability(current_probability);
 }
 